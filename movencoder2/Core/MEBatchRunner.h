@@ -0,0 +1,129 @@
+//
+//  MEBatchRunner.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEBatchRunner.h
+ * @abstract Internal API - Run many transcode jobs in one process
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEBatchRunner runs a list of jobs with a bounded number of concurrent
+ * METranscoder exports. Each job is built lazily and serially by the builder
+ * block right before it starts, so option parsing does not need to be
+ * thread-safe and only running jobs hold an open movie. Process-wide setup
+ * (FFmpeg, logging) is shared by every job.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEBatchRunner_h
+#define MEBatchRunner_h
+
+@import Foundation;
+
+@class METranscoder;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+typedef NS_ENUM(NSInteger, MEBatchJobStatus) {
+    MEBatchJobStatusPending = 0,
+    MEBatchJobStatusRunning,
+    MEBatchJobStatusSucceeded,
+    MEBatchJobStatusFailed,
+    MEBatchJobStatusCancelled,
+    MEBatchJobStatusInvalid,        // builder rejected the job spec
+};
+
+/// Short label of a status (e.g. "ok", "failed")
+NSString* _Nonnull MEBatchJobStatusLabel(MEBatchJobStatus status);
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEBatchJob : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+- (instancetype)initWithIdentifier:(NSString*)identifier spec:(NSDictionary*)spec NS_DESIGNATED_INITIALIZER;
++ (instancetype)jobWithIdentifier:(NSString*)identifier spec:(NSDictionary*)spec;
+
+@property (nonatomic, readonly) NSString* identifier;
+@property (nonatomic, readonly) NSDictionary* spec;
+
+// updated by MEBatchRunner; atomic
+@property (readonly) MEBatchJobStatus status;
+@property (readonly, nullable) NSString* message;
+@property (readonly) CFAbsoluteTime elapsed;
+
+/// Run the export on the calling thread and update status, message and elapsed.
+- (void)runWithTranscoder:(METranscoder*)transcoder;
+
+/// Mark the job invalid; used when the job spec cannot be built.
+- (void)rejectWithReason:(nullable NSString*)reason;
+
+/// A pending job is marked cancelled; a running export is cancelled.
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Build the transcoder of a job; return nil and set *reason to reject the job.
+typedef METranscoder* _Nullable (^MEBatchJobBuilder)(MEBatchJob* job, NSString* _Nullable * _Nonnull reason);
+
+@interface MEBatchRunner : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param jobs Jobs in submission order
+ @param maxConcurrentJobs Number of exports running at once (at least 1)
+ @param builder Called serially on the runner queue right before each job starts
+ */
+- (instancetype)initWithJobs:(NSArray<MEBatchJob*>*)jobs
+           maxConcurrentJobs:(NSUInteger)maxConcurrentJobs
+                     builder:(MEBatchJobBuilder)builder NS_DESIGNATED_INITIALIZER;
++ (instancetype)batchRunnerWithJobs:(NSArray<MEBatchJob*>*)jobs
+                  maxConcurrentJobs:(NSUInteger)maxConcurrentJobs
+                            builder:(MEBatchJobBuilder)builder;
+
+@property (nonatomic, readonly) NSArray<MEBatchJob*>* jobs;
+@property (nonatomic, readonly) NSUInteger maxConcurrentJobs;
+
+/// Start running jobs; completion is called once on the main queue after the last job ends.
+- (void)startWithCompletion:(nullable dispatch_block_t)completion;
+
+/// Cancel running jobs; pending jobs are marked cancelled.
+- (void)cancel;
+
+@property (readonly, getter=isFinished) BOOL finished;  // atomic
+@property (readonly, getter=isCancelled) BOOL cancelled; // atomic
+
+/// Number of jobs with the status
+- (NSUInteger)countOfStatus:(MEBatchJobStatus)status;
+
+/// One line per job plus totals, for the exit summary
+- (NSString*)summary;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEBatchRunner_h */
@@ -0,0 +1,240 @@
+//
+//  MEBatchRunner.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MEBatchRunner.h"
+#import "METranscoder+Internal.h"
+#import "MESecureLogging.h"
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NSString* MEBatchJobStatusLabel(MEBatchJobStatus status)
+{
+    switch (status) {
+        case MEBatchJobStatusPending:   return @"pending";
+        case MEBatchJobStatusRunning:   return @"running";
+        case MEBatchJobStatusSucceeded: return @"ok";
+        case MEBatchJobStatusFailed:    return @"failed";
+        case MEBatchJobStatusCancelled: return @"cancelled";
+        case MEBatchJobStatusInvalid:   return @"invalid";
+    }
+    return @"unknown";
+}
+
+@interface MEBatchJob ()
+@property (readwrite) MEBatchJobStatus status;
+@property (readwrite, nullable) NSString* message;
+@property (readwrite) CFAbsoluteTime elapsed;
+@property (strong, nullable) METranscoder* transcoder; // atomic; set while running
+@end
+
+@implementation MEBatchJob
+
+- (instancetype)initWithIdentifier:(NSString*)identifier spec:(NSDictionary*)spec
+{
+    if (self = [super init]) {
+        _identifier = [identifier copy];
+        _spec = [spec copy];
+        _status = MEBatchJobStatusPending;
+    }
+    return self;
+}
+
++ (instancetype)jobWithIdentifier:(NSString*)identifier spec:(NSDictionary*)spec
+{
+    return [[self alloc] initWithIdentifier:identifier spec:spec];
+}
+
+- (void)runWithTranscoder:(METranscoder*)transcoder
+{
+    @synchronized (self) {
+        // cancel may have arrived while building
+        if (self.status != MEBatchJobStatusPending) return;
+        self.transcoder = transcoder;
+        self.status = MEBatchJobStatusRunning;
+    }
+    SecureLogf(@"[MEBatchJob] Job %@ started.", self.identifier);
+
+    CFAbsoluteTime t0 = CFAbsoluteTimeGetCurrent();
+    NSError* error = nil;
+    BOOL success = [transcoder exportCustomOnError:&error]; // blocking method call
+
+    @synchronized (self) {
+        self.elapsed = CFAbsoluteTimeGetCurrent() - t0;
+        self.transcoder = nil;
+        if (success) {
+            self.status = MEBatchJobStatusSucceeded;
+        } else if (transcoder.cancelled) {
+            self.status = MEBatchJobStatusCancelled;
+        } else {
+            NSError* finalError = transcoder.finalError ?: error;
+            self.status = MEBatchJobStatusFailed;
+            self.message = finalError.localizedDescription ?: @"Export failed.";
+        }
+    }
+    SecureLogf(@"[MEBatchJob] Job %@ %@ (%.2f sec).",
+               self.identifier, MEBatchJobStatusLabel(self.status), self.elapsed);
+}
+
+- (void)rejectWithReason:(NSString*)reason
+{
+    @synchronized (self) {
+        if (self.status != MEBatchJobStatusPending) return;
+        self.status = MEBatchJobStatusInvalid;
+        self.message = reason ?: @"Invalid job specification.";
+    }
+    SecureErrorLogf(@"[MEBatchJob] Job %@ rejected: %@", self.identifier, self.message);
+}
+
+- (void)cancel
+{
+    METranscoder* running = nil;
+    @synchronized (self) {
+        if (self.status == MEBatchJobStatusPending) {
+            self.status = MEBatchJobStatusCancelled;
+        } else if (self.status == MEBatchJobStatusRunning) {
+            running = self.transcoder;
+        }
+    }
+    [running cancelAsync];
+}
+
+@end
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MEBatchRunner ()
+@property (nonatomic, copy) MEBatchJobBuilder builder;
+@property (nonatomic, strong) dispatch_queue_t dispatchQueue;  // serial; builds and admits jobs
+@property (nonatomic, strong) dispatch_queue_t workQueue;      // concurrent; runs exports
+@property (nonatomic, strong) dispatch_semaphore_t slots;
+@property (nonatomic, strong) dispatch_group_t group;
+@property (readwrite, getter=isFinished) BOOL finished;
+@property (readwrite, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, assign) CFAbsoluteTime timeStamp0;
+@end
+
+@implementation MEBatchRunner
+
+- (instancetype)initWithJobs:(NSArray<MEBatchJob*>*)jobs
+           maxConcurrentJobs:(NSUInteger)maxConcurrentJobs
+                     builder:(MEBatchJobBuilder)builder
+{
+    if (self = [super init]) {
+        _jobs = [jobs copy];
+        _maxConcurrentJobs = MAX(maxConcurrentJobs, (NSUInteger)1);
+        _builder = [builder copy];
+        _dispatchQueue = dispatch_queue_create("MEBatchRunner.dispatch", DISPATCH_QUEUE_SERIAL);
+        _workQueue = dispatch_queue_create("MEBatchRunner.work", DISPATCH_QUEUE_CONCURRENT);
+        _slots = dispatch_semaphore_create((long)_maxConcurrentJobs);
+        _group = dispatch_group_create();
+    }
+    return self;
+}
+
++ (instancetype)batchRunnerWithJobs:(NSArray<MEBatchJob*>*)jobs
+                  maxConcurrentJobs:(NSUInteger)maxConcurrentJobs
+                            builder:(MEBatchJobBuilder)builder
+{
+    return [[self alloc] initWithJobs:jobs maxConcurrentJobs:maxConcurrentJobs builder:builder];
+}
+
+- (void)startWithCompletion:(dispatch_block_t)completion
+{
+    self.timeStamp0 = CFAbsoluteTimeGetCurrent();
+    SecureLogf(@"[MEBatchRunner] Starting %lu jobs (%lu concurrent).",
+              (unsigned long)self.jobs.count, (unsigned long)self.maxConcurrentJobs);
+
+    // The runner is retained by the blocks below until the last job ends
+    dispatch_group_enter(self.group);
+    dispatch_async(self.dispatchQueue, ^{
+        for (MEBatchJob* job in self.jobs) {
+            // Wait for a free slot before building, so only running jobs hold an open movie
+            dispatch_semaphore_wait(self.slots, DISPATCH_TIME_FOREVER);
+            if (![self admitJob:job]) {
+                dispatch_semaphore_signal(self.slots);
+            }
+        }
+        dispatch_group_leave(self.group);
+    });
+
+    dispatch_group_notify(self.group, dispatch_get_main_queue(), ^{
+        self.finished = YES;
+        if (completion) completion();
+    });
+}
+
+// Called on dispatchQueue; returns YES if the job was handed to workQueue
+- (BOOL)admitJob:(MEBatchJob*)job
+{
+    if (self.cancelled) {
+        [job cancel];
+        return NO;
+    }
+
+    NSString* reason = nil;
+    METranscoder* transcoder = self.builder(job, &reason);
+    if (!transcoder) {
+        [job rejectWithReason:reason];
+        return NO;
+    }
+
+    dispatch_group_enter(self.group);
+    dispatch_async(self.workQueue, ^{
+        [job runWithTranscoder:transcoder];
+        dispatch_semaphore_signal(self.slots);
+        dispatch_group_leave(self.group);
+    });
+    return YES;
+}
+
+- (void)cancel
+{
+    @synchronized (self) {
+        if (self.cancelled) return;
+        self.cancelled = YES;
+    }
+    for (MEBatchJob* job in self.jobs) {
+        [job cancel];
+    }
+}
+
+- (NSUInteger)countOfStatus:(MEBatchJobStatus)status
+{
+    NSUInteger count = 0;
+    for (MEBatchJob* job in self.jobs) {
+        if (job.status == status) count++;
+    }
+    return count;
+}
+
+- (NSString*)summary
+{
+    NSMutableString* text = [NSMutableString string];
+    for (MEBatchJob* job in self.jobs) {
+        [text appendFormat:@"%@\t%@\t%.2f sec", job.identifier, MEBatchJobStatusLabel(job.status), job.elapsed];
+        if (job.message) [text appendFormat:@"\t%@", job.message];
+        [text appendString:@"\n"];
+    }
+    CFAbsoluteTime elapsed = self.timeStamp0 > 0 ? CFAbsoluteTimeGetCurrent() - self.timeStamp0 : 0;
+    [text appendFormat:@"total %lu: ok %lu, failed %lu, invalid %lu, cancelled %lu (%.2f sec)",
+     (unsigned long)self.jobs.count,
+     (unsigned long)[self countOfStatus:MEBatchJobStatusSucceeded],
+     (unsigned long)[self countOfStatus:MEBatchJobStatusFailed],
+     (unsigned long)[self countOfStatus:MEBatchJobStatusInvalid],
+     (unsigned long)[self countOfStatus:MEBatchJobStatusCancelled],
+     elapsed];
+    return text;
+}
+
+@end
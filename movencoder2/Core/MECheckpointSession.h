@@ -0,0 +1,87 @@
+//
+//  MECheckpointSession.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MECheckpointSession.h
+ * @abstract Internal API - Resumable export in checkpointed parts
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MECheckpointSession splits the source into parts of about chunkDuration,
+ * with boundaries moved to the next video sync sample so every part starts on
+ * a source keyframe. Each part is a complete export into "<output>.parts/",
+ * so its GOPs are closed and the file is finalized when the part ends.
+ *
+ * After every part a manifest is written atomically with the last encoded
+ * PTS and a rate summary (bytes, seconds, bit rate) of each part. When the
+ * session starts again with the same input, arguments and chunk duration it
+ * skips finished parts and the reader starts at the first missing one. When
+ * all parts exist they are joined into the output without re-encoding
+ * (MEMovieAssembler.h) and the work directory is removed.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MECheckpointSession_h
+#define MECheckpointSession_h
+
+@import Foundation;
+@import CoreMedia;
+
+@class METranscoder;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Build the transcoder of one part; the session sets its startTime/endTime.
+typedef METranscoder* _Nullable (^MECheckpointPartBuilder)(NSURL* partURL);
+
+@interface MECheckpointSession : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param inputURL Source movie
+ @param outputURL Final movie; parts are kept next to it in "<output>.parts/"
+ @param chunkDuration Target part length in seconds
+ @param fingerprint Anything that changes the encoded result (i.e. arguments); a manifest
+        with another fingerprint is discarded
+ @param builder Called for each part that is not finished yet
+ */
+- (instancetype)initWithInputURL:(NSURL*)inputURL
+                       outputURL:(NSURL*)outputURL
+                   chunkDuration:(double)chunkDuration
+                     fingerprint:(NSArray<NSString*>*)fingerprint
+                         builder:(MECheckpointPartBuilder)builder NS_DESIGNATED_INITIALIZER;
++ (instancetype)sessionWithInputURL:(NSURL*)inputURL
+                          outputURL:(NSURL*)outputURL
+                      chunkDuration:(double)chunkDuration
+                        fingerprint:(NSArray<NSString*>*)fingerprint
+                            builder:(MECheckpointPartBuilder)builder;
+
+@property (nonatomic, readonly) NSURL* workDirectoryURL;
+@property (nonatomic, readonly) NSURL* manifestURL;
+
+/// Export missing parts and join them. Blocks the calling thread.
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Cancel the running part; finished parts are kept for the next run.
+- (void)cancel;
+
+@property (readonly, getter=isCancelled) BOOL cancelled;    // atomic
+@property (readonly) NSUInteger partCount;                  // atomic; 0 until planned
+@property (readonly) NSUInteger completedPartCount;         // atomic
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MECheckpointSession_h */
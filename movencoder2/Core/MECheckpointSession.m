@@ -0,0 +1,289 @@
+//
+//  MECheckpointSession.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr, userCanceledErr
+
+#import "MECheckpointSession.h"
+#import "MEMovieAssembler.h"
+#import "METranscoder+Internal.h"
+#import "MESecureLogging.h"
+
+static const NSInteger kManifestVersion = 1;
+static NSString* const kManifestName = @"manifest.json";
+
+static inline NSError* MECheckpointError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Checkpointed export failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+static NSDictionary* timeDictionary(CMTime time) {
+    return CFBridgingRelease(CMTimeCopyAsDictionary(time, kCFAllocatorDefault));
+}
+
+static CMTime timeFromDictionary(id object) {
+    if (![object isKindOfClass:[NSDictionary class]]) return kCMTimeInvalid;
+    return CMTimeMakeFromDictionary((__bridge CFDictionaryRef)object);
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MECheckpointSession ()
+@property (nonatomic, strong) NSURL* inputURL;
+@property (nonatomic, strong) NSURL* outputURL;
+@property (nonatomic, assign) double chunkDuration;
+@property (nonatomic, copy) NSArray<NSString*>* fingerprint;
+@property (nonatomic, copy) MECheckpointPartBuilder builder;
+@property (nonatomic, strong) NSMutableArray<NSDictionary*>* parts;    // finished parts, in order
+@property (strong, nullable) METranscoder* currentTranscoder;          // atomic
+@property (readwrite, getter=isCancelled) BOOL cancelled;
+@property (readwrite) NSUInteger partCount;
+@property (readwrite) NSUInteger completedPartCount;
+@end
+
+@implementation MECheckpointSession
+
+- (instancetype)initWithInputURL:(NSURL*)inputURL
+                       outputURL:(NSURL*)outputURL
+                   chunkDuration:(double)chunkDuration
+                     fingerprint:(NSArray<NSString*>*)fingerprint
+                         builder:(MECheckpointPartBuilder)builder
+{
+    if (self = [super init]) {
+        _inputURL = inputURL;
+        _outputURL = outputURL;
+        _chunkDuration = MAX(chunkDuration, 1.0);
+        _fingerprint = [fingerprint copy];
+        _builder = [builder copy];
+        _parts = [NSMutableArray array];
+        NSString* dirName = [outputURL.lastPathComponent stringByAppendingString:@".parts"];
+        _workDirectoryURL = [outputURL.URLByDeletingLastPathComponent URLByAppendingPathComponent:dirName isDirectory:YES];
+        _manifestURL = [_workDirectoryURL URLByAppendingPathComponent:kManifestName];
+    }
+    return self;
+}
+
++ (instancetype)sessionWithInputURL:(NSURL*)inputURL
+                          outputURL:(NSURL*)outputURL
+                      chunkDuration:(double)chunkDuration
+                        fingerprint:(NSArray<NSString*>*)fingerprint
+                            builder:(MECheckpointPartBuilder)builder
+{
+    return [[self alloc] initWithInputURL:inputURL outputURL:outputURL chunkDuration:chunkDuration
+                              fingerprint:fingerprint builder:builder];
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+    [self.currentTranscoder cancelAsync];
+}
+
+/* =================================================================================== */
+// MARK: - planning
+/* =================================================================================== */
+
+- (NSArray<NSValue*>*)planRanges
+{
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMovie* movie = [AVMovie movieWithURL:self.inputURL options:options];
+    CMTime duration = movie.duration;
+    if (!CMTIME_IS_NUMERIC(duration) || CMTIME_COMPARE_INLINE(duration, <=, kCMTimeZero)) return @[];
+    
+    AVMovieTrack* video = [movie tracksWithMediaType:AVMediaTypeVideo].firstObject;
+    CMTime chunk = CMTimeMakeWithSeconds(self.chunkDuration, MAX(movie.timescale, 600));
+    CMTime lastChunk = CMTimeMultiplyByFloat64(chunk, 1.5);   // no short tail part
+    NSMutableArray<NSValue*>* ranges = [NSMutableArray array];
+    CMTime start = kCMTimeZero;
+    while (CMTIME_COMPARE_INLINE(start, <, duration)) {
+        CMTime end = duration;
+        if (CMTIME_COMPARE_INLINE(CMTimeSubtract(duration, start), >, lastChunk)) {
+            end = [MEMovieAssembler syncTimeOfTrack:video atOrAfter:CMTimeAdd(start, chunk)];
+            if (!CMTIME_IS_VALID(end)) {
+                end = CMTimeAdd(start, chunk);
+            }
+            if (CMTIME_COMPARE_INLINE(end, <=, start) || CMTIME_COMPARE_INLINE(end, >, duration)) {
+                end = duration;
+            }
+        }
+        [ranges addObject:[NSValue valueWithCMTimeRange:CMTimeRangeFromTimeToTime(start, end)]];
+        start = end;
+    }
+    return ranges;
+}
+
+- (NSDictionary*)sourceDescription
+{
+    NSDictionary* attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:self.inputURL.path error:nil];
+    return @{@"input": self.inputURL.path,
+             @"size": @(attributes.fileSize),
+             @"modified": @((long long)floor(attributes.fileModificationDate.timeIntervalSince1970)),
+             @"args": self.fingerprint,
+             @"chunk": @(self.chunkDuration)};
+}
+
+- (NSURL*)partURLAtIndex:(NSUInteger)index
+{
+    NSString* name = [NSString stringWithFormat:@"part-%04lu.mov", (unsigned long)index];
+    return [self.workDirectoryURL URLByAppendingPathComponent:name];
+}
+
+// Keep the finished parts of a previous run which match the plan
+- (void)loadManifestWithSource:(NSDictionary*)source ranges:(NSArray<NSValue*>*)ranges
+{
+    [self.parts removeAllObjects];
+    NSData* data = [NSData dataWithContentsOfURL:self.manifestURL];
+    NSDictionary* manifest = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (![manifest isKindOfClass:[NSDictionary class]]) return;
+    
+    NSArray* listed = [manifest[@"parts"] isKindOfClass:[NSArray class]] ? manifest[@"parts"] : @[];
+    BOOL sameSource = [manifest[@"version"] isEqual:@(kManifestVersion)] && [manifest[@"source"] isEqual:source];
+    if (!sameSource) {
+        SecureLog(@"[MECheckpointSession] Checkpoint is from another input or settings; starting over.");
+    }
+    NSFileManager* fm = [NSFileManager defaultManager];
+    for (NSUInteger index = 0; index < listed.count; index++) {
+        NSDictionary* part = listed[index];
+        NSURL* url = [self partURLAtIndex:index];
+        BOOL valid = sameSource && index == self.parts.count && index < ranges.count &&
+                     [part isKindOfClass:[NSDictionary class]];
+        if (valid) {
+            CMTimeRange range = ranges[index].CMTimeRangeValue;
+            NSDictionary* attributes = [fm attributesOfItemAtPath:url.path error:nil];
+            valid = (CMTimeCompare(timeFromDictionary(part[@"start"]), range.start) == 0 &&
+                     CMTimeCompare(timeFromDictionary(part[@"end"]), CMTimeRangeGetEnd(range)) == 0 &&
+                     attributes && [part[@"bytes"] isEqual:@(attributes.fileSize)]);
+        }
+        if (valid) {
+            [self.parts addObject:part];
+        } else {
+            [fm removeItemAtURL:url error:nil];
+        }
+    }
+}
+
+- (BOOL)writeManifestWithSource:(NSDictionary*)source error:(NSError**)error
+{
+    NSMutableDictionary* manifest = [@{@"version": @(kManifestVersion),
+                                       @"source": source,
+                                       @"parts": self.parts} mutableCopy];
+    NSDictionary* last = self.parts.lastObject;
+    if (last) {
+        manifest[@"lastEncodedPTS"] = last[@"end"];
+    }
+    NSData* data = [NSJSONSerialization dataWithJSONObject:manifest
+                                                   options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys
+                                                     error:error];
+    return data && [data writeToURL:self.manifestURL options:NSDataWritingAtomic error:error];
+}
+
+/* =================================================================================== */
+// MARK: - running
+/* =================================================================================== */
+
+- (BOOL)runWithError:(NSError**)error
+{
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if (![fm createDirectoryAtURL:self.workDirectoryURL withIntermediateDirectories:NO attributes:nil error:nil] &&
+        ![fm fileExistsAtPath:self.workDirectoryURL.path]) {
+        if (error) *error = MECheckpointError(@"Cannot create the checkpoint directory.", paramErr);
+        return NO;
+    }
+    
+    NSArray<NSValue*>* ranges = [self planRanges];
+    if (ranges.count == 0) {
+        if (error) *error = MECheckpointError(@"Input movie has no duration.", paramErr);
+        return NO;
+    }
+    NSDictionary* source = [self sourceDescription];
+    [self loadManifestWithSource:source ranges:ranges];
+    self.partCount = ranges.count;
+    self.completedPartCount = self.parts.count;
+    
+    if (self.parts.count) {
+        double bytes = 0, seconds = 0;
+        for (NSDictionary* part in self.parts) {
+            bytes += [part[@"bytes"] doubleValue];
+            seconds += [part[@"seconds"] doubleValue];
+        }
+        SecureLogf(@"[MECheckpointSession] Resuming at part %lu/%lu from %.3f sec (%.0f kbps so far).",
+                   (unsigned long)self.parts.count + 1, (unsigned long)ranges.count,
+                   CMTimeGetSeconds(timeFromDictionary(self.parts.lastObject[@"end"])),
+                   seconds > 0 ? bytes * 8 / seconds / 1000 : 0);
+    }
+    
+    for (NSUInteger index = self.parts.count; index < ranges.count; index++) {
+        CMTimeRange range = ranges[index].CMTimeRangeValue;
+        NSURL* partURL = [self partURLAtIndex:index];
+        [fm removeItemAtURL:partURL error:nil];   // unfinished part of a killed run
+        
+        METranscoder* transcoder = self.builder(partURL);
+        if (!transcoder) {
+            if (error) *error = MECheckpointError(@"Cannot prepare a part.", paramErr);
+            return NO;
+        }
+        transcoder.startTime = range.start;
+        transcoder.endTime = CMTimeRangeGetEnd(range);
+        // Parts are joined by MEMovieAssembler, so moving their moov to the front is wasted I/O
+        transcoder.param[kMovieLayoutKey] = kMovieLayoutMoovAtEnd;
+        
+        self.currentTranscoder = transcoder;
+        NSError* partError = nil;
+        BOOL success = !self.cancelled && [transcoder exportCustomOnError:&partError]; // blocking method call
+        self.currentTranscoder = nil;
+        if (!success) {
+            if (self.cancelled) {
+                SecureLogf(@"[MECheckpointSession] Cancelled; %lu of %lu parts are kept in %@",
+                           (unsigned long)self.parts.count, (unsigned long)ranges.count, self.workDirectoryURL.path);
+                if (error) *error = MECheckpointError(@"Export was cancelled.", userCanceledErr);
+            } else if (error) {
+                *error = transcoder.finalError ?: partError ?: MECheckpointError(@"Part export failed.", paramErr);
+            }
+            return NO;
+        }
+        
+        NSDictionary* attributes = [fm attributesOfItemAtPath:partURL.path error:nil];
+        unsigned long long bytes = attributes.fileSize;
+        double seconds = CMTimeGetSeconds(range.duration);
+        [self.parts addObject:@{@"start": timeDictionary(range.start),
+                                @"end": timeDictionary(CMTimeRangeGetEnd(range)),
+                                @"bytes": @(bytes),
+                                @"seconds": @(seconds),
+                                @"bitRate": @(seconds > 0 ? (double)bytes * 8 / seconds : 0)}];
+        if (![self writeManifestWithSource:source error:error]) {
+            SecureErrorLogf(@"[MECheckpointSession] ERROR: Cannot write %@", self.manifestURL.path);
+            return NO;
+        }
+        self.completedPartCount = self.parts.count;
+        SecureLogf(@"[MECheckpointSession] Part %lu/%lu done at %.3f sec (%.0f kbps).",
+                   (unsigned long)self.parts.count, (unsigned long)ranges.count,
+                   CMTimeGetSeconds(CMTimeRangeGetEnd(range)), seconds > 0 ? bytes * 8 / seconds / 1000 : 0);
+    }
+    
+    NSMutableArray<NSURL*>* partURLs = [NSMutableArray array];
+    for (NSUInteger index = 0; index < ranges.count; index++) {
+        [partURLs addObject:[self partURLAtIndex:index]];
+    }
+    if (![MEMovieAssembler concatenateMovieURLs:partURLs toURL:self.outputURL error:error]) {
+        return NO;  // parts are kept; the next run only joins them again
+    }
+    
+    for (NSURL* url in partURLs) {
+        [fm removeItemAtURL:url error:nil];
+    }
+    [fm removeItemAtURL:self.manifestURL error:nil];
+    rmdir(self.workDirectoryURL.fileSystemRepresentation);  // only if nothing else was put there
+    return YES;
+}
+
+@end
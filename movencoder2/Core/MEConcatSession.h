@@ -0,0 +1,85 @@
+//
+//  MEConcatSession.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEConcatSession.h
+ * @abstract Internal API - Join clips by copying their compressed samples
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * The clips are appended back to back into one QuickTime movie. Each video and
+ * audio track of a clip goes into the same track of the output as the first
+ * clip, with its samples copied and its timestamps moved by the duration of the
+ * clips before it.
+ *
+ * Every clip is checked against the first one before anything is written:
+ * - H.264/HEVC video: the parameter sets (SPS/PPS, VPS/SPS/PPS) are read from
+ *   the sample descriptions in the same order createDescriptionH264/H265 build
+ *   them. Identical sets share a sample description. Different sets that decode
+ *   with the same setup (MEMovieAssembler) switch the sample description at the
+ *   junction.
+ * - Audio: format, sample rate, channels, bit depth and channel layout.
+ *
+ * A clip that fails the check is exported by METranscoder with the builder
+ * (kept in "<output>.concat/") and checked again; all other clips are copied.
+ * The track layout of video and audio must be the same for every clip.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEConcatSession_h
+#define MEConcatSession_h
+
+@import Foundation;
+
+@class METranscoder;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Build the transcoder that conforms inputURL into partURL.
+typedef METranscoder* _Nullable (^MEConcatPartBuilder)(NSURL* inputURL, NSURL* partURL);
+
+@interface MEConcatSession : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param inputURLs Clips in order; the first one is the reference format
+ @param outputURL Final movie
+ @param builder Called for each clip that does not match the first one
+ */
+- (instancetype)initWithInputURLs:(NSArray<NSURL*>*)inputURLs
+                        outputURL:(NSURL*)outputURL
+                          builder:(MEConcatPartBuilder)builder NS_DESIGNATED_INITIALIZER;
++ (instancetype)sessionWithInputURLs:(NSArray<NSURL*>*)inputURLs
+                           outputURL:(NSURL*)outputURL
+                             builder:(MEConcatPartBuilder)builder;
+
+@property (nonatomic, readonly) NSURL* workDirectoryURL;
+/// Copy tracks other than video and audio too (kCopyOtherMediaKey)
+@property (nonatomic, assign) BOOL copyOtherMedia;
+
+/// Export the joined movie. Blocks the calling thread.
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Cancel the running export.
+- (void)cancel;
+
+@property (readonly, getter=isCancelled) BOOL cancelled;    // atomic
+/// Number of clips that were re-encoded; valid after runWithError:
+@property (readonly) NSUInteger conformedClipCount;         // atomic
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEConcatSession_h */
@@ -0,0 +1,316 @@
+//
+//  MEConcatSession.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr, userCanceledErr
+
+#import "MEConcatSession.h"
+#import "MEMovieAssembler.h"
+#import "METranscoder+Internal.h"
+#import "MECodecUtils.h"
+#import "MESecureLogging.h"
+
+static inline NSError* MEConcatError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Concatenation failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+// Tracks whose layout must match across clips; other media follow with copyOtherMedia
+static NSArray<AVMediaType>* checkedMediaTypes(void) {
+    return @[AVMediaTypeVideo, AVMediaTypeAudio];
+}
+
+/// nil when the audio of format can follow the audio of reference in one track
+static NSString* _Nullable audioIncompatibility(CMAudioFormatDescriptionRef format, CMAudioFormatDescriptionRef reference) {
+    const AudioStreamBasicDescription* asbdR = CMAudioFormatDescriptionGetStreamBasicDescription(reference);
+    const AudioStreamBasicDescription* asbdF = CMAudioFormatDescriptionGetStreamBasicDescription(format);
+    if (!asbdR || !asbdF) return @"audio format";
+    if (asbdR->mFormatID != asbdF->mFormatID || asbdR->mFormatFlags != asbdF->mFormatFlags) return @"audio format";
+    if (asbdR->mSampleRate != asbdF->mSampleRate) return @"sample rate";
+    if (asbdR->mChannelsPerFrame != asbdF->mChannelsPerFrame) return @"channel count";
+    if (asbdR->mBitsPerChannel != asbdF->mBitsPerChannel || asbdR->mFramesPerPacket != asbdF->mFramesPerPacket) {
+        return @"audio packet format";
+    }
+    size_t sizeR = 0, sizeF = 0;
+    const AudioChannelLayout* layoutR = CMAudioFormatDescriptionGetChannelLayout(reference, &sizeR);
+    const AudioChannelLayout* layoutF = CMAudioFormatDescriptionGetChannelLayout(format, &sizeF);
+    if (layoutR && layoutF && (sizeR != sizeF || memcmp(layoutR, layoutF, sizeR) != 0)) return @"channel layout";
+    return nil;
+}
+
+/// nil when the video of format can follow the video of reference in one track
+static NSString* _Nullable videoIncompatibility(CMVideoFormatDescriptionRef format, CMVideoFormatDescriptionRef reference) {
+    if (parameterSetsOfDescription(reference)) {
+        return [MEMovieAssembler incompatibilityOfVideoFormat:format withFormat:reference];
+    }
+    // other codecs carry no parameter sets; the sample descriptions must be the same
+    NSArray* ignoredKeys = @[(__bridge NSString*)kCMFormatDescriptionExtension_VerbatimSampleDescription,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_VerbatimISOSampleEntry,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_FormatName,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_Vendor,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_Version,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_RevisionLevel,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_TemporalQuality,
+                             (__bridge NSString*)kCMFormatDescriptionExtension_SpatialQuality];
+    if (!CMFormatDescriptionEqualIgnoringExtensionKeys(reference, format, (__bridge CFArrayRef)ignoredKeys, NULL)) {
+        return @"video format";
+    }
+    return nil;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MEConcatSession ()
+@property (nonatomic, strong) NSArray<NSURL*>* inputURLs;
+@property (nonatomic, strong) NSURL* outputURL;
+@property (nonatomic, copy) MEConcatPartBuilder builder;
+@property (strong, nullable) METranscoder* currentTranscoder;          // atomic
+@property (readwrite, getter=isCancelled) BOOL cancelled;
+@property (readwrite) NSUInteger conformedClipCount;
+@end
+
+@implementation MEConcatSession
+
+- (instancetype)initWithInputURLs:(NSArray<NSURL*>*)inputURLs
+                        outputURL:(NSURL*)outputURL
+                          builder:(MEConcatPartBuilder)builder
+{
+    if (self = [super init]) {
+        _inputURLs = [inputURLs copy];
+        _outputURL = outputURL;
+        _builder = [builder copy];
+        NSString* dirName = [outputURL.lastPathComponent stringByAppendingString:@".concat"];
+        _workDirectoryURL = [outputURL.URLByDeletingLastPathComponent URLByAppendingPathComponent:dirName isDirectory:YES];
+    }
+    return self;
+}
+
++ (instancetype)sessionWithInputURLs:(NSArray<NSURL*>*)inputURLs
+                           outputURL:(NSURL*)outputURL
+                             builder:(MEConcatPartBuilder)builder
+{
+    return [[self alloc] initWithInputURLs:inputURLs outputURL:outputURL builder:builder];
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+    [self.currentTranscoder cancelAsync];
+}
+
+/* =================================================================================== */
+// MARK: - checking
+/* =================================================================================== */
+
+/// nil if every video and audio sample of clip can be copied into the tracks of reference
+- (nullable NSString*)incompatibilityOfClip:(AVMovie*)clip withReference:(AVMovie*)reference
+{
+    for (AVMediaType type in checkedMediaTypes()) {
+        NSArray<AVMovieTrack*>* refTracks = [reference tracksWithMediaType:type];
+        NSArray<AVMovieTrack*>* tracks = [clip tracksWithMediaType:type];
+        if (tracks.count != refTracks.count) return @"track layout";
+        for (NSUInteger index = 0; index < tracks.count; index++) {
+            CMFormatDescriptionRef refDesc = (__bridge CMFormatDescriptionRef)refTracks[index].formatDescriptions.firstObject;
+            if (!refDesc) return @"sample description";
+            for (id item in tracks[index].formatDescriptions) {
+                CMFormatDescriptionRef desc = (__bridge CMFormatDescriptionRef)item;
+                NSString* mismatch = [type isEqualToString:AVMediaTypeVideo]
+                                   ? videoIncompatibility(desc, refDesc) : audioIncompatibility(desc, refDesc);
+                if (mismatch) return mismatch;
+            }
+        }
+    }
+    return nil;
+}
+
+/// Log where the output video switches to another set of SPS/PPS (VPS) without re-encoding
+- (void)logParameterSetChangeOfClip:(AVMovie*)clip withReference:(AVMovie*)reference index:(NSUInteger)index
+{
+    CMFormatDescriptionRef refDesc = (__bridge CMFormatDescriptionRef)
+        [reference tracksWithMediaType:AVMediaTypeVideo].firstObject.formatDescriptions.firstObject;
+    NSArray<NSData*>* refSets = refDesc ? parameterSetsOfDescription(refDesc) : nil;
+    if (!refSets) return;
+    for (id item in [clip tracksWithMediaType:AVMediaTypeVideo].firstObject.formatDescriptions) {
+        NSArray<NSData*>* sets = parameterSetsOfDescription((__bridge CMFormatDescriptionRef)item);
+        if (![sets isEqualToArray:refSets]) {
+            SecureLogf(@"[MEConcatSession] Clip %lu has other parameter sets; a sample description is added at its junction.",
+                       (unsigned long)index);
+            return;
+        }
+    }
+}
+
+/* =================================================================================== */
+// MARK: - running
+/* =================================================================================== */
+
+- (nullable AVMovie*)conformClipAtURL:(NSURL*)inputURL index:(NSUInteger)index error:(NSError**)error
+{
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if (![fm createDirectoryAtURL:self.workDirectoryURL withIntermediateDirectories:YES attributes:nil error:nil]) {
+        if (error) *error = MEConcatError(@"Cannot create the work directory.", paramErr);
+        return nil;
+    }
+    NSString* name = [NSString stringWithFormat:@"clip-%03lu.mov", (unsigned long)index];
+    NSURL* partURL = [self.workDirectoryURL URLByAppendingPathComponent:name];
+    [fm removeItemAtURL:partURL error:nil];
+    METranscoder* transcoder = self.builder(inputURL, partURL);
+    if (!transcoder) {
+        if (error) *error = MEConcatError(@"Cannot prepare a part.", paramErr);
+        return nil;
+    }
+
+    self.currentTranscoder = transcoder;
+    NSError* partError = nil;
+    BOOL success = !self.cancelled && [transcoder exportCustomOnError:&partError]; // blocking method call
+    self.currentTranscoder = nil;
+    if (!success) {
+        if (self.cancelled) {
+            if (error) *error = MEConcatError(@"Export was cancelled.", userCanceledErr);
+        } else if (error) {
+            *error = transcoder.finalError ?: partError ?: MEConcatError(@"Part export failed.", paramErr);
+        }
+        return nil;
+    }
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    return [AVMovie movieWithURL:partURL options:options];
+}
+
+- (BOOL)runWithError:(NSError**)error
+{
+    if (self.inputURLs.count == 0) {
+        if (error) *error = MEConcatError(@"No input movie.", paramErr);
+        return NO;
+    }
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    NSMutableArray<AVMovie*>* clips = [NSMutableArray array];  // keeps the tracks alive until the header is written
+    for (NSURL* url in self.inputURLs) {
+        AVMovie* clip = [AVMovie movieWithURL:url options:options];
+        if (!CMTIME_IS_NUMERIC(clip.duration) || CMTIME_COMPARE_INLINE(clip.duration, <=, kCMTimeZero)) {
+            if (error) *error = MEConcatError([NSString stringWithFormat:@"Movie has no duration: %@", url.path], paramErr);
+            return NO;
+        }
+        [clips addObject:clip];
+    }
+
+    // Compare every clip with the first one; conform the ones that differ
+    AVMovie* reference = clips.firstObject;
+    self.conformedClipCount = 0;
+    NSFileManager* fm = [NSFileManager defaultManager];
+    for (NSUInteger index = 1; index < clips.count; index++) {
+        NSString* mismatch = [self incompatibilityOfClip:clips[index] withReference:reference];
+        if (!mismatch) {
+            [self logParameterSetChangeOfClip:clips[index] withReference:reference index:index];
+            continue;
+        }
+        SecureLogf(@"[MEConcatSession] Clip %lu differs from the first clip in %@; re-encoding it.",
+                   (unsigned long)index, mismatch);
+        AVMovie* conformed = [self conformClipAtURL:self.inputURLs[index] index:index error:error];
+        if (!conformed) {
+            if (self.cancelled) [fm removeItemAtURL:self.workDirectoryURL error:nil];
+            return NO;
+        }
+        mismatch = [self incompatibilityOfClip:conformed withReference:reference];
+        if (mismatch) {
+            NSString* reason = [NSString stringWithFormat:@"%@ still differs from the first clip in %@ after re-encoding.",
+                                self.inputURLs[index].lastPathComponent, mismatch];
+            if (error) *error = MEConcatError(reason, paramErr);
+            return NO;
+        }
+        clips[index] = conformed;
+        self.conformedClipCount += 1;
+    }
+    if (self.cancelled) {
+        [fm removeItemAtURL:self.workDirectoryURL error:nil];
+        if (error) *error = MEConcatError(@"Export was cancelled.", userCanceledErr);
+        return NO;
+    }
+
+    BOOL success = [self assembleClips:clips error:error];
+    if (success) {
+        [fm removeItemAtURL:self.workDirectoryURL error:nil];
+    }
+    return success;
+}
+
+/// Append the tracks of each clip to the matching track of the first clip, moved by the clips before it
+- (BOOL)assembleClips:(NSArray<AVMovie*>*)clips error:(NSError**)error
+{
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if ([fm fileExistsAtPath:self.outputURL.path] && ![fm removeItemAtURL:self.outputURL error:error]) {
+        SecureErrorLogf(@"[MEConcatSession] ERROR: Cannot replace %@", self.outputURL.path);
+        return NO;
+    }
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMovie* reference = clips.firstObject;
+    AVMutableMovie* movie = [AVMutableMovie movieWithSettingsFromMovie:reference options:options error:error];
+    if (!movie) return NO;
+    // sample data is copied into the destination, then the header is added to it
+    movie.defaultMediaDataStorage = [[AVMediaDataStorage alloc] initWithURL:self.outputURL options:nil];
+
+    // output track per (media type, index within the type) of the first clip
+    NSMutableArray<AVMutableMovieTrack*>* outputs = [NSMutableArray array];
+    NSMutableArray<AVMediaType>* types = [NSMutableArray array];
+    NSMutableArray<NSNumber*>* ordinals = [NSMutableArray array];
+    NSMutableDictionary<AVMediaType, NSNumber*>* counts = [NSMutableDictionary dictionary];
+    for (AVMovieTrack* track in reference.tracks) {
+        AVMediaType type = track.mediaType;
+        if (![checkedMediaTypes() containsObject:type] && !self.copyOtherMedia) continue;
+        AVMutableMovieTrack* output = [movie addMutableTrackWithMediaType:type copySettingsFromTrack:track options:nil];
+        if (!output) {
+            SecureErrorLogf(@"[MEConcatSession] ERROR: Cannot add %@ track.", type);
+            return NO;
+        }
+        [outputs addObject:output];
+        [types addObject:type];
+        [ordinals addObject:counts[type] ?: @0];
+        counts[type] = @(counts[type].unsignedIntegerValue + 1);
+    }
+
+    CMTime cursor = kCMTimeZero;
+    for (AVMovie* clip in clips) {
+        for (NSUInteger index = 0; index < outputs.count; index++) {
+            NSArray<AVMovieTrack*>* tracks = [clip tracksWithMediaType:types[index]];
+            NSUInteger ordinal = ordinals[index].unsignedIntegerValue;
+            if (ordinal >= tracks.count) continue;     // other media missing in this clip
+            AVMovieTrack* track = tracks[ordinal];
+            CMTimeRange range = CMTimeRangeGetIntersection(track.timeRange, CMTimeRangeMake(kCMTimeZero, clip.duration));
+            if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) continue;
+            AVMutableMovieTrack* output = outputs[index];
+            CMTime at = CMTimeAdd(cursor, range.start);
+            CMTime trackEnd = CMTimeRangeGetEnd(output.timeRange);
+            if (CMTIME_COMPARE_INLINE(trackEnd, <, at)) {
+                [output insertEmptyTimeRange:CMTimeRangeFromTimeToTime(trackEnd, at)];
+            }
+            if (![output insertTimeRange:range ofTrack:track atTime:at copySampleData:YES error:error]) {
+                SecureErrorLogf(@"[MEConcatSession] ERROR: Cannot append %@ track %d.", types[index], track.trackID);
+                return NO;
+            }
+        }
+        cursor = CMTimeAdd(cursor, clip.duration);
+    }
+
+    if (![movie writeMovieHeaderToURL:self.outputURL
+                             fileType:AVFileTypeQuickTimeMovie
+                              options:AVMovieWritingAddMovieHeaderToDestination
+                                error:error]) {
+        SecureErrorLogf(@"[MEConcatSession] ERROR: Cannot write movie header to %@", self.outputURL.path);
+        return NO;
+    }
+    SecureLogf(@"[MEConcatSession] Joined %lu clips (%lu re-encoded, %.3f sec) into %@",
+               (unsigned long)clips.count, (unsigned long)self.conformedClipCount,
+               CMTimeGetSeconds(cursor), self.outputURL.lastPathComponent);
+    return YES;
+}
+
+@end
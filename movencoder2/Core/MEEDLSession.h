@@ -0,0 +1,87 @@
+//
+//  MEEDLSession.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEEDLSession.h
+ * @abstract Internal API - Export many clips of one source in a single decode pass
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * An edit decision list is a list of time ranges of one source, each exported
+ * to its own movie. The source video is decoded once: one AVAssetReader reads
+ * the union of the ranges in order (SBSpanSource, jumping over gaps of more than
+ * a second), and SBFanoutReader hands every frame to the clips whose range it
+ * falls into. Overlapping clips share the decoded frames.
+ *
+ * Each clip is an METranscoder from the builder with its startTime/endTime set.
+ * It is started when the reader reaches its range and takes its video frames
+ * through videoSourceProvider; its own reader handles audio and other media for
+ * its range. When the video of every clip is encoded by libavcodec with the same
+ * filter, the filter also runs once, on a filter-only MEManager in front of the
+ * fan-out, and the clips encode the filtered frames.
+ *
+ * Jobs that do not decode video (copy, remux, metadata fix-up) or that do not
+ * write through AVAssetWriter (-mux, -segment, libav input) export each clip on
+ * its own instead.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEEDLSession_h
+#define MEEDLSession_h
+
+@import Foundation;
+@import CoreMedia;
+
+@class METranscoder;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Build the transcoder of one clip; the session sets its startTime/endTime.
+typedef METranscoder* _Nullable (^MEEDLClipBuilder)(NSURL* clipURL);
+
+@interface MEEDLSession : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param inputURL Source movie
+ @param timeRanges Range of each clip (NSValue of CMTimeRange); ranges may overlap
+ @param clipURLs Output movie of each clip, same count as timeRanges
+ @param builder Called once to probe the job, then once per clip
+ */
+- (instancetype)initWithInputURL:(NSURL*)inputURL
+                      timeRanges:(NSArray<NSValue*>*)timeRanges
+                        clipURLs:(NSArray<NSURL*>*)clipURLs
+                         builder:(MEEDLClipBuilder)builder NS_DESIGNATED_INITIALIZER;
++ (instancetype)sessionWithInputURL:(NSURL*)inputURL
+                         timeRanges:(NSArray<NSValue*>*)timeRanges
+                           clipURLs:(NSArray<NSURL*>*)clipURLs
+                            builder:(MEEDLClipBuilder)builder;
+
+/// Export every clip. Blocks the calling thread. A failed clip does not stop the others.
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Cancel the running exports.
+- (void)cancel;
+
+@property (readonly, getter=isCancelled) BOOL cancelled;    // atomic
+/// Number of clips that failed; valid after runWithError:
+@property (readonly) NSUInteger failedClipCount;            // atomic
+/// YES once the clips took their video from the shared decode pass
+@property (readonly) BOOL usedSharedDecode;                 // atomic
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEEDLSession_h */
@@ -0,0 +1,357 @@
+//
+//  MEEDLSession.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr, userCanceledErr
+
+#import "MEEDLSession.h"
+#import "METranscoder+Internal.h"
+#import "SBFanoutReader.h"
+#import "MESecureLogging.h"
+
+static inline NSError* MEEDLError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"EDL export failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+static const NSUInteger kBranchFrames = 4;      // decoded frames queued per clip
+static const double kSpanMergeGap = 1.0;        // decode through gaps shorter than this (sec)
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MEEDLSession ()
+@property (nonatomic, strong) NSURL* inputURL;
+@property (nonatomic, strong) NSArray<NSValue*>* timeRanges;
+@property (nonatomic, strong) NSArray<NSURL*>* clipURLs;
+@property (nonatomic, copy) MEEDLClipBuilder builder;
+
+// shared decode pass
+@property (strong, nullable) AVAssetReader* assetReader;                // atomic
+@property (strong, nullable) SBChannel* filterChannel;                  // atomic
+@property (strong, nullable) SBFanoutReader* fanoutReader;              // atomic
+@property (nonatomic, assign) CMPersistentTrackID sharedTrackID;
+@property (nonatomic, assign) BOOL sharedFilter;
+
+// guarded by @synchronized(self)
+@property (nonatomic, strong) NSMutableSet<METranscoder*>* runningTranscoders;
+@property (nonatomic, strong, nullable) NSError* firstError;
+
+@property (readwrite, getter=isCancelled) BOOL cancelled;
+@property (readwrite) NSUInteger failedClipCount;
+@property (readwrite) BOOL usedSharedDecode;
+@end
+
+@implementation MEEDLSession
+
+- (instancetype)initWithInputURL:(NSURL*)inputURL
+                      timeRanges:(NSArray<NSValue*>*)timeRanges
+                        clipURLs:(NSArray<NSURL*>*)clipURLs
+                         builder:(MEEDLClipBuilder)builder
+{
+    NSParameterAssert(timeRanges.count == clipURLs.count);
+    if (self = [super init]) {
+        _inputURL = inputURL;
+        _timeRanges = [timeRanges copy];
+        _clipURLs = [clipURLs copy];
+        _builder = [builder copy];
+        _runningTranscoders = [NSMutableSet set];
+    }
+    return self;
+}
+
++ (instancetype)sessionWithInputURL:(NSURL*)inputURL
+                         timeRanges:(NSArray<NSValue*>*)timeRanges
+                           clipURLs:(NSArray<NSURL*>*)clipURLs
+                            builder:(MEEDLClipBuilder)builder
+{
+    return [[self alloc] initWithInputURL:inputURL timeRanges:timeRanges clipURLs:clipURLs builder:builder];
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+    [self.fanoutReader cancel];
+    [self.filterChannel cancel];
+    [self.assetReader cancelReading];
+    NSArray<METranscoder*>* running = nil;
+    @synchronized (self) {
+        running = self.runningTranscoders.allObjects;
+    }
+    for (METranscoder* transcoder in running) {
+        [transcoder cancelAsync];
+    }
+}
+
+/* =================================================================================== */
+// MARK: - planning
+/* =================================================================================== */
+
+/// nil if the clips can take their video from one decode pass
+- (nullable NSString*)ineligibilityOfTranscoder:(METranscoder*)transcoder
+{
+    if (!transcoder.videoEncode && ![transcoder hasVideoMEManagers]) return @"video is not decoded";
+    if (transcoder.metadataFixup) return @"metadata fix-up copies the samples";
+    if (transcoder.muxerFormat || transcoder.segmentDuration > 0) return @"output is not written by AVAssetWriter";
+    if ([transcoder.inputBackend isEqualToString:kInputBackendLibav]) return @"video is decoded by libavcodec";
+    if ([transcoder.inMovie tracksWithMediaType:AVMediaTypeVideo].count == 0) return @"source has no video track";
+    return nil;
+}
+
+/// Filter string to run once for every clip, or nil when each clip keeps its own filter
+- (nullable NSString*)sharedFilterOfTranscoder:(METranscoder*)transcoder track:(AVMovieTrack*)track
+{
+    id item = transcoder.managers[keyForTrackID(track.trackID)];
+    if (![item isKindOfClass:[MEManager class]]) return nil;
+    MEManager* manager = item;
+    // the clip manager must still have something to do once the filter is gone
+    if (!(manager.videoFilterString.length && manager.videoEncoderSetting)) return nil;
+    return manager.videoFilterString;
+}
+
+/* =================================================================================== */
+// MARK: - running
+/* =================================================================================== */
+
+- (void)recordFailureOfClip:(NSUInteger)index error:(nullable NSError*)error
+{
+    NSError* clipError = error ?: MEEDLError(@"Clip export failed.", paramErr);
+    SecureErrorLogf(@"[MEEDLSession] ERROR: Clip %lu (%@) failed: %@", (unsigned long)index,
+                    self.clipURLs[index].lastPathComponent, clipError.localizedFailureReason ?: clipError.localizedDescription);
+    @synchronized (self) {
+        self.failedClipCount += 1;
+        if (!self.firstError) self.firstError = clipError;
+    }
+}
+
+- (nullable METranscoder*)transcoderOfClip:(NSUInteger)index
+{
+    NSURL* url = self.clipURLs[index];
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    METranscoder* transcoder = self.builder(url);
+    if (!transcoder) {
+        [self recordFailureOfClip:index error:MEEDLError(@"Cannot prepare a clip.", paramErr)];
+        return nil;
+    }
+    CMTimeRange range = self.timeRanges[index].CMTimeRangeValue;
+    transcoder.startTime = range.start;
+    transcoder.endTime = CMTimeRangeGetEnd(range);
+    return transcoder;
+}
+
+- (BOOL)exportTranscoder:(METranscoder*)transcoder ofClip:(NSUInteger)index
+{
+    @synchronized (self) {
+        [self.runningTranscoders addObject:transcoder];
+    }
+    NSError* clipError = nil;
+    BOOL success = !self.cancelled && [transcoder exportCustomOnError:&clipError]; // blocking method call
+    @synchronized (self) {
+        [self.runningTranscoders removeObject:transcoder];
+    }
+    if (!success && !self.cancelled) {
+        [self recordFailureOfClip:index error:(transcoder.finalError ?: clipError)];
+    }
+    return success;
+}
+
+/// Each clip reads and decodes its own range
+- (void)exportClipsOneByOneWithReason:(NSString*)reason
+{
+    SecureLogf(@"[MEEDLSession] Exporting each clip on its own: %@.", reason);
+    for (NSUInteger index = 0; index < self.clipURLs.count && !self.cancelled; index++) {
+        @autoreleasepool {
+            METranscoder* transcoder = [self transcoderOfClip:index];
+            if (transcoder) {
+                [self exportTranscoder:transcoder ofClip:index];
+            }
+        }
+    }
+}
+
+/// Called on the fan-out queue when the reader reaches the clip; the export runs concurrently
+- (void)startClip:(NSUInteger)index branch:(SBFanoutBranch*)branch group:(dispatch_group_t)group
+{
+    if (self.cancelled) {
+        [branch cancel];
+        return;
+    }
+    METranscoder* transcoder = [self transcoderOfClip:index];
+    if (!transcoder) {
+        [branch cancel];
+        return;
+    }
+    CMPersistentTrackID trackID = self.sharedTrackID;
+    if (self.sharedFilter) {
+        MEManager* manager = transcoder.managers[keyForTrackID(trackID)];
+        manager.videoFilterString = nil;
+    }
+    transcoder.videoSourceProvider = ^MEOutput* _Nullable (AVMovieTrack* track) {
+        return (track.trackID == trackID) ? (MEOutput*)branch : nil;
+    };
+
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        [self exportTranscoder:transcoder ofClip:index];
+        // the reader must not wait for a clip which stopped consuming (failure, cache hit)
+        [branch cancel];
+    });
+}
+
+/// One reader over the union of the ranges, an optional shared filter, then the fan-out
+- (BOOL)exportClipsWithSharedDecodeOf:(AVMovie*)source track:(AVMovieTrack*)track
+                                probe:(METranscoder*)probe error:(NSError**)error
+{
+    NSError* readerError = nil;
+    AVAssetReader* ar = [AVAssetReader assetReaderWithAsset:source error:&readerError];
+    if (!ar) {
+        if (error) *error = readerError ?: MEEDLError(@"Cannot create the asset reader.", paramErr);
+        return NO;
+    }
+    NSMutableDictionary<NSString*,id>* arOutputSetting = [NSMutableDictionary dictionary];
+    [probe addDecompressionPropertiesOf:track setting:arOutputSetting];
+    arOutputSetting[(__bridge NSString*)kCVPixelBufferPixelFormatTypeKey] = @(kCVPixelFormatType_422YpCbCr8);
+    AVAssetReaderOutput* arOutput = [AVAssetReaderTrackOutput assetReaderTrackOutputWithTrack:track
+                                                                               outputSettings:arOutputSetting];
+    arOutput.alwaysCopiesSampleData = NO;
+    NSArray<NSValue*>* spans = SBMergedTimeRanges(self.timeRanges, CMTimeMakeWithSeconds(kSpanMergeGap, 600));
+    SBSpanSource* spanSource = [SBSpanSource spanSourceWithReaderOutput:arOutput spans:spans];
+    if (![ar canAddOutput:arOutput]) {
+        if (error) *error = MEEDLError(@"Video track cannot be decoded.", paramErr);
+        return NO;
+    }
+    [ar addOutput:arOutput];
+    [spanSource prepareReader:ar];
+    if (![ar startReading]) {
+        if (error) *error = ar.error ?: MEEDLError(@"Cannot start reading.", paramErr);
+        return NO;
+    }
+    self.assetReader = ar;
+
+    // the filter graph runs once; its output is what the clips encode
+    MEOutput* producer = (MEOutput*)spanSource;
+    NSString* filterString = [self sharedFilterOfTranscoder:probe track:track];
+    if (filterString) {
+        MEManager* clipManager = probe.managers[keyForTrackID(track.trackID)];
+        MEManager* filter = [MEManager new];
+        filter.videoFilterString = filterString;
+        filter.initialDelayInSec = clipManager.initialDelayInSec;
+        filter.verbose = clipManager.verbose;
+        CMFormatDescriptionRef desc = (__bridge CMFormatDescriptionRef)track.formatDescriptions.firstObject;
+        filter.sourceExtensions = desc ? CMFormatDescriptionGetExtensions(desc) : NULL;
+        filter.mediaTimeScale = track.naturalTimeScale;
+
+        SBChannel* channel = [SBChannel sbChannelWithProducerME:producer
+                                                     consumerME:[MEInput inputWithManager:filter]
+                                                        TrackID:track.trackID];
+        self.filterChannel = channel;
+        [channel startWithDelegate:nil completionHandler:^{}];
+        producer = [MEOutput outputWithManager:filter];
+        self.sharedFilter = YES;
+    }
+
+    SBFanoutReader* fanout = [SBFanoutReader fanoutReaderWithProducer:producer
+                                                                ranges:self.timeRanges
+                                                             maxFrames:kBranchFrames
+                                                                 label:@"com.movencoder2.MEEDLSession.fanout"];
+    self.sharedTrackID = track.trackID;
+    self.fanoutReader = fanout;
+    self.usedSharedDecode = YES;
+    SecureLogf(@"[MEEDLSession] Decoding %lu span(s) once for %lu clip(s)%@.",
+               (unsigned long)spans.count, (unsigned long)self.clipURLs.count,
+               (filterString ? @" with a shared filter" : @""));
+
+    dispatch_group_t group = dispatch_group_create();
+    __weak typeof(self) wself = self;
+    fanout.branchStartHandler = ^(NSUInteger index, SBFanoutBranch* branch) {
+        @autoreleasepool {
+            [wself startClip:index branch:branch group:group];
+        }
+    };
+    dispatch_group_enter(group);
+    [fanout startWithCompletionHandler:^{
+        dispatch_group_leave(group);
+    }];
+    if (self.cancelled) [self cancel];
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    [self.filterChannel cancel];
+    if (ar.status == AVAssetReaderStatusReading) {
+        [ar cancelReading];
+    }
+    if (ar.status == AVAssetReaderStatusFailed && !self.cancelled) {
+        if (error) *error = ar.error ?: MEEDLError(@"Decoding failed.", paramErr);
+        return NO;
+    }
+    SecureLogf(@"[MEEDLSession] Decoded %llu frames, handed out %llu.",
+               fanout.framesRead, fanout.framesDelivered);
+    return YES;
+}
+
+- (BOOL)runWithError:(NSError**)error
+{
+    if (self.clipURLs.count == 0) {
+        if (error) *error = MEEDLError(@"EDL has no clip.", paramErr);
+        return NO;
+    }
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMovie* source = [AVMovie movieWithURL:self.inputURL options:options];
+    CMTimeRange whole = CMTimeRangeMake(kCMTimeZero, source.duration);
+    NSMutableArray<NSValue*>* ranges = [NSMutableArray array];
+    for (NSValue* value in self.timeRanges) {
+        CMTimeRange range = CMTimeRangeGetIntersection(value.CMTimeRangeValue, whole);
+        if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) {
+            if (error) *error = MEEDLError(@"Clip range is outside of the input movie.", paramErr);
+            return NO;
+        }
+        [ranges addObject:[NSValue valueWithCMTimeRange:range]];
+    }
+    self.timeRanges = ranges;
+
+    METranscoder* probe = self.builder(self.clipURLs.firstObject);
+    if (!probe) {
+        if (error) *error = MEEDLError(@"Cannot prepare the transcoder.", paramErr);
+        return NO;
+    }
+    NSString* reason = [self ineligibilityOfTranscoder:probe];
+    AVMovieTrack* track = [source tracksWithMediaType:AVMediaTypeVideo].firstObject;
+    BOOL success = YES;
+    if (reason) {
+        probe = nil;
+        [self exportClipsOneByOneWithReason:reason];
+    } else {
+        success = [self exportClipsWithSharedDecodeOf:source track:track probe:probe error:error];
+        probe = nil;
+    }
+    self.fanoutReader = nil;
+    self.filterChannel = nil;
+    self.assetReader = nil;
+    if (!success) return NO;
+
+    if (self.cancelled) {
+        if (error) *error = MEEDLError(@"Export was cancelled.", userCanceledErr);
+        return NO;
+    }
+    NSUInteger failures = self.failedClipCount;
+    SecureLogf(@"[MEEDLSession] %lu of %lu clip(s) exported.",
+               (unsigned long)(self.clipURLs.count - failures), (unsigned long)self.clipURLs.count);
+    if (failures) {
+        if (error) {
+            @synchronized (self) {
+                *error = self.firstError;
+            }
+        }
+        return NO;
+    }
+    return YES;
+}
+
+@end
@@ -0,0 +1,91 @@
+//
+//  MEJobScheduler.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEJobScheduler.h
+ * @abstract Internal API - Core budget scheduler for the job server
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEJobScheduler splits the machine's cores across jobs. Each admitted job is
+ * granted a thread budget which becomes the encoder and filter thread count of
+ * its video tracks. Pending jobs are admitted in deadline order (earliest first,
+ * then submission order). When cores are released the fair share is
+ * recomputed over running and pending jobs; cores that no pending job can use
+ * are stolen by the admitted job closest to its deadline.
+ *
+ * libavcodec fixes the thread count when the encoder opens, so a budget does
+ * not change while its job runs; rebalancing happens on admission.
+ *
+ * The scheduler is pure bookkeeping and is not thread-safe; callers serialize
+ * access (MEJobServer uses its server queue).
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEJobScheduler_h
+#define MEJobScheduler_h
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Admission decision: start the job with the thread budget
+@interface MEJobGrant : NSObject
+@property (nonatomic, readonly) NSString* identifier;
+@property (nonatomic, readonly) NSUInteger cores;
+@end
+
+@interface MEJobScheduler : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param coreCount Cores to split across jobs (at least 1)
+ @param minimumCores Smallest budget worth starting a job with
+ @param maximumCores Largest budget of one job, except when stealing idle cores for a deadline
+ */
+- (instancetype)initWithCoreCount:(NSUInteger)coreCount
+                     minimumCores:(NSUInteger)minimumCores
+                     maximumCores:(NSUInteger)maximumCores NS_DESIGNATED_INITIALIZER;
++ (instancetype)schedulerWithCoreCount:(NSUInteger)coreCount
+                          minimumCores:(NSUInteger)minimumCores
+                          maximumCores:(NSUInteger)maximumCores;
+
+@property (nonatomic, readonly) NSUInteger coreCount;
+@property (nonatomic, readonly) NSUInteger minimumCores;
+@property (nonatomic, readonly) NSUInteger maximumCores;
+
+/// Queue a job; nil deadline sorts after every deadline. Returns NO for a duplicate identifier.
+- (BOOL)enqueueJob:(NSString*)identifier deadline:(nullable NSDate*)deadline;
+
+/// Remove a pending job; returns NO if it is not pending.
+- (BOOL)removePendingJob:(NSString*)identifier;
+
+/// Admit pending jobs that fit into the free cores, in deadline order.
+- (NSArray<MEJobGrant*>*)admitJobs;
+
+/// Release the budget of a running job.
+- (void)finishJob:(NSString*)identifier;
+
+/// Budget of a running job, 0 if it is not running
+- (NSUInteger)coresForJob:(NSString*)identifier;
+
+@property (nonatomic, readonly) NSUInteger freeCores;
+@property (nonatomic, readonly) NSUInteger runningCount;
+@property (nonatomic, readonly) NSUInteger pendingCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEJobScheduler_h */
@@ -0,0 +1,171 @@
+//
+//  MEJobScheduler.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MEJobScheduler.h"
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MEJobGrant ()
+@property (nonatomic, readwrite) NSString* identifier;
+@property (nonatomic, readwrite) NSUInteger cores;
+@end
+
+@implementation MEJobGrant
+@end
+
+@interface MEPendingJob : NSObject
+@property (nonatomic, strong) NSString* identifier;
+@property (nonatomic, strong) NSDate* deadline;     // distantFuture if none
+@property (nonatomic, assign) BOOL hasDeadline;
+@end
+
+@implementation MEPendingJob
+@end
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MEJobScheduler ()
+@property (nonatomic, strong) NSMutableArray<MEPendingJob*>* pending;          // kept in deadline order
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSNumber*>* running; // identifier : cores
+@end
+
+@implementation MEJobScheduler
+
+- (instancetype)initWithCoreCount:(NSUInteger)coreCount
+                     minimumCores:(NSUInteger)minimumCores
+                     maximumCores:(NSUInteger)maximumCores
+{
+    if (self = [super init]) {
+        _coreCount = MAX(coreCount, (NSUInteger)1);
+        _minimumCores = MIN(MAX(minimumCores, (NSUInteger)1), _coreCount);
+        _maximumCores = MIN(MAX(maximumCores, _minimumCores), _coreCount);
+        _pending = [NSMutableArray array];
+        _running = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
++ (instancetype)schedulerWithCoreCount:(NSUInteger)coreCount
+                          minimumCores:(NSUInteger)minimumCores
+                          maximumCores:(NSUInteger)maximumCores
+{
+    return [[self alloc] initWithCoreCount:coreCount minimumCores:minimumCores maximumCores:maximumCores];
+}
+
+- (NSUInteger)freeCores
+{
+    NSUInteger used = 0;
+    for (NSNumber* cores in self.running.allValues) {
+        used += cores.unsignedIntegerValue;
+    }
+    return (used < self.coreCount) ? self.coreCount - used : 0;
+}
+
+- (NSUInteger)runningCount
+{
+    return self.running.count;
+}
+
+- (NSUInteger)pendingCount
+{
+    return self.pending.count;
+}
+
+- (BOOL)enqueueJob:(NSString*)identifier deadline:(NSDate*)deadline
+{
+    if (self.running[identifier]) return NO;
+    for (MEPendingJob* job in self.pending) {
+        if ([job.identifier isEqualToString:identifier]) return NO;
+    }
+
+    MEPendingJob* job = [MEPendingJob new];
+    job.identifier = identifier;
+    job.deadline = deadline ?: [NSDate distantFuture];
+    job.hasDeadline = (deadline != nil);
+
+    // insert after every job due no later (earliest deadline first, then FIFO)
+    NSUInteger index = self.pending.count;
+    for (NSUInteger i = 0; i < self.pending.count; i++) {
+        if ([job.deadline compare:self.pending[i].deadline] == NSOrderedAscending) {
+            index = i;
+            break;
+        }
+    }
+    [self.pending insertObject:job atIndex:index];
+    return YES;
+}
+
+- (BOOL)removePendingJob:(NSString*)identifier
+{
+    for (NSUInteger i = 0; i < self.pending.count; i++) {
+        if ([self.pending[i].identifier isEqualToString:identifier]) {
+            [self.pending removeObjectAtIndex:i];
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (NSArray<MEJobGrant*>*)admitJobs
+{
+    NSMutableArray<MEJobGrant*>* grants = [NSMutableArray array];
+    MEPendingJob* closest = nil;    // admitted job closest to its deadline
+    MEJobGrant* closestGrant = nil;
+    NSUInteger free = self.freeCores;
+
+    while (self.pending.count && free >= self.minimumCores) {
+        // fair share over every job that wants cores now
+        NSUInteger active = self.running.count + self.pending.count;
+        NSUInteger share = MAX(self.coreCount / active, self.minimumCores);
+        share = MIN(MIN(share, self.maximumCores), free);
+
+        MEPendingJob* job = self.pending.firstObject;
+        [self.pending removeObjectAtIndex:0];
+        self.running[job.identifier] = @(share);
+        free -= share;
+
+        MEJobGrant* grant = [MEJobGrant new];
+        grant.identifier = job.identifier;
+        grant.cores = share;
+        [grants addObject:grant];
+        if (!closest) {
+            closest = job;
+            closestGrant = grant;
+        }
+    }
+
+    // Nothing is waiting: the first admitted job steals the idle cores. Only a job
+    // with a deadline may grow past maximumCores; the rest is kept for new arrivals.
+    if (closest && self.pending.count == 0 && free > 0) {
+        NSUInteger limit = closest.hasDeadline ? self.coreCount : self.maximumCores;
+        NSUInteger extra = MIN(free, limit - MIN(limit, closestGrant.cores));
+        if (extra > 0) {
+            closestGrant.cores += extra;
+            self.running[closest.identifier] = @(closestGrant.cores);
+        }
+    }
+    return grants;
+}
+
+- (void)finishJob:(NSString*)identifier
+{
+    [self.running removeObjectForKey:identifier];
+}
+
+- (NSUInteger)coresForJob:(NSString*)identifier
+{
+    return self.running[identifier].unsignedIntegerValue;
+}
+
+@end
@@ -0,0 +1,100 @@
+//
+//  MEJobServer.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEJobServer.h
+ * @abstract Internal API - Long-running job server on a Unix domain socket
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEJobServer accepts transcode jobs over a Unix domain socket and runs them
+ * with thread budgets from MEJobScheduler. Jobs are built by the same builder
+ * block as batch jobs (MEBatchRunner.h), serially on a build queue of their own,
+ * so a slow movie open does not hold up other clients. The socket is created
+ * accessible to its owner only.
+ *
+ * Protocol: one JSON object per line in both directions.
+ *
+ *     {"cmd":"submit", "id":"clip1", "in":"/path/in.mov", "out":"/path/out.mov",
+ *      "args":["-meve", "..."], "deadline":600}
+ *     {"cmd":"cancel", "id":"clip1"}
+ *     {"cmd":"status"}
+ *
+ * "id" and "deadline" (seconds from now) are optional. A submitting connection
+ * receives {"id":..., "status":"queued"}, then "running" with "cores", then the
+ * final status ("ok", "failed", "invalid", "cancelled") with "elapsed" and
+ * "message". "status" replies with every known job and the free cores.
+ * Errors are replied as {"error":"..."}.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEJobServer_h
+#define MEJobServer_h
+
+@import Foundation;
+
+#import "MEBatchRunner.h"
+
+@class MEJobScheduler;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEJobServer : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+- (instancetype)initWithSocketURL:(NSURL*)socketURL
+                        scheduler:(MEJobScheduler*)scheduler
+                          builder:(MEBatchJobBuilder)builder NS_DESIGNATED_INITIALIZER;
++ (instancetype)jobServerWithSocketURL:(NSURL*)socketURL
+                             scheduler:(MEJobScheduler*)scheduler
+                               builder:(MEBatchJobBuilder)builder;
+
+@property (nonatomic, readonly) NSURL* socketURL;
+@property (nonatomic, readonly) MEJobScheduler* scheduler;
+
+/// Bind and listen. Fails if another server is listening on the path.
+- (BOOL)startWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Stop accepting connections and cancel every job.
+- (void)stop;
+
+@property (readonly, getter=isStopped) BOOL stopped;    // atomic
+@property (readonly) NSUInteger runningJobCount;        // atomic
+
+@end
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+/// Reply handler of MEJobClient; return YES to wait for more replies.
+typedef BOOL (^MEJobClientReplyHandler)(NSDictionary* reply);
+
+@interface MEJobClient : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/// Send one request line and pass each reply line to the handler until it returns NO
+/// or the server closes the connection. Blocks the calling thread.
++ (BOOL)sendRequest:(NSDictionary*)request
+        toSocketURL:(NSURL*)socketURL
+       replyHandler:(MEJobClientReplyHandler)handler
+              error:(NSError * _Nullable * _Nullable)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEJobServer_h */
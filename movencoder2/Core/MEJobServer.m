@@ -0,0 +1,552 @@
+//
+//  MEJobServer.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MEJobServer.h"
+#import "MEJobScheduler.h"
+#import "METranscoder+Internal.h"
+#import "MESecureLogging.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const size_t kMaxRequestLength = 64 * 1024;     // per line
+static const NSUInteger kFinishedJobsKept = 100;       // for status replies
+static const int kListenBacklog = 16;
+static const int kSendTimeoutInSec = 5;                // a client that stops reading is dropped
+
+/* =================================================================================== */
+// MARK: - socket helpers
+/* =================================================================================== */
+
+static NSError* posixError(int code)
+{
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:code userInfo:nil];
+}
+
+static BOOL fillSocketAddress(NSURL* url, struct sockaddr_un* addr)
+{
+    const char* path = url.fileSystemRepresentation;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (!path || strlen(path) >= sizeof(addr->sun_path)) return NO;
+    strlcpy(addr->sun_path, path, sizeof(addr->sun_path));
+    return YES;
+}
+
+static void disableSigPipe(int fd)
+{
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+}
+
+// accept() inherits O_NONBLOCK from the listening socket; replies are written with blocking
+// writes instead, bounded by a send timeout so one stalled client cannot hold the server
+static void prepareAcceptedSocket(int fd)
+{
+    disableSigPipe(fd);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    struct timeval timeout = {kSendTimeoutInSec, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static BOOL writeMessage(int fd, NSDictionary* message)
+{
+    NSData* json = [NSJSONSerialization dataWithJSONObject:message options:0 error:nil];
+    if (!json) return NO;
+    NSMutableData* line = [json mutableCopy];
+    [line appendBytes:"\n" length:1];
+
+    const uint8_t* bytes = line.bytes;
+    size_t left = line.length;
+    while (left > 0) {
+        ssize_t written = write(fd, bytes, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return NO;
+        }
+        bytes += written;
+        left -= (size_t)written;
+    }
+    return YES;
+}
+
+// Remove complete lines from the buffer; a line which is not a JSON object yields NSNull
+static NSArray* takeMessages(NSMutableData* buffer)
+{
+    NSMutableArray* messages = [NSMutableArray array];
+    while (buffer.length) {
+        const char* bytes = buffer.bytes;
+        const char* newline = memchr(bytes, '\n', buffer.length);
+        if (!newline) break;
+        NSUInteger length = (NSUInteger)(newline - bytes);
+        NSData* line = [buffer subdataWithRange:NSMakeRange(0, length)];
+        [buffer replaceBytesInRange:NSMakeRange(0, length + 1) withBytes:NULL length:0];
+        if (line.length == 0) continue;
+
+        id message = [NSJSONSerialization JSONObjectWithData:line options:0 error:nil];
+        [messages addObject:[message isKindOfClass:[NSDictionary class]] ? message : [NSNull null]];
+    }
+    return messages;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MEJobConnection : NSObject
+@property (nonatomic, assign) int fd;
+@property (nonatomic, strong, nullable) dispatch_source_t source;
+@property (nonatomic, strong) NSMutableData* buffer;
+@end
+
+@implementation MEJobConnection
+@end
+
+@interface MEJobServer ()
+@property (nonatomic, copy) MEBatchJobBuilder builder;
+@property (nonatomic, strong) dispatch_queue_t serverQueue;    // serial; sockets, scheduler
+@property (nonatomic, strong) dispatch_queue_t buildQueue;     // serial; the builder parses options with getopt
+@property (nonatomic, strong) dispatch_queue_t workQueue;      // concurrent; runs exports
+@property (nonatomic, strong, nullable) dispatch_source_t listenSource;
+@property (nonatomic, strong) NSMutableSet<MEJobConnection*>* connections;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, MEBatchJob*>* jobs;
+@property (nonatomic, strong) NSMutableArray<NSString*>* jobOrder;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableArray<MEJobConnection*>*>* watchers;
+@property (nonatomic, assign) NSUInteger nextJobNumber;
+@property (readwrite, getter=isStopped) BOOL stopped;
+@property (readwrite) NSUInteger runningJobCount;
+@end
+
+@implementation MEJobServer
+
+- (instancetype)initWithSocketURL:(NSURL*)socketURL
+                        scheduler:(MEJobScheduler*)scheduler
+                          builder:(MEBatchJobBuilder)builder
+{
+    if (self = [super init]) {
+        _socketURL = socketURL;
+        _scheduler = scheduler;
+        _builder = [builder copy];
+        _serverQueue = dispatch_queue_create("MEJobServer.server", DISPATCH_QUEUE_SERIAL);
+        _buildQueue = dispatch_queue_create("MEJobServer.build", DISPATCH_QUEUE_SERIAL);
+        _workQueue = dispatch_queue_create("MEJobServer.work", DISPATCH_QUEUE_CONCURRENT);
+        _connections = [NSMutableSet set];
+        _jobs = [NSMutableDictionary dictionary];
+        _jobOrder = [NSMutableArray array];
+        _watchers = [NSMutableDictionary dictionary];
+        _nextJobNumber = 1;
+    }
+    return self;
+}
+
++ (instancetype)jobServerWithSocketURL:(NSURL*)socketURL
+                             scheduler:(MEJobScheduler*)scheduler
+                               builder:(MEBatchJobBuilder)builder
+{
+    return [[self alloc] initWithSocketURL:socketURL scheduler:scheduler builder:builder];
+}
+
+/* =================================================================================== */
+// MARK: - listening
+/* =================================================================================== */
+
+- (BOOL)startWithError:(NSError**)error
+{
+    struct sockaddr_un addr;
+    if (!fillSocketAddress(self.socketURL, &addr)) {
+        if (error) *error = posixError(ENAMETOOLONG);
+        SecureErrorLogf(@"[MEJobServer] ERROR: Socket path is too long: %@", self.socketURL.path);
+        return NO;
+    }
+
+    // Replace a stale socket left by a previous server; never remove anything else
+    struct stat st;
+    if (lstat(addr.sun_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            if (error) *error = posixError(EEXIST);
+            SecureErrorLogf(@"[MEJobServer] ERROR: Socket path exists and is not a socket: %@", self.socketURL.path);
+            return NO;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        BOOL alive = (probe >= 0 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        if (probe >= 0) close(probe);
+        if (alive) {
+            if (error) *error = posixError(EADDRINUSE);
+            SecureErrorLogf(@"[MEJobServer] ERROR: Another server is listening on %@", self.socketURL.path);
+            return NO;
+        }
+        unlink(addr.sun_path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) goto error;
+    {
+        // owner only from the start; a chmod after bind leaves a window for other users to connect
+        mode_t mask = umask(S_IRWXG | S_IRWXO);
+        int bound = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+        umask(mask);
+        if (bound != 0) goto error;
+    }
+    if (listen(fd, kListenBacklog) != 0) goto error;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    {
+        dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)fd, 0, self.serverQueue);
+        __weak typeof(self) wself = self;
+        dispatch_source_set_event_handler(source, ^{
+            [wself acceptConnectionsOn:fd];
+        });
+        NSString* path = self.socketURL.path;
+        dispatch_source_set_cancel_handler(source, ^{
+            close(fd);
+            unlink(path.fileSystemRepresentation);
+        });
+        self.listenSource = source;
+        dispatch_resume(source);
+    }
+    SecureLogf(@"[MEJobServer] Listening on %@ (%lu cores).",
+               self.socketURL.path, (unsigned long)self.scheduler.coreCount);
+    return YES;
+
+error:
+    {
+        int code = errno;
+        if (fd >= 0) close(fd);
+        if (error) *error = posixError(code);
+        SecureErrorLogf(@"[MEJobServer] ERROR: Cannot listen on %@ (%s)", self.socketURL.path, strerror(code));
+    }
+    return NO;
+}
+
+- (void)stop
+{
+    if (self.stopped) return;
+    self.stopped = YES;
+    dispatch_async(self.serverQueue, ^{
+        if (self.listenSource) {
+            dispatch_source_cancel(self.listenSource);
+            self.listenSource = nil;
+        }
+        for (NSString* identifier in [self.jobOrder copy]) {
+            MEBatchJob* job = self.jobs[identifier];
+            if ([self.scheduler removePendingJob:identifier]) {
+                [job cancel];
+                [self notifyFinishedJob:job];
+            } else {
+                [job cancel]; // running or being built; finished jobs ignore it
+            }
+        }
+        SecureLog(@"[MEJobServer] Stopped accepting jobs.");
+    });
+}
+
+// Called on serverQueue
+- (void)acceptConnectionsOn:(int)listenFD
+{
+    while (TRUE) {
+        int fd = accept(listenFD, NULL, NULL);
+        if (fd < 0) return; // EAGAIN or transient error; wait for the next event
+        prepareAcceptedSocket(fd);
+
+        MEJobConnection* connection = [MEJobConnection new];
+        connection.fd = fd;
+        connection.buffer = [NSMutableData data];
+        dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)fd, 0, self.serverQueue);
+        __weak typeof(self) wself = self;
+        __weak typeof(connection) wconnection = connection;
+        dispatch_source_set_event_handler(source, ^{
+            [wself readConnection:wconnection];
+        });
+        dispatch_source_set_cancel_handler(source, ^{
+            close(fd);
+        });
+        connection.source = source;
+        [self.connections addObject:connection];
+        dispatch_resume(source);
+    }
+}
+
+// Called on serverQueue
+- (void)readConnection:(MEJobConnection*)connection
+{
+    if (!connection) return;
+    uint8_t chunk[4096];
+    ssize_t count = read(connection.fd, chunk, sizeof(chunk));
+    if (count < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    if (count <= 0) {
+        [self closeConnection:connection];
+        return;
+    }
+    [connection.buffer appendBytes:chunk length:(NSUInteger)count];
+
+    for (id message in takeMessages(connection.buffer)) {
+        if (message == [NSNull null]) {
+            writeMessage(connection.fd, @{@"error": @"Request is not a JSON object."});
+            continue;
+        }
+        [self handleMessage:message from:connection];
+    }
+    if (connection.buffer.length > kMaxRequestLength) {
+        writeMessage(connection.fd, @{@"error": @"Request is too long."});
+        [self closeConnection:connection];
+    }
+}
+
+// Called on serverQueue
+- (void)closeConnection:(MEJobConnection*)connection
+{
+    if (connection.source) {
+        dispatch_source_cancel(connection.source);
+        connection.source = nil;
+    }
+    [self.connections removeObject:connection];
+    for (NSMutableArray<MEJobConnection*>* list in self.watchers.allValues) {
+        [list removeObject:connection];
+    }
+}
+
+/* =================================================================================== */
+// MARK: - requests
+/* =================================================================================== */
+
+// Called on serverQueue
+- (void)handleMessage:(NSDictionary*)message from:(MEJobConnection*)connection
+{
+    NSString* command = message[@"cmd"] ?: @"submit";
+    if ([@"submit" isEqual:command]) {
+        [self submitJob:message from:connection];
+    } else if ([@"cancel" isEqual:command]) {
+        [self cancelJob:message from:connection];
+    } else if ([@"status" isEqual:command]) {
+        writeMessage(connection.fd, [self statusReply]);
+    } else {
+        writeMessage(connection.fd, @{@"error": @"Unknown command."});
+    }
+}
+
+- (void)submitJob:(NSDictionary*)message from:(MEJobConnection*)connection
+{
+    if (self.stopped) {
+        writeMessage(connection.fd, @{@"error": @"Server is stopping."});
+        return;
+    }
+    id identifier = message[@"id"];
+    id args = message[@"args"];
+    id deadline = message[@"deadline"];
+    BOOL argsOK = (args == nil) || [args isKindOfClass:[NSArray class]];
+    for (id arg in (argsOK ? args : nil)) {
+        if (![arg isKindOfClass:[NSString class]]) argsOK = NO;
+    }
+    if (![message[@"in"] isKindOfClass:[NSString class]] || ![message[@"out"] isKindOfClass:[NSString class]] ||
+        !argsOK || (identifier && ![identifier isKindOfClass:[NSString class]]) ||
+        (deadline && ![deadline isKindOfClass:[NSNumber class]])) {
+        writeMessage(connection.fd, @{@"error": @"submit requires \"in\", \"out\" strings, an \"args\" string array and a numeric \"deadline\"."});
+        return;
+    }
+    if (!identifier) {
+        identifier = [NSString stringWithFormat:@"job-%lu", (unsigned long)self.nextJobNumber++];
+    }
+    MEBatchJob* previous = self.jobs[identifier];
+    if (previous && (previous.status == MEBatchJobStatusPending || previous.status == MEBatchJobStatusRunning)) {
+        writeMessage(connection.fd, @{@"id": identifier, @"error": @"Job id is in use."});
+        return;
+    }
+
+    NSDate* due = deadline ? [NSDate dateWithTimeIntervalSinceNow:MAX([deadline doubleValue], 0.0)] : nil;
+    MEBatchJob* job = [MEBatchJob jobWithIdentifier:identifier spec:message];
+    [self.jobOrder removeObject:identifier];
+    [self.jobOrder addObject:identifier];
+    self.jobs[identifier] = job;
+    self.watchers[identifier] = [NSMutableArray arrayWithObject:connection];
+    [self.scheduler enqueueJob:identifier deadline:due];
+    writeMessage(connection.fd, @{@"id": identifier, @"status": @"queued"});
+    SecureLogf(@"[MEJobServer] Job %@ queued.", identifier);
+
+    [self admitJobs];
+}
+
+- (void)cancelJob:(NSDictionary*)message from:(MEJobConnection*)connection
+{
+    id identifier = message[@"id"];
+    MEBatchJob* job = [identifier isKindOfClass:[NSString class]] ? self.jobs[identifier] : nil;
+    if (!job) {
+        writeMessage(connection.fd, @{@"error": @"Unknown job id."});
+        return;
+    }
+    if ([self.scheduler removePendingJob:identifier]) {
+        [job cancel];
+        [self notifyFinishedJob:job];
+    } else {
+        [job cancel]; // the final status is sent when the export returns
+    }
+    writeMessage(connection.fd, @{@"id": identifier, @"status": MEBatchJobStatusLabel(job.status)});
+}
+
+- (NSDictionary*)statusReply
+{
+    NSMutableArray* list = [NSMutableArray array];
+    for (NSString* identifier in self.jobOrder) {
+        MEBatchJob* job = self.jobs[identifier];
+        NSMutableDictionary* entry = [@{@"id": identifier,
+                                        @"status": MEBatchJobStatusLabel(job.status),
+                                        @"cores": @([self.scheduler coresForJob:identifier]),
+                                        @"elapsed": @(job.elapsed)} mutableCopy];
+        if (job.message) entry[@"message"] = job.message;
+        [list addObject:entry];
+    }
+    return @{@"jobs": list,
+             @"cores": @(self.scheduler.coreCount),
+             @"free_cores": @(self.scheduler.freeCores)};
+}
+
+/* =================================================================================== */
+// MARK: - running
+/* =================================================================================== */
+
+// Called on serverQueue
+- (void)admitJobs
+{
+    if (self.stopped) return;
+
+    BOOL released = NO;
+    for (MEJobGrant* grant in [self.scheduler admitJobs]) {
+        MEBatchJob* job = self.jobs[grant.identifier];
+        if (job.status != MEBatchJobStatusPending) {
+            [self.scheduler finishJob:grant.identifier];
+            [self notifyFinishedJob:job];
+            released = YES;
+            continue;
+        }
+        SecureLogf(@"[MEJobServer] Job %@ admitted with %lu cores.", job.identifier, (unsigned long)grant.cores);
+
+        // Building parses the options and opens the movie; keep it off serverQueue so
+        // other clients are served meanwhile. A job being built counts as running.
+        self.runningJobCount += 1;
+        NSUInteger cores = grant.cores;
+        dispatch_async(self.buildQueue, ^{
+            NSString* reason = nil;
+            METranscoder* transcoder = self.builder(job, &reason);
+            if (!transcoder) {
+                [job rejectWithReason:reason];
+                [self finishRunningJob:job];
+                return;
+            }
+            transcoder.param[kThreadBudgetKey] = @(cores);
+            dispatch_async(self.serverQueue, ^{
+                [self notifyJob:job message:@{@"id": job.identifier, @"status": @"running", @"cores": @(cores)}];
+            });
+            dispatch_async(self.workQueue, ^{
+                [job runWithTranscoder:transcoder];
+                [self finishRunningJob:job];
+            });
+        });
+    }
+    if (released) {
+        [self admitJobs];
+    }
+}
+
+// Called after a job ran or failed to build; releases its cores on serverQueue
+- (void)finishRunningJob:(MEBatchJob*)job
+{
+    dispatch_async(self.serverQueue, ^{
+        [self.scheduler finishJob:job.identifier];
+        self.runningJobCount -= 1;
+        [self notifyFinishedJob:job];
+        [self admitJobs];
+    });
+}
+
+// Called on serverQueue
+- (void)notifyJob:(MEBatchJob*)job message:(NSDictionary*)message
+{
+    for (MEJobConnection* connection in [self.watchers[job.identifier] copy]) {
+        if (!writeMessage(connection.fd, message)) {
+            [self closeConnection:connection];
+        }
+    }
+}
+
+// Called on serverQueue
+- (void)notifyFinishedJob:(MEBatchJob*)job
+{
+    NSMutableDictionary* message = [@{@"id": job.identifier,
+                                      @"status": MEBatchJobStatusLabel(job.status),
+                                      @"elapsed": @(job.elapsed)} mutableCopy];
+    if (job.message) message[@"message"] = job.message;
+    [self notifyJob:job message:message];
+    [self.watchers removeObjectForKey:job.identifier];
+
+    // keep a bounded history for status replies
+    NSUInteger finished = 0;
+    for (NSString* identifier in self.jobOrder.reverseObjectEnumerator.allObjects) {
+        MEBatchJobStatus status = self.jobs[identifier].status;
+        if (status == MEBatchJobStatusPending || status == MEBatchJobStatusRunning) continue;
+        if (++finished > kFinishedJobsKept) {
+            [self.jobOrder removeObject:identifier];
+            [self.jobs removeObjectForKey:identifier];
+        }
+    }
+}
+
+@end
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@implementation MEJobClient
+
++ (BOOL)sendRequest:(NSDictionary*)request
+        toSocketURL:(NSURL*)socketURL
+       replyHandler:(MEJobClientReplyHandler)handler
+              error:(NSError**)error
+{
+    struct sockaddr_un addr;
+    if (!fillSocketAddress(socketURL, &addr)) {
+        if (error) *error = posixError(ENAMETOOLONG);
+        return NO;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        int code = errno;
+        if (fd >= 0) close(fd);
+        if (error) *error = posixError(code);
+        return NO;
+    }
+    disableSigPipe(fd);
+
+    BOOL done = NO;
+    if (writeMessage(fd, request)) {
+        NSMutableData* buffer = [NSMutableData data];
+        uint8_t chunk[4096];
+        while (!done) {
+            ssize_t count = read(fd, chunk, sizeof(chunk));
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) break;
+            [buffer appendBytes:chunk length:(NSUInteger)count];
+            for (id message in takeMessages(buffer)) {
+                if (message == [NSNull null]) continue;
+                if (!handler(message)) {
+                    done = YES;
+                    break;
+                }
+            }
+        }
+    }
+    close(fd);
+    if (!done && error) *error = posixError(ECONNRESET);
+    return done;
+}
+
+@end
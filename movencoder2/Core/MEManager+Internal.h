@@ -22,6 +22,7 @@
 
 #import "MEManager.h"
 #import "MECommon.h"
+#include <stdatomic.h>
 
 @class MEFilterPipeline;
 @class MEEncoderPipeline;
@@ -38,7 +39,9 @@ NS_ASSUME_NONNULL_BEGIN
 {
     dispatch_queue_t _inputQueue;
     dispatch_queue_t _outputQueue;
+    atomic_flag _affinityReported; // placement of affinityTag logged once
 }
+@property (atomic) int muxerStreamIndex; // -1 until the libavformat stream is added
 @end
 
 @interface MEManager (Internal)
@@ -21,6 +21,7 @@
 #define MEManager_Pipeline_h
 
 #import "MEManager.h"
+#include <libavutil/frame.h>
 
 /* =================================================================================== */
 // MARK: -
@@ -59,6 +60,34 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)prepareInputFrameWith:(CMSampleBufferRef)sb;
 
+/**
+ * @brief Setup video encoder with parameters from a decoded AVFrame
+ * @discussion Frame based variant of -prepareVideoEncoderWith: for the libavcodec
+ * decoder backend. If filter pipeline is active, the filtered frame is used instead.
+ * @param frame Decoded AVFrame containing source format information
+ * @return TRUE if encoder was successfully prepared, FALSE otherwise
+ */
+- (BOOL)prepareVideoEncoderWithFrame:(AVFrame*)frame;
+
+/**
+ * @brief Setup video filter with parameters from a decoded AVFrame
+ * @discussion Frame based variant of -prepareVideoFilterWith: for the libavcodec
+ * decoder backend.
+ * @param frame Decoded AVFrame containing source format information
+ * @return TRUE if filter was successfully prepared, FALSE otherwise
+ */
+- (BOOL)prepareVideoFilterWithFrame:(AVFrame*)frame;
+
+/**
+ * @brief Prepare input AVFrame from a decoded AVFrame
+ * @discussion Moves the decoded frame reference into the internal input frame,
+ * so the image data is not copied. Timestamps are rescaled from frame->time_base
+ * to the manager time base.
+ * @param frame Decoded AVFrame; its reference is taken over and frame is reset
+ * @return TRUE if frame was successfully prepared, FALSE otherwise
+ */
+- (BOOL)prepareInputFrameWithFrame:(AVFrame*)frame;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -15,6 +15,7 @@
 #import "MESecureLogging.h"
 #import "MEFilterPipeline.h"
 #import "MEEncoderPipeline.h"
+#include <libavutil/pixdesc.h>
 
 /* =================================================================================== */
 // MARK: -
@@ -193,6 +194,95 @@ end:
     return FALSE;
 }
 
+/* =================================================================================== */
+// MARK: - Decoded AVFrame input
+/* =================================================================================== */
+
+/// Adopt the decoder time base when it is 1/N; otherwise fall back to the media time scale
+static void syncTimeBaseWithFrame(MEManager *self, AVFrame *frame) {
+    if (self.timeBase != 0) return;
+    AVRational tb = frame->time_base;
+    if (tb.num == 1 && tb.den > 0) {
+        self.timeBase = tb.den;
+    } else if (self.mediaTimeScale > 0) {
+        self.timeBase = self.mediaTimeScale;
+    } else {
+        self.timeBase = 90000;
+    }
+}
+
+- (BOOL)prepareVideoEncoderWithFrame:(AVFrame*)frame
+{
+    syncTimeBaseWithFrame(self, frame);
+    
+    // If filter pipeline is active, the encoder follows the filtered frame
+    if (self.filterPipeline.filterString.length > 0) {
+        return [self prepareVideoEncoderWith:NULL];
+    }
+    
+    struct AVFPixelFormatSpec spec = AVFPixelFormatSpecNone;
+    if (!AVFrameGetPixelFormatSpec(frame, &spec)) {
+        const char* name = av_get_pix_fmt_name(frame->format);
+        SecureErrorLogf(@"[MEManager] ERROR: Decoded pixel format %s is not supported without a video filter.",
+                        name ? name : "unknown");
+        return NO;
+    }
+    return [self.encoderPipeline prepareVideoEncoderWith:NULL
+                                           filteredFrame:frame
+                                     hasValidFilteredFrame:YES];
+}
+
+- (BOOL)prepareVideoFilterWithFrame:(AVFrame*)frame
+{
+    syncTimeBaseWithFrame(self, frame);
+    return [self.filterPipeline prepareVideoFilterWithFrame:frame];
+}
+
+- (BOOL)prepareInputFrameWithFrame:(AVFrame*)frame
+{
+    AVFrame *input = (AVFrame *)[self input];
+    struct AVFrameColorMetadata *cachedColorMetadata = [self cachedColorMetadata];
+    
+    syncTimeBaseWithFrame(self, frame);
+    
+    // prepare AVFrame for input
+    if (!input) {
+        input = av_frame_alloc(); // allocate frame
+        if (!input) {
+            SecureErrorLogf(@"[MEManager] ERROR: Cannot allocate a video frame.");
+            return FALSE;
+        }
+        [self setInput:input];
+    }
+    
+    // Take over the decoded buffer; no image copy is made
+    AVRational srcTimeBase = frame->time_base;
+    AVRational dstTimeBase = av_make_q(1, self.timeBase);
+    av_frame_unref(input);
+    av_frame_move_ref(input, frame);
+    
+    if (srcTimeBase.num > 0 && srcTimeBase.den > 0 && av_cmp_q(srcTimeBase, dstTimeBase) != 0) {
+        if (input->pts != AV_NOPTS_VALUE) {
+            input->pts = av_rescale_q(input->pts, srcTimeBase, dstTimeBase);
+        }
+        if (input->duration > 0) {
+            input->duration = av_rescale_q(input->duration, srcTimeBase, dstTimeBase);
+        }
+    }
+    input->time_base = dstTimeBase;
+    
+    // Cache color metadata from input frame (first sample only)
+    if (!self.colorMetadataCached) {
+        cachedColorMetadata->color_range = input->color_range;
+        cachedColorMetadata->color_primaries = input->color_primaries;
+        cachedColorMetadata->color_trc = input->color_trc;
+        cachedColorMetadata->colorspace = input->colorspace;
+        cachedColorMetadata->chroma_location = input->chroma_location;
+        self.colorMetadataCached = YES;
+    }
+    return TRUE;
+}
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -11,6 +11,8 @@
 #import "MEManager+Queuing.h"
 #import "MEManager+Internal.h"
 #import "MECommon.h"
+#import "MEAffinity.h"
+#import "MESecureLogging.h"
 
 /* =================================================================================== */
 // MARK: -
@@ -25,6 +27,26 @@ static const char* const kMEOutputQueue = "MEManager.MEOutputQueue";
 
 NS_ASSUME_NONNULL_BEGIN
 
+// Run queue work with the affinity tag of the manager; libav threads created inside inherit it.
+// Only pipeline setup creates those threads, so work after that runs untagged and pays no syscalls.
+static dispatch_block_t placedBlock(MEManager *self, dispatch_block_t block) {
+    NSInteger tag = self.affinityTag;
+    if (tag == kMEAffinityTagNone) return block;
+    BOOL pipelineReady = self.videoEncoderIsReady && (self.videoFilterString == nil || self.videoFilterIsReady);
+    if (pipelineReady) return block;
+    return MEAffinityBlock(tag, ^{
+        if (!atomic_flag_test_and_set(&self->_affinityReported)) {
+            NSInteger applied = MEAffinityCurrentThreadTag();
+            if (applied == tag) {
+                SecureLogf(@"[MEManager] Affinity: filter/encoder work placed on cache domain tag %ld", (long)tag);
+            } else {
+                SecureErrorLogf(@"[MEManager] WARNING: Affinity tag %ld not applied (thread has %ld)", (long)tag, (long)applied);
+            }
+        }
+        block();
+    });
+}
+
 @implementation MEManager (Queuing)
 
 - (dispatch_queue_t) inputQueue
@@ -49,6 +71,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void) input_sync:(dispatch_block_t)block
 {
+    block = placedBlock(self, block);
     dispatch_queue_t queue = self.inputQueue;
     void * key = [self inputQueueKeyPtr];
     assert (queue && key);
@@ -61,6 +84,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void) input_async:(dispatch_block_t)block
 {
+    block = placedBlock(self, block);
     dispatch_queue_t queue = self.inputQueue;
     void * key = [self inputQueueKeyPtr];
     assert (queue && key);
@@ -73,6 +97,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void) output_sync:(dispatch_block_t)block
 {
+    block = placedBlock(self, block);
     dispatch_queue_t queue = self.outputQueue;
     void * key = [self outputQueueKeyPtr];
     assert (queue && key);
@@ -85,6 +110,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void) output_async:(dispatch_block_t)block
 {
+    block = placedBlock(self, block);
     dispatch_queue_t queue = self.outputQueue;
     void * key = [self outputQueueKeyPtr];
     assert (queue && key);
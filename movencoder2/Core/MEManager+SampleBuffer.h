@@ -21,6 +21,8 @@
 #define MEManager_SampleBuffer_h
 
 #import "MEManager.h"
+#import "MEMuxer.h"
+#import "MEDemuxer.h"
 
 /* =================================================================================== */
 // MARK: -
@@ -56,6 +58,32 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)appendSampleBuffer:(CMSampleBufferRef _Nullable)sb;
 
+/**
+ * @brief Append decoded frame to input pipeline
+ * @discussion Input bridge API for the libavcodec decoder backend. Same as
+ * -appendSampleBuffer:, but the decoded AVFrame is moved into the filter/encoder
+ * input as is; no CMSampleBuffer is created and no image data is copied.
+ * Timestamps are rescaled from frame->time_base to the manager time base.
+ * @param frame Decoded AVFrame; its reference is taken over (NULL to signal flush)
+ * @return TRUE if frame was accepted, FALSE if error or pipeline not ready
+ */
+- (BOOL)appendFrame:(AVFrame * _Nullable)frame;
+
+/**
+ * @brief Feed decoded frames from a libavcodec decoder
+ * @discussion Input bridge API for MEDemuxer; plays the role SBChannel plays for
+ * MEInput. Once queueing starts, frames are decoded on queue and appended until
+ * end of stream, failure, or shouldStop returns YES. Frames outside range are
+ * skipped; the others are rescaled from the stream time_base to 1/mediaTimeScale. Then the input is marked as finished and handler receives 0 or the
+ * decoder AVERROR code.
+ * @param range Source time range to append (kCMTimeRangeInvalid for all frames)
+ */
+- (void)appendFramesFromDemuxer:(MEDemuxer*)demuxer
+                        onQueue:(dispatch_queue_t)queue
+                          range:(CMTimeRange)range
+                     shouldStop:(BOOL (^)(void))shouldStop
+              completionHandler:(void (^)(int result))handler;
+
 /**
  * @brief Check if pipeline is ready for more input
  * @discussion Input bridge API (mimics AVAssetWriterInput). Returns whether
@@ -80,6 +108,16 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (nullable CMSampleBufferRef)copyNextSampleBuffer CF_RETURNS_RETAINED;
 
+/**
+ * @brief Write next encoded packet to a libavformat muxer
+ * @discussion Output bridge API for the libavformat backend. Pulls the next
+ * encoded packet like -copyNextSampleBuffer, but hands the AVPacket to the muxer
+ * without creating a CMSampleBuffer. The video stream is added and the header
+ * written when the first packet arrives. Requires the video encoder.
+ * @return 1 when a packet was written, 0 at end of stream, -1 on failure
+ */
+- (int)writeNextPacketToMuxer:(MEMuxer*)muxer;
+
 /**
  * @brief Get the natural display size for the output video
  * @discussion Computes the display size accounting for pixel aspect ratio.
@@ -15,9 +15,11 @@
 #import "MECommon.h"
 #import "MEUtils.h"
 #import "MESecureLogging.h"
+#import "MEMetrics.h"
 #import "MEFilterPipeline.h"
 #import "MEEncoderPipeline.h"
 #import "MESampleBufferFactory.h"
+#import "MELatencyTracker.h"
 #import "Config/MEVideoEncoderConfig.h"
 
 /* =================================================================================== */
@@ -38,11 +40,46 @@ static inline BOOL useVideoEncoder(MEManager *obj) {
     return (obj.videoEncoderSetting != NULL);
 }
 
+// Metrics/trace payload of a frame or packet; read before it is handed over
+typedef struct {
+    uint64_t bytes;
+    double pts;     // seconds, or NAN
+} MEProbeInfo;
+
+static const MEProbeInfo kNoProbeInfo = {0, NAN};
+
+static inline double probeSeconds(MEManager *obj, int64_t pts) {
+    CMTimeScale timeBase = obj.timeBase;
+    return (pts != AV_NOPTS_VALUE && timeBase > 0) ? (double)pts / timeBase : NAN;
+}
+
+static MEProbeInfo frameProbeInfo(MEManager *obj, const AVFrame* _Nullable frame) {
+    MEProbeInfo info = kNoProbeInfo;
+    if (frame) {
+        for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) {
+            info.bytes += frame->buf[i]->size;
+        }
+        info.pts = probeSeconds(obj, frame->pts);
+    }
+    return info;
+}
+
 static inline long waitOnSemaphore(dispatch_semaphore_t semaphore, uint64_t timeoutMilliseconds) {
     dispatch_time_t timeout = dispatch_time(DISPATCH_TIME_NOW, timeoutMilliseconds * NSEC_PER_MSEC);
     return dispatch_semaphore_wait(semaphore, timeout);
 }
 
+// Retry interval while the filter/encoder returns EAGAIN
+static inline uint64_t eagainDelayMilliseconds(MEManager *self) {
+    return self.lowLatency ? 1 : 50;
+}
+
+static void logLatencySummary(MEManager *self) {
+    if (self.latencyTracker) {
+        SecureLogf(@"[MEManager] Latency: %@", [self.latencyTracker summary]);
+    }
+}
+
 static BOOL shouldStopQueueing(MEManager* self) {
     if (self.failed) goto error;
     AVAssetWriterStatus status = self.writerStatus;
@@ -87,7 +124,10 @@ static void enqueueToME(MEManager *self, int *ret) {
         
         // Delegate to filter pipeline to push frame
         void *frameToSend = inputFrameIsReady ? input : NULL;
+        uint64_t t0 = MEMetricsBegin();
+        MEProbeInfo probe = (t0 ? frameProbeInfo(self, frameToSend) : kNoProbeInfo);
         BOOL success = [self.filterPipeline pushFrameToFilter:frameToSend withResult:ret];
+        MEMetricsEndPTS(MEMetricsStageFilterPush, t0, (success && *ret == 0 && frameToSend), probe.bytes, probe.pts);
         
         if (success && *ret == 0) {
             if (inputFrameIsReady) {
@@ -124,7 +164,10 @@ static void enqueueToME(MEManager *self, int *ret) {
         
         // Delegate to encoder pipeline to send frame
         void *frameToSend = inputFrameIsReady ? input : NULL;
+        uint64_t t0 = MEMetricsBegin();
+        MEProbeInfo probe = (t0 ? frameProbeInfo(self, frameToSend) : kNoProbeInfo);
         BOOL success = [self.encoderPipeline sendFrameToEncoder:frameToSend withResult:ret];
+        MEMetricsEndPTS(MEMetricsStageEncoderSend, t0, (success && *ret == 0 && frameToSend), probe.bytes, probe.pts);
         
         if (success && *ret == 0) {
             // Note: Do NOT call av_frame_unref here - sendFrameToEncoder takes ownership
@@ -149,7 +192,13 @@ error:
 
 static void pullFilteredFrame(MEManager *self, int *ret) {
     // Delegate to filter pipeline
+    uint64_t t0 = MEMetricsBegin();
     BOOL success = [self.filterPipeline pullFilteredFrameWithResult:ret];
+    if (t0) {
+        BOOL pulled = (success && *ret == 0);
+        MEProbeInfo probe = (pulled ? frameProbeInfo(self, [self.filterPipeline filteredFrame]) : kNoProbeInfo);
+        MEMetricsEndPTS(MEMetricsStageFilterPull, t0, pulled, probe.bytes, probe.pts);
+    }
     if (!success && *ret < 0) {
         if (*ret != AVERROR(EAGAIN) && *ret != AVERROR_EOF) {
             self.failed = TRUE;
@@ -179,7 +228,10 @@ static void pushFilteredFrame(MEManager *self, int *ret) {
     
     if (self.filteredValid) {                               // Push filtered frame into encoder
         void *filteredFrame = [self.filterPipeline filteredFrame];
+        uint64_t t0 = MEMetricsBegin();
+        MEProbeInfo probe = (t0 ? frameProbeInfo(self, filteredFrame) : kNoProbeInfo);
         BOOL success = [self.encoderPipeline sendFrameToEncoder:filteredFrame withResult:ret];
+        MEMetricsEndPTS(MEMetricsStageEncoderSend, t0, (success && *ret == 0), probe.bytes, probe.pts);
         if (success && *ret == 0) {
             [self.filterPipeline resetFilteredFrame];
             return;
@@ -222,7 +274,14 @@ static void pullEncodedPacket(MEManager *self, int *ret) {
     }
     
     // Delegate to encoder pipeline
+    uint64_t t0 = MEMetricsBegin();
     BOOL success = [self.encoderPipeline receivePacketFromEncoderWithResult:ret];
+    if (t0) {
+        AVPacket* packet = (success && *ret == 0) ? (AVPacket*)[self.encoderPipeline encodedPacket] : NULL;
+        MEMetricsEndPTS(MEMetricsStageEncoderReceive, t0, (packet != NULL),
+                        (packet ? (uint64_t)packet->size : 0),
+                        (packet ? probeSeconds(self, packet->pts) : NAN));
+    }
     if (success && *ret == 0) {
         return;
     } else if (*ret == AVERROR(EAGAIN)) {                   // Encoder requests more input
@@ -255,7 +314,7 @@ static BOOL initialQueueing(MEManager *self) {
         CFAbsoluteTime limit = CFAbsoluteTimeGetCurrent() + delayLimitInSec;
         
         // Use semaphore wait instead of av_usleep for initial delay
-        int64_t timeoutMilliseconds = self.initialDelayInSec * MSEC_PER_SEC;
+        int64_t timeoutMilliseconds = self.lowLatency ? 0 : self.initialDelayInSec * MSEC_PER_SEC;
         waitOnSemaphore(self.eagainDelaySemaphore, timeoutMilliseconds);
         
         if (useVideoFilter(self)) {
@@ -290,6 +349,163 @@ error:
     return FALSE;
 }
 
+static BOOL startQueueing(MEManager *self) {
+    if (!self.queueing) {
+        if (self.verbose) {
+            SecureDebugLogf(@"[MEManager] videoEncoderSettings = \n%@", [self.videoEncoderSetting description]);
+            SecureDebugLogf(@"[MEManager] videoFilterString = %@", self.videoFilterString);
+        }
+        
+        self.queueing = initialQueueing(self);
+    }
+    return self.queueing;
+}
+
+/// Run the filter/encoder until the encoder pipeline holds the next packet.
+/// @return 1 when a packet is ready, 0 at end of stream, -1 on failure
+static int dequeueEncodedPacket(MEManager *self) {
+    __block int ret = 0;
+    
+    if (useVideoFilter(self)) {                         // filtered => encode => output
+        int countEAGAIN = 0;
+        do {
+            @autoreleasepool {
+                countEAGAIN = 0;
+                if (!self.videoFilterEOF) {
+                    [self output_sync:^{
+                        pullFilteredFrame(self, &ret);      // Pull filtered frame from the filtergraph
+                    }];
+                    if (self.failed) goto error;
+                    if (ret < 0) {
+                        if (ret == AVERROR_EOF) {
+                            ret = 0;
+                        }
+                        if (ret == AVERROR(EAGAIN)) {
+                            countEAGAIN++;                  // filtergraph requires more frame
+                            ret = 0;
+                        }
+                        if (ret < 0) {
+                            SecureErrorLogf(@"[MEManager] ERROR: Filter graph detected: %d", ret);
+                            goto error;
+                        }
+                    }
+                    
+                    // Fill missing metadata from cached input metadata as fallback
+                    if (self.filteredValid && self.colorMetadataCached) {
+                        void *filteredFrame = [self.filterPipeline filteredFrame];
+                        struct AVFrameColorMetadata *cachedColorMetadata = [self cachedColorMetadata];
+                        if (filteredFrame) {
+                            AVFrameFillMetadataFromCache((AVFrame *)filteredFrame, cachedColorMetadata);
+                        }
+                    }
+                }
+                {
+                    [self output_sync:^{
+                        pushFilteredFrame(self, &ret);      // Push filtered frame into encoder
+                        if (self.failed) return;
+                        if (ret < 0) return;
+                        pullEncodedPacket(self, &ret);      // Pull compressed output from encoder
+                    }];
+                    if (self.failed) goto error;
+                    if (ret < 0) {
+                        if (ret == AVERROR_EOF) {
+                            ret = 0;
+                        }
+                        if (ret == AVERROR(EAGAIN)) {
+                            countEAGAIN++;                  // encoder requires more frame
+                            ret = 0;
+                        }
+                        if (ret < 0) {
+                            SecureErrorLogf(@"[MEManager] ERROR: Filter graph detected: %d", ret);
+                            goto error;
+                        }
+                    }
+                }
+                if (countEAGAIN == 2) {                     // Try next queueing after delay
+                    waitOnSemaphore(self.eagainDelaySemaphore, eagainDelayMilliseconds(self));
+                    if (self.failed) goto error;
+                }
+            }
+        } while(countEAGAIN > 0);                       // loop - blocking
+    } else {                                            // encode => output
+        int countEAGAIN = 0;
+        do {
+            @autoreleasepool {
+                countEAGAIN = 0;
+                [self output_sync:^{
+                    pullEncodedPacket(self, &ret);          // Pull compressed output from encoder
+                }];
+                if (self.failed) goto error;
+                if (ret < 0) {
+                    if (ret == AVERROR_EOF) {
+                        ret = 0;
+                    }
+                    if (ret == AVERROR(EAGAIN)) {
+                        countEAGAIN++;                      // encoder requires more frame
+                        ret = 0;
+                    }
+                    if (ret < 0) {
+                        SecureErrorLogf(@"[MEManager] ERROR: Encoder detected: %d", ret);
+                        break;
+                    }
+                }
+                if (countEAGAIN == 1) {                     // Try next queueing after delay
+                    waitOnSemaphore(self.eagainDelaySemaphore, eagainDelayMilliseconds(self));
+                    if (self.failed) goto error;
+                }
+            }
+        } while(countEAGAIN > 0);                       // loop - blocking
+    }
+    if (self.videoFilterEOF && self.videoEncoderEOF) {
+        SecureLogf(@"[MEManager] End of output stream detected.");
+        logLatencySummary(self);
+        return 0;
+    }
+    if (ret == 0) {
+        return 1;
+    }
+    SecureErrorLogf(@"[MEManager] ERROR: Unable to dequeue the encoded packet.");
+    
+error:
+    self.failed = TRUE;
+    return -1;
+}
+
+/// Feed the input frame (or the flush request) into the filter/encoder.
+/// Blocks while the input/output timestamp gap is too large or the pipeline returns EAGAIN.
+static BOOL enqueueInputFrame(MEManager *self) {
+    __block int ret = 0;
+    int64_t gapLimitInSec = self.timeBase * (self.lowLatency ? 1 : 10);
+    do {
+        @autoreleasepool {
+            // Wait until the input/output timestamp gap is less than 10 seconds (1 second in low latency).
+            while (llabs(self.lastEnqueuedPTS - self.lastDequeuedPTS) >= gapLimitInSec) {
+                // Use semaphore wait instead of busy loop with usleep
+                waitOnSemaphore(self.timestampGapSemaphore, eagainDelayMilliseconds(self));
+                if (self.failed) return NO;
+            }
+            
+            // Feed a new frame into the filter/encoder context
+            [self output_sync:^{
+                enqueueToME(self, &ret);
+            }];
+            
+            // Abort on unexpected errors (other than EAGAIN)
+            if (self.failed || (ret < 0 && ret != AVERROR(EAGAIN))) {
+                SecureErrorLogf(@"[MEManager] ERROR: Failed to enqueue the input frame (ret=%d)", ret);
+                return NO;
+            }
+            
+            // Retry enqueue if EAGAIN is returned
+            if (ret == AVERROR(EAGAIN)) {
+                // Use semaphore wait instead of av_usleep for backoff
+                waitOnSemaphore(self.eagainDelaySemaphore, eagainDelayMilliseconds(self));
+            }
+        }
+    } while (ret == AVERROR(EAGAIN));
+    return YES;
+}
+
 /* =================================================================================== */
 // MARK: - Category implementation
 /* =================================================================================== */
@@ -327,6 +543,9 @@ error:
 - (BOOL)appendSampleBuffer:(CMSampleBufferRef _Nullable)sb
 {
     AVFrame *input = (AVFrame *)[self input];
+    if (sb && self.latencyTracker) {
+        [self.latencyTracker markInputPTS:CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb))];
+    }
 
     if (self.failed) goto error;
     AVAssetWriterStatus status = self.writerStatus;
@@ -361,7 +580,10 @@ error:
     }
     
     if (sb) {                                               // Create AVFrame from CMSampleBuffer
+        uint64_t t0 = MEMetricsBegin();
         BOOL result = [self prepareInputFrameWith:sb];
+        MEProbeInfo probe = ((result && t0) ? frameProbeInfo(self, input) : kNoProbeInfo);
+        MEMetricsEndPTS(MEMetricsStagePrepareInput, t0, result, probe.bytes, probe.pts);
         if (!result) {
             SecureErrorLogf(@"[MEManager] ERROR: Failed to prepare the input frame");
             goto error;
@@ -370,40 +592,80 @@ error:
         // Treat as flush request
     }
     
-    {
-        __block int ret = 0;
-        int64_t gapLimitInSec = self.timeBase * 10;
-        do {
-            @autoreleasepool {
-                // Wait until the input/output timestamp gap is less than 10 seconds.
-                while (llabs(self.lastEnqueuedPTS - self.lastDequeuedPTS) >= gapLimitInSec) {
-                    // Use semaphore wait instead of busy loop with usleep
-                    waitOnSemaphore(self.timestampGapSemaphore, 50);
-                    if (self.failed) return NO;
-                }
-                
-                // Feed a new frame into the filter/encoder context
-                [self output_sync:^{
-                    enqueueToME(self, &ret);
-                }];
-                
-                // Abort on unexpected errors (other than EAGAIN)
-                if (self.failed || (ret < 0 && ret != AVERROR(EAGAIN))) {
-                    SecureErrorLogf(@"[MEManager] ERROR: Failed to enqueue the input frame (ret=%d)", ret);
-                    return NO;
-                }
-                
-                // Retry enqueue if EAGAIN is returned
-                if (ret == AVERROR(EAGAIN)) {
-                    // Use semaphore wait instead of av_usleep for backoff
-                    waitOnSemaphore(self.eagainDelaySemaphore, 50);
-                }
+    return enqueueInputFrame(self);
+    
+error:
+    // Clean up input frame on error to prevent memory leaks
+    if (input) {
+        av_frame_unref(input);
+    }
+    self.failed = TRUE;
+    self.writerStatus = AVAssetWriterStatusFailed;
+    return FALSE;
+}
+
+- (BOOL)appendFrame:(AVFrame * _Nullable)frame
+{
+    AVFrame *input = (AVFrame *)[self input];
+    if (frame && self.latencyTracker && frame->pts != AV_NOPTS_VALUE && frame->time_base.den > 0) {
+        [self.latencyTracker markInputPTS:frame->pts * av_q2d(frame->time_base)];
+    }
+    
+    if (self.failed) goto error;
+    AVAssetWriterStatus status = self.writerStatus;
+    if (status != AVAssetWriterStatusWriting &&
+        status != AVAssetWriterStatusUnknown) {
+        return FALSE; // No more input allowed
+    }
+    if (useVideoFilter(self)) {                         // Verify if filtergraph is ready
+        if (!self.videoFilterIsReady) {                 // Prepare filter graph
+            if (!frame) {
+                SecureErrorLogf(@"[MEManager] ERROR: No decoded frame to prepare the filter graph");
+                goto error;
             }
-        } while (ret == AVERROR(EAGAIN));
-        return TRUE;
+            BOOL result = [self prepareVideoFilterWithFrame:frame];
+            if (!result || !self.videoFilterIsReady) {
+                SecureErrorLogf(@"[MEManager] ERROR: Failed to prepare the filter graph");
+                goto error;
+            }
+        }
+        if (self.videoFilterFlushed) {
+            return FALSE;
+        }
+    } else {                                            // verify if encoder is ready
+        if (!self.videoEncoderIsReady) {                // use new decoded frame
+            if (!frame) {
+                SecureErrorLogf(@"[MEManager] ERROR: No decoded frame to prepare the encoder");
+                goto error;
+            }
+            BOOL result = [self prepareVideoEncoderWithFrame:frame];
+            if (!result || !self.videoEncoderIsReady) {
+                SecureErrorLogf(@"[MEManager] ERROR: Failed to prepare the encoder");
+                goto error;
+            }
+        }
+        if (self.videoEncoderFlushed) {
+            return FALSE;
+        }
+    }
+    
+    if (frame) {                                            // Move decoded AVFrame into input
+        uint64_t t0 = MEMetricsBegin();
+        BOOL result = [self prepareInputFrameWithFrame:frame];
+        input = (AVFrame *)[self input];
+        MEProbeInfo probe = ((result && t0) ? frameProbeInfo(self, input) : kNoProbeInfo);
+        MEMetricsEndPTS(MEMetricsStagePrepareInput, t0, result, probe.bytes, probe.pts);
+        if (!result) {
+            SecureErrorLogf(@"[MEManager] ERROR: Failed to prepare the input frame");
+            goto error;
+        }
+    } else {
+        // Treat as flush request
     }
+    
+    return enqueueInputFrame(self);
+    
 error:
-    // Clean up input frame on error to prevent memory leaks
     if (input) {
         av_frame_unref(input);
     }
@@ -412,6 +674,62 @@ error:
     return FALSE;
 }
 
+- (void)appendFramesFromDemuxer:(MEDemuxer*)demuxer
+                        onQueue:(dispatch_queue_t)queue
+                          range:(CMTimeRange)range
+                     shouldStop:(BOOL (^)(void))shouldStop
+              completionHandler:(void (^)(int result))handler
+{
+    BOOL ranged = CMTIMERANGE_IS_VALID(range);
+    double startSec = ranged ? CMTimeGetSeconds(range.start) : -INFINITY;
+    double endSec = ranged ? CMTimeGetSeconds(CMTimeRangeGetEnd(range)) : INFINITY;
+    __block BOOL finished = FALSE;
+    __weak typeof(self) wself = self;
+    
+    // Runs once queueing starts (see initialQueueing); feeds frames until EOF
+    [self requestMediaDataWhenReadyOnQueueInternal:queue usingBlock:^{
+        MEManager* sself = wself;
+        if (!sself || finished) return;
+        AVFrame* frame = av_frame_alloc();
+        int result = frame ? 0 : AVERROR(ENOMEM);
+        BOOL more = (frame != NULL);
+        AVRational timeBase = av_make_q(1, sself.mediaTimeScale);
+        while (more && sself.isReadyForMoreMediaData && !shouldStop()) {
+            @autoreleasepool {
+                uint64_t t0 = MEMetricsBegin();
+                int ret = MEDemuxerReadFrame(demuxer, frame);
+                double pts = ((ret == 0 && frame->pts != AV_NOPTS_VALUE)
+                              ? frame->pts * av_q2d(frame->time_base) : NAN);
+                MEMetricsEndPTS(MEMetricsStageReaderWait, t0, (ret == 0), 0, pts);
+                if (ret < 0) {
+                    if (ret != AVERROR_EOF) result = ret;
+                    more = FALSE;
+                } else if (pts < startSec) {
+                    continue;                               // before the requested range
+                } else if (pts >= endSec) {
+                    more = FALSE;                           // past the requested range
+                } else {
+                    // the filter and encoder count in 1/mediaTimeScale
+                    if (av_cmp_q(frame->time_base, timeBase) != 0) {
+                        if (frame->pts != AV_NOPTS_VALUE) {
+                            frame->pts = av_rescale_q(frame->pts, frame->time_base, timeBase);
+                        }
+                        if (frame->duration > 0) {
+                            frame->duration = av_rescale_q(frame->duration, frame->time_base, timeBase);
+                        }
+                        frame->time_base = timeBase;
+                    }
+                    more = [sself appendFrame:frame];
+                }
+            }
+        }
+        av_frame_free(&frame);
+        finished = TRUE;
+        [sself markAsFinished];
+        handler(result);
+    }];
+}
+
 - (BOOL)isReadyForMoreMediaData
 {
     return !shouldStopQueueing(self);
@@ -438,123 +756,30 @@ error:
         return NULL; // No more output allowed
     }
     
-    if (!self.queueing) {
-        if (self.verbose) {
-            SecureDebugLogf(@"[MEManager] videoEncoderSettings = \n%@", [self.videoEncoderSetting description]);
-            SecureDebugLogf(@"[MEManager] videoFilterString = %@", self.videoFilterString);
-        }
-        
-        self.queueing = initialQueueing(self);
-        if (!self.queueing) {
-            goto error;
-        }
+    if (!startQueueing(self)) {
+        goto error;
     }
     
     if (useVideoEncoder(self)) {                            // encode => output
-        if (useVideoFilter(self)) {                         // filtered => encode => output
-            int countEAGAIN = 0;
-            do {
-                @autoreleasepool {
-                    countEAGAIN = 0;
-                    if (!self.videoFilterEOF) {
-                        [self output_sync:^{
-                            pullFilteredFrame(self, &ret);      // Pull filtered frame from the filtergraph
-                        }];
-                        if (self.failed) goto error;
-                        if (ret < 0) {
-                            if (ret == AVERROR_EOF) {
-                                ret = 0;
-                            }
-                            if (ret == AVERROR(EAGAIN)) {
-                                countEAGAIN++;                  // filtergraph requires more frame
-                                ret = 0;
-                            }
-                            if (ret < 0) {
-                                SecureErrorLogf(@"[MEManager] ERROR: Filter graph detected: %d", ret);
-                                goto error;
-                            }
-                        }
-                        
-                        // Fill missing metadata from cached input metadata as fallback
-                        if (self.filteredValid && self.colorMetadataCached) {
-                            void *filteredFrame = [self.filterPipeline filteredFrame];
-                            struct AVFrameColorMetadata *cachedColorMetadata = [self cachedColorMetadata];
-                            if (filteredFrame) {
-                                AVFrameFillMetadataFromCache((AVFrame *)filteredFrame, cachedColorMetadata);
-                            }
-                        }
-                    }
-                    {
-                        [self output_sync:^{
-                            pushFilteredFrame(self, &ret);      // Push filtered frame into encoder
-                            if (self.failed) return;
-                            if (ret < 0) return;
-                            pullEncodedPacket(self, &ret);      // Pull compressed output from encoder
-                        }];
-                        if (self.failed) goto error;
-                        if (ret < 0) {
-                            if (ret == AVERROR_EOF) {
-                                ret = 0;
-                            }
-                            if (ret == AVERROR(EAGAIN)) {
-                                countEAGAIN++;                  // encoder requires more frame
-                                ret = 0;
-                            }
-                            if (ret < 0) {
-                                SecureErrorLogf(@"[MEManager] ERROR: Filter graph detected: %d", ret);
-                                goto error;
-                            }
-                        }
-                    }
-                    if (countEAGAIN == 2) {                     // Try next queueing after delay
-                        waitOnSemaphore(self.eagainDelaySemaphore, 50);
-                        if (self.failed) goto error;
-                    }
-                }
-            } while(countEAGAIN > 0);                       // loop - blocking
-        } else {                                            // encode => output
-            int countEAGAIN = 0;
-            do {
-                @autoreleasepool {
-                    countEAGAIN = 0;
-                    [self output_sync:^{
-                        pullEncodedPacket(self, &ret);          // Pull compressed output from encoder
-                    }];
-                    if (self.failed) goto error;
-                    if (ret < 0) {
-                        if (ret == AVERROR_EOF) {
-                            ret = 0;
-                        }
-                        if (ret == AVERROR(EAGAIN)) {
-                            countEAGAIN++;                      // encoder requires more frame
-                            ret = 0;
-                        }
-                        if (ret < 0) {
-                            SecureErrorLogf(@"[MEManager] ERROR: Encoder detected: %d", ret);
-                            break;
-                        }
-                    }
-                    if (countEAGAIN == 1) {                     // Try next queueing after delay
-                        waitOnSemaphore(self.eagainDelaySemaphore, 50);
-                        if (self.failed) goto error;
-                    }
-                }
-            } while(countEAGAIN > 0);                       // loop - blocking
-        }
-        if (self.videoFilterEOF && self.videoEncoderEOF) {
-            SecureLogf(@"[MEManager] End of output stream detected.");
+        int dequeued = dequeueEncodedPacket(self);
+        if (dequeued == 0) {
             return NULL;
         }
-        if (ret == 0) {
+        if (dequeued > 0) {
+            uint64_t t0 = MEMetricsBegin();
             sb = [self createCompressedSampleBuffer];       // Create CMSampleBuffer from encoded packet
+            if (t0) {
+                MEMetricsEndPTS(MEMetricsStageCreateSampleBuffer, t0, (sb != NULL),
+                                (sb ? CMSampleBufferGetTotalSampleSize(sb) : 0),
+                                (sb ? CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb)) : NAN));
+            }
             if (sb) {
+                [self.latencyTracker markOutputPTS:CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb))];
                 // Let the encoder pipeline handle the packet cleanup
                 return sb;
             } else {
                 SecureErrorLogf(@"[MEManager] ERROR: Failed to createCompressedSampleBuffer.");
             }
-        } else {
-            SecureErrorLogf(@"[MEManager] ERROR: Unable to createCompressedSampleBuffer.");
         }
     } else {                                                // filtered => output
         {
@@ -581,7 +806,7 @@ error:
                         }
                     }
                     if (countEAGAIN == 1) {                     // Try next queueing after delay
-                        waitOnSemaphore(self.eagainDelaySemaphore, 50);
+                        waitOnSemaphore(self.eagainDelaySemaphore, eagainDelayMilliseconds(self));
                         if (self.failed) {
                             goto error;
                         }
@@ -591,11 +816,18 @@ error:
         }
         if (self.videoFilterEOF) {
             SecureLogf(@"[MEManager] End of output stream detected.");
+            logLatencySummary(self);
             return NULL;
         }
         if (ret == 0) {
+            uint64_t t0 = MEMetricsBegin();
             sb = [self createUncompressedSampleBuffer];     // Create CMSampleBuffer from filtered frame
+            if (t0) {
+                MEMetricsEndPTS(MEMetricsStageCreateSampleBuffer, t0, (sb != NULL), 0,
+                                (sb ? CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb)) : NAN));
+            }
             if (sb) {
+                [self.latencyTracker markOutputPTS:CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb))];
                 [self.filterPipeline resetFilteredFrame];
                 return sb;
             } else {
@@ -611,6 +843,58 @@ error:
     return NULL;
 }
 
+- (int)writeNextPacketToMuxer:(MEMuxer*)muxer
+{
+    if (self.failed) return -1;
+    if (!useVideoEncoder(self)) {
+        SecureErrorLogf(@"[MEManager] ERROR: The muxer requires the video encoder.");
+        self.failed = TRUE;
+        return -1;
+    }
+    if (!startQueueing(self)) {
+        self.failed = TRUE;
+        return -1;
+    }
+    
+    int dequeued = dequeueEncodedPacket(self);
+    if (dequeued <= 0) return dequeued;
+    
+    AVPacket *packet = (AVPacket *)[self.encoderPipeline encodedPacket];
+    AVCodecContext *avctx = (AVCodecContext *)[self.encoderPipeline codecContext];
+    if (self.muxerStreamIndex < 0) {                        // extradata is ready with the first packet
+        MEMuxerCleanAperture clap = {0, 0, 0, 0};
+        NSValue *cleanApertureValue = self.videoEncoderConfig.cleanAperture ?: self.videoEncoderSetting[kMEVECleanApertureKey];
+        if (cleanApertureValue) {
+            NSRect rect = cleanApertureValue.rectValue;     // same layout as createDescriptionWithAperture()
+            clap.width = rect.origin.x;
+            clap.height = rect.origin.y;
+            clap.hOffset = rect.size.width;
+            clap.vOffset = rect.size.height;
+        }
+        int index = MEMuxerAddVideoStream(muxer, avctx, (cleanApertureValue ? &clap : NULL));
+        int ret = (index < 0) ? index : MEMuxerWriteHeader(muxer);
+        if (ret < 0) {
+            SecureErrorLogf(@"[MEManager] ERROR: Cannot start the muxer (%d)", ret);
+            self.failed = TRUE;
+            return -1;
+        }
+        self.muxerStreamIndex = index;
+    }
+    
+    uint64_t t0 = MEMetricsBegin();
+    uint64_t bytes = (uint64_t)packet->size;
+    double pts = probeSeconds(self, packet->pts);
+    int ret = MEMuxerWritePacket(muxer, self.muxerStreamIndex, packet, av_make_q(1, self.timeBase));
+    MEMetricsEndPTS(MEMetricsStageWriterAppend, t0, (ret == 0), bytes, pts);
+    if (ret < 0) {
+        SecureErrorLogf(@"[MEManager] ERROR: Cannot write the packet to the muxer (%d)", ret);
+        self.failed = TRUE;
+        return -1;
+    }
+    [self.latencyTracker markOutputPTS:pts];
+    return 1;
+}
+
 - (CGSize)naturalSize
 {
     // Prefer type-safe config
@@ -31,6 +31,7 @@
 @class MEFilterPipeline;
 @class MEEncoderPipeline;
 @class MESampleBufferFactory;
+@class MELatencyTracker;
 
 /* =================================================================================== */
 // MARK: -
@@ -91,6 +92,32 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic) float initialDelayInSec;
 @property (nonatomic) BOOL verbose;
 @property (nonatomic) int log_level;
+/**
+ Encoder and filter thread budget. 0 keeps the libav defaults.
+ */
+@property (nonatomic) int threadCount;
+/**
+ Keep parameter sets out of band in the encoder extradata (default YES).
+ NO repeats them in the stream, for headerless outputs such as Annex-B.
+ */
+@property (nonatomic) BOOL useGlobalHeader;
+/**
+ Low latency: zero-latency encoder, no initial delay, 1 sec timestamp gap and 1 msec
+ retry waits. Frame-in to packet-out latency is recorded in latencyTracker.
+ */
+@property (nonatomic) BOOL lowLatency;
+/**
+ Run the video encoder in a child process (MEWorkerEncoderPipeline), restarted
+ from the last closed GOP after a crash. Set before the encoder is prepared.
+ */
+@property (nonatomic) BOOL encoderWorker;
+/**
+ Affinity tag of the cache domain for the filter and encoder work of this manager
+ (MEAffinityNextTag()); threads the filter graph and encoder create inherit it.
+ 0 leaves placement to the scheduler. Set before the first sample.
+ */
+@property (nonatomic) NSInteger affinityTag;
+@property (nonatomic, strong, readonly, nullable) MELatencyTracker *latencyTracker;
 
 /**
  * Filter pipeline component for video filtering operations
@@ -19,7 +19,9 @@
 #import "MEErrorFormatter.h"
 #import "MEFilterPipeline.h"
 #import "MEEncoderPipeline.h"
+#import "MEWorkerEncoderPipeline.h"
 #import "MESampleBufferFactory.h"
+#import "MELatencyTracker.h"
 
 /* =================================================================================== */
 // MARK: -
@@ -140,6 +142,7 @@ NS_ASSUME_NONNULL_BEGIN
         readerStatus = AVAssetReaderStatusUnknown;
         writerStatus = AVAssetWriterStatusUnknown;
         initialDelayInSec = 1.0;
+        _muxerStreamIndex = -1;
         inputQueueKey = &inputQueueKey;
         outputQueueKey = &outputQueueKey;
         
@@ -237,8 +240,9 @@ NS_ASSUME_NONNULL_BEGIN
 {
     videoFilterString = filterString;
     
-    // Sync to filter pipeline
+    // Sync to filter pipeline and sample buffer factory
     self.filterPipeline.filterString = filterString;
+    self.sampleBufferFactory.videoFilterString = filterString;
 }
 
 - (void)setVerbose:(BOOL)verbose
@@ -260,6 +264,59 @@ NS_ASSUME_NONNULL_BEGIN
     self.encoderPipeline.logLevel = logLevel;
 }
 
+- (void)setThreadCount:(int)threadCount
+{
+    _threadCount = threadCount;
+    
+    // Sync to all pipeline components
+    self.filterPipeline.threadCount = threadCount;
+    self.encoderPipeline.threadCount = threadCount;
+}
+
+- (BOOL)useGlobalHeader
+{
+    return self.encoderPipeline.useGlobalHeader;
+}
+
+- (void)setUseGlobalHeader:(BOOL)useGlobalHeader
+{
+    self.encoderPipeline.useGlobalHeader = useGlobalHeader;
+}
+
+- (void)setLowLatency:(BOOL)lowLatency
+{
+    _lowLatency = lowLatency;
+    self.encoderPipeline.lowLatency = lowLatency;
+    if (lowLatency && !_latencyTracker) {
+        _latencyTracker = [MELatencyTracker new];
+    }
+}
+
+- (void)setEncoderWorker:(BOOL)encoderWorker
+{
+    if (_encoderWorker == encoderWorker) return;
+    if (self.encoderPipeline.isReady) {
+        SecureErrorLogf(@"[MEManager] ERROR: encoderWorker cannot be changed after the encoder is prepared.");
+        return;
+    }
+    _encoderWorker = encoderWorker;
+    
+    // Replace the encoder pipeline, carrying over what was synced to it so far
+    MEEncoderPipeline *previous = self.encoderPipeline;
+    MEEncoderPipeline *pipeline = encoderWorker ? [[MEWorkerEncoderPipeline alloc] init] : [[MEEncoderPipeline alloc] init];
+    pipeline.videoEncoderSetting = previous.videoEncoderSetting;
+    pipeline.videoEncoderConfig = videoEncoderConfig;
+    pipeline.sourceExtensions = previous.sourceExtensions;
+    pipeline.verbose = previous.verbose;
+    pipeline.logLevel = previous.logLevel;
+    pipeline.threadCount = previous.threadCount;
+    pipeline.useGlobalHeader = previous.useGlobalHeader;
+    pipeline.lowLatency = previous.lowLatency;
+    pipeline.timeBase = previous.timeBase;
+    _encoderPipeline = pipeline;
+    encoderReadySemaphore = pipeline.encoderReadySemaphore;
+}
+
 - (void)setSourceExtensions:(CFDictionaryRef _Nullable)extensions
 {
     sourceExtensions = extensions;
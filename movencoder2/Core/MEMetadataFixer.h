@@ -0,0 +1,72 @@
+//
+//  MEMetadataFixer.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEMetadataFixer.h
+ * @abstract Internal API - Rewrite color, aspect and field tags without re-encoding
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEMetadataFixer builds a replacement for a video sample description. For
+ * H.264/HEVC the parameter sets are taken from the description
+ * (parameterSetsOfDescription), the SPS VUI is rewritten by the libavcodec
+ * h264_metadata/hevc_metadata bitstream filter, and the description is built
+ * again by createDescriptionH264/H265. PPS, SEI and the VPS pass through the
+ * filter unchanged. The colr, pasp and fiel extensions are then set on it.
+ * Other codecs get the extensions only.
+ *
+ * The samples are not touched. Streams that also carry parameter sets in band
+ * (avc3/hev1) keep the old VUI in those copies.
+ *
+ * Options (NSString values):
+ * - primaries, transfer, matrix: ISO/IEC 23091-4 code point or FFmpeg name
+ *   (bt709, bt2020, smpte2084, arib-std-b67, bt2020nc, ...)
+ * - range: full or limited
+ * - sar: sample aspect ratio as h:v
+ * - field: progressive, tff or bff (container only)
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEMetadataFixer_h
+#define MEMetadataFixer_h
+
+@import Foundation;
+@import CoreMedia;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEMetadataFixer : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/// nil with an error if an option is unknown or its value is invalid
+- (nullable instancetype)initWithOptions:(NSDictionary<NSString*, NSString*>*)options
+                                   error:(NSError * _Nullable * _Nullable)error NS_DESIGNATED_INITIALIZER;
++ (nullable instancetype)fixerWithOptions:(NSDictionary<NSString*, NSString*>*)options
+                                    error:(NSError * _Nullable * _Nullable)error;
+
+/// Option names taken by initWithOptions:error:
++ (NSArray<NSString*>*)optionNames;
+
+/**
+ Create the fixed sample description.
+ @return A new CMFormatDescriptionRef, or NULL on failure. Caller is responsible for releasing.
+ */
+- (nullable CMFormatDescriptionRef)createFixedFormatDescription:(CMFormatDescriptionRef)desc
+                                                          error:(NSError * _Nullable * _Nullable)error CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEMetadataFixer_h */
@@ -0,0 +1,264 @@
+//
+//  MEMetadataFixer.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr
+@import CoreVideo;
+
+#import "MEMetadataFixer.h"
+#import "MECodecUtils.h"
+#import "MEErrorFormatter.h"
+#import "MESecureLogging.h"
+
+#include <libavcodec/bsf.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+
+static inline NSError* MEFixupError(NSString* reason) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:paramErr
+                           userInfo:@{NSLocalizedDescriptionKey : @"Metadata fix-up failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/// Code point 0...255, or the FFmpeg name resolved by fromName; -1 if neither
+static int parseCodePoint(NSString* value, int (*fromName)(const char*)) {
+    NSScanner* scanner = [NSScanner scannerWithString:value];
+    int code = -1;
+    if ([scanner scanInt:&code] && scanner.isAtEnd) {
+        return (code >= 0 && code <= 255) ? code : -1;
+    }
+    code = fromName(value.UTF8String);
+    return (code >= 0) ? code : -1;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@implementation MEMetadataFixer
+{
+    int _primaries;     // -1 = unchanged
+    int _transfer;
+    int _matrix;
+    int _fullRange;
+    AVRational _sar;    // {0, 0} = unchanged
+    int _fieldCount;    // 0 = unchanged
+    BOOL _topFieldFirst;
+}
+
++ (NSArray<NSString*>*)optionNames
+{
+    return @[@"primaries", @"transfer", @"matrix", @"range", @"sar", @"field"];
+}
+
+- (nullable instancetype)initWithOptions:(NSDictionary<NSString*, NSString*>*)options error:(NSError**)error
+{
+    if (self = [super init]) {
+        _primaries = _transfer = _matrix = _fullRange = -1;
+        _sar = av_make_q(0, 0);
+        NSString* invalid = nil;
+        for (NSString* key in options) {
+            NSString* value = options[key];
+            if (![value isKindOfClass:[NSString class]] || value.length == 0) {
+                invalid = key;
+            } else if ([key isEqualToString:@"primaries"]) {
+                _primaries = parseCodePoint(value, av_color_primaries_from_name);
+                if (_primaries < 0 || !CVColorPrimariesGetStringForIntegerCodePoint(_primaries)) invalid = key;
+            } else if ([key isEqualToString:@"transfer"]) {
+                _transfer = parseCodePoint(value, av_color_transfer_from_name);
+                if (_transfer < 0 || !CVTransferFunctionGetStringForIntegerCodePoint(_transfer)) invalid = key;
+            } else if ([key isEqualToString:@"matrix"]) {
+                _matrix = parseCodePoint(value, av_color_space_from_name);
+                if (_matrix < 0 || !CVYCbCrMatrixGetStringForIntegerCodePoint(_matrix)) invalid = key;
+            } else if ([key isEqualToString:@"range"]) {
+                if ([value isEqualToString:@"full"]) _fullRange = 1;
+                else if ([value isEqualToString:@"limited"]) _fullRange = 0;
+                else invalid = key;
+            } else if ([key isEqualToString:@"sar"]) {
+                NSArray<NSString*>* items = [value componentsSeparatedByString:@":"];
+                int h = (items.count == 2) ? items[0].intValue : 0;
+                int v = (items.count == 2) ? items[1].intValue : 0;
+                if (h > 0 && v > 0 && h <= 65535 && v <= 65535) _sar = av_make_q(h, v);
+                else invalid = key;
+            } else if ([key isEqualToString:@"field"]) {
+                if ([value isEqualToString:@"progressive"]) _fieldCount = 1;
+                else if ([value isEqualToString:@"tff"]) { _fieldCount = 2; _topFieldFirst = YES; }
+                else if ([value isEqualToString:@"bff"]) { _fieldCount = 2; _topFieldFirst = NO; }
+                else invalid = key;
+            } else {
+                invalid = key;
+            }
+            if (invalid) break;
+        }
+        if (invalid) {
+            if (error) *error = MEFixupError([NSString stringWithFormat:@"Invalid fix-up option: %@", invalid]);
+            return nil;
+        }
+    }
+    return self;
+}
+
++ (nullable instancetype)fixerWithOptions:(NSDictionary<NSString*, NSString*>*)options error:(NSError**)error
+{
+    return [[self alloc] initWithOptions:options error:error];
+}
+
+- (BOOL)changesVUI
+{
+    return (_primaries >= 0 || _transfer >= 0 || _matrix >= 0 || _fullRange >= 0 || _sar.num > 0);
+}
+
+/* =================================================================================== */
+// MARK: - parameter sets
+/* =================================================================================== */
+
+/// avcC/hvcC rewritten through h264_metadata/hevc_metadata; nil on failure
+- (nullable NSDictionary*)fixedAtomsOfDescription:(CMFormatDescriptionRef)desc error:(NSError**)error
+{
+    FourCharCode subType = CMFormatDescriptionGetMediaSubType(desc);
+    BOOL isH264 = (subType == kCMVideoCodecType_H264 || subType == 'avc3');
+    NSArray<NSData*>* parameterSets = parameterSetsOfDescription(desc);
+    if (!parameterSets) {
+        if (error) *error = MEFixupError(@"Cannot read the parameter sets.");
+        return nil;
+    }
+    // Annex-B extradata, as libavcodec hands it to createDescriptionH264/H265
+    NSMutableData* annexB = [NSMutableData data];
+    const uint8_t startCode[4] = {0x00, 0x00, 0x00, 0x01};
+    for (NSData* parameterSet in parameterSets) {
+        [annexB appendBytes:startCode length:4];
+        [annexB appendData:parameterSet];
+    }
+
+    const AVBitStreamFilter* filter = av_bsf_get_by_name(isH264 ? "h264_metadata" : "hevc_metadata");
+    AVBSFContext* bsf = NULL;
+    AVCodecContext* avctx = NULL;
+    CMFormatDescriptionRef parsed = NULL;
+    NSString* failure = nil;
+    int ret = filter ? av_bsf_alloc(filter, &bsf) : AVERROR_BSF_NOT_FOUND;
+    if (ret >= 0) {
+        bsf->par_in->codec_type = AVMEDIA_TYPE_VIDEO;
+        bsf->par_in->codec_id = isH264 ? AV_CODEC_ID_H264 : AV_CODEC_ID_HEVC;
+        bsf->par_in->extradata = av_mallocz(annexB.length + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (bsf->par_in->extradata) {
+            memcpy(bsf->par_in->extradata, annexB.bytes, annexB.length);
+            bsf->par_in->extradata_size = (int)annexB.length;
+        } else {
+            ret = AVERROR(ENOMEM);
+        }
+    }
+    if (ret >= 0 && _primaries >= 0) ret = av_opt_set_int(bsf->priv_data, "colour_primaries", _primaries, 0);
+    if (ret >= 0 && _transfer >= 0) ret = av_opt_set_int(bsf->priv_data, "transfer_characteristics", _transfer, 0);
+    if (ret >= 0 && _matrix >= 0) ret = av_opt_set_int(bsf->priv_data, "matrix_coefficients", _matrix, 0);
+    if (ret >= 0 && _fullRange >= 0) ret = av_opt_set_int(bsf->priv_data, "video_full_range_flag", _fullRange, 0);
+    if (ret >= 0 && _sar.num > 0) ret = av_opt_set_q(bsf->priv_data, "sample_aspect_ratio", _sar, 0);
+    if (ret >= 0) ret = av_bsf_init(bsf);   // the VUI of the extradata is rewritten here
+    if (ret < 0) {
+        failure = [NSString stringWithFormat:@"Bitstream filter failed: %@", [MEErrorFormatter stringFromFFmpegCode:ret]];
+    } else {
+        avctx = avcodec_alloc_context3(NULL);
+        int size = bsf->par_out->extradata_size;
+        if (avctx) avctx->extradata = av_mallocz((size_t)size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (avctx && avctx->extradata) {
+            memcpy(avctx->extradata, bsf->par_out->extradata, (size_t)size);
+            avctx->extradata_size = size;
+            parsed = isH264 ? createDescriptionH264(avctx) : createDescriptionH265(avctx);
+        }
+        if (!parsed) failure = @"Cannot parse the rewritten parameter sets.";
+    }
+    avcodec_free_context(&avctx);
+    av_bsf_free(&bsf);
+    if (failure) {
+        if (error) *error = MEFixupError(failure);
+        return nil;
+    }
+
+    NSDictionary* atoms = (__bridge NSDictionary*)CMFormatDescriptionGetExtension(parsed,
+                            kCMFormatDescriptionExtension_SampleDescriptionExtensionAtoms);
+    NSDictionary* result = [atoms copy];
+    CFRelease(parsed);
+    if (![result isKindOfClass:[NSDictionary class]]) {
+        if (error) *error = MEFixupError(@"Rewritten description has no avcC/hvcC.");
+        return nil;
+    }
+    return result;
+}
+
+/* =================================================================================== */
+// MARK: - sample description
+/* =================================================================================== */
+
+- (nullable CMFormatDescriptionRef)createFixedFormatDescription:(CMFormatDescriptionRef)desc error:(NSError**)error
+{
+    FourCharCode subType = CMFormatDescriptionGetMediaSubType(desc);
+    NSMutableDictionary* extensions = [(__bridge NSDictionary*)CMFormatDescriptionGetExtensions(desc) mutableCopy]
+                                    ?: [NSMutableDictionary dictionary];
+    // the verbatim copy of the old sample entry would be written instead of the new extensions
+    [extensions removeObjectForKey:(__bridge NSString*)kCMFormatDescriptionExtension_VerbatimSampleDescription];
+    [extensions removeObjectForKey:(__bridge NSString*)kCMFormatDescriptionExtension_VerbatimISOSampleEntry];
+
+    if ([self changesVUI] && parameterSetsOfDescription(desc)) {
+        NSDictionary* fixedAtoms = [self fixedAtomsOfDescription:desc error:error];
+        if (!fixedAtoms) return NULL;
+        NSString* atomsKey = (__bridge NSString*)kCMFormatDescriptionExtension_SampleDescriptionExtensionAtoms;
+        NSMutableDictionary* atoms = [extensions[atomsKey] mutableCopy] ?: [NSMutableDictionary dictionary];
+        [atoms addEntriesFromDictionary:fixedAtoms];
+        extensions[atomsKey] = atoms;
+        if (subType == 'avc3' || subType == 'hev1') {
+            SecureLog(@"[MEMetadataFixer] In-band parameter sets of the samples keep their VUI.");
+        }
+    }
+
+    // colr
+    if (_primaries >= 0) {
+        extensions[(__bridge NSString*)kCMFormatDescriptionExtension_ColorPrimaries] =
+            (__bridge NSString*)CVColorPrimariesGetStringForIntegerCodePoint(_primaries);
+    }
+    if (_transfer >= 0) {
+        extensions[(__bridge NSString*)kCMFormatDescriptionExtension_TransferFunction] =
+            (__bridge NSString*)CVTransferFunctionGetStringForIntegerCodePoint(_transfer);
+    }
+    if (_matrix >= 0) {
+        extensions[(__bridge NSString*)kCMFormatDescriptionExtension_YCbCrMatrix] =
+            (__bridge NSString*)CVYCbCrMatrixGetStringForIntegerCodePoint(_matrix);
+    }
+    if (_fullRange >= 0) {
+        extensions[(__bridge NSString*)kCMFormatDescriptionExtension_FullRangeVideo] = @(_fullRange == 1);
+    }
+    // pasp
+    if (_sar.num > 0) {
+        extensions[(__bridge NSString*)kCMFormatDescriptionExtension_PixelAspectRatio] =
+            @{(__bridge NSString*)kCMFormatDescriptionKey_PixelAspectRatioHorizontalSpacing : @(_sar.num),
+              (__bridge NSString*)kCMFormatDescriptionKey_PixelAspectRatioVerticalSpacing : @(_sar.den)};
+    }
+    // fiel
+    if (_fieldCount > 0) {
+        extensions[(__bridge NSString*)kCMFormatDescriptionExtension_FieldCount] = @(_fieldCount);
+        if (_fieldCount == 2) {
+            extensions[(__bridge NSString*)kCMFormatDescriptionExtension_FieldDetail] = _topFieldFirst
+                ? (__bridge NSString*)kCMFormatDescriptionFieldDetail_SpatialFirstLineEarly
+                : (__bridge NSString*)kCMFormatDescriptionFieldDetail_SpatialFirstLineLate;
+        } else {
+            [extensions removeObjectForKey:(__bridge NSString*)kCMFormatDescriptionExtension_FieldDetail];
+        }
+    }
+
+    CMVideoDimensions dims = CMVideoFormatDescriptionGetDimensions(desc);
+    CMVideoFormatDescriptionRef fixed = NULL;
+    OSStatus err = CMVideoFormatDescriptionCreate(kCFAllocatorDefault, subType, dims.width, dims.height,
+                                                  (__bridge CFDictionaryRef)extensions, &fixed);
+    if (err != noErr || !fixed) {
+        if (error) *error = MEFixupError(@"Cannot create the fixed sample description.");
+        return NULL;
+    }
+    return fixed;
+}
+
+@end
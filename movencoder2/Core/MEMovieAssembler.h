@@ -0,0 +1,86 @@
+//
+//  MEMovieAssembler.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEMovieAssembler.h
+ * @abstract Internal API - Join movie files without re-encoding
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEMovieAssembler appends whole movies back to back with AVMutableMovie and
+ * copies their sample data into the destination file, then writes the movie
+ * header to the same file. Samples are not decoded or re-encoded. Cut points
+ * that keep every GOP whole are found with the sync sample lookups below, and
+ * whether samples of two sources can share a track is checked on their format
+ * descriptions.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEMovieAssembler_h
+#define MEMovieAssembler_h
+
+@import Foundation;
+@import CoreMedia;
+
+@class AVMovieTrack;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEMovieAssembler : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Concatenate movies in order into a QuickTime movie file.
+ @param inputURLs Movies to join; tracks are matched by media type and settings
+ @param outputURL Destination; replaced if it exists
+ */
++ (BOOL)concatenateMovieURLs:(NSArray<NSURL*>*)inputURLs
+                       toURL:(NSURL*)outputURL
+                       error:(NSError * _Nullable * _Nullable)error;
+
+/**
+ Check that samples of format can follow samples of reference in one track: the
+ codec, dimensions, profile, chroma format and bit depth (avcC/hvcC), and the
+ color and field extensions match. Parameter sets themselves may differ; the
+ track then switches sample descriptions at the junction.
+ @return nil if compatible, or the name of the first mismatch
+ */
++ (nullable NSString*)incompatibilityOfVideoFormat:(CMFormatDescriptionRef)format
+                                        withFormat:(CMFormatDescriptionRef)reference;
+
+/**
+ First full sync sample at or after time, in movie time.
+ @return kCMTimeInvalid if the track has an edit list or no sample table
+ */
++ (CMTime)syncTimeOfTrack:(nullable AVMovieTrack*)track atOrAfter:(CMTime)time;
+
+/**
+ Last full sync sample at or before time, in movie time.
+ @return kCMTimeInvalid if the track has an edit list or no sample table
+ */
++ (CMTime)syncTimeOfTrack:(nullable AVMovieTrack*)track atOrBefore:(CMTime)time;
+
+/**
+ Whether the GOP of the full sync sample at time (movie time) is open: the sample is marked
+ partial sync, or a sample following it in decode order is presented before it (leading
+ pictures of x264 open-gop or HEVC CRA, which may reference the previous GOP).
+ @return YES also when the track cannot be inspected
+ */
++ (BOOL)isOpenGOPOfTrack:(nullable AVMovieTrack*)track atSyncTime:(CMTime)time;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEMovieAssembler_h */
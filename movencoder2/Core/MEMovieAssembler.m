@@ -0,0 +1,185 @@
+//
+//  MEMovieAssembler.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr
+
+#import "MECommon.h"
+#import "MEMovieAssembler.h"
+#import "MESecureLogging.h"
+
+static inline NSError* MEAssemblerError(NSString* reason) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:paramErr
+                           userInfo:@{NSLocalizedDescriptionKey : @"Movie assembly failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+static const NSUInteger kMaxSyncSearch = 1000;  // samples scanned for a sync sample
+
+// Profile, chroma format and bit depth from avcC/hvcC; the parts must decode with the same setup
+static NSData* _Nullable parameterSetSummary(CMFormatDescriptionRef desc) {
+    NSDictionary* atoms = (__bridge NSDictionary*)CMFormatDescriptionGetExtension(desc,
+                            kCMFormatDescriptionExtension_SampleDescriptionExtensionAtoms);
+    if (![atoms isKindOfClass:[NSDictionary class]]) return nil;
+    NSData* avcC = atoms[@"avcC"];
+    NSData* hvcC = atoms[@"hvcC"];
+    if ([avcC isKindOfClass:[NSData class]] && avcC.length >= 4) {
+        const uint8_t* p = avcC.bytes;
+        uint8_t summary[] = {p[1]};                             // profile_idc
+        return [NSData dataWithBytes:summary length:sizeof(summary)];
+    }
+    if ([hvcC isKindOfClass:[NSData class]] && hvcC.length >= 23) {
+        const uint8_t* p = hvcC.bytes;
+        uint8_t summary[] = {(uint8_t)(p[1] & 0x1f), (uint8_t)(p[16] & 0x03), (uint8_t)(p[17] & 0x07), (uint8_t)(p[18] & 0x07)};
+        return [NSData dataWithBytes:summary length:sizeof(summary)];  // profile, chroma, luma/chroma depth
+    }
+    return nil;
+}
+
+static BOOL sameExtension(CMFormatDescriptionRef a, CMFormatDescriptionRef b, CFStringRef key) {
+    CFPropertyListRef va = CMFormatDescriptionGetExtension(a, key);
+    CFPropertyListRef vb = CMFormatDescriptionGetExtension(b, key);
+    return (va == vb) || (va && vb && CFEqual(va, vb));
+}
+
+@implementation MEMovieAssembler
+
++ (BOOL)concatenateMovieURLs:(NSArray<NSURL*>*)inputURLs toURL:(NSURL*)outputURL error:(NSError**)error
+{
+    if (inputURLs.count == 0) {
+        if (error) *error = MEAssemblerError(@"No input movie.");
+        return NO;
+    }
+
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if ([fm fileExistsAtPath:outputURL.path] && ![fm removeItemAtURL:outputURL error:error]) {
+        SecureErrorLogf(@"[MEMovieAssembler] ERROR: Cannot replace %@", outputURL.path);
+        return NO;
+    }
+
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMovie* first = [AVMovie movieWithURL:inputURLs.firstObject options:options];
+    AVMutableMovie* movie = [AVMutableMovie movieWithSettingsFromMovie:first options:options error:error];
+    if (!movie) {
+        SecureErrorLogf(@"[MEMovieAssembler] ERROR: Cannot create movie from %@", inputURLs.firstObject.path);
+        return NO;
+    }
+    // sample data is copied into the destination, then the header is added to it
+    movie.defaultMediaDataStorage = [[AVMediaDataStorage alloc] initWithURL:outputURL options:nil];
+
+    CMTime cursor = kCMTimeZero;
+    for (NSURL* url in inputURLs) {
+        @autoreleasepool {
+            AVMovie* part = [AVMovie movieWithURL:url options:options];
+            CMTimeRange range = CMTimeRangeMake(kCMTimeZero, part.duration);
+            if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) {
+                if (error) *error = MEAssemblerError([NSString stringWithFormat:@"Movie has no duration: %@", url.path]);
+                return NO;
+            }
+            if (![movie insertTimeRange:range ofAsset:part atTime:cursor copySampleData:YES error:error]) {
+                SecureErrorLogf(@"[MEMovieAssembler] ERROR: Cannot append %@", url.path);
+                return NO;
+            }
+            cursor = CMTimeAdd(cursor, range.duration);
+        }
+    }
+
+    if (![movie writeMovieHeaderToURL:outputURL
+                             fileType:AVFileTypeQuickTimeMovie
+                              options:AVMovieWritingAddMovieHeaderToDestination
+                                error:error]) {
+        SecureErrorLogf(@"[MEMovieAssembler] ERROR: Cannot write movie header to %@", outputURL.path);
+        return NO;
+    }
+    SecureLogf(@"[MEMovieAssembler] Joined %lu movies (%.3f sec) into %@",
+               (unsigned long)inputURLs.count, CMTimeGetSeconds(cursor), outputURL.lastPathComponent);
+    return YES;
+}
+
++ (nullable NSString*)incompatibilityOfVideoFormat:(CMFormatDescriptionRef)format
+                                        withFormat:(CMFormatDescriptionRef)reference
+{
+    if (CMFormatDescriptionGetMediaSubType(reference) != CMFormatDescriptionGetMediaSubType(format)) {
+        return @"codec";
+    }
+    CMVideoDimensions dr = CMVideoFormatDescriptionGetDimensions(reference);
+    CMVideoDimensions df = CMVideoFormatDescriptionGetDimensions(format);
+    if (dr.width != df.width || dr.height != df.height) {
+        return @"dimensions";
+    }
+    NSData* ps = parameterSetSummary(reference);
+    if (!ps || ![ps isEqualToData:parameterSetSummary(format)]) {
+        return @"profile, chroma format or bit depth";
+    }
+    CFStringRef keys[] = {
+        kCMFormatDescriptionExtension_ColorPrimaries,
+        kCMFormatDescriptionExtension_TransferFunction,
+        kCMFormatDescriptionExtension_YCbCrMatrix,
+        kCMFormatDescriptionExtension_FieldCount,
+        kCMFormatDescriptionExtension_FieldDetail,
+    };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (!sameExtension(reference, format, keys[i])) {
+            return [NSString stringWithFormat:@"%@", (__bridge NSString*)keys[i]];
+        }
+    }
+    return nil;
+}
+
+// Scan sample cursors from target in presentation order; step is +1 or -1
++ (CMTime)syncTimeOfTrack:(nullable AVMovieTrack*)track from:(CMTime)target step:(int64_t)step
+{
+    if (!track || !track.canProvideSampleCursors || track.segments.count != 1) return kCMTimeInvalid;
+    AVAssetTrackSegment* segment = track.segments.firstObject;
+    CMTimeMapping mapping = segment.timeMapping;
+    if (segment.isEmpty || CMTIME_COMPARE_INLINE(mapping.source.duration, !=, mapping.target.duration)) return kCMTimeInvalid;
+    
+    CMTime offset = CMTimeSubtract(mapping.target.start, mapping.source.start);   // movie = media + offset
+    CMTime mediaTarget = CMTimeSubtract(target, offset);
+    AVSampleCursor* cursor = [track makeSampleCursorWithPresentationTimeStamp:mediaTarget];
+    for (NSUInteger i = 0; cursor && i < kMaxSyncSearch; i++) {
+        int32_t order = CMTimeCompare(cursor.presentationTimeStamp, mediaTarget);
+        if (cursor.currentSampleSyncInfo.sampleIsFullSync && (step > 0 ? order >= 0 : order <= 0)) {
+            return CMTimeAdd(cursor.presentationTimeStamp, offset);
+        }
+        if ([cursor stepInPresentationOrderByCount:step] != step) break;
+    }
+    return kCMTimeInvalid;
+}
+
++ (CMTime)syncTimeOfTrack:(nullable AVMovieTrack*)track atOrAfter:(CMTime)time
+{
+    return [self syncTimeOfTrack:track from:time step:1];
+}
+
++ (CMTime)syncTimeOfTrack:(nullable AVMovieTrack*)track atOrBefore:(CMTime)time
+{
+    return [self syncTimeOfTrack:track from:time step:-1];
+}
+
++ (BOOL)isOpenGOPOfTrack:(nullable AVMovieTrack*)track atSyncTime:(CMTime)time
+{
+    if (!track || !track.canProvideSampleCursors || track.segments.count != 1) return YES;
+    CMTimeMapping mapping = track.segments.firstObject.timeMapping;
+    CMTime syncPTS = CMTimeSubtract(time, CMTimeSubtract(mapping.target.start, mapping.source.start));
+    AVSampleCursor* cursor = [track makeSampleCursorWithPresentationTimeStamp:syncPTS];
+    if (!cursor || CMTimeCompare(cursor.presentationTimeStamp, syncPTS) != 0) return YES;
+    if (cursor.currentSampleSyncInfo.sampleIsPartialSync) return YES;
+    
+    // leading pictures come right after the sync sample in decode order
+    for (NSUInteger i = 0; i < kMaxSyncSearch; i++) {
+        if ([cursor stepInDecodeOrderByCount:1] != 1) break;
+        if (cursor.currentSampleSyncInfo.sampleIsFullSync) break;
+        if (CMTimeCompare(cursor.presentationTimeStamp, syncPTS) < 0) return YES;
+    }
+    return NO;
+}
+
+@end
@@ -0,0 +1,86 @@
+//
+//  MERemuxer.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MERemuxer.h
+ * @abstract Internal API - Rewrap a movie without sample buffers
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * METranscoder uses MERemuxer when no track is encoded or converted. Instead of
+ * pumping CMSampleBuffers through AVAssetReader/AVAssetWriter per track, the
+ * selected tracks are inserted into an AVMutableMovie, which copies the sample
+ * data chunk by chunk into the output and builds the sample tables in memory.
+ * The movie header is then appended to the same file.
+ *
+ * For a fast start layout the finished file is rewritten once at the box level:
+ * the input is memory mapped, the moov box is moved in front of the media data
+ * with its chunk offsets (stco/co64) shifted, and everything else is copied with
+ * large sequential writes. If a shifted 32-bit stco offset would overflow, the
+ * stco boxes are promoted to co64 and the enclosing box sizes grow to match.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MERemuxer_h
+#define MERemuxer_h
+
+@import Foundation;
+@import AVFoundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Called for each copied track before the movie header is written; NO fails the remux.
+typedef BOOL (^MERemuxTrackHandler)(AVMutableMovieTrack* track, NSError * _Nullable * _Nullable error);
+
+@interface MERemuxer : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Copy the tracks of the given media types over timeRange into a QuickTime movie file.
+ @param movie Source movie
+ @param timeRange Range of the source; the output starts at zero
+ @param mediaTypes Media types of the tracks to copy
+ @param outputURL Destination; replaced if it exists
+ @param fastStart Move the movie header in front of the media data
+ */
++ (BOOL)remuxMovie:(AVMovie*)movie
+         timeRange:(CMTimeRange)timeRange
+        mediaTypes:(NSArray<AVMediaType>*)mediaTypes
+             toURL:(NSURL*)outputURL
+         fastStart:(BOOL)fastStart
+             error:(NSError * _Nullable * _Nullable)error;
+
+/**
+ Same as above; trackHandler may change the copied tracks, i.e. replace their
+ sample descriptions, before the header is written.
+ */
++ (BOOL)remuxMovie:(AVMovie*)movie
+         timeRange:(CMTimeRange)timeRange
+        mediaTypes:(NSArray<AVMediaType>*)mediaTypes
+             toURL:(NSURL*)outputURL
+         fastStart:(BOOL)fastStart
+      trackHandler:(nullable MERemuxTrackHandler)trackHandler
+             error:(NSError * _Nullable * _Nullable)error;
+
+/**
+ Rewrite a movie file whose moov box is the last top-level box so that moov
+ follows ftyp. Files already in that layout are left as they are.
+ */
++ (BOOL)moveMovieHeaderToFrontOfFileAtURL:(NSURL*)url error:(NSError * _Nullable * _Nullable)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MERemuxer_h */
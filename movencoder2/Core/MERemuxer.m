@@ -0,0 +1,405 @@
+//
+//  MERemuxer.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr, ioErr
+
+#import "MERemuxer.h"
+#import "MESecureLogging.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const size_t kWriteBlockSize = 8 * 1024 * 1024;   // sequential write unit of the fast start rewrite
+static const int kMaxBoxDepth = 8;
+
+static inline NSError* MERemuxError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Remux failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/* =================================================================================== */
+// MARK: - box level
+/* =================================================================================== */
+
+static inline uint32_t rd32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline uint64_t rd64(const uint8_t* p) {
+    return (uint64_t)rd32(p) << 32 | rd32(p + 4);
+}
+
+static inline void wr32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+static inline void wr64(uint8_t* p, uint64_t v) {
+    wr32(p, (uint32_t)(v >> 32));
+    wr32(p + 4, (uint32_t)v);
+}
+
+/// Box at p within avail bytes; NO if the header or size is broken
+static BOOL parseBox(const uint8_t* p, uint64_t avail, uint64_t* size, uint32_t* type, uint32_t* headerSize) {
+    if (avail < 8) return NO;
+    uint64_t boxSize = rd32(p);
+    uint32_t header = 8;
+    if (boxSize == 1) {
+        if (avail < 16) return NO;
+        boxSize = rd64(p + 8);
+        header = 16;
+    } else if (boxSize == 0) {
+        boxSize = avail;    // extends to the end
+    }
+    if (boxSize < header || boxSize > avail) return NO;
+    *size = boxSize;
+    *type = rd32(p + 4);
+    *headerSize = header;
+    return YES;
+}
+
+/// Sum the stco entries under the box payload and find the largest one; NO if a box is broken
+static BOOL scanChunkOffsets(const uint8_t* p, uint64_t length, int depth, uint64_t* entries, uint64_t* maxOffset) {
+    if (depth > kMaxBoxDepth) return NO;
+    while (length > 0) {
+        uint64_t size = 0;
+        uint32_t type = 0, header = 0;
+        if (!parseBox(p, length, &size, &type, &header)) return NO;
+        const uint8_t* body = p + header;
+        uint64_t bodySize = size - header;
+        switch (type) {
+            case 'moov': case 'trak': case 'mdia': case 'minf': case 'stbl':
+                if (!scanChunkOffsets(body, bodySize, depth + 1, entries, maxOffset)) return NO;
+                break;
+            case 'stco': {
+                if (bodySize < 8) return NO;
+                uint32_t count = rd32(body + 4);
+                if ((uint64_t)count * 4 > bodySize - 8) return NO;
+                for (uint32_t i = 0; i < count; i++) {
+                    *maxOffset = MAX(*maxOffset, (uint64_t)rd32(body + 8 + (uint64_t)i * 4));
+                }
+                *entries += count;
+                break;
+            }
+            default:
+                break;
+        }
+        p += size;
+        length -= size;
+    }
+    return YES;
+}
+
+/// Append the boxes of the payload to out with every stco promoted to co64, every chunk offset
+/// shifted by delta and the sizes of the enclosing boxes grown to match; NO if a box is broken
+static BOOL appendPromotedBoxes(const uint8_t* p, uint64_t length, uint64_t delta, int depth, NSMutableData* out) {
+    if (depth > kMaxBoxDepth) return NO;
+    while (length > 0) {
+        uint64_t size = 0;
+        uint32_t type = 0, header = 0;
+        if (!parseBox(p, length, &size, &type, &header)) return NO;
+        const uint8_t* body = p + header;
+        uint64_t bodySize = size - header;
+        switch (type) {
+            case 'moov': case 'trak': case 'mdia': case 'minf': case 'stbl': {
+                NSUInteger start = out.length;
+                [out appendBytes:p length:header];
+                if (!appendPromotedBoxes(body, bodySize, delta, depth + 1, out)) return NO;
+                uint64_t newSize = out.length - start;
+                uint8_t* boxHeader = (uint8_t*)out.mutableBytes + start;
+                if (header == 16) {
+                    wr64(boxHeader + 8, newSize);
+                } else if (newSize > UINT32_MAX) {
+                    return NO;
+                } else {
+                    wr32(boxHeader, (uint32_t)newSize);
+                }
+                break;
+            }
+            case 'stco': {
+                if (bodySize < 8) return NO;
+                uint32_t count = rd32(body + 4);
+                if ((uint64_t)count * 4 > bodySize - 8) return NO;
+                uint64_t newSize = 16 + (uint64_t)count * 8;
+                if (newSize > UINT32_MAX) return NO;
+                uint8_t boxHeader[16];
+                wr32(boxHeader, (uint32_t)newSize);
+                wr32(boxHeader + 4, 'co64');
+                memcpy(boxHeader + 8, body, 8);     // version/flags and entry count
+                [out appendBytes:boxHeader length:sizeof(boxHeader)];
+                for (uint32_t i = 0; i < count; i++) {
+                    uint8_t entry[8];
+                    wr64(entry, (uint64_t)rd32(body + 8 + (uint64_t)i * 4) + delta);
+                    [out appendBytes:entry length:sizeof(entry)];
+                }
+                break;
+            }
+            case 'co64': {
+                if (bodySize < 8) return NO;
+                uint32_t count = rd32(body + 4);
+                if ((uint64_t)count * 8 > bodySize - 8) return NO;
+                NSUInteger start = out.length;
+                [out appendBytes:p length:(NSUInteger)size];
+                uint8_t* entries = (uint8_t*)out.mutableBytes + start + header + 8;
+                for (uint32_t i = 0; i < count; i++) {
+                    uint8_t* entry = entries + (uint64_t)i * 8;
+                    wr64(entry, rd64(entry) + delta);
+                }
+                break;
+            }
+            default:
+                [out appendBytes:p length:(NSUInteger)size];
+                break;
+        }
+        p += size;
+        length -= size;
+    }
+    return YES;
+}
+
+/// Add delta to every stco/co64 entry under the box payload; NO if an stco entry would overflow
+static BOOL shiftChunkOffsets(uint8_t* p, uint64_t length, uint64_t delta, int depth) {
+    if (depth > kMaxBoxDepth) return NO;
+    while (length > 0) {
+        uint64_t size = 0;
+        uint32_t type = 0, header = 0;
+        if (!parseBox(p, length, &size, &type, &header)) return NO;
+        uint8_t* body = p + header;
+        uint64_t bodySize = size - header;
+        switch (type) {
+            case 'moov': case 'trak': case 'mdia': case 'minf': case 'stbl':
+                if (!shiftChunkOffsets(body, bodySize, delta, depth + 1)) return NO;
+                break;
+            case 'stco': {
+                if (bodySize < 8) return NO;
+                uint32_t count = rd32(body + 4);
+                if ((uint64_t)count * 4 > bodySize - 8) return NO;
+                for (uint32_t i = 0; i < count; i++) {
+                    uint8_t* entry = body + 8 + (uint64_t)i * 4;
+                    uint64_t offset = (uint64_t)rd32(entry) + delta;
+                    if (offset > UINT32_MAX) return NO;
+                    wr32(entry, (uint32_t)offset);
+                }
+                break;
+            }
+            case 'co64': {
+                if (bodySize < 8) return NO;
+                uint32_t count = rd32(body + 4);
+                if ((uint64_t)count * 8 > bodySize - 8) return NO;
+                for (uint32_t i = 0; i < count; i++) {
+                    uint8_t* entry = body + 8 + (uint64_t)i * 8;
+                    wr64(entry, rd64(entry) + delta);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        p += size;
+        length -= size;
+    }
+    return YES;
+}
+
+static BOOL writeAll(int fd, const uint8_t* p, uint64_t length) {
+    while (length > 0) {
+        size_t chunk = (size_t)MIN(length, (uint64_t)kWriteBlockSize);
+        ssize_t n = write(fd, p, chunk);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return NO;
+        p += n;
+        length -= (uint64_t)n;
+    }
+    return YES;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@implementation MERemuxer
+
++ (BOOL)remuxMovie:(AVMovie*)movie
+         timeRange:(CMTimeRange)timeRange
+        mediaTypes:(NSArray<AVMediaType>*)mediaTypes
+             toURL:(NSURL*)outputURL
+         fastStart:(BOOL)fastStart
+             error:(NSError**)error
+{
+    return [self remuxMovie:movie timeRange:timeRange mediaTypes:mediaTypes toURL:outputURL
+                  fastStart:fastStart trackHandler:nil error:error];
+}
+
++ (BOOL)remuxMovie:(AVMovie*)movie
+         timeRange:(CMTimeRange)timeRange
+        mediaTypes:(NSArray<AVMediaType>*)mediaTypes
+             toURL:(NSURL*)outputURL
+         fastStart:(BOOL)fastStart
+      trackHandler:(nullable MERemuxTrackHandler)trackHandler
+             error:(NSError**)error
+{
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if ([fm fileExistsAtPath:outputURL.path] && ![fm removeItemAtURL:outputURL error:error]) {
+        SecureErrorLogf(@"[MERemuxer] ERROR: Cannot replace %@", outputURL.path);
+        return NO;
+    }
+
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMutableMovie* output = [AVMutableMovie movieWithSettingsFromMovie:movie options:options error:error];
+    if (!output) {
+        SecureErrorLog(@"[MERemuxer] ERROR: Cannot create the output movie.");
+        return NO;
+    }
+    // sample data is copied into the destination, then the header is added to it
+    output.defaultMediaDataStorage = [[AVMediaDataStorage alloc] initWithURL:outputURL options:nil];
+
+    NSUInteger trackCount = 0;
+    for (AVMovieTrack* track in movie.tracks) {
+        if (![mediaTypes containsObject:track.mediaType]) continue;
+        CMTimeRange range = CMTimeRangeGetIntersection(timeRange, track.timeRange);
+        if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) continue;
+        AVMutableMovieTrack* copy = [output addMutableTrackWithMediaType:track.mediaType
+                                                   copySettingsFromTrack:track options:nil];
+        CMTime at = CMTimeSubtract(range.start, timeRange.start);
+        if (!copy || ![copy insertTimeRange:range ofTrack:track atTime:at copySampleData:YES error:error]) {
+            SecureErrorLogf(@"[MERemuxer] ERROR: Cannot copy %@ track %d.", track.mediaType, track.trackID);
+            [fm removeItemAtURL:outputURL error:nil];
+            return NO;
+        }
+        if (trackHandler && !trackHandler(copy, error)) {
+            SecureErrorLogf(@"[MERemuxer] ERROR: Cannot update %@ track %d.", track.mediaType, track.trackID);
+            [fm removeItemAtURL:outputURL error:nil];
+            return NO;
+        }
+        trackCount++;
+    }
+    if (trackCount == 0) {
+        [fm removeItemAtURL:outputURL error:nil];
+        if (error) *error = MERemuxError(@"No track to copy.", paramErr);
+        return NO;
+    }
+
+    if (![output writeMovieHeaderToURL:outputURL
+                              fileType:AVFileTypeQuickTimeMovie
+                               options:AVMovieWritingAddMovieHeaderToDestination
+                                 error:error]) {
+        SecureErrorLogf(@"[MERemuxer] ERROR: Cannot write movie header to %@", outputURL.path);
+        [fm removeItemAtURL:outputURL error:nil];
+        return NO;
+    }
+    if (fastStart && ![self moveMovieHeaderToFrontOfFileAtURL:outputURL error:error]) {
+        [fm removeItemAtURL:outputURL error:nil];
+        return NO;
+    }
+    SecureLogf(@"[MERemuxer] Copied %lu tracks (%.3f sec) into %@",
+               (unsigned long)trackCount, CMTimeGetSeconds(timeRange.duration), outputURL.lastPathComponent);
+    return YES;
+}
+
++ (BOOL)moveMovieHeaderToFrontOfFileAtURL:(NSURL*)url error:(NSError**)error
+{
+    int fd = open(url.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if (fd >= 0) close(fd);
+        if (error) *error = MERemuxError(@"Cannot read the movie file.", ioErr);
+        return NO;
+    }
+    uint64_t fileSize = (uint64_t)st.st_size;
+    const uint8_t* base = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        if (error) *error = MERemuxError(@"Cannot map the movie file.", ioErr);
+        return NO;
+    }
+    madvise((void*)base, (size_t)fileSize, MADV_SEQUENTIAL);
+
+    // Top-level layout: [ftyp] ... moov, with moov last
+    uint64_t ftypEnd = 0, moovStart = 0, moovSize = 0, mdatStart = UINT64_MAX;
+    uint64_t pos = 0;
+    NSString* failure = nil;
+    while (pos < fileSize) {
+        uint64_t size = 0;
+        uint32_t type = 0, header = 0;
+        if (!parseBox(base + pos, fileSize - pos, &size, &type, &header)) {
+            failure = @"Broken top-level box.";
+            break;
+        }
+        if (type == 'ftyp' && pos == 0) ftypEnd = size;
+        if (type == 'mdat' && mdatStart == UINT64_MAX) mdatStart = pos;
+        if (type == 'moov') {
+            moovStart = pos;
+            moovSize = size;
+        }
+        pos += size;
+    }
+    BOOL done = NO;
+    if (!failure && moovSize == 0) {
+        failure = @"No movie header.";
+    } else if (!failure && moovStart < mdatStart) {
+        done = YES;     // already fast start
+    } else if (!failure && moovStart + moovSize != fileSize) {
+        failure = @"Movie header is not the last box.";
+    }
+    if (failure || done) {
+        munmap((void*)base, (size_t)fileSize);
+        if (failure && error) *error = MERemuxError(failure, paramErr);
+        return done;
+    }
+
+    // Everything between ftyp and moov moves back by the size of moov
+    NSMutableData* moov = [NSMutableData dataWithBytes:base + moovStart length:(NSUInteger)moovSize];
+    uint64_t size = 0;
+    uint32_t type = 0, header = 0;
+    parseBox(moov.mutableBytes, moovSize, &size, &type, &header);
+    uint64_t stcoEntries = 0, stcoMax = 0;
+    BOOL shifted = scanChunkOffsets((uint8_t*)moov.mutableBytes + header, moovSize - header, 0,
+                                    &stcoEntries, &stcoMax);
+    if (shifted && stcoMax + moovSize > UINT32_MAX) {
+        // 32-bit offsets would overflow: promote every stco to co64, which grows moov by 4 bytes
+        // per entry, and shift by the grown size
+        uint64_t promotedSize = moovSize + stcoEntries * 4;
+        NSMutableData* promoted = [NSMutableData dataWithCapacity:(NSUInteger)promotedSize];
+        shifted = appendPromotedBoxes(moov.bytes, moovSize, promotedSize, 0, promoted) &&
+                  promoted.length == promotedSize;
+        moov = promoted;
+        moovSize = promotedSize;
+    } else if (shifted) {
+        shifted = shiftChunkOffsets((uint8_t*)moov.mutableBytes + header, moovSize - header, moovSize, 0);
+    }
+    if (!shifted) {
+        munmap((void*)base, (size_t)fileSize);
+        if (error) *error = MERemuxError(@"Chunk offsets cannot be moved.", paramErr);
+        return NO;
+    }
+
+    NSString* tempName = [NSString stringWithFormat:@".%@.faststart", url.lastPathComponent];
+    NSURL* tempURL = [url.URLByDeletingLastPathComponent URLByAppendingPathComponent:tempName];
+    int out = open(tempURL.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    BOOL ok = (out >= 0) &&
+              writeAll(out, base, ftypEnd) &&
+              writeAll(out, moov.bytes, moovSize) &&
+              writeAll(out, base + ftypEnd, moovStart - ftypEnd);
+    if (out >= 0 && close(out) != 0) ok = NO;
+    munmap((void*)base, (size_t)fileSize);
+    if (ok) {
+        ok = (rename(tempURL.fileSystemRepresentation, url.fileSystemRepresentation) == 0);
+    }
+    if (!ok) {
+        unlink(tempURL.fileSystemRepresentation);
+        if (error) *error = MERemuxError(@"Cannot rewrite the movie file.", ioErr);
+    }
+    return ok;
+}
+
+@end
@@ -0,0 +1,81 @@
+//
+//  MEResultCache.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEResultCache.h
+ * @abstract Internal API - Content addressed on-disk store of finished outputs
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * A job is identified by a SHA-256 key over its input content and everything
+ * that affects its output (see -[METranscoder me_resultCacheKey]). When the key
+ * is found, the stored output is cloned to the output path (copied when the
+ * file system cannot clone) instead of encoding again. The output never shares
+ * an inode with the entry, so editing it cannot change the cache. Finished
+ * outputs are copied in the same way and made read-only.
+ *
+ * The store is bounded: after each store the least recently used entries are
+ * removed until the total size fits in maxBytes. Hits, misses, stores and
+ * evictions are kept in the directory, so several processes (batch, server)
+ * share one cache; updates are serialized with flock(2).
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEResultCache_h
+#define MEResultCache_h
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEResultCache : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param directoryURL Cache directory; created when missing
+ @param maxBytes Total size of the stored outputs to keep
+ */
+- (instancetype)initWithDirectoryURL:(NSURL*)directoryURL maxBytes:(uint64_t)maxBytes NS_DESIGNATED_INITIALIZER;
++ (instancetype)resultCacheWithDirectoryURL:(NSURL*)directoryURL maxBytes:(uint64_t)maxBytes;
+
+@property (nonatomic, readonly) NSURL* directoryURL;
+@property (nonatomic, readonly) uint64_t maxBytes;
+
+/// SHA-256 of the size and the whole content of a file, in hex
++ (nullable NSString*)contentHashOfFileAtURL:(NSURL*)url;
+
+/// libavcodec, libavformat, libavfilter and libavutil versions and the FFmpeg build
++ (NSString*)libraryVersionString;
+
+/// SHA-256 in hex of the components joined with newlines
++ (NSString*)keyWithComponents:(NSArray<NSString*>*)components;
+
+/**
+ Place the stored output for key at outputURL, replacing any file there.
+ Counts a hit or a miss.
+ @return YES on a hit
+ */
+- (BOOL)placeEntryForKey:(NSString*)key atURL:(NSURL*)outputURL;
+
+/// Copy a finished output into the store, then evict down to maxBytes.
+- (BOOL)storeFileAtURL:(NSURL*)outputURL forKey:(NSString*)key error:(NSError * _Nullable * _Nullable)error;
+
+/// hits, misses, stores, evictions, entries and bytes (NSNumber values)
+- (NSDictionary<NSString*, NSNumber*>*)statistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEResultCache_h */
@@ -0,0 +1,318 @@
+//
+//  MEResultCache.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // ioErr
+
+#import "MEResultCache.h"
+#include <CommonCrypto/CommonDigest.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavfilter/avfilter.h>
+#include <libavutil/avutil.h>
+#include <sys/clonefile.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <copyfile.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const size_t kHashChunkBytes = 4 * 1024 * 1024;
+static NSString* const kStatsName = @".stats.json";
+static NSString* const kLockName = @".lock";
+static NSString* const kTempPrefix = @".tmp-";
+
+static inline NSError* MEResultCacheError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Result cache failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+static NSString* hexDigest(CC_SHA256_CTX* ctx) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, ctx);
+    NSMutableString* hex = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [hex appendFormat:@"%02x", digest[i]];
+    }
+    return hex;
+}
+
+static BOOL hashRange(CC_SHA256_CTX* ctx, int fd, off_t offset, uint64_t length, uint8_t* buffer, size_t bufferSize) {
+    while (length > 0) {
+        ssize_t n = pread(fd, buffer, (size_t)MIN(length, (uint64_t)bufferSize), offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return NO;
+        CC_SHA256_Update(ctx, buffer, (CC_LONG)n);
+        offset += n;
+        length -= (uint64_t)n;
+    }
+    return YES;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@implementation MEResultCache
+
+- (instancetype)initWithDirectoryURL:(NSURL*)directoryURL maxBytes:(uint64_t)maxBytes
+{
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _maxBytes = maxBytes;
+        [NSFileManager.defaultManager createDirectoryAtURL:directoryURL
+                               withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+    return self;
+}
+
++ (instancetype)resultCacheWithDirectoryURL:(NSURL*)directoryURL maxBytes:(uint64_t)maxBytes
+{
+    return [[self alloc] initWithDirectoryURL:directoryURL maxBytes:maxBytes];
+}
+
+/* =================================================================================== */
+// MARK: - keys
+/* =================================================================================== */
+
++ (nullable NSString*)contentHashOfFileAtURL:(NSURL*)url
+{
+    int fd = open(url.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nil;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return nil;
+    }
+
+    CC_SHA256_CTX ctx;
+    CC_SHA256_Init(&ctx);
+    uint64_t size = (uint64_t)st.st_size;
+    CC_SHA256_Update(&ctx, &size, sizeof(size));
+
+    // The whole content is hashed: a re-render of the same size can differ anywhere,
+    // and a stale hit would be served silently. Reading is far cheaper than encoding.
+    uint8_t* buffer = malloc(kHashChunkBytes);
+    BOOL ok = (buffer != NULL);
+    if (ok) {
+        fcntl(fd, F_RDAHEAD, 1);
+        ok = hashRange(&ctx, fd, 0, size, buffer, kHashChunkBytes);
+    }
+    free(buffer);
+    close(fd);
+
+    NSString* hash = hexDigest(&ctx);
+    return ok ? hash : nil;
+}
+
++ (NSString*)libraryVersionString
+{
+    return [NSString stringWithFormat:@"avcodec=%u avformat=%u avfilter=%u avutil=%u build=%s",
+            avcodec_version(), avformat_version(), avfilter_version(), avutil_version(), av_version_info()];
+}
+
++ (NSString*)keyWithComponents:(NSArray<NSString*>*)components
+{
+    NSData* data = [[components componentsJoinedByString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding];
+    CC_SHA256_CTX ctx;
+    CC_SHA256_Init(&ctx);
+    CC_SHA256_Update(&ctx, data.bytes, (CC_LONG)data.length);
+    return hexDigest(&ctx);
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+/// Run block holding the cache-wide lock, shared by every process using the directory
+- (void)withLock:(void (NS_NOESCAPE ^)(void))block
+{
+    NSURL* lockURL = [self.directoryURL URLByAppendingPathComponent:kLockName];
+    int fd = open(lockURL.fileSystemRepresentation, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        while (flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+    }
+    @synchronized (self) {
+        block();
+    }
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+}
+
+- (NSURL*)statsURL
+{
+    return [self.directoryURL URLByAppendingPathComponent:kStatsName];
+}
+
+- (NSMutableDictionary<NSString*, NSNumber*>*)loadCounters
+{
+    NSData* data = [NSData dataWithContentsOfURL:[self statsURL]];
+    NSDictionary* dict = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    NSMutableDictionary* counters = [NSMutableDictionary dictionary];
+    for (NSString* name in @[@"hits", @"misses", @"stores", @"evictions"]) {
+        id value = [dict isKindOfClass:[NSDictionary class]] ? dict[name] : nil;
+        counters[name] = [value isKindOfClass:[NSNumber class]] ? value : @0;
+    }
+    return counters;
+}
+
+- (void)bumpCounter:(NSString*)name by:(uint64_t)delta
+{
+    if (delta == 0) return;
+    NSMutableDictionary* counters = [self loadCounters];
+    counters[name] = @([counters[name] unsignedLongLongValue] + delta);
+    NSData* data = [NSJSONSerialization dataWithJSONObject:counters options:NSJSONWritingSortedKeys error:nil];
+    [data writeToURL:[self statsURL] atomically:YES];
+}
+
+/// Stored outputs, oldest use first
+- (NSArray<NSURL*>*)entriesByLastUse
+{
+    NSArray<NSURLResourceKey>* keys = @[NSURLContentModificationDateKey, NSURLFileSizeKey, NSURLIsRegularFileKey];
+    NSArray<NSURL*>* contents = [NSFileManager.defaultManager contentsOfDirectoryAtURL:self.directoryURL
+                                                          includingPropertiesForKeys:keys
+                                                                             options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                               error:nil];
+    NSMutableArray<NSURL*>* entries = [NSMutableArray array];
+    for (NSURL* url in contents) {
+        NSNumber* regular = nil;
+        [url getResourceValue:&regular forKey:NSURLIsRegularFileKey error:nil];
+        if (regular.boolValue) [entries addObject:url];
+    }
+    [entries sortUsingComparator:^NSComparisonResult(NSURL* a, NSURL* b) {
+        NSDate *da = nil, *db = nil;
+        [a getResourceValue:&da forKey:NSURLContentModificationDateKey error:nil];
+        [b getResourceValue:&db forKey:NSURLContentModificationDateKey error:nil];
+        return [da ?: NSDate.distantPast compare:db ?: NSDate.distantPast];
+    }];
+    return entries;
+}
+
+static uint64_t fileSize(NSURL* url) {
+    NSNumber* size = nil;
+    [url getResourceValue:&size forKey:NSURLFileSizeKey error:nil];
+    return size.unsignedLongLongValue;
+}
+
+- (nullable NSURL*)entryURLForKey:(NSString*)key
+{
+    // The entry keeps the output extension; the key alone is unique
+    for (NSURL* url in [self entriesByLastUse]) {
+        if ([url.lastPathComponent.stringByDeletingPathExtension isEqualToString:key]) {
+            return url;
+        }
+    }
+    return nil;
+}
+
+- (void)evictLocked
+{
+    NSArray<NSURL*>* entries = [self entriesByLastUse];
+    uint64_t total = 0;
+    for (NSURL* url in entries) total += fileSize(url);
+
+    uint64_t evicted = 0;
+    for (NSURL* url in entries) {
+        if (total <= self.maxBytes) break;
+        uint64_t size = fileSize(url);
+        if ([NSFileManager.defaultManager removeItemAtURL:url error:nil]) {
+            total -= MIN(total, size);
+            evicted++;
+        }
+    }
+    [self bumpCounter:@"evictions" by:evicted];
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+- (BOOL)placeEntryForKey:(NSString*)key atURL:(NSURL*)outputURL
+{
+    __block BOOL hit = NO;
+    [self withLock:^{
+        NSURL* entryURL = [self entryURLForKey:key];
+        if (entryURL) {
+            // Never share the inode: the output must stay writable and private to the user.
+            // A clone costs no space on APFS; other volumes get a plain copy.
+            const char* src = entryURL.fileSystemRepresentation;
+            const char* dst = outputURL.fileSystemRepresentation;
+            [NSFileManager.defaultManager removeItemAtURL:outputURL error:nil];
+            hit = (clonefile(src, dst, CLONE_NOFOLLOW) == 0);
+            if (!hit) {
+                hit = (copyfile(src, dst, NULL, COPYFILE_DATA | COPYFILE_EXCL) == 0);
+                if (!hit) unlink(dst);
+            }
+            if (hit) {
+                chmod(dst, 0644);
+                // Mark as recently used for eviction order
+                [entryURL setResourceValue:[NSDate date] forKey:NSURLContentModificationDateKey error:nil];
+            }
+        }
+        [self bumpCounter:(hit ? @"hits" : @"misses") by:1];
+    }];
+    return hit;
+}
+
+- (BOOL)storeFileAtURL:(NSURL*)outputURL forKey:(NSString*)key error:(NSError * _Nullable * _Nullable)error
+{
+    NSFileManager* fm = NSFileManager.defaultManager;
+    NSString* name = key;
+    if (outputURL.pathExtension.length) {
+        name = [key stringByAppendingPathExtension:outputURL.pathExtension];
+    }
+    NSURL* entryURL = [self.directoryURL URLByAppendingPathComponent:name];
+    NSURL* tempURL = [self.directoryURL URLByAppendingPathComponent:
+                      [kTempPrefix stringByAppendingString:NSUUID.UUID.UUIDString]];
+
+    // Copy outside the lock; only the rename and eviction are serialized
+    NSError* copyError = nil;
+    if (![fm copyItemAtURL:outputURL toURL:tempURL error:&copyError]) {
+        if (error) *error = MEResultCacheError([NSString stringWithFormat:@"Failed to copy into cache: %@",
+                                                copyError.localizedDescription], ioErr);
+        return NO;
+    }
+    chmod(tempURL.fileSystemRepresentation, 0444);
+
+    __block BOOL ok = NO;
+    [self withLock:^{
+        ok = (rename(tempURL.fileSystemRepresentation, entryURL.fileSystemRepresentation) == 0);
+        if (ok) {
+            [self bumpCounter:@"stores" by:1];
+            [self evictLocked];
+        }
+    }];
+    if (!ok) {
+        [fm removeItemAtURL:tempURL error:nil];
+        if (error) *error = MEResultCacheError(@"Failed to add the output to the cache.", ioErr);
+    }
+    return ok;
+}
+
+- (NSDictionary<NSString*, NSNumber*>*)statistics
+{
+    __block NSMutableDictionary* stats = nil;
+    [self withLock:^{
+        stats = [self loadCounters];
+        NSArray<NSURL*>* entries = [self entriesByLastUse];
+        uint64_t total = 0;
+        for (NSURL* url in entries) total += fileSize(url);
+        stats[@"entries"] = @(entries.count);
+        stats[@"bytes"] = @(total);
+    }];
+    return stats;
+}
+
+@end
@@ -0,0 +1,87 @@
+//
+//  MESmartRenderSession.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MESmartRenderSession.h
+ * @abstract Internal API - Trim by re-encoding only the GOPs cut by the trim points
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * For a trim of [start, end), the video between the first full sync sample at
+ * or after start and the last one at or before end is copied as compressed
+ * samples. Only the partial GOPs in front of and behind it are exported by
+ * METranscoder (the "head" and "tail" parts, kept in "<output>.smart/").
+ * Audio, and other media with kCopyOtherMediaKey, are copied for the whole
+ * range. The result is one QuickTime movie whose video track holds a sample
+ * description per part.
+ *
+ * Smart rendering applies when the job re-encodes the video track only, with
+ * the source codec and no filter or scaling. The encoded parts are checked
+ * against the source: codec, dimensions, profile, chroma format and bit depth
+ * of the parameter sets, and the color and field extensions. Anything else
+ * falls back to a full export of the range with the same transcoder builder.
+ * Cut points are the full sync samples of the source. A cut at an open GOP
+ * (partial sync, or leading pictures shown before the sync sample as with
+ * x264 open-gop or HEVC CRA) falls back to a full export.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MESmartRenderSession_h
+#define MESmartRenderSession_h
+
+@import Foundation;
+@import CoreMedia;
+
+@class METranscoder;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Build the transcoder of one part; the session sets its startTime/endTime.
+typedef METranscoder* _Nullable (^MESmartRenderPartBuilder)(NSURL* partURL);
+
+@interface MESmartRenderSession : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param inputURL Source movie
+ @param outputURL Final movie
+ @param timeRange Range of the source to keep
+ @param builder Called for the head, the tail, or the full range on fallback
+ */
+- (instancetype)initWithInputURL:(NSURL*)inputURL
+                       outputURL:(NSURL*)outputURL
+                       timeRange:(CMTimeRange)timeRange
+                         builder:(MESmartRenderPartBuilder)builder NS_DESIGNATED_INITIALIZER;
++ (instancetype)sessionWithInputURL:(NSURL*)inputURL
+                          outputURL:(NSURL*)outputURL
+                          timeRange:(CMTimeRange)timeRange
+                            builder:(MESmartRenderPartBuilder)builder;
+
+@property (nonatomic, readonly) NSURL* workDirectoryURL;
+
+/// Export the trimmed movie. Blocks the calling thread.
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Cancel the running export.
+- (void)cancel;
+
+@property (readonly, getter=isCancelled) BOOL cancelled;    // atomic
+/// YES once GOPs were copied; NO when the whole range was exported
+@property (readonly) BOOL usedSmartRender;                  // atomic
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MESmartRenderSession_h */
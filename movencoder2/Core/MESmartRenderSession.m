@@ -0,0 +1,315 @@
+//
+//  MESmartRenderSession.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr, userCanceledErr
+
+#import "MESmartRenderSession.h"
+#import "MEMovieAssembler.h"
+#import "METranscoder+Internal.h"
+#import "MESecureLogging.h"
+
+static inline NSError* MESmartRenderError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Smart render failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+// Codec family of a video sample description or encoder: 'avc1' or 'hvc1'; 0 if neither
+static FourCharCode codecFamily(FourCharCode subType) {
+    switch (subType) {
+        case 'avc1': case 'avc3': return 'avc1';
+        case 'hvc1': case 'hev1': return 'hvc1';
+        default: return 0;
+    }
+}
+
+static FourCharCode codecFamilyOfEncoder(NSString* _Nullable name) {
+    if ([name isEqualToString:@"libx264"] || [name isEqualToString:@"h264_videotoolbox"]) return 'avc1';
+    if ([name isEqualToString:@"libx265"] || [name isEqualToString:@"hevc_videotoolbox"]) return 'hvc1';
+    return 0;
+}
+
+static FourCharCode fourCCFromString(NSString* _Nullable string) {
+    if (string.length != 4) return 0;
+    const char* c = string.UTF8String;
+    return (FourCharCode)((uint8_t)c[0] << 24 | (uint8_t)c[1] << 16 | (uint8_t)c[2] << 8 | (uint8_t)c[3]);
+}
+
+static CMFormatDescriptionRef _Nullable firstFormatDescription(AVAssetTrack* _Nullable track) {
+    id desc = track.formatDescriptions.firstObject;
+    return (__bridge CMFormatDescriptionRef)desc;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MESmartRenderSession ()
+@property (nonatomic, strong) NSURL* inputURL;
+@property (nonatomic, strong) NSURL* outputURL;
+@property (nonatomic, assign) CMTimeRange timeRange;
+@property (nonatomic, copy) MESmartRenderPartBuilder builder;
+@property (strong, nullable) METranscoder* currentTranscoder;          // atomic
+@property (readwrite, getter=isCancelled) BOOL cancelled;
+@property (readwrite) BOOL usedSmartRender;
+@end
+
+@implementation MESmartRenderSession
+
+- (instancetype)initWithInputURL:(NSURL*)inputURL
+                       outputURL:(NSURL*)outputURL
+                       timeRange:(CMTimeRange)timeRange
+                         builder:(MESmartRenderPartBuilder)builder
+{
+    if (self = [super init]) {
+        _inputURL = inputURL;
+        _outputURL = outputURL;
+        _timeRange = timeRange;
+        _builder = [builder copy];
+        NSString* dirName = [outputURL.lastPathComponent stringByAppendingString:@".smart"];
+        _workDirectoryURL = [outputURL.URLByDeletingLastPathComponent URLByAppendingPathComponent:dirName isDirectory:YES];
+    }
+    return self;
+}
+
++ (instancetype)sessionWithInputURL:(NSURL*)inputURL
+                          outputURL:(NSURL*)outputURL
+                          timeRange:(CMTimeRange)timeRange
+                            builder:(MESmartRenderPartBuilder)builder
+{
+    return [[self alloc] initWithInputURL:inputURL outputURL:outputURL timeRange:timeRange builder:builder];
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+    [self.currentTranscoder cancelAsync];
+}
+
+/* =================================================================================== */
+// MARK: - planning
+/* =================================================================================== */
+
+/// nil if the job only re-encodes video into the source codec without changing the picture
+- (nullable NSString*)ineligibilityOfTranscoder:(METranscoder*)transcoder sourceVideo:(AVMovieTrack*)track
+{
+    if (transcoder.muxerFormat || transcoder.segmentDuration > 0) return @"output is not a movie file";
+    if (transcoder.audioEncode || [transcoder hasAudioMEConverters]) return @"audio is re-encoded";
+
+    FourCharCode source = codecFamily(CMFormatDescriptionGetMediaSubType(firstFormatDescription(track)));
+    if (track.formatDescriptions.count != 1 || source == 0) return @"source is not a single H.264/HEVC stream";
+
+    MEManager* manager = nil;
+    for (id item in transcoder.managers.allValues) {
+        if ([item isKindOfClass:[MEManager class]]) manager = item;
+    }
+    FourCharCode target = 0;
+    if (manager) {
+        if (manager.videoFilterString.length) return @"video filter is used";
+        NSValue* size = manager.videoEncoderSetting[kMEVECodecWxHKey];
+        CMVideoDimensions dims = CMVideoFormatDescriptionGetDimensions(firstFormatDescription(track));
+        if (size && (size.sizeValue.width != dims.width || size.sizeValue.height != dims.height)) {
+            return @"video is scaled";
+        }
+        target = codecFamilyOfEncoder(manager.videoEncoderSetting[kMEVECodecNameKey]);
+    } else if (transcoder.videoEncode) {
+        target = codecFamily(fourCCFromString(transcoder.videoFourcc));
+    }
+    if (target != source) return @"video is not re-encoded into the source codec";
+    return nil;
+}
+
+/* =================================================================================== */
+// MARK: - running
+/* =================================================================================== */
+
+- (BOOL)exportRange:(CMTimeRange)range toURL:(NSURL*)url error:(NSError**)error
+{
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    METranscoder* transcoder = self.builder(url);
+    if (!transcoder) {
+        if (error) *error = MESmartRenderError(@"Cannot prepare a part.", paramErr);
+        return NO;
+    }
+    transcoder.startTime = range.start;
+    transcoder.endTime = CMTimeRangeGetEnd(range);
+
+    self.currentTranscoder = transcoder;
+    NSError* partError = nil;
+    BOOL success = !self.cancelled && [transcoder exportCustomOnError:&partError]; // blocking method call
+    self.currentTranscoder = nil;
+    if (!success) {
+        if (self.cancelled) {
+            if (error) *error = MESmartRenderError(@"Export was cancelled.", userCanceledErr);
+        } else if (error) {
+            *error = transcoder.finalError ?: partError ?: MESmartRenderError(@"Part export failed.", paramErr);
+        }
+    }
+    return success;
+}
+
+- (BOOL)exportFullRangeWithReason:(NSString*)reason error:(NSError**)error
+{
+    SecureLogf(@"[MESmartRenderSession] Exporting the whole range: %@.", reason);
+    self.usedSmartRender = NO;
+    return [self exportRange:self.timeRange toURL:self.outputURL error:error];
+}
+
+- (BOOL)runWithError:(NSError**)error
+{
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMovie* source = [AVMovie movieWithURL:self.inputURL options:options];
+    NSArray<AVMovieTrack*>* videoTracks = [source tracksWithMediaType:AVMediaTypeVideo];
+    AVMovieTrack* video = videoTracks.firstObject;
+    CMTimeRange range = CMTimeRangeGetIntersection(self.timeRange, CMTimeRangeMake(kCMTimeZero, source.duration));
+    if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) {
+        if (error) *error = MESmartRenderError(@"Trim range is outside of the input movie.", paramErr);
+        return NO;
+    }
+    self.timeRange = range;
+    if (videoTracks.count != 1) {
+        return [self exportFullRangeWithReason:@"source has no single video track" error:error];
+    }
+
+    METranscoder* probe = self.builder(self.outputURL);
+    if (!probe) {
+        if (error) *error = MESmartRenderError(@"Cannot prepare the transcoder.", paramErr);
+        return NO;
+    }
+    NSString* reason = [self ineligibilityOfTranscoder:probe sourceVideo:video];
+    BOOL copyOtherMedia = probe.copyOtherMedia;
+    probe = nil;
+    if (reason) {
+        return [self exportFullRangeWithReason:reason error:error];
+    }
+
+    // Copy [first sync at/after start, last sync at/before end); re-encode what is around it
+    CMTime end = CMTimeRangeGetEnd(range);
+    CMTime copyStart = [MEMovieAssembler syncTimeOfTrack:video atOrAfter:range.start];
+    CMTime copyEnd = [MEMovieAssembler syncTimeOfTrack:video atOrBefore:end];
+    if (!CMTIME_IS_VALID(copyStart) || !CMTIME_IS_VALID(copyEnd) || CMTIME_COMPARE_INLINE(copyStart, >=, copyEnd)) {
+        return [self exportFullRangeWithReason:@"no whole GOP inside the range" error:error];
+    }
+    // Leading pictures of an open GOP reference the GOP before it, which is re-encoded or gone
+    if ([MEMovieAssembler isOpenGOPOfTrack:video atSyncTime:copyStart] ||
+        [MEMovieAssembler isOpenGOPOfTrack:video atSyncTime:copyEnd]) {
+        return [self exportFullRangeWithReason:@"source has open GOPs at the cut points" error:error];
+    }
+    CMTimeRange head = CMTimeRangeFromTimeToTime(range.start, copyStart);
+    CMTimeRange middle = CMTimeRangeFromTimeToTime(copyStart, copyEnd);
+    CMTimeRange tail = CMTimeRangeFromTimeToTime(copyEnd, end);
+
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if (![fm createDirectoryAtURL:self.workDirectoryURL withIntermediateDirectories:YES attributes:nil error:nil]) {
+        if (error) *error = MESmartRenderError(@"Cannot create the work directory.", paramErr);
+        return NO;
+    }
+    NSURL* headURL = [self.workDirectoryURL URLByAppendingPathComponent:@"head.mov"];
+    NSURL* tailURL = [self.workDirectoryURL URLByAppendingPathComponent:@"tail.mov"];
+    SecureLogf(@"[MESmartRenderSession] Re-encoding %.3f + %.3f sec, copying %.3f sec.",
+               CMTimeGetSeconds(head.duration), CMTimeGetSeconds(tail.duration), CMTimeGetSeconds(middle.duration));
+
+    BOOL success = YES;
+    NSArray<NSURL*>* partURLs = @[headURL, tailURL];
+    CMTimeRange partRanges[] = {head, tail};
+    NSMutableArray* partMovies = [NSMutableArray array];   // AVMovie, or NSNull for an empty part
+    for (NSUInteger index = 0; index < partURLs.count; index++) {
+        if (CMTIMERANGE_IS_EMPTY(partRanges[index])) {
+            [partMovies addObject:[NSNull null]];
+            continue;
+        }
+        success = [self exportRange:partRanges[index] toURL:partURLs[index] error:error];
+        if (!success) break;
+        AVMovie* part = [AVMovie movieWithURL:partURLs[index] options:options];
+        CMFormatDescriptionRef partDesc = firstFormatDescription([part tracksWithMediaType:AVMediaTypeVideo].firstObject);
+        NSString* mismatch = partDesc ? [MEMovieAssembler incompatibilityOfVideoFormat:partDesc
+                                                                     withFormat:firstFormatDescription(video)]
+                                       : @"no video";
+        if (mismatch) {
+            [fm removeItemAtURL:self.workDirectoryURL error:nil];
+            NSString* why = [NSString stringWithFormat:@"encoded GOPs differ from the source in %@", mismatch];
+            return [self exportFullRangeWithReason:why error:error];
+        }
+        [partMovies addObject:part];
+    }
+    if (success) {
+        success = [self assembleMovie:source head:partMovies[0] tail:partMovies[1] middle:middle
+                       copyOtherMedia:copyOtherMedia error:error];
+    }
+    if (success) {
+        self.usedSmartRender = YES;
+        [fm removeItemAtURL:self.workDirectoryURL error:nil];
+    } else if (self.cancelled) {
+        [fm removeItemAtURL:self.workDirectoryURL error:nil];
+    }
+    return success;
+}
+
+/// head, source GOPs and tail into one video track; other media from the source. Empty parts are NSNull.
+- (BOOL)assembleMovie:(AVMovie*)source head:(id)head tail:(id)tail middle:(CMTimeRange)middle
+       copyOtherMedia:(BOOL)copyOtherMedia error:(NSError**)error
+{
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if ([fm fileExistsAtPath:self.outputURL.path] && ![fm removeItemAtURL:self.outputURL error:error]) {
+        SecureErrorLogf(@"[MESmartRenderSession] ERROR: Cannot replace %@", self.outputURL.path);
+        return NO;
+    }
+    NSDictionary* options = @{AVURLAssetPreferPreciseDurationAndTimingKey: @YES};
+    AVMovieTrack* sourceVideo = [source tracksWithMediaType:AVMediaTypeVideo].firstObject;
+    AVMutableMovie* movie = [AVMutableMovie movieWithSettingsFromMovie:source options:options error:error];
+    if (!movie) return NO;
+    // sample data is copied into the destination, then the header is added to it
+    movie.defaultMediaDataStorage = [[AVMediaDataStorage alloc] initWithURL:self.outputURL options:nil];
+
+    AVMutableMovieTrack* video = [movie addMutableTrackWithMediaType:AVMediaTypeVideo
+                                               copySettingsFromTrack:sourceVideo options:nil];
+    CMTime cursor = kCMTimeZero;
+    for (id item in @[head, source, tail]) {
+        if (item == [NSNull null]) continue;
+        AVMovieTrack* track = sourceVideo;
+        CMTimeRange range = middle;
+        if (item != source) {
+            track = [(AVMovie*)item tracksWithMediaType:AVMediaTypeVideo].firstObject;
+            range = track.timeRange;
+        }
+        if (![video insertTimeRange:range ofTrack:track atTime:cursor copySampleData:YES error:error]) {
+            SecureErrorLog(@"[MESmartRenderSession] ERROR: Cannot append video samples.");
+            return NO;
+        }
+        cursor = CMTimeAdd(cursor, range.duration);
+    }
+
+    for (AVMovieTrack* track in source.tracks) {
+        NSString* type = track.mediaType;
+        if ([type isEqualToString:AVMediaTypeVideo]) continue;
+        if (![type isEqualToString:AVMediaTypeAudio] && !copyOtherMedia) continue;
+        CMTimeRange range = CMTimeRangeGetIntersection(self.timeRange, track.timeRange);
+        if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) continue;
+        AVMutableMovieTrack* copy = [movie addMutableTrackWithMediaType:type copySettingsFromTrack:track options:nil];
+        CMTime at = CMTimeSubtract(range.start, self.timeRange.start);
+        if (![copy insertTimeRange:range ofTrack:track atTime:at copySampleData:YES error:error]) {
+            SecureErrorLogf(@"[MESmartRenderSession] ERROR: Cannot copy %@ track %d.", type, track.trackID);
+            return NO;
+        }
+    }
+
+    if (![movie writeMovieHeaderToURL:self.outputURL
+                             fileType:AVFileTypeQuickTimeMovie
+                              options:AVMovieWritingAddMovieHeaderToDestination
+                                error:error]) {
+        SecureErrorLogf(@"[MESmartRenderSession] ERROR: Cannot write movie header to %@", self.outputURL.path);
+        return NO;
+    }
+    SecureLogf(@"[MESmartRenderSession] Wrote %.3f sec into %@", CMTimeGetSeconds(cursor), self.outputURL.lastPathComponent);
+    return YES;
+}
+
+@end
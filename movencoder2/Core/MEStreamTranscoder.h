@@ -0,0 +1,82 @@
+//
+//  MEStreamTranscoder.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEStreamTranscoder.h
+ * @abstract Internal API - libav only transcode of one video stream, pipes included
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEStreamTranscoder connects MEDemuxer, an MEManager and MEMuxer without any
+ * AVFoundation object, so neither side needs to be a movie file:
+ *
+ *     Y4M/NUT on stdin -> libavcodec decode -> MEFilterPipeline -> MEEncoderPipeline
+ *         -> Annex-B H.264/HEVC, IVF or NUT on stdout
+ *
+ * Use "pipe:0" / "pipe:1" (or "-") for stdin/stdout. When the output container has
+ * no header for parameter sets (Annex-B, IVF, MPEG-TS) the encoder repeats them in
+ * the stream. Pipe buffers are enlarged where the platform allows (F_SETPIPE_SZ).
+ *
+ * With followsInput, the input is a file still being recorded (MEGrowingFile):
+ * encoding runs behind the recorder and finishes once completionMarker exists or
+ * the file has not grown for idleTimeout seconds.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEStreamTranscoder_h
+#define MEStreamTranscoder_h
+
+@import Foundation;
+
+@class MEManager;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEStreamTranscoder : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param input Source path or libavformat URL; "-" reads stdin
+ @param output Destination path or libavformat URL; "-" writes stdout
+ @param manager MEManager with the video encoder (and filter) configured
+ */
+- (instancetype)initWithInput:(NSString*)input output:(NSString*)output manager:(MEManager*)manager NS_DESIGNATED_INITIALIZER;
++ (instancetype)streamTranscoderWithInput:(NSString*)input output:(NSString*)output manager:(MEManager*)manager;
+
+@property (nonatomic, readonly) NSString* input;
+@property (nonatomic, readonly) NSString* output;
+@property (nonatomic, readonly) MEManager* manager;
+
+@property (nonatomic, copy, nullable) NSString* inputFormat;    // libavformat demuxer (yuv4mpegpipe, nut); nil probes
+@property (nonatomic, copy) NSString* outputFormat;             // libavformat muxer (default nut)
+@property (nonatomic) int decoderThreads;                       // 0 = one per core
+@property (nonatomic) BOOL verbose;
+
+@property (nonatomic) BOOL followsInput;                        // input is a growing file
+@property (nonatomic) NSTimeInterval idleTimeout;               // growing input ends after no growth (default 60; 0 = marker only)
+@property (nonatomic, copy, nullable) NSString* completionMarker; // growing input ends once this file exists
+
+/// Transcode until the input ends. Blocks the calling thread.
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Stop reading input; the frames already queued are not written.
+- (void)cancel;
+
+@property (readonly, getter=isCancelled) BOOL cancelled;    // atomic
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEStreamTranscoder_h */
@@ -0,0 +1,209 @@
+//
+//  MEStreamTranscoder.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr, userCanceledErr
+
+#import "MEStreamTranscoder.h"
+#import "MEManager+SampleBuffer.h"
+#import "MESecureLogging.h"
+#import "MEMetrics.h"
+#import "MEDemuxer.h"
+#import "MEMuxer.h"
+#import "MEGrowingFile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char* const kStreamDecoderQueueLabel = "movencoder.streamDecoderQueue";
+static const int kPipeBufferSize = 1 << 20;     // F_SETPIPE_SZ request; capped by the system
+
+static inline NSError* MEStreamError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Stream transcode failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/// "-" is shorthand for the stdin/stdout pipe protocol
+static NSString* libavURL(NSString* path, int fd) {
+    return [path isEqualToString:@"-"] ? [NSString stringWithFormat:@"pipe:%d", fd] : path;
+}
+
+/// Fewer wakeups per frame on FIFOs; a no-op where F_SETPIPE_SZ does not exist (macOS)
+static void enlargePipeBuffer(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) return;
+#ifdef F_SETPIPE_SZ
+    if (fcntl(fd, F_SETPIPE_SZ, kPipeBufferSize) < 0) {
+        SecureDebugLogf(@"[MEStreamTranscoder] F_SETPIPE_SZ failed on fd %d (errno %d)", fd, errno);
+    }
+#else
+    (void)kPipeBufferSize;
+#endif
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEStreamTranscoder () {
+    MEGrowingFile* _growingFile;    // guarded by @synchronized(self); -cancel ends its wait
+}
+@property (readwrite, getter=isCancelled) BOOL cancelled;
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation MEStreamTranscoder
+
+- (instancetype)initWithInput:(NSString*)input output:(NSString*)output manager:(MEManager*)manager
+{
+    self = [super init];
+    if (self) {
+        _input = [input copy];
+        _output = [output copy];
+        _manager = manager;
+        _outputFormat = @"nut";
+        _idleTimeout = 60.0;
+    }
+    return self;
+}
+
++ (instancetype)streamTranscoderWithInput:(NSString*)input output:(NSString*)output manager:(MEManager*)manager
+{
+    return [[self alloc] initWithInput:input output:output manager:manager];
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+    @synchronized (self) {
+        MEGrowingFileCancel(_growingFile);
+    }
+}
+
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error
+{
+    MEManager* mgr = self.manager;
+    NSString* inputURL = libavURL(self.input, STDIN_FILENO);
+    NSString* outputURL = libavURL(self.output, STDOUT_FILENO);
+    MEDemuxer* demuxer = NULL;
+    MEMuxer* muxer = NULL;
+    NSError* err = nil;
+    int ret = 0;
+
+    if (!mgr.videoEncoderSetting) {
+        err = MEStreamError(@"The stream transcode requires a libavcodec video encoder.", paramErr);
+        goto end;
+    }
+    if ([inputURL isEqualToString:@"pipe:0"]) {
+        enlargePipeBuffer(STDIN_FILENO);
+    }
+    if ([outputURL isEqualToString:@"pipe:1"]) {
+        enlargePipeBuffer(STDOUT_FILENO);
+    }
+
+    if (self.followsInput) {
+        MEGrowingFile* growingFile = MEGrowingFileOpen(inputURL.fileSystemRepresentation,
+                                                       self.completionMarker.fileSystemRepresentation,
+                                                       self.idleTimeout, &ret);
+        if (!growingFile) {
+            err = MEStreamError([NSString stringWithFormat:@"Cannot open the growing input %@ (%d).", inputURL, ret], paramErr);
+            goto end;
+        }
+        @synchronized (self) {
+            _growingFile = growingFile;
+        }
+        if (self.cancelled) {
+            MEGrowingFileCancel(growingFile);
+        }
+        demuxer = MEDemuxerCreateWithIO(MEGrowingFileIOContext(growingFile), self.inputFormat.UTF8String,
+                                        self.decoderThreads, &ret);
+    } else {
+        demuxer = MEDemuxerCreate(inputURL.UTF8String, self.inputFormat.UTF8String, self.decoderThreads, &ret);
+    }
+    if (!demuxer) {
+        err = MEStreamError([NSString stringWithFormat:@"Cannot open the input %@ (%d).", inputURL, ret], paramErr);
+        goto end;
+    }
+    muxer = MEMuxerCreate(outputURL.UTF8String, self.outputFormat.UTF8String, &ret);
+    if (!muxer) {
+        err = MEStreamError([NSString stringWithFormat:@"Cannot open the %@ output %@ (%d).",
+                             self.outputFormat, outputURL, ret], paramErr);
+        goto end;
+    }
+
+    {
+        AVRational tb = MEDemuxerStream(demuxer)->time_base;
+        if (tb.num == 1) {
+            mgr.mediaTimeScale = tb.den;
+        }
+        // Annex-B, IVF and MPEG-TS carry parameter sets in band
+        mgr.useGlobalHeader = (MEMuxerWantsGlobalHeader(muxer) != 0);
+
+        if (self.verbose) {
+            const AVCodecContext* avctx = MEDemuxerCodecContext(demuxer);
+            SecureDebugLogf(@"[MEStreamTranscoder] %@ -> %@ (%@), decoder %s, %d threads",
+                            inputURL, outputURL, self.outputFormat, avctx->codec->name, avctx->thread_count);
+        }
+    }
+
+    {
+        dispatch_group_t dg = dispatch_group_create();
+        dispatch_queue_t queue = dispatch_queue_create(kStreamDecoderQueueLabel, DISPATCH_QUEUE_SERIAL);
+        __block int decodeResult = 0;
+        __weak typeof(self) wself = self;
+        dispatch_group_enter(dg);
+        [mgr appendFramesFromDemuxer:demuxer onQueue:queue range:kCMTimeRangeInvalid shouldStop:^BOOL{
+            return wself.cancelled;
+        } completionHandler:^(int result) {
+            decodeResult = result;
+            dispatch_group_leave(dg);
+        }];
+
+        // Drain even after -cancel; the input side flushes the encoder so the output is complete
+        int written = 0;
+        do {
+            @autoreleasepool {
+                written = [mgr writeNextPacketToMuxer:muxer];
+            }
+        } while (written > 0);
+        dispatch_group_wait(dg, DISPATCH_TIME_FOREVER);
+
+        if (decodeResult < 0) {
+            err = MEStreamError([NSString stringWithFormat:@"Decoding the input failed (%d).", decodeResult], paramErr);
+        } else if (written < 0) {
+            err = MEStreamError(@"Encoding or muxing the video stream failed.", paramErr);
+        } else if ((ret = MEMuxerFinish(muxer)) < 0) {
+            err = MEStreamError([NSString stringWithFormat:@"Cannot finish the %@ output (%d).",
+                                 self.outputFormat, ret], paramErr);
+        } else if (self.cancelled) {
+            err = MEStreamError(@"Stream transcode was cancelled.", userCanceledErr);
+        }
+    }
+
+end:
+    MEMuxerFree(&muxer);
+    MEDemuxerFree(&demuxer);
+    @synchronized (self) {
+        MEGrowingFileClose(&_growingFile);
+    }
+    if (err) {
+        SecureErrorLogf(@"[MEStreamTranscoder] ERROR: %@", err.localizedFailureReason);
+        if (error) *error = err;
+        return NO;
+    }
+    return YES;
+}
+
+@end
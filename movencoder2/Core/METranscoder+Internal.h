@@ -19,6 +19,16 @@
 #import "MEOutput.h"
 #import "MEAudioConverter.h"
 #import "SBChannel.h"
+#import "MEDemuxer.h"
+
+@class SBChannelScheduler;
+@class MEMetricsExporter;
+@class MESegmentWriter;
+@class MEResultCache;
+@class SBSliceReader;
+
+/// Decoded frames of a source video track from a shared reader, or nil to read the track itself
+typedef MEOutput* _Nullable (^MEVideoSourceProvider)(AVMovieTrack* _Nonnull track);
 
 /* =================================================================================== */
 // MARK: -
@@ -42,10 +52,31 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (strong, nonatomic) NSMutableArray<SBChannel*>* sbChannels;
 @property (strong, nonatomic, nullable) NSMutableDictionary* managers;
+@property (strong, nullable) SBChannelScheduler* channelScheduler; // atomic
 
 // Centralized, type-safe configuration used internally
 @property (strong, nonatomic) METranscodeConfiguration* transcodeConfig;
 
+// rate-limited progress reporting (polls SBChannel counters)
+@property (strong, nonatomic, nullable) dispatch_source_t progressTimer;
+@property (strong, nonatomic, nullable) NSMutableArray<NSNumber*>* progressSampleCounts;
+
+// per-stage metrics export (kMetricsPathKey)
+@property (strong, nonatomic, nullable) MEMetricsExporter* metricsExporter;
+@property (nonatomic, assign) BOOL tracing; // kTracePathKey
+
+// segment output (kSegmentDurationKey)
+@property (strong, nonatomic, nullable) MESegmentWriter* segmentWriter;
+
+// libavformat output (kMuxerFormatKey)
+@property (strong, nonatomic, nullable) MEManager* muxerManager;
+
+// decoded video from a shared reader (MEEDLSession); audio is still read per transcoder
+@property (copy, nonatomic, nullable) MEVideoSourceProvider videoSourceProvider;
+
+// intra-only video decoded by several readers (kSliceReadersKey)
+@property (strong, nonatomic, nullable) NSMutableArray<SBSliceReader*>* sliceSources;
+
 @property (nonatomic, assign) CFAbsoluteTime timeStamp0;
 @property (nonatomic, assign) CFAbsoluteTime timeStamp1;
 @property (nonatomic, readonly) CFAbsoluteTime timeElapsed;
@@ -75,7 +106,13 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void) rwDidStarted;
 - (void) rwDidFinished;
-- (void) didReadBuffer:(CMSampleBufferRef)buffer from:(SBChannel*)channel;
+- (void) startProgressReporting;
+- (void) stopProgressReporting;
+- (void) reportProgress;
+- (void) startMetricsExport;
+- (void) finishMetricsExport;
+- (void) startTraceExport;
+- (void) finishTraceExport;
 
 // MARK: - utility methods
 
@@ -90,10 +127,23 @@ NS_ASSUME_NONNULL_BEGIN
 - (void) cleanupTemporaryFilesForOutput:(NSURL*)outputURL;
 
 // MARK: - refactored helper steps (export pipeline)
-- (BOOL)me_prepareExportSession:(NSError * _Nullable * _Nullable)error useME:(BOOL*)useME useAC:(BOOL*)useAC;
+- (BOOL)me_prepareExportSession:(NSError * _Nullable * _Nullable)error useME:(BOOL*)useME useAC:(BOOL*)useAC
+                          remux:(BOOL*)remux;
+- (BOOL)me_prepareReaderWriter:(NSError * _Nullable * _Nullable)error;
 - (BOOL)me_configureWriterAndPrepareChannelsWithMovie:(AVMutableMovie*)mov useME:(BOOL)useME useAC:(BOOL)useAC error:(NSError * _Nullable * _Nullable)error;
 - (BOOL)me_startIOAndWaitWithReader:(AVAssetReader*)ar writer:(AVAssetWriter*)aw finish:(BOOL*)finish error:(NSError * _Nullable * _Nullable)error;
 - (BOOL)me_finalizeSessionWithFinish:(BOOL)finish error:(NSError * _Nullable * _Nullable)error;
+- (BOOL)me_exportWithMuxerFromMovie:(AVMutableMovie*)mov error:(NSError * _Nullable * _Nullable)error;
+- (void)me_prepareDemuxedVideoWith:(AVMovie*)movie demuxer:(MEDemuxer*)demuxer;
+- (BOOL)me_canRemux;
+- (BOOL)me_remuxMovie:(AVMutableMovie*)mov;
+- (BOOL)me_fixupMovie:(AVMutableMovie*)mov useME:(BOOL)useME useAC:(BOOL)useAC error:(NSError * _Nullable * _Nullable)error;
+- (nullable MEResultCache*)me_resultCache;
+- (nullable NSString*)me_resultCacheKey;
+- (void)me_applyPrefetchToChannels;
+- (void)me_applySchedulerToChannels;
+- (nullable NSError*)me_sliceSourceError;
+- (void)me_configureManager:(MEManager*)mgr trackID:(CMPersistentTrackID)trackID;
 
 @end
 
@@ -124,8 +174,9 @@ NS_ASSUME_NONNULL_BEGIN
 - (void) addDecompressionPropertiesOf:(AVMovieTrack*)track setting:(NSMutableDictionary*)arOutputSetting;
 - (NSMutableDictionary<NSString*,id>*) videoCompressionSettingFor:(AVMovieTrack *)track;
 
+- (nullable MEOutput*) decodedVideoSourceOf:(AVMovieTrack*)track from:(AVAssetReader*)ar;
 - (void) prepareVideoChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(AVAssetWriter*)aw;
-- (void) prepareVideoMEChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(AVAssetWriter*)aw;
+- (void) prepareVideoMEChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(nullable AVAssetWriter*)aw;
 
 @end
 
@@ -153,6 +204,26 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, readonly) BOOL copyField;
 @property (nonatomic, readonly) BOOL copyNCLC;
 
+@property (nonatomic, readonly) NSUInteger prefetchFrames;
+@property (nonatomic, readonly) size_t prefetchBytes;
+@property (nonatomic, readonly) double interleaveWindow;
+@property (nonatomic, readonly, nullable) NSURL* metricsURL;
+@property (nonatomic, readonly, nullable) NSURL* traceURL;
+@property (nonatomic, readonly) int threadBudget;
+@property (nonatomic, readonly) NSString* movieLayout;
+@property (nonatomic, readonly) double movieFragmentInterval;
+@property (nonatomic, readonly) double segmentDuration;
+@property (nonatomic, readonly, nullable) NSString* muxerFormat;
+@property (nonatomic, readonly) NSString* inputBackend;
+@property (nonatomic, readonly) int decoderThreads;
+@property (nonatomic, readonly) BOOL lowLatency;
+@property (nonatomic, readonly, nullable) NSURL* resultCacheURL;
+@property (nonatomic, readonly) uint64_t resultCacheSize;
+@property (nonatomic, readonly, nullable) NSDictionary<NSString*, NSString*>* metadataFixup;
+@property (nonatomic, readonly) NSUInteger sliceReaderCount;
+@property (nonatomic, readonly) BOOL encoderWorker;
+@property (nonatomic, readonly) BOOL threadAffinity;
+
 @end
 
 NS_ASSUME_NONNULL_END
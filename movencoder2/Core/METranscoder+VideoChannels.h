@@ -14,6 +14,8 @@
 #import "MECommon.h"
 #import "METranscoder.h"
 
+@class MEOutput;
+
 /* =================================================================================== */
 // MARK: -
 /* =================================================================================== */
@@ -22,6 +24,18 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface METranscoder (VideoChannels)
 
+/**
+ * @brief Decompressed video source of a track
+ *
+ * Returns the producer handed out by videoSourceProvider for the track,
+ * or adds a new decompressing output for it to the asset reader.
+ *
+ * @param track Source video track
+ * @param ar Asset reader
+ * @return Producer for an SBChannel, or nil if the track cannot be read
+ */
+- (nullable MEOutput*) decodedVideoSourceOf:(AVMovieTrack*)track from:(AVAssetReader*)ar;
+
 /**
  * @brief Setup video encoding channels with AVFoundation
  *
@@ -42,11 +56,14 @@ NS_ASSUME_NONNULL_BEGIN
  * Provides advanced video processing capabilities and can operate
  * in either encoding or passthrough mode based on configuration.
  *
+ * Without an asset writer the first encoded track is kept as muxerManager
+ * for the libavformat backend instead of being connected to a writer input.
+ *
  * @param movie Source movie
  * @param ar Asset reader
- * @param aw Asset writer
+ * @param aw Asset writer, or nil for the libavformat backend
  */
-- (void) prepareVideoMEChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(AVAssetWriter*)aw;
+- (void) prepareVideoMEChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(nullable AVAssetWriter*)aw;
 
 @end
 
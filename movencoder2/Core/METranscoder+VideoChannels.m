@@ -10,6 +10,11 @@
 
 #import "METranscoder+Internal.h"
 #import "MESecureLogging.h"
+#import "SBSliceReader.h"
+#import "MEAffinity.h"
+
+// Frames per chunk of a sliced decode, unless kPrefetchFramesKey is set
+static const NSUInteger kSliceChunkFrames = 8;
 
 /* =================================================================================== */
 // MARK: -
@@ -19,6 +24,55 @@ NS_ASSUME_NONNULL_BEGIN
 
 @implementation METranscoder (VideoChannels)
 
+/// Decompressed frames of the track: from videoSourceProvider when it has them, or a new reader output
+- (nullable MEOutput*) decodedVideoSourceOf:(AVMovieTrack*)track from:(AVAssetReader*)ar
+{
+    if (self.videoSourceProvider) {
+        MEOutput* shared = self.videoSourceProvider(track);
+        if (shared) return shared;
+    }
+    
+    NSMutableDictionary<NSString*,id>* arOutputSetting = [NSMutableDictionary dictionary];
+    [self addDecompressionPropertiesOf:track setting:arOutputSetting];
+    arOutputSetting[(__bridge NSString*)kCVPixelBufferPixelFormatTypeKey] = @(kCVPixelFormatType_422YpCbCr8);
+    
+    // Intra-only decode scales with readers; the merged frames are in presentation order again
+    NSUInteger slices = self.sliceReaderCount;
+    if (slices > 1 && [SBSliceReader isIntraOnlyTrack:track]) {
+        NSUInteger chunkFrames = self.prefetchFrames ?: kSliceChunkFrames;
+        SBSliceReader* sliced = [SBSliceReader sliceReaderWithTrack:track
+                                                     outputSettings:arOutputSetting
+                                                          timeRange:CMTimeRangeFromTimeToTime(self.startTime, self.endTime)
+                                                            readers:slices
+                                                        chunkFrames:chunkFrames
+                                                           maxBytes:self.prefetchBytes];
+        if (!self.sliceSources) {
+            self.sliceSources = [NSMutableArray array];
+        }
+        [self.sliceSources addObject:sliced];
+        SecureLogf(@"[METranscoder] Video track(%d) is decoded by %lu readers in chunks of %lu frames",
+                   track.trackID, (unsigned long)sliced.readerCount, (unsigned long)chunkFrames);
+        return (MEOutput*)sliced;
+    } else if (slices > 1) {
+        SecureLogf(@"[METranscoder] Video track(%d) is not intra-only; decoded by one reader", track.trackID);
+    }
+    
+    AVAssetReaderOutput* arOutput = [AVAssetReaderTrackOutput assetReaderTrackOutputWithTrack:track
+                                                                               outputSettings:arOutputSetting];
+    __block BOOL arOK = FALSE;
+    dispatch_sync(self.processQueue, ^{
+        arOK = [ar canAddOutput:arOutput];
+    });
+    if (!arOK) {
+        SecureErrorLogf(@"Skipping video track(%d) - reader output not supported", track.trackID);
+        return nil;
+    }
+    dispatch_sync(self.processQueue, ^{
+        [ar addOutput:arOutput];
+    });
+    return (MEOutput*)arOutput;
+}
+
 - (void) prepareVideoChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(AVAssetWriter*)aw
 {
     if (self.videoEncode == FALSE) {
@@ -28,22 +82,8 @@ NS_ASSUME_NONNULL_BEGIN
     
     for (AVMovieTrack* track in [movie tracksWithMediaType:AVMediaTypeVideo]) {
         // source
-        NSMutableDictionary<NSString*,id>* arOutputSetting = [NSMutableDictionary dictionary];
-        [self addDecompressionPropertiesOf:track setting:arOutputSetting];
-        arOutputSetting[(__bridge NSString*)kCVPixelBufferPixelFormatTypeKey] = @(kCVPixelFormatType_422YpCbCr8);
-        AVAssetReaderOutput* arOutput = [AVAssetReaderTrackOutput assetReaderTrackOutputWithTrack:track
-                                                                                   outputSettings:arOutputSetting];
-        __block BOOL arOK = FALSE;
-        dispatch_sync(self.processQueue, ^{
-            arOK = [ar canAddOutput:arOutput];
-        });
-        if (!arOK) {
-            SecureErrorLogf(@"Skipping video track(%d) - reader output not supported", track.trackID);
-            continue;
-        }
-        dispatch_sync(self.processQueue, ^{
-            [ar addOutput:arOutput];
-        });
+        MEOutput* arOutput = [self decodedVideoSourceOf:track from:ar];
+        if (!arOutput) continue;
         
         //
         NSMutableDictionary<NSString*,id> * awInputSetting = [self videoCompressionSettingFor:track];
@@ -63,14 +103,14 @@ NS_ASSUME_NONNULL_BEGIN
         });
         
         // channel
-        SBChannel* sbcVideo = [SBChannel sbChannelWithProducerME:(MEOutput*)arOutput
+        SBChannel* sbcVideo = [SBChannel sbChannelWithProducerME:arOutput
                                                       consumerME:(MEInput*)awInput
                                                          TrackID:track.trackID];
         [self.sbChannels addObject:sbcVideo];
     }
 }
 
-- (void) prepareVideoMEChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(AVAssetWriter*)aw
+- (void) prepareVideoMEChannelsWith:(AVMovie*)movie from:(AVAssetReader*)ar to:(nullable AVAssetWriter*)aw
 {
     for (AVMovieTrack* track in [movie tracksWithMediaType:AVMediaTypeVideo]) {
         //
@@ -78,6 +118,10 @@ NS_ASSUME_NONNULL_BEGIN
         //NSDictionary* managers = self.managers[key];
         MEManager* mgr = self.managers[key];
         if (!mgr) continue;
+        if (!aw && self.muxerManager) {
+            SecureErrorLogf(@"Skipping video track(%d) - the libavformat muxer takes one video track", track.trackID);
+            continue;
+        }
 
         // Capture source track's format description extensions
         NSArray* descArray = track.formatDescriptions;
@@ -91,34 +135,27 @@ NS_ASSUME_NONNULL_BEGIN
         
         int32_t ts = track.naturalTimeScale;
         mgr.mediaTimeScale = ts;
+        [self me_configureManager:mgr trackID:track.trackID];
         
         // source from
-        NSMutableDictionary<NSString*,id>* arOutputSetting = [NSMutableDictionary dictionary];
-        [self addDecompressionPropertiesOf:track setting:arOutputSetting];
-        arOutputSetting[(__bridge NSString*)kCVPixelBufferPixelFormatTypeKey] = @(kCVPixelFormatType_422YpCbCr8);
-        AVAssetReaderOutput* arOutput = [AVAssetReaderTrackOutput assetReaderTrackOutputWithTrack:track
-                                                                                   outputSettings:arOutputSetting];
-        __block BOOL arOK = FALSE;
-        dispatch_sync(self.processQueue, ^{
-            arOK = [ar canAddOutput:arOutput];
-        });
-        if (!arOK) {
-            SecureErrorLogf(@"Skipping video track(%d) - reader output not supported", track.trackID);
-            continue;
-        }
-        dispatch_sync(self.processQueue, ^{
-            [ar addOutput:arOutput];
-        });
+        MEOutput* arOutput = [self decodedVideoSourceOf:track from:ar];
+        if (!arOutput) continue;
         
         // source to
         MEInput* meInput = [MEInput inputWithManager:mgr];
         
         // source channel
-        SBChannel* sbcMEInput = [SBChannel sbChannelWithProducerME:(MEOutput*)arOutput
+        SBChannel* sbcMEInput = [SBChannel sbChannelWithProducerME:arOutput
                                                         consumerME:meInput
                                                            TrackID:track.trackID];
         [self.sbChannels addObject:sbcMEInput];
         
+        // the libavformat muxer pulls packets from the manager directly
+        if (!aw) {
+            self.muxerManager = mgr;
+            continue;
+        }
+        
         /* ========================================================================================== */
         
         // destination from
@@ -155,6 +192,40 @@ NS_ASSUME_NONNULL_BEGIN
     }
 }
 
+/// Apply the per-track encoder options (thread budget, low latency, worker, affinity) to the manager
+- (void)me_configureManager:(MEManager*)mgr trackID:(CMPersistentTrackID)trackID
+{
+    int threads = self.threadBudget;
+    if (threads > 0) {
+        mgr.threadCount = threads;
+    }
+    if (self.lowLatency) {
+        mgr.lowLatency = YES;
+    }
+    if (self.encoderWorker) {
+        mgr.encoderWorker = YES;
+    }
+    if (self.threadAffinity) {
+        [self me_placeManager:mgr trackID:trackID];
+    }
+}
+
+/// Give the manager the next cache domain; concurrent managers (and jobs) spread over the domains
+- (void)me_placeManager:(MEManager*)mgr trackID:(CMPersistentTrackID)trackID
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        SecureLogf(@"[METranscoder] Affinity: %@", MEAffinityTopologyDescription());
+    });
+    if (!MEAffinityIsSupported()) {
+        SecureLogf(@"[METranscoder] Affinity: video track(%d) left to the scheduler", trackID);
+        return;
+    }
+    mgr.affinityTag = MEAffinityNextTag();
+    SecureLogf(@"[METranscoder] Affinity: video track(%d) -> tag %ld of %ld",
+               trackID, (long)mgr.affinityTag, (long)MEAffinityDomainCount());
+}
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -93,6 +93,141 @@ NS_ASSUME_NONNULL_BEGIN
     return copyNCLC;
 }
 
+- (NSUInteger) prefetchFrames
+{
+    NSNumber* numFrames = self.transcodeConfig.encodingParams[kPrefetchFramesKey];
+    int frames = (numFrames != nil) ? numFrames.intValue : 0;
+    if (self.lowLatency && (frames > 0 || self.prefetchBytes > 0)) {
+        frames = 1;                                 // every queued frame adds a frame of latency
+    }
+    return (NSUInteger)MAX(frames, 0);
+}
+
+- (size_t) prefetchBytes
+{
+    NSNumber* numBytes = self.transcodeConfig.encodingParams[kPrefetchBytesKey];
+    long long bytes = (numBytes != nil) ? numBytes.longLongValue : 0;
+    return (size_t)MAX(bytes, 0);
+}
+
+- (double) interleaveWindow
+{
+    NSNumber* numWindow = self.transcodeConfig.encodingParams[kInterleaveWindowKey];
+    double window = (numWindow != nil) ? numWindow.doubleValue : 0.0;
+    return MAX(window, 0.0);
+}
+
+- (nullable NSURL*) metricsURL
+{
+    NSString* path = self.transcodeConfig.encodingParams[kMetricsPathKey];
+    if (![path isKindOfClass:[NSString class]] || path.length == 0) return nil;
+    return [NSURL fileURLWithPath:path.stringByExpandingTildeInPath];
+}
+
+- (nullable NSURL*) traceURL
+{
+    NSString* path = self.transcodeConfig.encodingParams[kTracePathKey];
+    if (![path isKindOfClass:[NSString class]] || path.length == 0) return nil;
+    return [NSURL fileURLWithPath:path.stringByExpandingTildeInPath];
+}
+
+- (NSString*) movieLayout
+{
+    NSString* layout = self.transcodeConfig.encodingParams[kMovieLayoutKey];
+    NSArray* layouts = @[kMovieLayoutFastStart, kMovieLayoutMoovAtEnd, kMovieLayoutFragmented];
+    if ([layout isKindOfClass:[NSString class]] && [layouts containsObject:layout]) return layout;
+    return kMovieLayoutFastStart;
+}
+
+- (double) movieFragmentInterval
+{
+    NSNumber* numInterval = self.transcodeConfig.encodingParams[kMovieFragmentIntervalKey];
+    double interval = (numInterval != nil) ? numInterval.doubleValue : 10.0;
+    return (interval > 0) ? interval : 10.0;
+}
+
+- (double) segmentDuration
+{
+    NSNumber* numDuration = self.transcodeConfig.encodingParams[kSegmentDurationKey];
+    double duration = (numDuration != nil) ? numDuration.doubleValue : 0.0;
+    return MAX(duration, 0.0);
+}
+
+- (nullable NSString*) muxerFormat
+{
+    NSString* format = self.transcodeConfig.encodingParams[kMuxerFormatKey];
+    NSArray* formats = @[@"mp4", @"mov", @"matroska", @"mpegts", @"nut", @"ivf", @"h264", @"hevc"];
+    if ([format isKindOfClass:[NSString class]] && [formats containsObject:format]) return format;
+    return nil;
+}
+
+- (NSString*) inputBackend
+{
+    NSString* backend = self.transcodeConfig.encodingParams[kInputBackendKey];
+    if ([backend isKindOfClass:[NSString class]] && [backend isEqualToString:kInputBackendLibav]) return kInputBackendLibav;
+    return kInputBackendAVFoundation;
+}
+
+- (int) decoderThreads
+{
+    NSNumber* numThreads = self.transcodeConfig.encodingParams[kDecoderThreadsKey];
+    int threads = (numThreads != nil) ? numThreads.intValue : 0;
+    return MAX(threads, 0);
+}
+
+- (BOOL) lowLatency
+{
+    NSNumber* numLowLatency = self.transcodeConfig.encodingParams[kLowLatencyKey];
+    return (numLowLatency != nil) ? numLowLatency.boolValue : FALSE;
+}
+
+- (nullable NSURL*) resultCacheURL
+{
+    NSString* path = self.transcodeConfig.encodingParams[kResultCacheDirectoryKey];
+    if (![path isKindOfClass:[NSString class]] || path.length == 0) return nil;
+    return [NSURL fileURLWithPath:path.stringByExpandingTildeInPath isDirectory:YES];
+}
+
+- (uint64_t) resultCacheSize
+{
+    NSNumber* numSize = self.transcodeConfig.encodingParams[kResultCacheSizeKey];
+    uint64_t size = (numSize != nil) ? numSize.unsignedLongLongValue : 0;
+    return (size > 0) ? size : 20ULL * 1000 * 1000 * 1000;
+}
+
+- (nullable NSDictionary<NSString*, NSString*>*) metadataFixup
+{
+    NSDictionary* fixup = self.transcodeConfig.encodingParams[kMetadataFixupKey];
+    if (![fixup isKindOfClass:[NSDictionary class]] || fixup.count == 0) return nil;
+    return fixup;
+}
+
+- (BOOL) encoderWorker
+{
+    NSNumber* numWorker = self.transcodeConfig.encodingParams[kEncoderWorkerKey];
+    return (numWorker != nil) ? numWorker.boolValue : FALSE;
+}
+
+- (BOOL) threadAffinity
+{
+    NSNumber* numAffinity = self.transcodeConfig.encodingParams[kThreadAffinityKey];
+    return (numAffinity != nil) ? numAffinity.boolValue : FALSE;
+}
+
+- (NSUInteger) sliceReaderCount
+{
+    NSNumber* numReaders = self.transcodeConfig.encodingParams[kSliceReadersKey];
+    int readers = (numReaders != nil) ? numReaders.intValue : 0;
+    return (NSUInteger)MAX(readers, 0);
+}
+
+- (int) threadBudget
+{
+    NSNumber* numThreads = self.transcodeConfig.encodingParams[kThreadBudgetKey];
+    int threads = (numThreads != nil) ? numThreads.intValue : 0;
+    return MAX(threads, 0);
+}
+
 @end
 
 NS_ASSUME_NONNULL_END
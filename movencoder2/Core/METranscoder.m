@@ -11,6 +11,19 @@
 #import "METranscoder+Internal.h"
 #import "MESecureLogging.h"
 #import "MEProgressUtil.h"
+#import "SBPrefetchQueue.h"
+#import "SBSliceReader.h"
+#import "SBChannelScheduler.h"
+#import "MEMetrics.h"
+#import "METrace.h"
+#import "MESegmentWriter.h"
+#import "MEManager+SampleBuffer.h"
+#import "MEMuxer.h"
+#import "MEDemuxer.h"
+#import "MEResultCache.h"
+#import "MERemuxer.h"
+#import "MEMetadataFixer.h"
+@import UniformTypeIdentifiers;
 
 /* =================================================================================== */
 // MARK: -
@@ -28,9 +41,39 @@ NSString* const kVideoCodecKey = @"videoCodec";
 NSString* const kAudioCodecKey = @"audioCodec";
 NSString* const kAudioChannelLayoutTagKey = @"audioChannelLayoutTag";
 NSString* const kAudioVolumeKey = @"audioVolume";
+NSString* const kPrefetchFramesKey = @"prefetchFrames";
+NSString* const kPrefetchBytesKey = @"prefetchBytes";
+NSString* const kInterleaveWindowKey = @"interleaveWindow";
+NSString* const kMetricsPathKey = @"metricsPath";
+NSString* const kTracePathKey = @"tracePath";
+NSString* const kThreadBudgetKey = @"threadBudget";
+NSString* const kMovieLayoutKey = @"movieLayout";
+NSString* const kMovieFragmentIntervalKey = @"movieFragmentInterval";
+NSString* const kMuxerFormatKey = @"muxerFormat";
+NSString* const kSegmentDurationKey = @"segmentDuration";
+NSString* const kInputBackendKey = @"inputBackend";
+NSString* const kDecoderThreadsKey = @"decoderThreads";
+NSString* const kLowLatencyKey = @"lowLatency";
+NSString* const kResultCacheDirectoryKey = @"resultCacheDirectory";
+NSString* const kResultCacheSizeKey = @"resultCacheSize";
+NSString* const kMetadataFixupKey = @"metadataFixup";
+NSString* const kSliceReadersKey = @"sliceReaders";
+NSString* const kEncoderWorkerKey = @"encoderWorker";
+NSString* const kThreadAffinityKey = @"threadAffinity";
+
+NSString* const kMovieLayoutFastStart = @"faststart";
+NSString* const kMovieLayoutMoovAtEnd = @"moovAtEnd";
+NSString* const kMovieLayoutFragmented = @"fragmented";
+
+NSString* const kInputBackendAVFoundation = @"avfoundation";
+NSString* const kInputBackendLibav = @"libav";
 
 static const char* const kControlQueueLabel = "movencoder.controlQueue";
 static const char* const kProcessQueueLabel = "movencoder.processQueue";
+static const char* const kDecoderQueueLabel = "movencoder.decoderQueue";
+
+static const double kProgressIntervalInSec = 0.25; // progressCallback rate limit (4 Hz)
+static const double kMetricsIntervalInSec = 5.0;   // Prometheus textfile rewrite interval
 
 /* =================================================================================== */
 // MARK: -
@@ -316,15 +359,54 @@ static inline NSError* MECreateError(NSString* description, NSString* reason, NS
 
     BOOL useME = NO;
     BOOL useAC = NO;
+    BOOL remux = NO;
     AVMutableMovie* mov = self.inMovie;
     AVAssetWriter* aw = nil;
     AVAssetReader* ar = nil;
     BOOL finish = NO;
+    MEResultCache* resultCache = nil;
+    NSString* cacheKey = nil;
+    BOOL cacheHit = NO;
 
-    if (![self me_prepareExportSession:error useME:&useME useAC:&useAC]) {
+    if (![self me_prepareExportSession:error useME:&useME useAC:&useAC remux:&remux]) {
         goto finalize;
     }
 
+    // Same input content and settings: place the stored output instead of encoding
+    resultCache = [self me_resultCache];
+    cacheKey = resultCache ? [self me_resultCacheKey] : nil;
+    if (cacheKey) {
+        cacheHit = [resultCache placeEntryForKey:cacheKey atURL:self.outputURL];
+        SecureLogf(@"[METranscoder] Result cache %@: %@", (cacheHit ? @"hit" : @"miss"), cacheKey);
+        if (cacheHit) {
+            [self rwDidStarted];
+            self.finalSuccess = TRUE;
+            [self rwDidFinished];
+            goto finalize;
+        }
+    }
+
+    if (self.muxerFormat) {
+        [self me_exportWithMuxerFromMovie:mov error:error];
+        goto finalize;
+    }
+
+    // Metadata fix-up copies the samples as they are and replaces the video sample descriptions
+    if (self.metadataFixup) {
+        [self me_fixupMovie:mov useME:useME useAC:useAC error:error];
+        goto finalize;
+    }
+
+    // Nothing is encoded: copy sample data without sample buffers; the channel path is the fallback
+    if (remux) {
+        if ([self me_remuxMovie:mov]) {
+            goto finalize;
+        }
+        if (![self me_prepareReaderWriter:error]) {
+            goto finalize;
+        }
+    }
+
     if (![self me_configureWriterAndPrepareChannelsWithMovie:mov useME:useME useAC:useAC error:error]) {
         goto finalize;
     }
@@ -341,6 +423,18 @@ static inline NSError* MECreateError(NSString* description, NSString* reason, NS
 finalize:
     if (self.finalSuccess) {
         SecureLog(@"[METranscoder] Export session completed.");
+        if (cacheKey && !cacheHit) {
+            NSError* cacheError = nil;
+            if (![resultCache storeFileAtURL:self.outputURL forKey:cacheKey error:&cacheError]) {
+                SecureErrorLogf(@"[METranscoder] Failed to store the output in the result cache: %@",
+                                cacheError.localizedFailureReason);
+            }
+        }
+        if (resultCache) {
+            NSDictionary* stats = [resultCache statistics];
+            SecureLogf(@"[METranscoder] Result cache: hits=%@ misses=%@ entries=%@ bytes=%@ evictions=%@",
+                       stats[@"hits"], stats[@"misses"], stats[@"entries"], stats[@"bytes"], stats[@"evictions"]);
+        }
     } else if (self.cancelled) {
         SecureLog(@"[METranscoder] Export session cancelled.");
     } else {
@@ -360,6 +454,8 @@ finalize:
 
     self.timeStamp1 = CFAbsoluteTimeGetCurrent();
     SecureLogf(@"[METranscoder] elapsed: %.2f sec", self.timeElapsed);
+    [self finishMetricsExport];
+    [self finishTraceExport];
     [self cleanupTemporaryFilesForOutput:self.outputURL];
     self.writerIsBusy = FALSE;
     return self.finalSuccess;
@@ -368,6 +464,7 @@ finalize:
 #pragma mark - Export helper steps
 
 - (BOOL)me_prepareExportSession:(NSError * _Nullable * _Nullable)error useME:(BOOL*)useME useAC:(BOOL*)useAC
+                          remux:(BOOL*)remux
 {
     if (self.writerIsBusy) {
         NSError* err = nil;
@@ -380,8 +477,21 @@ finalize:
         return NO;
     }
 
+    // The libavcodec decoder hands AVFrames to the encoder; only the libavformat muxer takes its output
+    if ([self.inputBackend isEqualToString:kInputBackendLibav] && !self.muxerFormat) {
+        NSError* err = nil;
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:@"The libav input backend requires the libavformat muxer."
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+        if (error) *error = err;
+        return NO;
+    }
+    
+    // segment output goes into a directory that MESegmentWriter cleans up by itself
     NSFileManager *fm = [NSFileManager new];
-    if ([fm fileExistsAtPath:[outputURL path]]) {
+    if (self.segmentDuration == 0 && [fm fileExistsAtPath:[outputURL path]]) {
         if (![fm removeItemAtURL:outputURL error:nil]) {
             NSError* err = nil;
             [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
@@ -415,14 +525,9 @@ finalize:
     *useME = [self hasVideoMEManagers];
     *useAC = [self hasAudioMEConverters];
 
-    if (![self prepareRW]) {
-        NSError* err = nil;
-        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
-            reason:@"Either AVAssetReader or AVAssetWriter is not available."
-              code:paramErr
-                to:&err];
-        self.finalError = err;
-        if (error) *error = err;
+    // Decide on the remux fast path first; the reader and writer are only prepared when it fails
+    *remux = (!*useME && !*useAC && !self.metadataFixup && [self me_canRemux]);
+    if (!*remux && ![self me_prepareReaderWriter:error]) {
         return NO;
     }
 
@@ -439,16 +544,195 @@ finalize:
     return YES;
 }
 
+- (BOOL)me_prepareReaderWriter:(NSError * _Nullable * _Nullable)error
+{
+    if (![self prepareRW]) {
+        NSError* err = nil;
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:@"Either AVAssetReader or AVAssetWriter is not available."
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+        if (error) *error = err;
+        return NO;
+    }
+    return YES;
+}
+
+/// Rewrap only: no encoder, movie file output through AVFoundation, not fragmented, no muxed track
+- (BOOL)me_canRemux
+{
+    if (self.videoEncode || self.audioEncode || self.muxerFormat || self.segmentDuration > 0 ||
+        [self.movieLayout isEqualToString:kMovieLayoutFragmented]) {
+        return NO;
+    }
+    // AVMutableMovie cannot rewrap muxed (i.e. MPEG-2 PS) tracks; the channel path demuxes them
+    return ([self.inMovie tracksWithMediaType:AVMediaTypeMuxed].count == 0);
+}
+
+- (BOOL)me_remuxMovie:(AVMutableMovie*)mov
+{
+    NSMutableArray<AVMediaType>* types = [@[AVMediaTypeVideo, AVMediaTypeAudio] mutableCopy];
+    if (self.copyOtherMedia) {
+        [types addObjectsFromArray:@[AVMediaTypeText, AVMediaTypeClosedCaption, AVMediaTypeSubtitle,
+                                     AVMediaTypeTimecode, AVMediaTypeMetadata, AVMediaTypeDepthData]];
+    }
+    CMTimeRange range = CMTimeRangeFromTimeToTime(self.startTime, self.endTime);
+    BOOL fastStart = [self.movieLayout isEqualToString:kMovieLayoutFastStart];
+    NSError* err = nil;
+    if (![MERemuxer remuxMovie:mov timeRange:range mediaTypes:types toURL:self.outputURL fastStart:fastStart error:&err]) {
+        SecureLogf(@"[METranscoder] Remux fast path is not available (%@); using sample buffers.",
+                   err.localizedFailureReason ?: err.localizedDescription);
+        return NO;
+    }
+    [self rwDidStarted];
+    self.finalSuccess = TRUE;
+    [self rwDidFinished];
+    return YES;
+}
+
+- (BOOL)me_fixupMovie:(AVMutableMovie*)mov useME:(BOOL)useME useAC:(BOOL)useAC error:(NSError**)error
+{
+    NSError* err = nil;
+    MEMetadataFixer* fixer = nil;
+    if (useME || useAC || ![self me_canRemux]) {
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:@"Metadata fix-up requires a movie file output without encoding."
+              code:paramErr
+                to:&err];
+    } else {
+        fixer = [MEMetadataFixer fixerWithOptions:self.metadataFixup error:&err];
+    }
+    if (fixer) {
+        NSMutableArray<AVMediaType>* types = [@[AVMediaTypeVideo, AVMediaTypeAudio] mutableCopy];
+        if (self.copyOtherMedia) {
+            [types addObjectsFromArray:@[AVMediaTypeText, AVMediaTypeClosedCaption, AVMediaTypeSubtitle,
+                                         AVMediaTypeTimecode, AVMediaTypeMetadata, AVMediaTypeDepthData]];
+        }
+        CMTimeRange range = CMTimeRangeFromTimeToTime(self.startTime, self.endTime);
+        BOOL fastStart = [self.movieLayout isEqualToString:kMovieLayoutFastStart];
+        MERemuxTrackHandler handler = ^BOOL(AVMutableMovieTrack* track, NSError** handlerError) {
+            if (![track.mediaType isEqualToString:AVMediaTypeVideo]) return YES;
+            for (id item in track.formatDescriptions) {
+                CMFormatDescriptionRef desc = (__bridge CMFormatDescriptionRef)item;
+                CMFormatDescriptionRef fixed = [fixer createFixedFormatDescription:desc error:handlerError];
+                if (!fixed) return NO;
+                [track replaceFormatDescription:desc withFormatDescription:fixed];
+                CFRelease(fixed);
+            }
+            return YES;
+        };
+        if ([MERemuxer remuxMovie:mov timeRange:range mediaTypes:types toURL:self.outputURL
+                        fastStart:fastStart trackHandler:handler error:&err]) {
+            [self rwDidStarted];
+            self.finalSuccess = TRUE;
+            [self rwDidFinished];
+            return YES;
+        }
+    }
+    self.finalError = err;
+    if (error) *error = err;
+    return NO;
+}
+
+/// nil unless kResultCacheDirectoryKey is set and the output is a single file
+- (nullable MEResultCache*)me_resultCache
+{
+    NSURL* cacheURL = self.resultCacheURL;
+    if (!cacheURL || !self.inputURL.isFileURL) return nil;
+    if (self.segmentDuration > 0 && !self.muxerFormat) return nil;
+    return [MEResultCache resultCacheWithDirectoryURL:cacheURL maxBytes:self.resultCacheSize];
+}
+
+static NSString* stableDescription(id object) {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSDictionary* dict = object;
+        NSArray* keys = [dict.allKeys sortedArrayUsingComparator:^NSComparisonResult(id a, id b) {
+            return [[a description] compare:[b description]];
+        }];
+        NSMutableArray<NSString*>* items = [NSMutableArray arrayWithCapacity:keys.count];
+        for (id key in keys) {
+            [items addObject:[NSString stringWithFormat:@"%@=%@", key, stableDescription(dict[key])]];
+        }
+        return [NSString stringWithFormat:@"{%@}", [items componentsJoinedByString:@","]];
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        NSMutableArray<NSString*>* items = [NSMutableArray array];
+        for (id item in (NSArray*)object) {
+            [items addObject:stableDescription(item)];
+        }
+        return [NSString stringWithFormat:@"[%@]", [items componentsJoinedByString:@","]];
+    }
+    return [object description] ?: @"";
+}
+
+/// Key over input content and everything that shapes the output; nil if the input cannot be hashed
+- (nullable NSString*)me_resultCacheKey
+{
+    NSString* contentHash = [MEResultCache contentHashOfFileAtURL:self.inputURL];
+    if (!contentHash) return nil;
+
+    NSMutableArray<NSString*>* components = [NSMutableArray array];
+    [components addObject:[NSString stringWithFormat:@"input=%@", contentHash]];
+    [components addObject:[NSString stringWithFormat:@"range=%lld/%d-%lld/%d",
+                           self.startTime.value, self.startTime.timescale,
+                           self.endTime.value, self.endTime.timescale]];
+    [components addObject:[NSString stringWithFormat:@"output=%@", self.outputURL.pathExtension.lowercaseString]];
+
+    // Parameters that only affect scheduling, telemetry or the cache itself are left out
+    NSSet* ignoredKeys = [NSSet setWithObjects:kPrefetchFramesKey, kPrefetchBytesKey, kInterleaveWindowKey,
+                          kMetricsPathKey, kTracePathKey, kDecoderThreadsKey,
+                          kResultCacheDirectoryKey, kResultCacheSizeKey, kSliceReadersKey,
+                          kEncoderWorkerKey, kThreadAffinityKey, nil];
+    NSMutableDictionary* params = [self.transcodeConfig.encodingParams mutableCopy];
+    [params removeObjectsForKeys:ignoredKeys.allObjects];
+    [components addObject:[NSString stringWithFormat:@"params=%@", stableDescription(params)]];
+
+    // Encoder settings and filter graph that MEVideoEncoderConfig is resolved from, per track
+    NSArray* trackKeys = [self.managers.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString* key in trackKeys) {
+        id manager = self.managers[key];
+        if ([manager isKindOfClass:[MEManager class]]) {
+            MEManager* mgr = manager;
+            [components addObject:[NSString stringWithFormat:@"track %@ encoder=%@ filter=%@ globalHeader=%d",
+                                   key, stableDescription(mgr.videoEncoderSetting),
+                                   mgr.videoFilterString ?: @"", mgr.useGlobalHeader]];
+        } else if ([manager isKindOfClass:[MEAudioConverter class]]) {
+            MEAudioConverter* converter = manager;
+            [components addObject:[NSString stringWithFormat:@"track %@ audio=%@ volume=%.3f",
+                                   key, stableDescription(converter.audioSettings), converter.volumeDb]];
+        }
+    }
+
+    [components addObject:[MEResultCache libraryVersionString]];
+    [components addObject:NSProcessInfo.processInfo.operatingSystemVersionString];   // AVFoundation encoders
+    return [MEResultCache keyWithComponents:components];
+}
+
 - (BOOL)me_configureWriterAndPrepareChannelsWithMovie:(AVMutableMovie*)mov useME:(BOOL)useME useAC:(BOOL)useAC error:(NSError * _Nullable * _Nullable)error
 {
     AVAssetWriter* aw = self.assetWriter;
     AVAssetReader* ar = self.assetReader;
 
+    // Only faststart rewrites the whole file at finish; the other layouts append the moov.
+    // Segment output has no movie file, so the layout does not apply.
+    BOOL segmented = (self.segmentWriter != nil);
+    NSString* layout = segmented ? @"segments" : self.movieLayout;
+    CMTime fragmentInterval = kCMTimeInvalid;
+    if ([layout isEqualToString:kMovieLayoutFragmented]) {
+        fragmentInterval = CMTimeMakeWithSeconds(self.movieFragmentInterval, mov.timescale);
+    }
+    BOOL fastStart = [layout isEqualToString:kMovieLayoutFastStart];
     dispatch_sync(self.processQueue, ^{
         aw.movieTimeScale = mov.timescale;
-        aw.movieFragmentInterval = kCMTimeInvalid;
-        aw.shouldOptimizeForNetworkUse = TRUE;
+        if (!segmented) {
+            aw.movieFragmentInterval = fragmentInterval;
+            aw.shouldOptimizeForNetworkUse = fastStart;
+        }
     });
+    if (self.verbose) {
+        SecureDebugLogf(@"[METranscoder] Movie layout: %@", layout);
+    }
 
     if (useAC) {
         [self prepareAudioMEChannelsWith:mov from:ar to:aw];
@@ -461,15 +745,69 @@ finalize:
     } else {
         [self prepareVideoChannelsWith:mov from:ar to:aw];
     }
+    [self me_applyPrefetchToChannels];
+    [self me_applySchedulerToChannels];
     return YES;
 }
 
+- (void)me_applySchedulerToChannels
+{
+    double window = self.interleaveWindow;
+    if (window <= 0) return;
+    
+    SBChannelScheduler* scheduler = [SBChannelScheduler schedulerWithWindow:window
+                                                                  startTime:CMTimeGetSeconds(self.startTime)];
+    NSUInteger registered = 0;
+    for (SBChannel* sbc in self.sbChannels) {
+        // Pace encoder->writer channels only. Parking a channel fed by the shared AVAssetReader
+        // (reader->ME, audio or passthrough copy) stalls the reader, and with it the encoders
+        // the leading channel is waiting for.
+        if (![sbc.meOutput isKindOfClass:[MEOutput class]]) continue;
+        if (![sbc.meInput isKindOfClass:[AVAssetWriterInput class]]) continue;
+        [scheduler registerChannel:sbc];
+        sbc.scheduler = scheduler;
+        registered++;
+    }
+    if (registered > 1) {
+        self.channelScheduler = scheduler;
+    } else {
+        for (SBChannel* sbc in self.sbChannels) {
+            sbc.scheduler = nil;
+        }
+    }
+}
+
+- (void)me_applyPrefetchToChannels
+{
+    NSUInteger frames = self.prefetchFrames;
+    size_t bytes = self.prefetchBytes;
+    if (frames == 0 && bytes == 0) return;
+    
+    for (SBChannel* sbc in self.sbChannels) {
+        // Only reader-side channels decode; MEOutput channels are fed by encoders
+        id producer = sbc.meOutput;
+        if (![producer isKindOfClass:[AVAssetReaderOutput class]]) continue;
+        // Passthrough copy has nothing to overlap with
+        id consumer = sbc.meInput;
+        if ([consumer isKindOfClass:[AVAssetWriterInput class]] &&
+            ((AVAssetWriterInput*)consumer).outputSettings == nil) continue;
+        
+        sbc.prefetchFrames = frames;
+        sbc.prefetchBytes = bytes;
+        if (self.verbose) {
+            SecureLogf(@"[METranscoder] Prefetch enabled for track %d (frames:%lu, bytes:%zu)",
+                       sbc.track, (unsigned long)frames, bytes);
+        }
+    }
+}
+
 - (BOOL)me_startIOAndWaitWithReader:(AVAssetReader*)ar writer:(AVAssetWriter*)aw finish:(BOOL*)finish error:(NSError * _Nullable * _Nullable)error
 {
     __block BOOL arStarted = FALSE;
     __block BOOL awStarted = FALSE;
     dispatch_sync(self.processQueue, ^{
-        arStarted = [ar startReading];
+        // every track may come from a shared reader (videoSourceProvider)
+        arStarted = (ar.outputs.count == 0) || [ar startReading];
         awStarted = [aw startWriting];
     });
     if (!(arStarted && awStarted)) {
@@ -491,6 +829,9 @@ finalize:
     });
 
     [self rwDidStarted];
+    [self startProgressReporting];
+    [self startMetricsExport];
+    [self startTraceExport];
 
     dispatch_group_t dg = dispatch_group_create();
     NSArray<SBChannel*>* channelArray = self.sbChannels;
@@ -506,13 +847,20 @@ finalize:
     dispatch_semaphore_t waitSem = dispatch_semaphore_create(0);
 
     dispatch_group_notify(dg, self.processQueue, ^{
+        [wself stopProgressReporting];
+        SBChannelScheduler* scheduler = wself.channelScheduler;
+        if (scheduler && wself.verbose) {
+            SecureLogf(@"[METranscoder] Interleave window %.2f sec: parked %llu times, %.2f sec total (watchdog %llu)",
+                       scheduler.window, scheduler.parkCount, scheduler.parkedSeconds, scheduler.watchdogCount);
+        }
         BOOL finalize = TRUE;
         BOOL cancelled = wself.cancelled;
         if (!cancelled) {
             BOOL arFailed = (war.status == AVAssetReaderStatusFailed);
-            if (arFailed) {
+            NSError* sliceError = [wself me_sliceSourceError];
+            if (arFailed || sliceError) {
                 wself.finalSuccess = FALSE;
-                wself.finalError = war.error;
+                wself.finalError = (arFailed ? war.error : sliceError);
                 finalize = FALSE;
             }
         }
@@ -521,9 +869,13 @@ finalize:
             [waw finishWritingWithCompletionHandler:^{
                 dispatch_async(wself.processQueue, ^{
                     BOOL awFailed = (waw.status == AVAssetWriterStatusFailed);
+                    NSError* segmentError = nil;
                     if (awFailed) {
                         wself.finalSuccess = FALSE;
                         wself.finalError = waw.error ?: war.error;
+                    } else if (wself.segmentWriter && ![wself.segmentWriter finishWithError:&segmentError]) {
+                        wself.finalSuccess = FALSE;
+                        wself.finalError = segmentError;
                     } else {
                         *finish = !cancelled;
                     }
@@ -544,6 +896,18 @@ finalize:
     return YES;
 }
 
+- (nullable NSError*)me_sliceSourceError
+{
+    for (SBSliceReader* source in self.sliceSources) {
+        if (self.verbose) {
+            SecureLogf(@"[METranscoder] Sliced decode: %lu readers, merge waited %llu times",
+                       (unsigned long)source.readerCount, source.mergeStalls);
+        }
+        if (source.error) return source.error;
+    }
+    return nil;
+}
+
 - (BOOL)me_finalizeSessionWithFinish:(BOOL)finish error:(NSError * _Nullable * _Nullable)error
 {
     [self rwDidFinished];
@@ -551,8 +915,184 @@ finalize:
 }
 
 
+- (BOOL)me_exportWithMuxerFromMovie:(AVMutableMovie*)mov error:(NSError * _Nullable * _Nullable)error
+{
+    AVAssetReader* ar = self.assetReader;
+    NSString* format = self.muxerFormat;
+    BOOL libavInput = [self.inputBackend isEqualToString:kInputBackendLibav];
+    MEDemuxer* demuxer = NULL;
+    NSError* err = nil;
+    int ret = 0;
+    
+    if (libavInput) {
+        demuxer = MEDemuxerCreate(self.inputURL.fileSystemRepresentation, NULL, self.decoderThreads, &ret);
+        if (!demuxer) {
+            [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+                reason:[NSString stringWithFormat:@"Cannot open the libavcodec decoder (%d).", ret]
+                  code:paramErr
+                    to:&err];
+            self.finalError = err;
+            if (error) *error = err;
+            return NO;
+        }
+        [self me_prepareDemuxedVideoWith:mov demuxer:demuxer];
+    } else {
+        [self prepareVideoMEChannelsWith:mov from:ar to:nil];
+    }
+    MEManager* mgr = self.muxerManager;
+    if (!(mgr && mgr.videoEncoderSetting)) {
+        MEDemuxerFree(&demuxer);
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:@"The libavformat muxer requires a video track encoded by libavcodec."
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+        if (error) *error = err;
+        return NO;
+    }
+    if (mov.tracks.count > 1) {
+        SecureLogf(@"[METranscoder] Only the encoded video track is written by the %@ muxer.", format);
+    }
+    
+    MEMuxer* muxer = MEMuxerCreate(self.outputURL.fileSystemRepresentation, format.UTF8String, &ret);
+    if (!muxer) {
+        MEDemuxerFree(&demuxer);
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:[NSString stringWithFormat:@"Cannot open the %@ muxer (%d).", format, ret]
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+        if (error) *error = err;
+        return NO;
+    }
+    
+    mgr.useGlobalHeader = (MEMuxerWantsGlobalHeader(muxer) != 0);
+    
+    if (!libavInput) {
+        __block BOOL arStarted = FALSE;
+        dispatch_sync(self.processQueue, ^{
+            arStarted = (ar.outputs.count == 0) || [ar startReading];
+        });
+        if (!arStarted) {
+            MEMuxerFree(&muxer);
+            self.finalSuccess = FALSE;
+            self.finalError = ar.error;
+            [self rwDidFinished];
+            if (error) *error = self.finalError;
+            return NO;
+        }
+    }
+    
+    [self rwDidStarted];
+    [self startProgressReporting];
+    [self startMetricsExport];
+    [self startTraceExport];
+    
+    dispatch_group_t dg = dispatch_group_create();
+    for (SBChannel* sbc in self.sbChannels) {
+        dispatch_group_enter(dg);
+        [sbc startWithDelegate:self completionHandler:^{ dispatch_group_leave(dg); }];
+    }
+    __block int decodeResult = 0;
+    if (libavInput) {
+        dispatch_group_enter(dg);
+        __weak typeof(self) wself = self;
+        dispatch_queue_t queue = dispatch_queue_create(kDecoderQueueLabel, DISPATCH_QUEUE_SERIAL);
+        CMTimeRange range = CMTimeRangeFromTimeToTime(self.startTime, self.endTime);
+        [mgr appendFramesFromDemuxer:demuxer onQueue:queue range:range shouldStop:^BOOL{
+            return wself.cancelled;
+        } completionHandler:^(int result) {
+            decodeResult = result;
+            dispatch_group_leave(dg);
+        }];
+    }
+    
+    // Packets go from the encoder to the muxer on this thread; no CMSampleBuffer is made
+    int written = 0;
+    do {
+        @autoreleasepool {
+            written = [mgr writeNextPacketToMuxer:muxer];
+        }
+    } while (written > 0 && !self.cancelled);
+    
+    dispatch_group_wait(dg, DISPATCH_TIME_FOREVER);
+    dispatch_sync(self.processQueue, ^{
+        [self stopProgressReporting];
+    });
+    MEDemuxerFree(&demuxer);
+    
+    BOOL success = FALSE;
+    if (self.cancelled) {
+        // keep finalError as is
+    } else if (ar && ar.status == AVAssetReaderStatusFailed) {
+        self.finalError = ar.error;
+    } else if ((err = [self me_sliceSourceError])) {
+        self.finalError = err;
+    } else if (decodeResult < 0) {
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:[NSString stringWithFormat:@"Decoding the video track failed (%d).", decodeResult]
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+    } else if (written < 0) {
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:@"Encoding or muxing the video track failed."
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+    } else if ((ret = MEMuxerFinish(muxer)) < 0) {
+        [self post:[NSString stringWithFormat:@"%s (%d)", __PRETTY_FUNCTION__, __LINE__]
+            reason:[NSString stringWithFormat:@"Cannot finish the %@ muxer (%d).", format, ret]
+              code:paramErr
+                to:&err];
+        self.finalError = err;
+    } else {
+        success = TRUE;
+    }
+    MEMuxerFree(&muxer);
+    
+    self.finalSuccess = success;
+    if (success) {
+        self.finalError = nil;
+    } else if (error) {
+        *error = self.finalError;
+    }
+    [self rwDidFinished];
+    return success;
+}
+
+- (void)me_prepareDemuxedVideoWith:(AVMovie*)movie demuxer:(MEDemuxer*)demuxer
+{
+    // The decoder reads the best video stream; it stands in for the first video track
+    for (AVMovieTrack* track in [movie tracksWithMediaType:AVMediaTypeVideo]) {
+        MEManager* mgr = self.managers[keyForTrackID(track.trackID)];
+        if (![mgr isKindOfClass:[MEManager class]]) continue;
+        
+        // Frames are rescaled to 1/mediaTimeScale as they are appended; a time_base that
+        // reduces to 1/N (i.e. 2/60) keeps its own clock, 1001/30000 uses the track's
+        AVRational tb = MEDemuxerStream(demuxer)->time_base;
+        int num = 0, den = 0;
+        av_reduce(&num, &den, tb.num, tb.den, INT_MAX);
+        mgr.mediaTimeScale = (num == 1) ? den : track.naturalTimeScale;
+        [self me_configureManager:mgr trackID:track.trackID];
+        self.muxerManager = mgr;
+        
+        if (self.verbose) {
+            const AVCodecContext* avctx = MEDemuxerCodecContext(demuxer);
+            SecureDebugLogf(@"[METranscoder] libavcodec decoder: %s, %d threads", avctx->codec->name, avctx->thread_count);
+        }
+        return;
+    }
+}
+
 - (void) cancelExportCustom
 {
+    // Release parked channels first; SBChannel -cancel waits on each channel queue
+    [self.channelScheduler cancel];
+    for (SBSliceReader* source in self.sliceSources) {
+        [source cancel];
+    }
+    
     __weak typeof(self) wself = self;
     dispatch_async(self.processQueue, ^{
         NSMutableArray<SBChannel*>* channels = wself.sbChannels;
@@ -589,33 +1129,177 @@ finalize:
     }
 }
 
+// MARK: - progress telemetry
+
 /**
- Enqueue progressCallback <SBChannelDelegate>
+ Start periodic progressCallback; samples SBChannel counters instead of per-sample callbacks
+ */
+- (void) startProgressReporting
+{
+    if (!(self.callbackQueue && self.progressCallback)) return;
+    
+    NSUInteger channelCount = self.sbChannels.count;
+    NSMutableArray<NSNumber*>* counts = [NSMutableArray arrayWithCapacity:channelCount];
+    for (NSUInteger i = 0; i < channelCount; i++) {
+        [counts addObject:@(0)];
+    }
+    self.progressSampleCounts = counts;
+    
+    uint64_t interval = (uint64_t)(kProgressIntervalInSec * NSEC_PER_SEC);
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.processQueue);
+    dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+    __weak typeof(self) wself = self;
+    dispatch_source_set_event_handler(timer, ^{
+        [wself reportProgress];
+    });
+    self.progressTimer = timer;
+    dispatch_resume(timer);
+}
+
+/**
+ Stop periodic progressCallback and flush the final state (call on processQueue)
+ */
+- (void) stopProgressReporting
+{
+    dispatch_source_t timer = self.progressTimer;
+    if (!timer) return;
+    dispatch_source_cancel(timer);
+    self.progressTimer = nil;
+    [self reportProgress];
+}
 
- @param sb CMSampleBuffer
- @param channel SBChannel (one for normal track, two for ME Channel)
+/**
+ Enqueue progressCallback for each channel which has advanced since last report (call on processQueue)
  */
-- (void) didReadBuffer:(CMSampleBufferRef)sb from:(SBChannel*)channel
+- (void) reportProgress
 {
     dispatch_queue_t queue = self.callbackQueue;
     progress_block_t block = self.progressCallback;
-    if (queue && block) {
-        float progress = [MEProgressUtil progressPercentForSampleBuffer:sb start:self.startTime end:self.endTime];
-        float pts = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb));
-        float dts = CMTimeGetSeconds(CMSampleBufferGetDecodeTimeStamp(sb));
-        int count = channel.count;
+    NSMutableArray<NSNumber*>* lastCounts = self.progressSampleCounts;
+    if (!(queue && block && lastCounts)) return;
+    
+    CFAbsoluteTime elapsed = self.timeElapsed;
+    Float64 start = CMTimeGetSeconds(self.startTime);
+    Float64 end = CMTimeGetSeconds(self.endTime);
+    
+    NSArray<SBChannel*>* channels = self.sbChannels;
+    NSUInteger channelCount = MIN(channels.count, lastCounts.count);
+    for (NSUInteger i = 0; i < channelCount; i++) {
+        SBChannel* channel = channels[i];
+        SBChannelStats stats = [channel statsSnapshot];
+        if (stats.samples == 0 || stats.samples == lastCounts[i].longLongValue) continue;
+        lastCounts[i] = @(stats.samples);
         
         NSMutableDictionary* info = [channel.info mutableCopy];
-        info[kProgressPercentKey] = @(progress);
-        info[kProgressPTSKey] = @(pts);
-        info[kProgressDTSKey] = @(dts);
-        info[kProgressCountKey] = @(count);
+        info[kProgressPercentKey] = @([MEProgressUtil progressPercentForSeconds:stats.lastEndPTS
+                                                                          start:self.startTime
+                                                                            end:self.endTime]);
+        info[kProgressPTSKey] = @((float)stats.lastPTS);
+        info[kProgressDTSKey] = @((float)stats.lastDTS);
+        info[kProgressCountKey] = @((int)stats.samples);
+        info[kProgressBytesKey] = @(stats.bytes);
+        if (channel.prefetchQueue) {
+            info[kProgressQueueFillKey] = @((float)([channel.prefetchQueue fillRatio] * 100.0));
+        }
+        if (elapsed > 0) {
+            Float64 done = stats.lastEndPTS - start;
+            float speed = (done > 0 ? (float)(done / elapsed) : 0.0f);
+            info[kProgressFPSKey] = @((float)(stats.samples / elapsed));
+            info[kProgressSpeedKey] = @(speed);
+            if (speed > 0 && !isnan(end)) {
+                info[kProgressETAKey] = @((float)(MAX(end - stats.lastEndPTS, 0.0) / speed));
+            }
+        }
         dispatch_async(queue, ^{
             block(info);
         });
     }
 }
 
+// MARK: - metrics export
+
+/**
+ Enable per-stage metrics and start the exporter when kMetricsPathKey is set
+ */
+- (void) startMetricsExport
+{
+    NSURL* url = self.metricsURL;
+    if (!url) return;
+    
+    MEMetricsExporter* exporter = [MEMetricsExporter exporterWithURL:url
+                                                              format:[MEMetricsExporter formatForURL:url]
+                                                            interval:kMetricsIntervalInSec];
+    __weak typeof(self) wself = self;
+    exporter.jobProgress = ^MEMetricsJobProgress{
+        MEMetricsJobProgress progress = {0, 0.0};
+        METranscoder* sself = wself;
+        if (!sself) return progress;
+        Float64 start = CMTimeGetSeconds(sself.startTime);
+        for (SBChannel* channel in sself.sbChannels) {
+            if (![channel.meInput isKindOfClass:[AVAssetWriterInput class]]) continue;
+            SBChannelStats stats = [channel statsSnapshot];
+            if ([channel.mediaType isEqualToString:AVMediaTypeVideo]) {
+                progress.frames += (uint64_t)stats.samples;
+            }
+            if (!isnan(stats.lastEndPTS)) {
+                progress.mediaSeconds = MAX(progress.mediaSeconds, stats.lastEndPTS - start);
+            }
+        }
+        return progress;
+    };
+    self.metricsExporter = exporter;
+    [exporter start];
+    if (self.verbose) {
+        SecureLogf(@"[METranscoder] Metrics export enabled (%@)", url.path);
+    }
+}
+
+/**
+ Write the final metrics document with job summary
+ */
+- (void) finishMetricsExport
+{
+    MEMetricsExporter* exporter = self.metricsExporter;
+    if (!exporter) return;
+    self.metricsExporter = nil;
+    
+    NSError* error = nil;
+    if (![exporter finishWithError:&error]) {
+        SecureErrorLogf(@"[METranscoder] ERROR: Failed to export metrics: %@", error.localizedDescription);
+    }
+}
+
+/**
+ Start recording per-frame trace events when kTracePathKey is set
+ */
+- (void) startTraceExport
+{
+    if (!self.traceURL) return;
+    METraceStart();
+    self.tracing = TRUE;
+}
+
+/**
+ Stop recording and write the Chrome trace-event JSON
+ */
+- (void) finishTraceExport
+{
+    NSURL* url = self.traceURL;
+    if (!(self.tracing && url)) return;
+    self.tracing = FALSE;
+    METraceStop();
+    
+    NSError* error = nil;
+    if (METraceWriteToURL(url, &error)) {
+        if (self.verbose) {
+            SecureLogf(@"[METranscoder] Trace written: %llu events (%@)", METraceEventCount(), url.path);
+        }
+    } else {
+        SecureErrorLogf(@"[METranscoder] ERROR: Failed to export trace: %@", error.localizedDescription);
+    }
+    METraceDiscard();
+}
+
 // MARK: - utility methods
 
 - (BOOL) post:(NSString*)description
@@ -635,30 +1319,71 @@ finalize:
     __block NSError *error = nil;
     __block AVAssetReader* assetReader = nil;
     __block AVAssetWriter* assetWriter = nil;
+    
+    // Segment output: outputURL is a directory receiving CMAF segments from the writer delegate
+    // libavformat output: no writer; see me_exportWithMuxerFromMovie:error:
+    // libav input: no reader; MEDemuxer decodes the video track
+    NSString* muxerFormat = self.muxerFormat;
+    BOOL libavInput = (muxerFormat && [self.inputBackend isEqualToString:kInputBackendLibav]);
+    MESegmentWriter* segmentWriter = nil;
+    double segmentDuration = muxerFormat ? 0 : self.segmentDuration;
+    if (segmentDuration > 0) {
+        segmentWriter = [MESegmentWriter segmentWriterWithDirectoryURL:self.outputURL
+                                                        targetDuration:segmentDuration];
+        AVAssetTrack* videoTrack = [self.inMovie tracksWithMediaType:AVMediaTypeVideo].firstObject;
+        if (videoTrack) {
+            segmentWriter.frameDuration = videoTrack.minFrameDuration;
+        }
+        if (![segmentWriter prepareWithError:&error]) {
+            SecureErrorLog(@"[METranscoder] ERROR: Failed to prepare segment output directory");
+            if (error)
+                self.finalError = error;
+            return FALSE;
+        }
+    }
+    
     dispatch_sync(self.processQueue, ^{
-        assetReader = [[AVAssetReader alloc] initWithAsset:self.inMovie
-                                                     error:&error];
-        if (error) return;
-        assetWriter = [[AVAssetWriter alloc] initWithURL:self.outputURL
-                                                fileType:AVFileTypeQuickTimeMovie
-                                                   error:&error];
+        if (!libavInput) {
+            assetReader = [[AVAssetReader alloc] initWithAsset:self.inMovie
+                                                         error:&error];
+            if (error) return;
+        }
+        if (segmentWriter) {
+            assetWriter = [[AVAssetWriter alloc] initWithContentType:UTTypeMPEG4Movie];
+            assetWriter.outputFileTypeProfile = AVFileTypeProfileMPEG4CMAFCompliant;
+            assetWriter.preferredOutputSegmentInterval = CMTimeMakeWithSeconds(segmentDuration, 90000);
+            assetWriter.initialSegmentStartTime = self.startTime;
+            assetWriter.delegate = segmentWriter;
+        } else if (!muxerFormat) {
+            assetWriter = [[AVAssetWriter alloc] initWithURL:self.outputURL
+                                                    fileType:AVFileTypeQuickTimeMovie
+                                                       error:&error];
+        }
     });
     
-    if (!assetReader) {
+    if (!assetReader && !libavInput) {
         SecureErrorLog(@"[METranscoder] ERROR: Failed to init AVAssetReader");
         if (error)
             self.finalError = error;
         return FALSE;
     }
-    if (!assetWriter) {
+    if (!assetWriter && !muxerFormat) {
         SecureErrorLog(@"[METranscoder] ERROR: Failed to init AVAssetWriter");
         if (error)
             self.finalError = error;
         return FALSE;
     }
     
+    // Read only the requested range so a partial export does not decode from zero
+    CMTime duration = self.inMovie.duration;
+    if (CMTIME_COMPARE_INLINE(self.startTime, >, kCMTimeZero) ||
+        CMTIME_COMPARE_INLINE(self.endTime, <, duration)) {
+        assetReader.timeRange = CMTimeRangeFromTimeToTime(self.startTime, self.endTime);
+    }
+    
     self.assetReader = assetReader;
     self.assetWriter = assetWriter;
+    self.segmentWriter = segmentWriter;
     return TRUE;
 }
 
@@ -0,0 +1,202 @@
+//
+//  MEDemuxer.c
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#include "MEDemuxer.h"
+
+#include <libavutil/mem.h>
+#include <libavutil/timestamp.h>
+
+struct MEDemuxer {
+    AVFormatContext* fmtctx;
+    AVCodecContext* avctx;
+    AVPacket* packet;
+    int streamIndex;
+    int draining;           // the flush packet has been sent to the decoder
+    int pending;            // packet was refused with EAGAIN and must be sent again
+    int64_t skippedPackets; // packets the decoder rejected as invalid data
+};
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+static int openDecoder(MEDemuxer* demuxer, const AVCodec* codec, int threadCount)
+{
+    AVStream* st = demuxer->fmtctx->streams[demuxer->streamIndex];
+    demuxer->avctx = avcodec_alloc_context3(codec);
+    if (!demuxer->avctx) return AVERROR(ENOMEM);
+
+    int ret = avcodec_parameters_to_context(demuxer->avctx, st->codecpar);
+    if (ret < 0) return ret;
+    demuxer->avctx->pkt_timebase = st->time_base;
+    demuxer->avctx->framerate = st->avg_frame_rate;
+
+    // frame threading scales with cores; slice threading helps intra-only codecs
+    demuxer->avctx->thread_count = (threadCount > 0) ? threadCount : 0;
+    demuxer->avctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    return avcodec_open2(demuxer->avctx, codec, NULL);
+}
+
+/// Feed the next packet of the video stream; sends the flush packet at end of file.
+/// AVERROR(EAGAIN) keeps the packet; it is sent again after the caller received a frame.
+static int sendNextPacket(MEDemuxer* demuxer)
+{
+    if (demuxer->draining) return AVERROR_EOF;
+
+    int ret = 0;
+    if (!demuxer->pending) {
+        ret = av_read_frame(demuxer->fmtctx, demuxer->packet);
+        if (ret == AVERROR_EOF) {
+            ret = avcodec_send_packet(demuxer->avctx, NULL);
+            if (ret != AVERROR(EAGAIN)) demuxer->draining = 1;
+            return ret;
+        }
+        if (ret < 0) return ret;
+        if (demuxer->packet->stream_index != demuxer->streamIndex) {
+            av_packet_unref(demuxer->packet);
+            return 0;
+        }
+    }
+
+    ret = avcodec_send_packet(demuxer->avctx, demuxer->packet);
+    if (ret == AVERROR(EAGAIN)) {
+        demuxer->pending = 1;
+        return ret;
+    }
+    demuxer->pending = 0;
+    if (ret == AVERROR_INVALIDDATA) {
+        // a corrupt packet costs one frame, not the whole job; the decoder recovers at the next key frame
+        demuxer->skippedPackets++;
+        av_log(demuxer->avctx, AV_LOG_WARNING, "Skipped invalid packet (pts %s, %"PRId64" skipped)\n",
+               av_ts2str(demuxer->packet->pts), demuxer->skippedPackets);
+        ret = 0;
+    }
+    av_packet_unref(demuxer->packet);
+    return ret;
+}
+
+static MEDemuxer* createDemuxer(const char* url, AVIOContext* pb, const char* formatName, int threadCount, int* error)
+{
+    int ret = 0;
+    const AVCodec* codec = NULL;
+    const AVInputFormat* format = NULL;
+    MEDemuxer* demuxer = av_mallocz(sizeof(MEDemuxer));
+    if (!demuxer) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (formatName) {
+        format = av_find_input_format(formatName);
+        if (!format) {
+            ret = AVERROR_DEMUXER_NOT_FOUND;
+            goto end;
+        }
+    }
+    if (pb) {
+        // caller owned I/O; avformat_close_input leaves it open
+        demuxer->fmtctx = avformat_alloc_context();
+        if (!demuxer->fmtctx) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        demuxer->fmtctx->pb = pb;
+    }
+    ret = avformat_open_input(&demuxer->fmtctx, url, format, NULL);
+    if (ret < 0) goto end;
+    ret = avformat_find_stream_info(demuxer->fmtctx, NULL);
+    if (ret < 0) goto end;
+
+    ret = av_find_best_stream(demuxer->fmtctx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (ret < 0) goto end;
+    demuxer->streamIndex = ret;
+
+    // only the video stream is read; let the demuxer skip the others
+    for (unsigned i = 0; i < demuxer->fmtctx->nb_streams; i++) {
+        if ((int)i != demuxer->streamIndex) {
+            demuxer->fmtctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    ret = openDecoder(demuxer, codec, threadCount);
+    if (ret < 0) goto end;
+
+    demuxer->packet = av_packet_alloc();
+    if (!demuxer->packet) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    return demuxer;
+
+end:
+    MEDemuxerFree(&demuxer);
+    if (error) *error = ret;
+    return NULL;
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+MEDemuxer* MEDemuxerCreate(const char* url, const char* formatName, int threadCount, int* error)
+{
+    return createDemuxer(url, NULL, formatName, threadCount, error);
+}
+
+MEDemuxer* MEDemuxerCreateWithIO(AVIOContext* pb, const char* formatName, int threadCount, int* error)
+{
+    if (!pb) {
+        if (error) *error = AVERROR(EINVAL);
+        return NULL;
+    }
+    return createDemuxer("", pb, formatName, threadCount, error);
+}
+
+const AVCodecContext* MEDemuxerCodecContext(const MEDemuxer* demuxer)
+{
+    return demuxer ? demuxer->avctx : NULL;
+}
+
+const AVStream* MEDemuxerStream(const MEDemuxer* demuxer)
+{
+    return demuxer ? demuxer->fmtctx->streams[demuxer->streamIndex] : NULL;
+}
+
+int MEDemuxerReadFrame(MEDemuxer* demuxer, AVFrame* frame)
+{
+    if (!demuxer || !frame) return AVERROR(EINVAL);
+    av_frame_unref(frame);
+
+    for (;;) {
+        int ret = avcodec_receive_frame(demuxer->avctx, frame);
+        if (ret == 0) {
+            AVStream* st = demuxer->fmtctx->streams[demuxer->streamIndex];
+            frame->pts = frame->best_effort_timestamp;
+            frame->time_base = st->time_base;
+            if (frame->sample_aspect_ratio.num == 0) {
+                frame->sample_aspect_ratio = av_guess_sample_aspect_ratio(demuxer->fmtctx, st, frame);
+            }
+            return 0;
+        }
+        if (ret != AVERROR(EAGAIN)) return ret;     // AVERROR_EOF once drained
+
+        ret = sendNextPacket(demuxer);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) return ret;
+    }
+}
+
+void MEDemuxerFree(MEDemuxer** demuxer)
+{
+    if (!demuxer || !*demuxer) return;
+    MEDemuxer* d = *demuxer;
+    av_packet_free(&d->packet);
+    avcodec_free_context(&d->avctx);
+    avformat_close_input(&d->fmtctx);
+    av_freep(demuxer);
+}
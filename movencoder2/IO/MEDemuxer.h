@@ -0,0 +1,74 @@
+//
+//  MEDemuxer.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEDemuxer.h
+ * @abstract Internal API - libavformat/libavcodec input for the video track
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEDemuxer reads the best video stream of a file with libavformat and decodes it
+ * with libavcodec. Unlike AVAssetReader, the decoder threading is under our
+ * control: frame and slice threading are both enabled, with threadCount workers
+ * (0 lets libavcodec pick one per core). Decoded AVFrames are handed to MEManager
+ * as they are, so no CMSampleBuffer is created on the input side.
+ *
+ * Decoded frames carry the stream time base in frame->time_base, and frame->pts
+ * is set from the best effort timestamp.
+ *
+ * This file is plain C on top of libavformat/libavcodec/libavutil only, so it
+ * builds and can be tested on any platform FFmpeg supports.
+ *
+ * Functions return 0 on success and a negative AVERROR code on failure.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEDemuxer_h
+#define MEDemuxer_h
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+typedef struct MEDemuxer MEDemuxer;
+
+/**
+ Open the source and the decoder for its best video stream.
+ @param url Source file path or URL ("pipe:0" reads stdin)
+ @param formatName "yuv4mpegpipe", "nut", ..., or NULL to probe the source
+ @param threadCount Decoder threads, or 0 for automatic
+ @param error Receives an AVERROR code on failure (may be NULL)
+ */
+MEDemuxer* MEDemuxerCreate(const char* url, const char* formatName, int threadCount, int* error);
+
+/**
+ Same as MEDemuxerCreate, reading through caller owned I/O (i.e. MEGrowingFile).
+ pb must stay valid until MEDemuxerFree; it is not closed by the demuxer.
+ */
+MEDemuxer* MEDemuxerCreateWithIO(AVIOContext* pb, const char* formatName, int threadCount, int* error);
+
+/// Opened decoder context (dimensions, pixel format, color, field order)
+const AVCodecContext* MEDemuxerCodecContext(const MEDemuxer* demuxer);
+
+/// Source video stream
+const AVStream* MEDemuxerStream(const MEDemuxer* demuxer);
+
+/**
+ Decode the next frame. Any reference held by frame is released first.
+ A packet the decoder rejects as invalid data is logged and skipped.
+ @return 0, AVERROR_EOF after the last frame, or another AVERROR
+ */
+int MEDemuxerReadFrame(MEDemuxer* demuxer, AVFrame* frame);
+
+/// Close the source and free the demuxer; *demuxer is set to NULL.
+void MEDemuxerFree(MEDemuxer** demuxer);
+
+#endif /* MEDemuxer_h */
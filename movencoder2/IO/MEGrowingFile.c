@@ -0,0 +1,209 @@
+//
+//  MEGrowingFile.c
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#include "MEGrowingFile.h"
+
+#include <libavutil/mem.h>
+#include <libavutil/time.h>
+#include <libavutil/error.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#define ME_GROWING_KQUEUE 1
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#define ME_GROWING_INOTIFY 1
+#endif
+
+static const int kIOBufferSize = 256 * 1024;
+static const int kWaitSliceMsec = 500;  // cancel and the marker are checked at least this often
+
+struct MEGrowingFile {
+    int fd;
+    int watchfd;            // kqueue or inotify descriptor; -1 falls back to timed waits
+    char* donePath;
+    double idleTimeout;
+    atomic_int cancelled;
+    int complete;           // no more growth; reads at the end return EOF
+    AVIOContext* pb;
+};
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+static int openWatch(MEGrowingFile* file, const char* path)
+{
+#if ME_GROWING_KQUEUE
+    int kq = kqueue();
+    if (kq < 0) return -1;
+    struct kevent ev;
+    EV_SET(&ev, file->fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND, 0, NULL);
+    if (kevent(kq, &ev, 1, NULL, 0, NULL) < 0) {
+        close(kq);
+        return -1;
+    }
+    (void)path;
+    return kq;
+#elif ME_GROWING_INOTIFY
+    int ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ifd < 0) return -1;
+    if (inotify_add_watch(ifd, path, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+        close(ifd);
+        return -1;
+    }
+    return ifd;
+#else
+    (void)file; (void)path;
+    return -1;
+#endif
+}
+
+/// Block until the file may have grown, or for one wait slice
+static void waitForGrowth(MEGrowingFile* file)
+{
+#if ME_GROWING_KQUEUE
+    if (file->watchfd >= 0) {
+        struct kevent ev;
+        struct timespec timeout = {0, kWaitSliceMsec * 1000000L};
+        kevent(file->watchfd, NULL, 0, &ev, 1, &timeout);
+        return;
+    }
+#elif ME_GROWING_INOTIFY
+    if (file->watchfd >= 0) {
+        struct pollfd pfd = {file->watchfd, POLLIN, 0};
+        if (poll(&pfd, 1, kWaitSliceMsec) > 0) {
+            char events[4096];
+            while (read(file->watchfd, events, sizeof(events)) > 0) {}  // drain; non-blocking
+        }
+        return;
+    }
+#endif
+    av_usleep(kWaitSliceMsec * 1000);
+}
+
+static int readPacket(void* opaque, uint8_t* buf, int size)
+{
+    MEGrowingFile* file = opaque;
+    int64_t idleSince = av_gettime_relative();
+    for (;;) {
+        ssize_t n = read(file->fd, buf, (size_t)size);
+        if (n > 0) return (int)n;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return AVERROR(errno);
+        }
+        if (file->complete) return AVERROR_EOF;
+
+        // At the current end: decide whether the recording is over, else wait
+        if (atomic_load(&file->cancelled) ||
+            (file->donePath && access(file->donePath, F_OK) == 0) ||
+            (file->idleTimeout > 0 && av_gettime_relative() - idleSince >= (int64_t)(file->idleTimeout * 1e6))) {
+            file->complete = 1;
+            continue;   // pick up anything written before the marker
+        }
+        waitForGrowth(file);
+    }
+}
+
+static int64_t seekFile(void* opaque, int64_t offset, int whence)
+{
+    MEGrowingFile* file = opaque;
+    whence &= ~AVSEEK_FORCE;
+    if (!file->complete && (whence == AVSEEK_SIZE || whence == SEEK_END)) {
+        return AVERROR(ENOSYS);     // the end is not final yet
+    }
+    if (whence == AVSEEK_SIZE) {
+        struct stat st;
+        return (fstat(file->fd, &st) == 0) ? (int64_t)st.st_size : AVERROR(errno);
+    }
+    off_t pos = lseek(file->fd, (off_t)offset, whence);
+    return (pos < 0) ? AVERROR(errno) : (int64_t)pos;
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+MEGrowingFile* MEGrowingFileOpen(const char* path, const char* donePath, double idleTimeout, int* error)
+{
+    int ret = 0;
+    uint8_t* buffer = NULL;
+    MEGrowingFile* file = av_mallocz(sizeof(MEGrowingFile));
+    if (!file) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    file->fd = -1;
+    file->watchfd = -1;
+    file->idleTimeout = idleTimeout;
+    atomic_init(&file->cancelled, 0);
+
+    file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0) {
+        ret = AVERROR(errno);
+        goto end;
+    }
+    if (donePath) {
+        file->donePath = av_strdup(donePath);
+        if (!file->donePath) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+    file->watchfd = openWatch(file, path);
+
+    buffer = av_malloc(kIOBufferSize);
+    if (buffer) {
+        file->pb = avio_alloc_context(buffer, kIOBufferSize, 0, file, readPacket, NULL, seekFile);
+    }
+    if (!file->pb) {
+        av_free(buffer);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    return file;
+
+end:
+    MEGrowingFileClose(&file);
+    if (error) *error = ret;
+    return NULL;
+}
+
+AVIOContext* MEGrowingFileIOContext(MEGrowingFile* file)
+{
+    return file ? file->pb : NULL;
+}
+
+void MEGrowingFileCancel(MEGrowingFile* file)
+{
+    if (file) atomic_store(&file->cancelled, 1);
+}
+
+void MEGrowingFileClose(MEGrowingFile** file)
+{
+    if (!file || !*file) return;
+    MEGrowingFile* f = *file;
+    if (f->pb) {
+        av_freep(&f->pb->buffer);
+        avio_context_free(&f->pb);
+    }
+    if (f->watchfd >= 0) close(f->watchfd);
+    if (f->fd >= 0) close(f->fd);
+    av_freep(&f->donePath);
+    av_freep(file);
+}
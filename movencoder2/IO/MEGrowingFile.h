@@ -0,0 +1,62 @@
+//
+//  MEGrowingFile.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEGrowingFile.h
+ * @abstract Internal API - libavformat input that follows a file still being written
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEGrowingFile provides an AVIOContext for a file that a recorder is still
+ * appending to. Reads at the current end of the file do not return EOF; they
+ * block until the file grows, waiting on kqueue (EVFILT_VNODE) on macOS or
+ * inotify on Linux instead of sleep-polling. The file is treated as complete
+ * once the completion marker exists, or when it has not grown for idleTimeout
+ * seconds; then the remaining data is read and EOF is returned.
+ *
+ * Until the file is complete its size is reported as unknown (AVSEEK_SIZE), so
+ * demuxers do not mistake the current size for the final one. The source must
+ * be readable while it is written: MXF, MPEG-TS, NUT, Matroska or fragmented
+ * MOV/MP4. A MOV with the movie header at the end cannot be followed.
+ *
+ * This file is plain C on top of libavformat/libavutil only.
+ *
+ * Functions return 0 on success and a negative AVERROR code on failure.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEGrowingFile_h
+#define MEGrowingFile_h
+
+#include <libavformat/avio.h>
+
+typedef struct MEGrowingFile MEGrowingFile;
+
+/**
+ Open a growing file for reading.
+ @param path Source file path
+ @param donePath Completion marker path; the file is complete once it exists (may be NULL)
+ @param idleTimeout Seconds without growth after which the file is complete (0 = wait for the marker)
+ @param error Receives an AVERROR code on failure (may be NULL)
+ */
+MEGrowingFile* MEGrowingFileOpen(const char* path, const char* donePath, double idleTimeout, int* error);
+
+/// Read-only AVIOContext for the demuxer; owned by the growing file
+AVIOContext* MEGrowingFileIOContext(MEGrowingFile* file);
+
+/// Treat the file as complete now; a blocked read returns within the wait interval. Thread safe.
+void MEGrowingFileCancel(MEGrowingFile* file);
+
+/// Close the file and free the AVIOContext; *file is set to NULL.
+void MEGrowingFileClose(MEGrowingFile** file);
+
+#endif /* MEGrowingFile_h */
@@ -0,0 +1,161 @@
+//
+//  MEMuxer.c
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#include "MEMuxer.h"
+
+#include <string.h>
+#include <libavutil/intreadwrite.h>
+#include <libavutil/mem.h>
+
+struct MEMuxer {
+    AVFormatContext* fmtctx;
+    int headerWritten;
+    int finished;
+};
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+static int closeOutput(MEMuxer* muxer)
+{
+    AVFormatContext* fmtctx = muxer->fmtctx;
+    if (fmtctx && fmtctx->pb && !(fmtctx->oformat->flags & AVFMT_NOFILE)) {
+        return avio_closep(&fmtctx->pb);
+    }
+    return 0;
+}
+
+/// Attach the clean aperture as frame cropping (top, bottom, left, right; uint32 LE)
+static int addFrameCropping(AVCodecParameters* par, const MEMuxerCleanAperture* clap)
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 19, 100)
+    int left = (par->width - clap->width) / 2 + clap->hOffset;
+    int top = (par->height - clap->height) / 2 + clap->vOffset;
+    int right = par->width - clap->width - left;
+    int bottom = par->height - clap->height - top;
+    if (left < 0 || top < 0 || right < 0 || bottom < 0) {
+        return AVERROR(EINVAL);
+    }
+    AVPacketSideData* sd = av_packet_side_data_new(&par->coded_side_data, &par->nb_coded_side_data,
+                                                   AV_PKT_DATA_FRAME_CROPPING, 4 * sizeof(uint32_t), 0);
+    if (!sd) {
+        return AVERROR(ENOMEM);
+    }
+    AV_WL32(sd->data + 0, (uint32_t)top);
+    AV_WL32(sd->data + 4, (uint32_t)bottom);
+    AV_WL32(sd->data + 8, (uint32_t)left);
+    AV_WL32(sd->data + 12, (uint32_t)right);
+    return 0;
+#else
+    (void)par; (void)clap;
+    return AVERROR(ENOSYS);     // frame cropping side data requires libavcodec 61.19 or later
+#endif
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+MEMuxer* MEMuxerCreate(const char* url, const char* formatName, int* error)
+{
+    int ret = 0;
+    MEMuxer* muxer = av_mallocz(sizeof(MEMuxer));
+    if (!muxer) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avformat_alloc_output_context2(&muxer->fmtctx, NULL, formatName, url);
+    if (ret < 0) goto end;
+    if (!(muxer->fmtctx->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&muxer->fmtctx->pb, url, AVIO_FLAG_WRITE);
+        if (ret < 0) goto end;
+    }
+    return muxer;
+
+end:
+    MEMuxerFree(&muxer);
+    if (error) *error = ret;
+    return NULL;
+}
+
+int MEMuxerWantsGlobalHeader(const MEMuxer* muxer)
+{
+    return (muxer && (muxer->fmtctx->oformat->flags & AVFMT_GLOBALHEADER)) ? 1 : 0;
+}
+
+int MEMuxerAddVideoStream(MEMuxer* muxer, const AVCodecContext* avctx, const MEMuxerCleanAperture* clap)
+{
+    if (!muxer || !avctx || muxer->headerWritten) return AVERROR(EINVAL);
+
+    AVStream* st = avformat_new_stream(muxer->fmtctx, NULL);
+    if (!st) return AVERROR(ENOMEM);
+
+    // codec, extradata, dimensions, color, sample aspect ratio and field order
+    int ret = avcodec_parameters_from_context(st->codecpar, avctx);
+    if (ret < 0) return ret;
+    st->time_base = avctx->time_base;
+    st->avg_frame_rate = avctx->framerate;
+    st->sample_aspect_ratio = avctx->sample_aspect_ratio;
+
+    // QuickTime players expect HEVC parameter sets in the sample entry (hvc1, not hev1)
+    const char* name = muxer->fmtctx->oformat->name;
+    if (st->codecpar->codec_id == AV_CODEC_ID_HEVC &&
+        (strcmp(name, "mov") == 0 || strcmp(name, "mp4") == 0)) {
+        st->codecpar->codec_tag = MKTAG('h', 'v', 'c', '1');
+    }
+
+    if (clap && clap->width > 0 && clap->height > 0) {
+        ret = addFrameCropping(st->codecpar, clap);
+        if (ret < 0) return ret;
+    }
+    return st->index;
+}
+
+int MEMuxerWriteHeader(MEMuxer* muxer)
+{
+    if (!muxer || muxer->headerWritten || muxer->fmtctx->nb_streams == 0) return AVERROR(EINVAL);
+    int ret = avformat_write_header(muxer->fmtctx, NULL);
+    if (ret < 0) return ret;
+    muxer->headerWritten = 1;
+    return 0;
+}
+
+int MEMuxerWritePacket(MEMuxer* muxer, int streamIndex, AVPacket* packet, AVRational timeBase)
+{
+    if (!muxer || !packet || !muxer->headerWritten || muxer->finished) return AVERROR(EINVAL);
+    if (streamIndex < 0 || (unsigned)streamIndex >= muxer->fmtctx->nb_streams) return AVERROR(EINVAL);
+
+    AVStream* st = muxer->fmtctx->streams[streamIndex];
+    packet->stream_index = streamIndex;
+    av_packet_rescale_ts(packet, timeBase, st->time_base);
+    return av_interleaved_write_frame(muxer->fmtctx, packet);
+}
+
+int MEMuxerFinish(MEMuxer* muxer)
+{
+    if (!muxer || !muxer->headerWritten || muxer->finished) return AVERROR(EINVAL);
+    muxer->finished = 1;
+    int ret = av_write_trailer(muxer->fmtctx);
+    int closeRet = closeOutput(muxer);
+    return (ret < 0) ? ret : closeRet;
+}
+
+void MEMuxerFree(MEMuxer** muxer)
+{
+    if (!muxer || !*muxer) return;
+    MEMuxer* m = *muxer;
+    if (m->fmtctx) {
+        closeOutput(m);
+        avformat_free_context(m->fmtctx);
+        m->fmtctx = NULL;
+    }
+    av_freep(muxer);
+}
@@ -0,0 +1,87 @@
+//
+//  MEMuxer.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEMuxer.h
+ * @abstract Internal API - libavformat output for encoded video packets
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEMuxer writes AVPackets from the encoder straight into a libavformat container
+ * (mp4, mov, matroska, mpegts, nut, ivf or raw Annex-B), without creating
+ * CMSampleBuffers. The stream is described from the encoder context, so the
+ * container carries the same properties as the AVAssetWriter path:
+ *
+ *     colr  <- color_primaries / color_trc / colorspace / color_range
+ *     pasp  <- sample_aspect_ratio
+ *     fiel  <- field_order (mov)
+ *     clap  <- MEMuxerCleanAperture, as frame cropping side data
+ *
+ * This file is plain C on top of libavformat/libavcodec/libavutil only, so it
+ * builds and can be tested on any platform FFmpeg supports.
+ *
+ * Functions return 0 (or a stream index) on success and a negative AVERROR code
+ * on failure.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEMuxer_h
+#define MEMuxer_h
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+typedef struct MEMuxer MEMuxer;
+
+/// QuickTime style clean aperture; offsets are from the picture center
+typedef struct {
+    int width;
+    int height;
+    int hOffset;
+    int vOffset;
+} MEMuxerCleanAperture;
+
+/**
+ Allocate a muxer and open the destination.
+ @param url Destination file path or URL ("pipe:1" writes stdout)
+ @param formatName "mp4", "mov", "matroska", "mpegts", "nut", "ivf", "h264"/"hevc"
+        (raw Annex-B), or NULL to guess from url
+ @param error Receives an AVERROR code on failure (may be NULL)
+ */
+MEMuxer* MEMuxerCreate(const char* url, const char* formatName, int* error);
+
+/// 1 if the container stores parameter sets in its header (encoder extradata), else 0
+int MEMuxerWantsGlobalHeader(const MEMuxer* muxer);
+
+/**
+ Add a video stream described by an opened encoder context.
+ @param clap Clean aperture, or NULL to keep the full picture
+ @return Stream index or AVERROR
+ */
+int MEMuxerAddVideoStream(MEMuxer* muxer, const AVCodecContext* avctx, const MEMuxerCleanAperture* clap);
+
+/// Write the container header; call once after all streams are added.
+int MEMuxerWriteHeader(MEMuxer* muxer);
+
+/**
+ Write one packet. The reference held by packet is taken over and packet is reset.
+ @param timeBase Time base of the packet timestamps
+ */
+int MEMuxerWritePacket(MEMuxer* muxer, int streamIndex, AVPacket* packet, AVRational timeBase);
+
+/// Write the trailer and close the destination.
+int MEMuxerFinish(MEMuxer* muxer);
+
+/// Close the destination if still open and free the muxer; *muxer is set to NULL.
+void MEMuxerFree(MEMuxer** muxer);
+
+#endif /* MEMuxer_h */
@@ -0,0 +1,84 @@
+//
+//  MESegmentWriter.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MESegmentWriter.h
+ * @abstract Internal API - CMAF segment files with HLS and DASH manifests
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MESegmentWriter is the delegate of an AVAssetWriter created for segment output
+ * (AVFileTypeProfileMPEG4CMAFCompliant). AVAssetWriter cuts a segment at the first
+ * sync sample after each preferredOutputSegmentInterval, so segments follow the
+ * GOP structure produced by the encoder. Every segment is written to the output
+ * directory as it arrives, then the media playlist and the MPD are rewritten:
+ *
+ *     init.mp4, segment-00001.m4s, ..., media.m3u8, master.m3u8, manifest.mpd
+ *
+ * The codecs (RFC 6381) and the coded size are read from the init segment and
+ * written to the MPD Representation and the CODECS/RESOLUTION of master.m3u8,
+ * as MSE based players need them before they can play.
+ *
+ * While encoding the playlist is an EVENT playlist and the MPD is dynamic, so
+ * players can start before the job ends. -finishWithError: closes both.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MESegmentWriter_h
+#define MESegmentWriter_h
+
+@import Foundation;
+@import AVFoundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MESegmentWriter : NSObject <AVAssetWriterDelegate>
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param directoryURL Directory receiving segments and manifests; created if missing
+ @param targetDuration Preferred segment duration in seconds
+ */
+- (instancetype)initWithDirectoryURL:(NSURL*)directoryURL targetDuration:(double)targetDuration NS_DESIGNATED_INITIALIZER;
++ (instancetype)segmentWriterWithDirectoryURL:(NSURL*)directoryURL targetDuration:(double)targetDuration;
+
+@property (nonatomic, readonly) NSURL* directoryURL;
+@property (nonatomic, readonly) double targetDuration;
+@property (readonly) NSUInteger segmentCount;   // media segments written so far
+/// Video frame duration for the manifest frame rate; set before the first segment. kCMTimeInvalid omits it.
+@property (nonatomic, assign) CMTime frameDuration;
+
+/// Create the directory and remove segments and manifests left by a previous run.
+- (BOOL)prepareWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Write the final playlist and MPD. Returns NO if any segment could not be written.
+- (BOOL)finishWithError:(NSError * _Nullable * _Nullable)error;
+
+/**
+ Same as the delegate callback, with the timing given directly instead of by an AVAssetSegmentReport.
+ @param start Earliest presentation time of a media segment; kCMTimeInvalid continues the previous one
+ @param duration Duration of a media segment; kCMTimeInvalid uses targetDuration
+ @param mediaType Media type the timing comes from, nil for video
+ */
+- (void)writeSegmentData:(NSData*)segmentData
+             segmentType:(AVAssetSegmentType)segmentType
+                   start:(CMTime)start
+                duration:(CMTime)duration
+               mediaType:(nullable AVMediaType)mediaType;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MESegmentWriter_h */
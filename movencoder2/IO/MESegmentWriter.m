@@ -0,0 +1,547 @@
+//
+//  MESegmentWriter.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr
+
+#import "MECommon.h"
+#import "MESegmentWriter.h"
+#import "MESecureLogging.h"
+
+static NSString* const kMEInitSegmentName = @"init.mp4";
+static NSString* const kMEMediaPlaylistName = @"media.m3u8";
+static NSString* const kMEMultivariantPlaylistName = @"master.m3u8";
+static NSString* const kMEManifestName = @"manifest.mpd";
+static NSString* const kMESegmentPrefix = @"segment-";
+static NSString* const kMESegmentExtension = @"m4s";
+static const int32_t kMESegmentTimescale = 90000; // MPD SegmentTimeline units
+
+static inline NSError* MESegmentError(NSString* reason) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:paramErr
+                           userInfo:@{NSLocalizedDescriptionKey : @"Segment output failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/* =================================================================================== */
+// MARK: - init segment
+/* =================================================================================== */
+
+static inline uint16_t rd16(const uint8_t* p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t rd32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+/// Payload of the first box of type directly under the payload p; NULL if absent or broken
+static const uint8_t* childBox(const uint8_t* p, size_t length, uint32_t type, size_t* payloadSize) {
+    while (length >= 8) {
+        size_t size = rd32(p);
+        if (size < 8 || size > length) return NULL;
+        if (rd32(p + 4) == type) {
+            *payloadSize = size - 8;
+            return p + 8;
+        }
+        p += size;
+        length -= size;
+    }
+    return NULL;
+}
+
+static NSString* fourccString(uint32_t fourcc) {
+    char chars[5] = {(char)(fourcc >> 24), (char)(fourcc >> 16), (char)(fourcc >> 8), (char)fourcc, 0};
+    return [NSString stringWithUTF8String:chars];
+}
+
+/// RFC 6381 "avc1.PPCCLL" from an avcC payload
+static NSString* _Nullable avcCodecString(uint32_t format, const uint8_t* _Nullable avcC, size_t size) {
+    if (!avcC || size < 4) return nil;
+    return [NSString stringWithFormat:@"%@.%02X%02X%02X", fourccString(format), avcC[1], avcC[2], avcC[3]];
+}
+
+/// ISO/IEC 14496-15 Annex E "hvc1.[A-C]P.C.[LH]L.B..." from an hvcC payload
+static NSString* _Nullable hevcCodecString(uint32_t format, const uint8_t* _Nullable hvcC, size_t size) {
+    if (!hvcC || size < 13) return nil;
+    static const char* const spaces[] = {"", "A", "B", "C"};
+    uint32_t flags = rd32(hvcC + 2), reversed = 0;
+    for (int bit = 0; bit < 32; bit++) {
+        reversed |= ((flags >> bit) & 1) << (31 - bit);
+    }
+    NSMutableString* text = [NSMutableString stringWithFormat:@"%@.%s%d.%X.%c%d", fourccString(format),
+                             spaces[hvcC[1] >> 6], hvcC[1] & 0x1F, reversed,
+                             (hvcC[1] & 0x20) ? 'H' : 'L', hvcC[12]];
+    // constraint indicator bytes, trailing zero bytes omitted
+    int last = 5;
+    while (last >= 0 && hvcC[6 + last] == 0) last--;
+    for (int i = 0; i <= last; i++) {
+        [text appendFormat:@".%X", hvcC[6 + i]];
+    }
+    return text;
+}
+
+/// Tag and length of the MPEG-4 descriptor at *p; *p moves to its payload
+static BOOL readDescriptor(const uint8_t** p, const uint8_t* end, uint8_t* tag, size_t* length) {
+    if (*p >= end) return NO;
+    *tag = *(*p)++;
+    size_t len = 0;
+    for (int i = 0; i < 4; i++) {
+        if (*p >= end) return NO;
+        uint8_t byte = *(*p)++;
+        len = len << 7 | (byte & 0x7F);
+        if (!(byte & 0x80)) break;
+    }
+    if (len > (size_t)(end - *p)) return NO;
+    *length = len;
+    return YES;
+}
+
+/// RFC 6381 "mp4a.OO.A" (object type, audio object type) from an esds payload
+static NSString* _Nullable mp4aCodecString(const uint8_t* _Nullable esds, size_t size) {
+    if (!esds || size < 4) return nil;
+    const uint8_t* p = esds + 4;    // version/flags
+    const uint8_t* end = esds + size;
+    uint8_t tag = 0;
+    size_t length = 0;
+    if (!readDescriptor(&p, end, &tag, &length) || tag != 0x03 || length < 3) return nil;
+    end = p + length;
+    uint8_t esFlags = p[2];
+    p += 3;
+    if (esFlags & 0x80) p += 2;                         // dependsOn_ES_ID
+    if ((esFlags & 0x40) && p < end) p += 1 + *p;       // URL
+    if (esFlags & 0x20) p += 2;                         // OCR_ES_Id
+    if (p >= end || !readDescriptor(&p, end, &tag, &length) || tag != 0x04 || length < 13) return nil;
+    uint8_t objectType = p[0];
+    end = p + length;
+    p += 13;
+    if (!readDescriptor(&p, end, &tag, &length) || tag != 0x05 || length < 1) {
+        return [NSString stringWithFormat:@"mp4a.%02x", objectType];
+    }
+    int audioObjectType = p[0] >> 3;
+    if (audioObjectType == 31 && length >= 2) {
+        audioObjectType = 32 + ((p[0] & 0x07) << 3 | p[1] >> 5);
+    }
+    return [NSString stringWithFormat:@"mp4a.%02x.%d", objectType, audioObjectType];
+}
+
+/// Codec of the first sample entry of a trak payload; the coded size of a video track goes to width/height
+static NSString* _Nullable trackCodecString(const uint8_t* trak, size_t trakSize, int* width, int* height) {
+    size_t mdiaSize = 0, hdlrSize = 0, minfSize = 0, stblSize = 0, stsdSize = 0;
+    const uint8_t* mdia = childBox(trak, trakSize, 'mdia', &mdiaSize);
+    const uint8_t* hdlr = mdia ? childBox(mdia, mdiaSize, 'hdlr', &hdlrSize) : NULL;
+    const uint8_t* minf = mdia ? childBox(mdia, mdiaSize, 'minf', &minfSize) : NULL;
+    const uint8_t* stbl = minf ? childBox(minf, minfSize, 'stbl', &stblSize) : NULL;
+    const uint8_t* stsd = stbl ? childBox(stbl, stblSize, 'stsd', &stsdSize) : NULL;
+    if (!hdlr || hdlrSize < 12 || !stsd || stsdSize < 16) return nil;
+    const uint8_t* entry = stsd + 8;    // version/flags, entry_count
+    size_t entrySize = rd32(entry);
+    if (entrySize < 8 || entrySize > stsdSize - 8) return nil;
+    uint32_t format = rd32(entry + 4);
+    const uint8_t* body = entry + 8;
+    size_t bodySize = entrySize - 8;
+
+    // child boxes follow the fixed fields of VisualSampleEntry / AudioSampleEntry
+    size_t fixed = 0;
+    switch (rd32(hdlr + 8)) {
+        case 'vide':
+            fixed = 78;
+            if (bodySize < fixed) return nil;
+            if (*width == 0) {
+                *width = rd16(body + 24);
+                *height = rd16(body + 26);
+            }
+            break;
+        case 'soun':
+            if (bodySize < 28) return nil;
+            fixed = (rd16(body + 8) == 1) ? 44 : (rd16(body + 8) == 2) ? 64 : 28;
+            if (bodySize < fixed) return nil;
+            break;
+        default:
+            return nil;
+    }
+    const uint8_t* boxes = body + fixed;
+    size_t boxesSize = bodySize - fixed, configSize = 0;
+    NSString* codec = nil;
+    switch (format) {
+        case 'avc1': case 'avc3':
+            codec = avcCodecString(format, childBox(boxes, boxesSize, 'avcC', &configSize), configSize);
+            break;
+        case 'hvc1': case 'hev1':
+            codec = hevcCodecString(format, childBox(boxes, boxesSize, 'hvcC', &configSize), configSize);
+            break;
+        case 'mp4a':
+            codec = mp4aCodecString(childBox(boxes, boxesSize, 'esds', &configSize), configSize);
+            break;
+        default:
+            break;
+    }
+    return codec ?: fourccString(format);
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MESegmentEntry : NSObject
+@property (nonatomic, copy) NSString* name;
+@property (nonatomic, assign) int64_t start;     // kMESegmentTimescale
+@property (nonatomic, assign) int64_t duration;  // kMESegmentTimescale
+@property (nonatomic, assign) NSUInteger bytes;
+@end
+
+@implementation MESegmentEntry
+@end
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+@interface MESegmentWriter ()
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSMutableArray<MESegmentEntry*>* segments;
+@property (nonatomic, strong, nullable) NSError* writeError;
+@property (nonatomic, strong) NSDate* availabilityStartTime;
+@property (nonatomic, copy) NSString* mimeType;
+@property (nonatomic, assign) BOOL hasInitSegment;
+@property (nonatomic, assign) BOOL finished;
+@property (nonatomic, assign) double peakBitRate;
+@property (nonatomic, copy, nullable) NSString* codecs;    // RFC 6381, one per track
+@property (nonatomic, assign) int width;                   // coded size of the video track
+@property (nonatomic, assign) int height;
+@end
+
+@implementation MESegmentWriter
+
+- (instancetype)initWithDirectoryURL:(NSURL*)directoryURL targetDuration:(double)targetDuration
+{
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _targetDuration = targetDuration;
+        _queue = dispatch_queue_create("MESegmentWriter", DISPATCH_QUEUE_SERIAL);
+        _segments = [NSMutableArray array];
+        _availabilityStartTime = [NSDate date];
+        _mimeType = @"video/mp4";
+        _frameDuration = kCMTimeInvalid;
+    }
+    return self;
+}
+
++ (instancetype)segmentWriterWithDirectoryURL:(NSURL*)directoryURL targetDuration:(double)targetDuration
+{
+    return [[self alloc] initWithDirectoryURL:directoryURL targetDuration:targetDuration];
+}
+
+- (NSUInteger)segmentCount
+{
+    __block NSUInteger count = 0;
+    dispatch_sync(self.queue, ^{
+        count = self.segments.count;
+    });
+    return count;
+}
+
+- (BOOL)prepareWithError:(NSError**)error
+{
+    NSFileManager* fm = [NSFileManager defaultManager];
+    if (![fm createDirectoryAtURL:self.directoryURL withIntermediateDirectories:YES attributes:nil error:error]) {
+        SecureErrorLogf(@"[MESegmentWriter] ERROR: Cannot create %@", self.directoryURL.path);
+        return NO;
+    }
+    // only our own files are removed; anything else in the directory is left alone
+    NSArray<NSString*>* names = [fm contentsOfDirectoryAtPath:self.directoryURL.path error:error];
+    if (!names) return NO;
+    for (NSString* name in names) {
+        BOOL stale = ([name isEqualToString:kMEInitSegmentName] ||
+                      [name isEqualToString:kMEMediaPlaylistName] ||
+                      [name isEqualToString:kMEMultivariantPlaylistName] ||
+                      [name isEqualToString:kMEManifestName] ||
+                      ([name hasPrefix:kMESegmentPrefix] && [name.pathExtension isEqualToString:kMESegmentExtension]));
+        if (stale && ![fm removeItemAtURL:[self.directoryURL URLByAppendingPathComponent:name] error:error]) {
+            SecureErrorLogf(@"[MESegmentWriter] ERROR: Cannot remove %@", name);
+            return NO;
+        }
+    }
+    self.availabilityStartTime = [NSDate date];
+    return YES;
+}
+
+- (BOOL)finishWithError:(NSError**)error
+{
+    __block NSError* err = nil;
+    dispatch_sync(self.queue, ^{
+        if (!self.writeError && !self.hasInitSegment) {
+            self.writeError = MESegmentError(@"No segment was produced.");
+        }
+        self.finished = TRUE;
+        if (!self.writeError) {
+            [self writeManifests];
+        }
+        err = self.writeError;
+    });
+    if (err) {
+        if (error) *error = err;
+        return NO;
+    }
+    SecureLogf(@"[MESegmentWriter] Wrote %lu segments into %@",
+               (unsigned long)self.segmentCount, self.directoryURL.path);
+    return YES;
+}
+
+/* =================================================================================== */
+// MARK: - AVAssetWriterDelegate
+/* =================================================================================== */
+
+- (void)assetWriter:(AVAssetWriter*)writer
+didOutputSegmentData:(NSData*)segmentData
+        segmentType:(AVAssetSegmentType)segmentType
+      segmentReport:(nullable AVAssetSegmentReport*)segmentReport
+{
+    // timing comes from the video track when there is one
+    AVAssetSegmentTrackReport* trackReport = nil;
+    for (AVAssetSegmentTrackReport* candidate in segmentReport.trackReports) {
+        if (!trackReport || [candidate.mediaType isEqualToString:AVMediaTypeVideo]) {
+            trackReport = candidate;
+        }
+    }
+    [self writeSegmentData:segmentData
+               segmentType:segmentType
+                     start:trackReport ? trackReport.earliestPresentationTimeStamp : kCMTimeInvalid
+                  duration:trackReport ? trackReport.duration : kCMTimeInvalid
+                 mediaType:trackReport.mediaType];
+}
+
+- (void)writeSegmentData:(NSData*)segmentData
+             segmentType:(AVAssetSegmentType)segmentType
+                   start:(CMTime)start
+                duration:(CMTime)duration
+               mediaType:(nullable AVMediaType)mediaType
+{
+    dispatch_sync(self.queue, ^{
+        if (self.writeError || self.finished) return;
+        if (segmentType == AVAssetSegmentTypeInitialization) {
+            [self writeInitSegment:segmentData];
+        } else {
+            [self writeMediaSegment:segmentData start:start duration:duration mediaType:mediaType];
+        }
+    });
+}
+
+/* =================================================================================== */
+// MARK: - private (call on queue)
+/* =================================================================================== */
+
+- (BOOL)writeData:(NSData*)data name:(NSString*)name
+{
+    NSURL* url = [self.directoryURL URLByAppendingPathComponent:name];
+    NSError* err = nil;
+    if (![data writeToURL:url options:NSDataWritingAtomic error:&err]) {
+        SecureErrorLogf(@"[MESegmentWriter] ERROR: Cannot write %@", name);
+        self.writeError = err ?: MESegmentError([NSString stringWithFormat:@"Cannot write %@", name]);
+        return NO;
+    }
+    return YES;
+}
+
+- (void)writeInitSegment:(NSData*)data
+{
+    if (![self writeData:data name:kMEInitSegmentName]) return;
+    self.hasInitSegment = TRUE;
+
+    // codecs of every track in moov, as MSE players need them to create a SourceBuffer
+    NSMutableArray<NSString*>* codecs = [NSMutableArray array];
+    int width = 0, height = 0;
+    size_t moovSize = 0;
+    const uint8_t* moov = childBox(data.bytes, data.length, 'moov', &moovSize);
+    while (moov && moovSize >= 8) {
+        size_t size = rd32(moov);
+        if (size < 8 || size > moovSize) break;
+        if (rd32(moov + 4) == 'trak') {
+            NSString* codec = trackCodecString(moov + 8, size - 8, &width, &height);
+            if (codec) [codecs addObject:codec];
+        }
+        moov += size;
+        moovSize -= size;
+    }
+    self.codecs = codecs.count ? [codecs componentsJoinedByString:@","] : nil;
+    self.width = width;
+    self.height = height;
+    if (!self.codecs) {
+        SecureErrorLog(@"[MESegmentWriter] WARNING: No codec found in the init segment; manifests omit codecs");
+    }
+}
+
+- (void)writeMediaSegment:(NSData*)data start:(CMTime)start duration:(CMTime)duration
+                mediaType:(nullable AVMediaType)mediaType
+{
+    MESegmentEntry* previous = self.segments.lastObject;
+    MESegmentEntry* entry = [MESegmentEntry new];
+    entry.name = [NSString stringWithFormat:@"%@%05lu.%@", kMESegmentPrefix,
+                  (unsigned long)(self.segments.count + 1), kMESegmentExtension];
+    entry.bytes = data.length;
+    if (CMTIME_IS_NUMERIC(start) && CMTIME_IS_NUMERIC(duration)) {
+        entry.start = CMTimeConvertScale(start, kMESegmentTimescale,
+                                         kCMTimeRoundingMethod_RoundHalfAwayFromZero).value;
+        entry.duration = CMTimeConvertScale(duration, kMESegmentTimescale,
+                                            kCMTimeRoundingMethod_RoundHalfAwayFromZero).value;
+        if (mediaType && ![mediaType isEqualToString:AVMediaTypeVideo]) {
+            self.mimeType = @"audio/mp4";
+        }
+    } else {
+        entry.start = previous ? previous.start + previous.duration : 0;
+        entry.duration = (int64_t)(self.targetDuration * kMESegmentTimescale);
+    }
+
+    // segment first, manifests after, so a reader never sees a missing file
+    if (![self writeData:data name:entry.name]) return;
+    [self.segments addObject:entry];
+    if (entry.duration > 0) {
+        double bitRate = entry.bytes * 8.0 * kMESegmentTimescale / entry.duration;
+        self.peakBitRate = MAX(self.peakBitRate, bitRate);
+    }
+    [self writeManifests];
+}
+
+- (void)writeManifests
+{
+    NSData* playlist = [[self mediaPlaylist] dataUsingEncoding:NSUTF8StringEncoding];
+    NSData* multivariant = [[self multivariantPlaylist] dataUsingEncoding:NSUTF8StringEncoding];
+    NSData* manifest = [[self manifest] dataUsingEncoding:NSUTF8StringEncoding];
+    if ([self writeData:playlist name:kMEMediaPlaylistName] &&
+        [self writeData:multivariant name:kMEMultivariantPlaylistName]) {
+        [self writeData:manifest name:kMEManifestName];
+    }
+}
+
+- (BOOL)hasFrameRate
+{
+    CMTime duration = self.frameDuration;
+    return CMTIME_IS_NUMERIC(duration) && duration.value > 0;
+}
+
+/// DASH FrameRateType: "N" or "N/D"
+- (NSString*)dashFrameRate
+{
+    int64_t num = self.frameDuration.timescale, den = self.frameDuration.value;
+    int64_t a = num, b = den;
+    while (b) {
+        int64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    num /= a;
+    den /= a;
+    return (den == 1) ? [NSString stringWithFormat:@"%lld", num] : [NSString stringWithFormat:@"%lld/%lld", num, den];
+}
+
+- (NSString*)multivariantPlaylist
+{
+    NSMutableString* attributes = [NSMutableString stringWithFormat:@"BANDWIDTH=%.0f", ceil(self.peakBitRate)];
+    if (self.codecs) {
+        [attributes appendFormat:@",CODECS=\"%@\"", self.codecs];
+    }
+    if (self.width > 0 && self.height > 0) {
+        [attributes appendFormat:@",RESOLUTION=%dx%d", self.width, self.height];
+    }
+    if (self.width > 0 && [self hasFrameRate]) {
+        [attributes appendFormat:@",FRAME-RATE=%.3f", (double)self.frameDuration.timescale / self.frameDuration.value];
+    }
+
+    NSMutableString* text = [NSMutableString string];
+    [text appendString:@"#EXTM3U\n"];
+    [text appendString:@"#EXT-X-VERSION:7\n"];
+    [text appendString:@"#EXT-X-INDEPENDENT-SEGMENTS\n"];
+    [text appendFormat:@"#EXT-X-STREAM-INF:%@\n%@\n", attributes, kMEMediaPlaylistName];
+    return text;
+}
+
+- (NSString*)mediaPlaylist
+{
+    // EXT-X-TARGETDURATION must cover the longest segment, which can exceed the
+    // preferred interval when the GOP is longer; RFC 8216 compares EXTINF rounded
+    // to the nearest integer, so 2.002 s segments keep a target of 2
+    int64_t longest = 0;
+    for (MESegmentEntry* entry in self.segments) {
+        longest = MAX(longest, entry.duration);
+    }
+    long target = MAX(lround(MAX(self.targetDuration, (double)longest / kMESegmentTimescale)), 1L);
+
+    NSMutableString* text = [NSMutableString string];
+    [text appendString:@"#EXTM3U\n"];
+    [text appendString:@"#EXT-X-VERSION:7\n"];
+    [text appendFormat:@"#EXT-X-TARGETDURATION:%ld\n", target];
+    [text appendFormat:@"#EXT-X-PLAYLIST-TYPE:%@\n", self.finished ? @"VOD" : @"EVENT"];
+    [text appendString:@"#EXT-X-MEDIA-SEQUENCE:1\n"];
+    [text appendString:@"#EXT-X-INDEPENDENT-SEGMENTS\n"];
+    [text appendFormat:@"#EXT-X-MAP:URI=\"%@\"\n", kMEInitSegmentName];
+    for (MESegmentEntry* entry in self.segments) {
+        [text appendFormat:@"#EXTINF:%.6f,\n%@\n", (double)entry.duration / kMESegmentTimescale, entry.name];
+    }
+    if (self.finished) {
+        [text appendString:@"#EXT-X-ENDLIST\n"];
+    }
+    return text;
+}
+
+- (NSString*)manifest
+{
+    NSISO8601DateFormatter* formatter = [NSISO8601DateFormatter new];
+    int64_t total = 0;
+    for (MESegmentEntry* entry in self.segments) {
+        total += entry.duration;
+    }
+    double seconds = (double)total / kMESegmentTimescale;
+
+    NSMutableString* text = [NSMutableString string];
+    [text appendString:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"];
+    [text appendString:@"<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011,urn:mpeg:dash:profile:cmaf:2019\""];
+    [text appendFormat:@" minBufferTime=\"PT%.1fS\"", self.targetDuration];
+    if (self.finished) {
+        [text appendFormat:@" type=\"static\" mediaPresentationDuration=\"PT%.3fS\">\n", seconds];
+    } else {
+        [text appendFormat:@" type=\"dynamic\" availabilityStartTime=\"%@\" publishTime=\"%@\" minimumUpdatePeriod=\"PT%.1fS\">\n",
+         [formatter stringFromDate:self.availabilityStartTime], [formatter stringFromDate:[NSDate date]],
+         self.targetDuration];
+    }
+    [text appendString:@"  <Period id=\"0\" start=\"PT0S\">\n"];
+    [text appendFormat:@"    <AdaptationSet id=\"0\" mimeType=\"%@\" segmentAlignment=\"true\" startWithSAP=\"1\">\n", self.mimeType];
+    [text appendFormat:@"      <Representation id=\"0\" bandwidth=\"%.0f\"", ceil(self.peakBitRate)];
+    if (self.codecs) {
+        [text appendFormat:@" codecs=\"%@\"", self.codecs];
+    }
+    if (self.width > 0 && self.height > 0) {
+        [text appendFormat:@" width=\"%d\" height=\"%d\"", self.width, self.height];
+        if ([self hasFrameRate]) {
+            [text appendFormat:@" frameRate=\"%@\"", [self dashFrameRate]];
+        }
+    }
+    [text appendString:@">\n"];
+    [text appendFormat:@"        <SegmentTemplate timescale=\"%d\" initialization=\"%@\" media=\"%@$Number%%05d$.%@\" startNumber=\"1\">\n",
+     kMESegmentTimescale, kMEInitSegmentName, kMESegmentPrefix, kMESegmentExtension];
+    [text appendString:@"          <SegmentTimeline>\n"];
+    int64_t expected = -1;
+    for (MESegmentEntry* entry in self.segments) {
+        if (entry.start != expected) {
+            [text appendFormat:@"            <S t=\"%lld\" d=\"%lld\"/>\n", entry.start, entry.duration];
+        } else {
+            [text appendFormat:@"            <S d=\"%lld\"/>\n", entry.duration];
+        }
+        expected = entry.start + entry.duration;
+    }
+    [text appendString:@"          </SegmentTimeline>\n"];
+    [text appendString:@"        </SegmentTemplate>\n"];
+    [text appendString:@"      </Representation>\n"];
+    [text appendString:@"    </AdaptationSet>\n"];
+    [text appendString:@"  </Period>\n"];
+    [text appendString:@"</MPD>\n"];
+    return text;
+}
+
+@end
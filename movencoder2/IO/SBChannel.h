@@ -26,6 +26,8 @@
 
 @class MEInput;
 @class MEOutput;
+@class SBPrefetchQueue;
+@class SBChannelScheduler;
 
 /* =================================================================================== */
 // MARK: -
@@ -39,6 +41,9 @@ typedef void (^CompletionHandler)(void);
 
 @class SBChannel;
 @protocol SBChannelDelegate <NSObject>
+@optional
+// Called for every sample on the channel queue; keep it cheap.
+// Progress reporting should poll -statsSnapshot instead.
 - (void)didReadBuffer:(CMSampleBufferRef _Nonnull)buffer from:(SBChannel* _Nonnull)channel;
 @end
 
@@ -46,6 +51,19 @@ typedef void (^CompletionHandler)(void);
 // MARK: -
 /* =================================================================================== */
 
+/// Point-in-time copy of the per-channel counters (lock-free, updated per sample)
+typedef struct {
+    int64_t samples;        // number of samples passed through the channel
+    int64_t bytes;          // total payload bytes (compressed size, or pixel buffer size)
+    double lastPTS;         // seconds; NAN until the first sample
+    double lastEndPTS;      // seconds; lastPTS + duration of the last sample
+    double lastDTS;         // seconds; NAN when the sample has no decode timestamp
+} SBChannelStats;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
 NS_ASSUME_NONNULL_BEGIN
 
 @interface SBChannel : NSObject
@@ -59,8 +77,19 @@ NS_ASSUME_NONNULL_BEGIN
 @property(nonatomic, strong, readonly) MEOutput* meOutput;
 @property(nonatomic, strong, readonly) MEInput* meInput;
 @property(nonatomic, assign) BOOL showProgress;
-@property(nonatomic) int count;
-@property(nonatomic, strong, readonly) NSDictionary* info;
+@property(nonatomic, readonly) int count;
+@property(nonatomic, strong, readonly) NSDictionary* info; // trackID, mediaType, tag
+
+// Optional read-ahead of the producer on its own queue; set before start (0 = disabled)
+@property(nonatomic, assign) NSUInteger prefetchFrames;
+@property(nonatomic, assign) size_t prefetchBytes;
+@property(nonatomic, strong, readonly, nullable) SBPrefetchQueue* prefetchQueue;
+
+// Optional timestamp-ordered pacing against other channels; set before start
+@property(nonatomic, strong, nullable) SBChannelScheduler* scheduler;
+
+/// Snapshot of the channel counters; safe to call from any thread.
+- (SBChannelStats)statsSnapshot;
 
 - (instancetype)initWithProducerME:(MEOutput*)meOutput
                         consumerME:(MEInput*)meInput
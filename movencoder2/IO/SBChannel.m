@@ -13,7 +13,11 @@
 #import "MEInput.h"
 #import "MEOutput.h"
 #import "MEManager.h"
+#import "SBPrefetchQueue.h"
+#import "SBChannelScheduler.h"
 #import "MESecureLogging.h"
+#import "MEMetrics.h"
+#include <stdatomic.h>
 
 /* =================================================================================== */
 // MARK: -
@@ -22,8 +26,17 @@
 NS_ASSUME_NONNULL_BEGIN
 
 @interface SBChannel ()
+{
+    // per-sample counters; written on the channel queue, read from any thread
+    _Atomic(int64_t) _statSamples;
+    _Atomic(int64_t) _statBytes;
+    _Atomic(double) _statLastPTS;
+    _Atomic(double) _statLastEndPTS;
+    _Atomic(double) _statLastDTS;
+}
 
 @property(nonatomic, strong) NSDictionary* info;
+@property(nonatomic, strong, nullable) SBPrefetchQueue* prefetchQueue;
 
 @property(nonatomic, assign, getter=isFinished) BOOL finished;
 @property(nonatomic, assign) char* queueLabel;
@@ -73,7 +86,11 @@ char* createLabel(CMPersistentTrackID track) {
         // assign queue-specific to detect same-queue calls
         void* unused = (__bridge void*)self;
         dispatch_queue_set_specific(_queue, sbChannelQueueKey, unused, NULL);
-        _count = 0;
+        atomic_init(&_statSamples, 0);
+        atomic_init(&_statBytes, 0);
+        atomic_init(&_statLastPTS, NAN);
+        atomic_init(&_statLastEndPTS, NAN);
+        atomic_init(&_statLastDTS, NAN);
     }
     return self;
 }
@@ -112,10 +129,48 @@ void dumpTiming(CMSampleBufferRef sb, NSString* typeString, NSString* tag, int c
           typeString, tag, dtsValue, dtsScale, dtime, ptsValue, ptsScale, ptime, count);
 }
 
-int countUp(SBChannel* self) {
-    int count = self.count + 1;
-    self.count = count;
-    return count;
+- (int)count
+{
+    return (int)atomic_load_explicit(&_statSamples, memory_order_relaxed);
+}
+
+- (SBChannelStats)statsSnapshot
+{
+    SBChannelStats stats;
+    stats.samples = atomic_load_explicit(&_statSamples, memory_order_relaxed);
+    stats.bytes = atomic_load_explicit(&_statBytes, memory_order_relaxed);
+    stats.lastPTS = atomic_load_explicit(&_statLastPTS, memory_order_relaxed);
+    stats.lastEndPTS = atomic_load_explicit(&_statLastEndPTS, memory_order_relaxed);
+    stats.lastDTS = atomic_load_explicit(&_statLastDTS, memory_order_relaxed);
+    return stats;
+}
+
+// Only the channel queue writes the counters, so plain load/store is sufficient.
+static int countUp(SBChannel* self, CMSampleBufferRef sb) {
+    int64_t count = atomic_load_explicit(&self->_statSamples, memory_order_relaxed) + 1;
+    int64_t bytes = atomic_load_explicit(&self->_statBytes, memory_order_relaxed) + (int64_t)SBSampleBufferPayloadSize(sb);
+    CMTime pts = CMSampleBufferGetPresentationTimeStamp(sb);
+    CMTime dts = CMSampleBufferGetDecodeTimeStamp(sb);
+    CMTime dur = CMSampleBufferGetDuration(sb);
+    atomic_store_explicit(&self->_statLastDTS,
+                          (CMTIME_IS_NUMERIC(dts) ? CMTimeGetSeconds(dts) : NAN), memory_order_relaxed);
+    if (CMTIME_IS_NUMERIC(pts)) {
+        double ptsSec = CMTimeGetSeconds(pts);
+        double endSec = CMTIME_IS_NUMERIC(dur) ? ptsSec + CMTimeGetSeconds(dur) : ptsSec;
+        atomic_store_explicit(&self->_statLastPTS, ptsSec, memory_order_relaxed);
+        atomic_store_explicit(&self->_statLastEndPTS, endSec, memory_order_relaxed);
+    }
+    atomic_store_explicit(&self->_statBytes, bytes, memory_order_relaxed);
+    atomic_store_explicit(&self->_statSamples, count, memory_order_release);
+    return (int)count;
+}
+
+// Finish a metrics/trace probe; payload size and PTS are only read while probing
+static inline void endSampleBufferProbe(MEMetricsStage stage, uint64_t t0, BOOL done, CMSampleBufferRef _Nullable sb) {
+    if (t0 == 0) return;
+    uint64_t bytes = (sb ? SBSampleBufferPayloadSize(sb) : 0);
+    CMTime pts = (sb ? CMSampleBufferGetPresentationTimeStamp(sb) : kCMTimeInvalid);
+    MEMetricsEndPTS(stage, t0, (done ? 1 : 0), bytes, (CMTIME_IS_NUMERIC(pts) ? CMTimeGetSeconds(pts) : NAN));
 }
 
 - (void)startWithDelegate:(nullable id<SBChannelDelegate>)delegate
@@ -124,44 +179,78 @@ int countUp(SBChannel* self) {
     self.delegate = delegate;
     self.completionHandler = block;
     
+    // Resolve channel attributes once; they never change while running
+    MEOutput* meOutput = self.meOutput;
+    BOOL isFromME = [meOutput isMemberOfClass:[MEOutput class]];
+    BOOL isToME = [self.meInput isMemberOfClass:[MEInput class]];
+    BOOL isPassThru = (!isFromME && !isToME);
+    BOOL isFromReader = [(id)meOutput isKindOfClass:[AVAssetReaderOutput class]];
+    BOOL isToWriter = [(id)self.meInput isKindOfClass:[AVAssetWriterInput class]];
+    BOOL isVideo = [meOutput.mediaType isEqualToString:@"vide"];
+    BOOL isAudio = [meOutput.mediaType isEqualToString:@"soun"];
+    NSString* tag = (isVideo ? @"video" : (isAudio ? @"audio" : @"other"));
+    if (isVideo)
+        tag = (isFromME ? @"out" : (isToME ? @"in " : @"p/t"));
+    
+    NSMutableDictionary* info = [NSMutableDictionary new];
+    info[kProgressTrackIDKey] = @(self.track);
+    info[kProgressMediaTypeKey] = self.mediaType;
+    info[kProgressTagKey] = tag;
+    self.info = [info copy];
+    
+    BOOL notifyDelegate = [delegate respondsToSelector:@selector(didReadBuffer:from:)];
+    
+    if (self.prefetchFrames > 0 || self.prefetchBytes > 0) {
+        NSString* label = [NSString stringWithFormat:@"com.movencoder2.SBPrefetchQueue.track%d", self.track];
+        self.prefetchQueue = [SBPrefetchQueue prefetchQueueWithProducer:meOutput
+                                                              maxFrames:self.prefetchFrames
+                                                               maxBytes:self.prefetchBytes
+                                                                  label:label];
+        [self.prefetchQueue start];
+    }
+    
     __weak typeof(self) wself = self;
     [self.meInput requestMediaDataWhenReadyOnQueue:self.queue usingBlock:^{
-        if (wself.finished) return;
+        SBChannel* sself = wself;
+        if (!sself || sself.finished) return;
         
-        id<SBChannelDelegate> delegate = wself.delegate;
-        MEOutput* meOutput = wself.meOutput;
-        MEInput* meInput = wself.meInput;
+        id<SBChannelDelegate> delegate = notifyDelegate ? sself.delegate : nil;
+        MEOutput* meOutput = sself.meOutput;
+        MEInput* meInput = sself.meInput;
+        SBPrefetchQueue* prefetchQueue = sself.prefetchQueue;
+        SBChannelScheduler* scheduler = sself.scheduler;
+        BOOL showProgress = sself.showProgress;
         
-        BOOL isFromME = [meOutput isMemberOfClass:[MEOutput class]];
-        BOOL isToME = [meInput isMemberOfClass:[MEInput class]];
-        BOOL isPassThru = (!isFromME && !isToME);
-        BOOL isVideo = [meOutput.mediaType isEqualToString:@"vide"];
-        BOOL isAudio = [meOutput.mediaType isEqualToString:@"soun"];
-        NSString* tag = (isVideo ? @"video" : (isAudio ? @"audio" : @"other"));
-        if (isVideo)
-            tag = (isFromME ? @"out" : (isToME ? @"in " : @"p/t"));
-        BOOL showProgress = wself.showProgress;
-        
-        NSMutableDictionary* info = [NSMutableDictionary new];
-        info[kProgressTrackIDKey] = @(wself.track);
-        info[kProgressMediaTypeKey] = wself.mediaType;
-        info[kProgressTagKey] = tag;
-        wself.info = info;
-
         BOOL result = TRUE;
         while (meInput.isReadyForMoreMediaData && result) {
             @autoreleasepool {
-                CMSampleBufferRef sb = [meOutput copyNextSampleBuffer];
+                uint64_t t0 = (isFromReader ? MEMetricsBegin() : 0);
+                CMSampleBufferRef sb = (prefetchQueue ? [prefetchQueue copyNextSampleBuffer]
+                                                      : [meOutput copyNextSampleBuffer]);
+                endSampleBufferProbe(MEMetricsStageReaderWait, t0, (sb != NULL), sb);
                 if (sb) {
-                    int count = countUp(wself);
+                    int count = countUp(sself, sb);
                     
                     if (showProgress) {
                         if (isToME) { // input
                             dumpTiming(sb, meOutput.mediaType, tag, count);
                         }
                     }
-                    [delegate didReadBuffer:sb from:wself];
-                    result = [meInput appendSampleBuffer:sb];
+                    [delegate didReadBuffer:sb from:sself];
+                    if (scheduler) {
+                        SBChannelStats stats = [sself statsSnapshot];
+                        [scheduler waitForTurnOfChannel:sself pts:stats.lastPTS];
+                        t0 = (isToWriter ? MEMetricsBegin() : 0);
+                        result = [meInput appendSampleBuffer:sb];
+                        endSampleBufferProbe(MEMetricsStageWriterAppend, t0, result, sb);
+                        if (result) {
+                            [scheduler channel:sself didAppendUpTo:stats.lastEndPTS];
+                        }
+                    } else {
+                        t0 = (isToWriter ? MEMetricsBegin() : 0);
+                        result = [meInput appendSampleBuffer:sb];
+                        endSampleBufferProbe(MEMetricsStageWriterAppend, t0, result, sb);
+                    }
                     
                     if (showProgress) {
                         if (isFromME || isPassThru) { // output
@@ -176,7 +265,7 @@ int countUp(SBChannel* self) {
             }
         }
         if (!result) {
-            [wself callCompletionHandlerIfNecessary];
+            [sself callCompletionHandlerIfNecessary];
         }
     }];
 }
@@ -201,18 +290,38 @@ int countUp(SBChannel* self) {
         
         self.finished = TRUE;
         [self.meInput markAsFinished];
+        [self.prefetchQueue cancel];
+        [self.scheduler channelDidFinish:self];
         
         if (self.completionHandler) {
             block = self.completionHandler;
             self.completionHandler = nil;
         }
     }
+    if (self.prefetchQueue) {
+        [self logPrefetchSummary];
+    }
     if (block) {
         // run on the caller's queue (normally self.queue)
         block();
     }
 }
 
+- (void)logPrefetchSummary
+{
+    SBPrefetchStats stats = [self.prefetchQueue stats];
+    NSString* verdict = @"balanced";
+    if (stats.consumerStalls > stats.producerStalls * 2) {
+        verdict = @"decode-bound";
+    } else if (stats.producerStalls > stats.consumerStalls * 2) {
+        verdict = @"consumer-bound";
+    }
+    SecureLogf(@"[SBChannel] track %d prefetch: avg fill %.0f%%, peak %lu frames, "
+               @"decode waits %llu, consumer waits %llu (%@)",
+               self.track, stats.averageFill * 100.0, (unsigned long)stats.peakFrames,
+               stats.consumerStalls, stats.producerStalls, verdict);
+}
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,87 @@
+//
+//  SBChannelScheduler.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header SBChannelScheduler.h
+ * @abstract Internal API - Timestamp-ordered pacing of writer-side SBChannels
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * SBChannelScheduler tracks the last appended PTS of every registered channel.
+ * A channel whose next sample is more than `window` seconds ahead of the slowest
+ * channel is parked on a condition variable until the slowest one catches up,
+ * so AVAssetWriter receives samples in roughly interleaved order and does not
+ * have to refuse the leading track.
+ *
+ * Only channels fed by an encoder (MEOutput) may be registered. A channel fed
+ * by the shared AVAssetReader must keep draining it; parking one stalls the
+ * reader and the encoders behind the slowest channel.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef SBChannelScheduler_h
+#define SBChannelScheduler_h
+
+@import Foundation;
+
+@class SBChannel;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBChannelScheduler : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param window Allowed lead in seconds over the slowest channel
+ @param startTime Session start time in seconds; initial position of every channel
+ */
+- (instancetype)initWithWindow:(double)window startTime:(double)startTime NS_DESIGNATED_INITIALIZER;
++ (instancetype)schedulerWithWindow:(double)window startTime:(double)startTime;
+
+@property (nonatomic, readonly) double window;
+
+/// Register a channel before it starts.
+- (void)registerChannel:(SBChannel*)channel;
+
+/**
+ Block the caller while the channel is too far ahead of the slowest channel.
+ The slowest channel never waits. Returns immediately after -cancel.
+ When no channel advanced for a whole watchdog interval the channel is released
+ and does not park again until another channel advances.
+ */
+- (void)waitForTurnOfChannel:(SBChannel*)channel pts:(double)pts;
+
+/// Advance the channel position and wake parked channels.
+- (void)channel:(SBChannel*)channel didAppendUpTo:(double)endPTS;
+
+/// Remove the channel from pacing and wake parked channels.
+- (void)channelDidFinish:(SBChannel*)channel;
+
+/// Release all parked channels and disable pacing.
+- (void)cancel;
+
+// Statistics; read under the scheduler lock
+@property (nonatomic, readonly) uint64_t parkCount;       // number of times a channel was parked
+@property (nonatomic, readonly) double parkedSeconds;     // total wall clock time spent parked
+@property (nonatomic, readonly) uint64_t watchdogCount;   // parks released without progress
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* SBChannelScheduler_h */
@@ -0,0 +1,204 @@
+//
+//  SBChannelScheduler.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MECommon.h"
+#import "SBChannelScheduler.h"
+#import "SBChannel.h"
+
+// A parked channel is released anyway when no channel made progress for this long.
+// This guards against a writer that needs more lead than the window allows; the
+// channel then keeps going without parking until another channel advances.
+static const NSTimeInterval kWatchdogIntervalInSec = 1.0;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBChannelScheduler () {
+    // guarded by condition
+    uint64_t _parkCount;
+    double _parkedSeconds;
+    uint64_t _watchdogCount;
+}
+
+@property (nonatomic, strong) NSCondition* condition;
+
+// guarded by condition
+@property (nonatomic, strong) NSMapTable<SBChannel*, NSNumber*>* positions; // active channels only
+@property (nonatomic, assign) uint64_t generation;  // bumped on every position change
+@property (nonatomic, strong) NSMapTable<SBChannel*, NSNumber*>* releasedAt; // watchdog release generation
+@property (nonatomic, assign) BOOL cancelled;
+@property (nonatomic, assign) double startTime;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation SBChannelScheduler
+
+- (instancetype)initWithWindow:(double)window startTime:(double)startTime
+{
+    if (self = [super init]) {
+        _window = window;
+        _startTime = startTime;
+        _condition = [NSCondition new];
+        _positions = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory];
+        _releasedAt = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                            valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    return self;
+}
+
++ (instancetype)schedulerWithWindow:(double)window startTime:(double)startTime
+{
+    return [[self alloc] initWithWindow:window startTime:startTime];
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+// Call with condition locked. Returns INFINITY when no other channel is active.
+- (double)minimumPositionExcluding:(SBChannel*)channel
+{
+    double minimum = INFINITY;
+    for (SBChannel* other in self.positions) {
+        if (other == channel) continue;
+        minimum = MIN(minimum, [self.positions objectForKey:other].doubleValue);
+    }
+    return minimum;
+}
+
+// Call with condition locked.
+- (BOOL)mayProceed:(SBChannel*)channel pts:(double)pts
+{
+    NSNumber* own = [self.positions objectForKey:channel];
+    if (!own) return YES;   // not registered or already finished
+    NSNumber* released = [self.releasedAt objectForKey:channel];
+    if (released && released.unsignedLongLongValue == self.generation) return YES; // watchdog still holds
+    double othersMin = [self minimumPositionExcluding:channel];
+    if (own.doubleValue <= othersMin) return YES;   // slowest channel never waits
+    return (pts <= othersMin + self.window);
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+- (void)registerChannel:(SBChannel*)channel
+{
+    [self.condition lock];
+    [self.positions setObject:@(self.startTime) forKey:channel];
+    [self.condition unlock];
+}
+
+- (void)waitForTurnOfChannel:(SBChannel*)channel pts:(double)pts
+{
+    if (isnan(pts)) return;
+
+    NSCondition* condition = self.condition;
+    [condition lock];
+    if (self.cancelled || [self mayProceed:channel pts:pts]) {
+        [condition unlock];
+        return;
+    }
+
+    _parkCount += 1;
+    CFAbsoluteTime parkedAt = CFAbsoluteTimeGetCurrent();
+    while (!self.cancelled && ![self mayProceed:channel pts:pts]) {
+        uint64_t generation = self.generation;
+        NSDate* deadline = [NSDate dateWithTimeIntervalSinceNow:kWatchdogIntervalInSec];
+        BOOL signaled = [condition waitUntilDate:deadline];
+        if (!signaled && generation == self.generation) {
+            // nobody advanced for a whole interval; let this channel feed the writer
+            // until another channel advances, instead of parking it again on every sample
+            _watchdogCount += 1;
+            [self.releasedAt setObject:@(self.generation) forKey:channel];
+            break;
+        }
+    }
+    _parkedSeconds += (CFAbsoluteTimeGetCurrent() - parkedAt);
+    [condition unlock];
+}
+
+- (void)channel:(SBChannel*)channel didAppendUpTo:(double)endPTS
+{
+    if (isnan(endPTS)) return;
+
+    [self.condition lock];
+    NSNumber* own = [self.positions objectForKey:channel];
+    if (own && endPTS > own.doubleValue) {
+        [self.positions setObject:@(endPTS) forKey:channel];
+        // its own progress does not end a watchdog release of the channel
+        NSNumber* released = [self.releasedAt objectForKey:channel];
+        BOOL stillReleased = (released && released.unsignedLongLongValue == self.generation);
+        self.generation += 1;
+        if (stillReleased) {
+            [self.releasedAt setObject:@(self.generation) forKey:channel];
+        }
+        [self.condition broadcast];
+    }
+    [self.condition unlock];
+}
+
+- (void)channelDidFinish:(SBChannel*)channel
+{
+    [self.condition lock];
+    [self.positions removeObjectForKey:channel];
+    [self.releasedAt removeObjectForKey:channel];
+    self.generation += 1;
+    [self.condition broadcast];
+    [self.condition unlock];
+}
+
+- (void)cancel
+{
+    [self.condition lock];
+    self.cancelled = TRUE;
+    [self.condition broadcast];
+    [self.condition unlock];
+}
+
+- (uint64_t)parkCount
+{
+    [self.condition lock];
+    uint64_t value = _parkCount;
+    [self.condition unlock];
+    return value;
+}
+
+- (double)parkedSeconds
+{
+    [self.condition lock];
+    double value = _parkedSeconds;
+    [self.condition unlock];
+    return value;
+}
+
+- (uint64_t)watchdogCount
+{
+    [self.condition lock];
+    uint64_t value = _watchdogCount;
+    [self.condition unlock];
+    return value;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
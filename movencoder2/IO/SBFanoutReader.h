@@ -0,0 +1,157 @@
+//
+//  SBFanoutReader.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header SBFanoutReader.h
+ * @abstract Internal API - One decode pass shared by several time ranges
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * SBSpanSource reads a decompressed AVAssetReaderOutput over a list of disjoint
+ * spans in one pass, using resetForReadingTimeRanges: between them.
+ *
+ * SBFanoutReader pulls sample buffers from a producer on its own queue and hands
+ * each one to every branch whose time range it overlaps. Overlapping branches
+ * share the same (retained) sample buffer. A branch behaves as an SBChannel
+ * producer and keeps up to a fixed number of frames; a full branch stalls the
+ * reader, so the slowest active consumer sets the pace. A branch ends once the
+ * reader has passed its range, or at end of stream.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef SBFanoutReader_h
+#define SBFanoutReader_h
+
+@import Foundation;
+@import AVFoundation;
+
+@class MEOutput;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Sort and merge time ranges (NSValue of CMTimeRange); ranges closer than gap are joined
+NSArray<NSValue*>* SBMergedTimeRanges(NSArray<NSValue*>* ranges, CMTime gap);
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBSpanSource : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param output Reader output with supportsRandomAccess; its reader must not be started yet
+ @param spans Ascending, disjoint time ranges (see SBMergedTimeRanges)
+ */
+- (instancetype)initWithReaderOutput:(AVAssetReaderOutput*)output
+                               spans:(NSArray<NSValue*>*)spans NS_DESIGNATED_INITIALIZER;
++ (instancetype)spanSourceWithReaderOutput:(AVAssetReaderOutput*)output
+                                     spans:(NSArray<NSValue*>*)spans;
+
+/// Set the first span as the reader time range. Call before startReading.
+- (void)prepareReader:(AVAssetReader*)reader;
+
+@property (nonatomic, readonly) AVMediaType mediaType;
+
+/// Returns NULL after the last span.
+- (nullable CMSampleBufferRef)copyNextSampleBuffer CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBFanoutBranch : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, readonly) CMTimeRange timeRange;
+@property (nonatomic, readonly) AVMediaType mediaType;
+
+/// Blocks until a sample buffer is available. Returns NULL once the range is done or on cancel.
+- (nullable CMSampleBufferRef)copyNextSampleBuffer CF_RETURNS_RETAINED;
+
+/// Drop queued frames and ignore the rest; the reader no longer waits for this branch.
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Called on the reader queue just before the first frame of a branch is queued
+/// (or when the stream ends without reaching it).
+typedef void (^SBFanoutBranchHandler)(NSUInteger index, SBFanoutBranch* branch);
+
+@interface SBFanoutReader : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param producer Source of sample buffers in presentation order (SBSpanSource, MEOutput, ...)
+ @param ranges Time range of each branch (NSValue of CMTimeRange), in any order
+ @param maxFrames Frames kept per branch (at least 1)
+ @param label Queue label used for the reader thread
+ */
+- (instancetype)initWithProducer:(MEOutput*)producer
+                          ranges:(NSArray<NSValue*>*)ranges
+                       maxFrames:(NSUInteger)maxFrames
+                           label:(NSString*)label NS_DESIGNATED_INITIALIZER;
++ (instancetype)fanoutReaderWithProducer:(MEOutput*)producer
+                                  ranges:(NSArray<NSValue*>*)ranges
+                               maxFrames:(NSUInteger)maxFrames
+                                   label:(NSString*)label;
+
+/// One branch per range, in the order of ranges
+@property (nonatomic, readonly) NSArray<SBFanoutBranch*>* branches;
+
+/// Set before start
+@property (nonatomic, copy, nullable) SBFanoutBranchHandler branchStartHandler;
+
+/// Start reading on the reader queue. The handler runs there once every branch is finished.
+- (void)startWithCompletionHandler:(dispatch_block_t)handler;
+
+/// Stop reading and cancel every branch.
+- (void)cancel;
+
+/// Sample buffers read from the producer so far
+@property (readonly) uint64_t framesRead;                   // atomic
+/// Sample buffers queued to a branch so far; greater than framesRead when ranges overlap
+@property (readonly) uint64_t framesDelivered;              // atomic
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* SBFanoutReader_h */
@@ -0,0 +1,355 @@
+//
+//  SBFanoutReader.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MECommon.h"
+#import "SBFanoutReader.h"
+#import "MEOutput.h"
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NSArray<NSValue*>* SBMergedTimeRanges(NSArray<NSValue*>* ranges, CMTime gap) {
+    NSMutableArray<NSValue*>* sorted = [NSMutableArray array];
+    for (NSValue* value in ranges) {
+        CMTimeRange range = value.CMTimeRangeValue;
+        if (!CMTIMERANGE_IS_VALID(range) || CMTIMERANGE_IS_EMPTY(range)) continue;
+        [sorted addObject:value];
+    }
+    [sorted sortUsingComparator:^NSComparisonResult(NSValue* a, NSValue* b) {
+        return (NSComparisonResult)CMTimeCompare(a.CMTimeRangeValue.start, b.CMTimeRangeValue.start);
+    }];
+
+    NSMutableArray<NSValue*>* merged = [NSMutableArray array];
+    CMTimeRange current = kCMTimeRangeInvalid;
+    for (NSValue* value in sorted) {
+        CMTimeRange range = value.CMTimeRangeValue;
+        if (CMTIMERANGE_IS_VALID(current) &&
+            CMTIME_COMPARE_INLINE(range.start, <=, CMTimeAdd(CMTimeRangeGetEnd(current), gap))) {
+            current = CMTimeRangeGetUnion(current, range);
+            continue;
+        }
+        if (CMTIMERANGE_IS_VALID(current)) {
+            [merged addObject:[NSValue valueWithCMTimeRange:current]];
+        }
+        current = range;
+    }
+    if (CMTIMERANGE_IS_VALID(current)) {
+        [merged addObject:[NSValue valueWithCMTimeRange:current]];
+    }
+    return merged;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBSpanSource ()
+@property (nonatomic, strong) AVAssetReaderOutput* output;
+@property (nonatomic, strong) NSArray<NSValue*>* spans;
+@property (nonatomic, weak, nullable) AVAssetReader* reader;
+@property (nonatomic, assign) NSUInteger spanIndex;
+@property (nonatomic, assign) BOOL configurationFinal;
+@end
+
+@implementation SBSpanSource
+
+- (instancetype)initWithReaderOutput:(AVAssetReaderOutput*)output spans:(NSArray<NSValue*>*)spans
+{
+    if (self = [super init]) {
+        _output = output;
+        _spans = [spans copy];
+        // required for resetForReadingTimeRanges:
+        output.supportsRandomAccess = (spans.count > 1);
+    }
+    return self;
+}
+
++ (instancetype)spanSourceWithReaderOutput:(AVAssetReaderOutput*)output spans:(NSArray<NSValue*>*)spans
+{
+    return [[self alloc] initWithReaderOutput:output spans:spans];
+}
+
+- (void)prepareReader:(AVAssetReader*)reader
+{
+    self.reader = reader;
+    if (self.spans.count > 0) {
+        reader.timeRange = self.spans.firstObject.CMTimeRangeValue;
+    }
+}
+
+- (AVMediaType)mediaType
+{
+    return self.output.mediaType;
+}
+
+- (nullable CMSampleBufferRef)copyNextSampleBuffer
+{
+    while (TRUE) {
+        CMSampleBufferRef sb = [self.output copyNextSampleBuffer];
+        if (sb) return sb;
+        if (self.configurationFinal) return NULL;
+
+        // end of a span: continue with the next one while the reader is healthy
+        BOOL reading = (self.reader.status == AVAssetReaderStatusReading);
+        if (reading && self.output.supportsRandomAccess && self.spanIndex + 1 < self.spans.count) {
+            self.spanIndex += 1;
+            [self.output resetForReadingTimeRanges:@[self.spans[self.spanIndex]]];
+            continue;
+        }
+        if (reading && self.output.supportsRandomAccess) {
+            [self.output markConfigurationAsFinal];
+        }
+        self.configurationFinal = TRUE;
+        return NULL;
+    }
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBFanoutBranch ()
+@property (nonatomic, strong) NSCondition* condition;       // shared with the reader
+@property (nonatomic, readwrite) CMTimeRange timeRange;
+@property (nonatomic, readwrite) AVMediaType mediaType;
+
+// guarded by condition
+@property (nonatomic, strong) NSMutableArray* buffers;      // CMSampleBufferRef
+@property (nonatomic, assign) BOOL started;
+@property (nonatomic, assign) BOOL finished;
+@property (nonatomic, assign) BOOL cancelled;
+@end
+
+@implementation SBFanoutBranch
+
+- (instancetype)initWithCondition:(NSCondition*)condition timeRange:(CMTimeRange)timeRange mediaType:(AVMediaType)mediaType
+{
+    if (self = [super init]) {
+        _condition = condition;
+        _timeRange = timeRange;
+        _mediaType = mediaType;
+        _buffers = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (nullable CMSampleBufferRef)copyNextSampleBuffer
+{
+    NSCondition* condition = self.condition;
+    CMSampleBufferRef sb = NULL;
+    [condition lock];
+    while (self.buffers.count == 0 && !self.finished && !self.cancelled) {
+        [condition wait];
+    }
+    if (self.buffers.count > 0 && !self.cancelled) {
+        sb = (CMSampleBufferRef)CFBridgingRetain(self.buffers.firstObject);
+        [self.buffers removeObjectAtIndex:0];
+        [condition broadcast];
+    }
+    [condition unlock];
+    return sb;
+}
+
+- (void)cancel
+{
+    [self.condition lock];
+    self.cancelled = TRUE;
+    [self.buffers removeAllObjects];
+    [self.condition broadcast];
+    [self.condition unlock];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBFanoutReader ()
+@property (nonatomic, strong) MEOutput* producer;
+@property (nonatomic, assign) NSUInteger maxFrames;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSCondition* condition;
+@property (nonatomic, readwrite) NSArray<SBFanoutBranch*>* branches;
+
+// guarded by condition
+@property (nonatomic, assign) BOOL started;
+@property (nonatomic, assign) BOOL cancelled;
+
+@property (readwrite) uint64_t framesRead;
+@property (readwrite) uint64_t framesDelivered;
+@end
+
+@implementation SBFanoutReader
+
+- (instancetype)initWithProducer:(MEOutput*)producer
+                          ranges:(NSArray<NSValue*>*)ranges
+                       maxFrames:(NSUInteger)maxFrames
+                           label:(NSString*)label
+{
+    if (self = [super init]) {
+        _producer = producer;
+        _maxFrames = MAX(maxFrames, (NSUInteger)1);
+        _queue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
+        _condition = [NSCondition new];
+        NSMutableArray<SBFanoutBranch*>* branches = [NSMutableArray array];
+        for (NSValue* value in ranges) {
+            [branches addObject:[[SBFanoutBranch alloc] initWithCondition:_condition
+                                                                timeRange:value.CMTimeRangeValue
+                                                                mediaType:producer.mediaType]];
+        }
+        _branches = branches;
+    }
+    return self;
+}
+
++ (instancetype)fanoutReaderWithProducer:(MEOutput*)producer
+                                  ranges:(NSArray<NSValue*>*)ranges
+                               maxFrames:(NSUInteger)maxFrames
+                                   label:(NSString*)label
+{
+    return [[self alloc] initWithProducer:producer ranges:ranges maxFrames:maxFrames label:label];
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+// Call with condition locked. The handler runs unlocked so that it can start a consumer.
+- (void)startBranchLocked:(SBFanoutBranch*)branch
+{
+    if (branch.started) return;
+    branch.started = TRUE;
+    SBFanoutBranchHandler handler = self.branchStartHandler;
+    if (!handler) return;
+    NSUInteger index = [self.branches indexOfObjectIdenticalTo:branch];
+    [self.condition unlock];
+    handler(index, branch);
+    [self.condition lock];
+}
+
+// Call with condition locked.
+- (void)deliverSampleBuffer:(CMSampleBufferRef)sb
+{
+    NSCondition* condition = self.condition;
+    CMTime pts = CMSampleBufferGetPresentationTimeStamp(sb);
+    CMTime dur = CMSampleBufferGetDuration(sb);
+    CMTime frameEnd = CMTIME_IS_NUMERIC(dur) ? CMTimeAdd(pts, dur) : pts;
+
+    for (SBFanoutBranch* branch in self.branches) {
+        if (self.cancelled) break;
+        if (branch.finished || branch.cancelled) continue;
+        CMTimeRange range = branch.timeRange;
+        CMTime end = CMTimeRangeGetEnd(range);
+        if (CMTIME_COMPARE_INLINE(pts, >=, end)) {
+            // presentation order: nothing more for this range
+            [self startBranchLocked:branch];
+            branch.finished = TRUE;
+            [condition broadcast];
+            continue;
+        }
+        BOOL overlaps = (CMTIME_COMPARE_INLINE(frameEnd, >, range.start) ||
+                         CMTIME_COMPARE_INLINE(pts, >=, range.start));
+        if (!overlaps) continue;
+
+        [self startBranchLocked:branch];
+        while (!self.cancelled && !branch.cancelled && branch.buffers.count >= self.maxFrames) {
+            [condition wait];
+        }
+        if (self.cancelled || branch.cancelled) continue;
+        [branch.buffers addObject:(__bridge id)sb];
+        self.framesDelivered += 1;
+        [condition broadcast];
+    }
+}
+
+- (void)readAll
+{
+    NSCondition* condition = self.condition;
+    MEOutput* producer = self.producer;
+    while (TRUE) {
+        [condition lock];
+        BOOL cancelled = self.cancelled;
+        [condition unlock];
+        if (cancelled) break;
+
+        // decode outside of the lock
+        CMSampleBufferRef sb = NULL;
+        @autoreleasepool {
+            sb = [producer copyNextSampleBuffer];
+        }
+        if (!sb) break;
+        self.framesRead += 1;
+
+        [condition lock];
+        [self deliverSampleBuffer:sb];
+        [condition unlock];
+        CFRelease(sb);
+    }
+
+    // end of stream: branches never reached still get their consumer, which sees an empty range
+    [condition lock];
+    for (SBFanoutBranch* branch in self.branches) {
+        if (!self.cancelled) {
+            [self startBranchLocked:branch];
+        }
+        branch.finished = TRUE;
+    }
+    [condition broadcast];
+    [condition unlock];
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+- (void)startWithCompletionHandler:(dispatch_block_t)handler
+{
+    [self.condition lock];
+    BOOL started = self.started;
+    self.started = TRUE;
+    [self.condition unlock];
+    if (started) return;
+
+    __weak typeof(self) wself = self;
+    dispatch_async(self.queue, ^{
+        [wself readAll];
+        handler();
+    });
+}
+
+- (void)cancel
+{
+    [self.condition lock];
+    self.cancelled = TRUE;
+    for (SBFanoutBranch* branch in self.branches) {
+        branch.cancelled = TRUE;
+        [branch.buffers removeAllObjects];
+    }
+    [self.condition broadcast];
+    [self.condition unlock];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
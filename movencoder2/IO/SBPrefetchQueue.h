@@ -0,0 +1,98 @@
+//
+//  SBPrefetchQueue.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header SBPrefetchQueue.h
+ * @abstract Internal API - Bounded read-ahead stage for SBChannel producers
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * SBPrefetchQueue pulls sample buffers from a producer on its own queue and keeps
+ * up to a fixed number of frames (and/or bytes) ready for the consumer, so that
+ * decode in AVAssetReader can overlap with encode in the consumer.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef SBPrefetchQueue_h
+#define SBPrefetchQueue_h
+
+@import Foundation;
+@import AVFoundation;
+
+@class MEOutput;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+/// Payload size used for byte accounting: compressed data size, or pixel buffer size
+size_t SBSampleBufferPayloadSize(CMSampleBufferRef _Nonnull sb);
+
+/// Fill level and stall counters of SBPrefetchQueue
+typedef struct {
+    NSUInteger frames;          // currently queued sample buffers
+    size_t bytes;               // currently queued payload bytes
+    NSUInteger peakFrames;      // high-water mark of queued sample buffers
+    double averageFill;         // average fill ratio seen by the consumer (0.0 .. 1.0)
+    uint64_t producerStalls;    // producer waited for space  -> consumer (encode) is slower
+    uint64_t consumerStalls;    // consumer waited for a frame -> producer (decode) is slower
+} SBPrefetchStats;
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBPrefetchQueue : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param producer Source of sample buffers (MEOutput or AVAssetReaderOutput)
+ @param maxFrames Frame limit (0 = unlimited; at least one of the limits must be non-zero)
+ @param maxBytes Byte limit (0 = unlimited)
+ @param label Queue label used for the prefetch thread
+ */
+- (instancetype)initWithProducer:(MEOutput*)producer
+                       maxFrames:(NSUInteger)maxFrames
+                        maxBytes:(size_t)maxBytes
+                           label:(NSString*)label NS_DESIGNATED_INITIALIZER;
++ (instancetype)prefetchQueueWithProducer:(MEOutput*)producer
+                                maxFrames:(NSUInteger)maxFrames
+                                 maxBytes:(size_t)maxBytes
+                                    label:(NSString*)label;
+
+@property (nonatomic, readonly) NSUInteger maxFrames;
+@property (nonatomic, readonly) size_t maxBytes;
+
+/// Start reading ahead on the prefetch queue.
+- (void)start;
+
+/// Stop reading ahead; wakes any waiting consumer which then sees end of stream.
+- (void)cancel;
+
+/// Blocks until a sample buffer is available. Returns NULL on end of stream or cancel.
+- (nullable CMSampleBufferRef)copyNextSampleBuffer CF_RETURNS_RETAINED;
+
+/// Snapshot of the fill level and stall counters; safe to call from any thread.
+- (SBPrefetchStats)stats;
+
+/// Current fill ratio against the tighter of the two limits (0.0 .. 1.0)
+- (double)fillRatio;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* SBPrefetchQueue_h */
@@ -0,0 +1,242 @@
+//
+//  SBPrefetchQueue.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MECommon.h"
+#import "SBPrefetchQueue.h"
+#import "MEOutput.h"
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+size_t SBSampleBufferPayloadSize(CMSampleBufferRef sb) {
+    size_t size = CMSampleBufferGetTotalSampleSize(sb);
+    if (size == 0) {
+        CVImageBufferRef ib = CMSampleBufferGetImageBuffer(sb);
+        if (ib && CFGetTypeID(ib) == CVPixelBufferGetTypeID()) {
+            size = CVPixelBufferGetDataSize((CVPixelBufferRef)ib);
+        }
+    }
+    return size;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBPrefetchQueue ()
+
+@property (nonatomic, strong) MEOutput* producer;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSCondition* condition;
+
+// guarded by condition
+@property (nonatomic, strong) NSMutableArray* buffers;  // CMSampleBufferRef
+@property (nonatomic, strong) NSMutableArray<NSNumber*>* sizes;
+@property (nonatomic, assign) size_t queuedBytes;
+@property (nonatomic, assign) NSUInteger peakFrames;
+@property (nonatomic, assign) BOOL started;
+@property (nonatomic, assign) BOOL endOfStream;
+@property (nonatomic, assign) BOOL cancelled;
+@property (nonatomic, assign) uint64_t producerStalls;
+@property (nonatomic, assign) uint64_t consumerStalls;
+@property (nonatomic, assign) uint64_t pops;
+@property (nonatomic, assign) double fillSum;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation SBPrefetchQueue
+
+- (instancetype)initWithProducer:(MEOutput*)producer
+                       maxFrames:(NSUInteger)maxFrames
+                        maxBytes:(size_t)maxBytes
+                           label:(NSString*)label
+{
+    if (self = [super init]) {
+        _producer = producer;
+        _maxFrames = maxFrames;
+        _maxBytes = maxBytes;
+        _queue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
+        _condition = [NSCondition new];
+        _buffers = [NSMutableArray array];
+        _sizes = [NSMutableArray array];
+    }
+    return self;
+}
+
++ (instancetype)prefetchQueueWithProducer:(MEOutput*)producer
+                                maxFrames:(NSUInteger)maxFrames
+                                 maxBytes:(size_t)maxBytes
+                                    label:(NSString*)label
+{
+    return [[self alloc] initWithProducer:producer maxFrames:maxFrames maxBytes:maxBytes label:label];
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+// Call with condition locked. Always accept at least one buffer so an oversized frame cannot deadlock.
+- (BOOL)isFull
+{
+    NSUInteger frames = self.buffers.count;
+    if (frames == 0) return NO;
+    if (self.maxFrames > 0 && frames >= self.maxFrames) return YES;
+    if (self.maxBytes > 0 && self.queuedBytes >= self.maxBytes) return YES;
+    return NO;
+}
+
+// Call with condition locked.
+- (double)fillRatioLocked
+{
+    double ratio = 0.0;
+    if (self.maxFrames > 0) {
+        ratio = MAX(ratio, (double)self.buffers.count / (double)self.maxFrames);
+    }
+    if (self.maxBytes > 0) {
+        ratio = MAX(ratio, (double)self.queuedBytes / (double)self.maxBytes);
+    }
+    return MIN(ratio, 1.0);
+}
+
+- (void)readAhead
+{
+    NSCondition* condition = self.condition;
+    MEOutput* producer = self.producer;
+    while (TRUE) {
+        [condition lock];
+        BOOL stalled = NO;
+        while (!self.cancelled && [self isFull]) {
+            if (!stalled) {
+                stalled = YES;
+                self.producerStalls += 1;
+            }
+            [condition wait];
+        }
+        BOOL cancelled = self.cancelled;
+        [condition unlock];
+        if (cancelled) break;
+
+        // decode outside of the lock
+        CMSampleBufferRef sb = NULL;
+        @autoreleasepool {
+            sb = [producer copyNextSampleBuffer];
+        }
+
+        [condition lock];
+        if (sb && !self.cancelled) {
+            size_t size = SBSampleBufferPayloadSize(sb);
+            [self.buffers addObject:(__bridge_transfer id)sb];
+            [self.sizes addObject:@(size)];
+            self.queuedBytes += size;
+            self.peakFrames = MAX(self.peakFrames, self.buffers.count);
+            [condition broadcast];
+            [condition unlock];
+            continue;
+        }
+        if (sb) CFRelease(sb);
+        self.endOfStream = TRUE;
+        [condition broadcast];
+        [condition unlock];
+        break;
+    }
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+- (void)start
+{
+    [self.condition lock];
+    BOOL started = self.started;
+    self.started = TRUE;
+    [self.condition unlock];
+    if (started) return;
+
+    __weak typeof(self) wself = self;
+    dispatch_async(self.queue, ^{
+        [wself readAhead];
+    });
+}
+
+- (void)cancel
+{
+    [self.condition lock];
+    self.cancelled = TRUE;
+    [self.buffers removeAllObjects];
+    [self.sizes removeAllObjects];
+    self.queuedBytes = 0;
+    [self.condition broadcast];
+    [self.condition unlock];
+}
+
+- (nullable CMSampleBufferRef)copyNextSampleBuffer
+{
+    NSCondition* condition = self.condition;
+    CMSampleBufferRef sb = NULL;
+    [condition lock];
+    BOOL stalled = NO;
+    while (self.buffers.count == 0 && !self.endOfStream && !self.cancelled) {
+        if (!stalled) {
+            stalled = YES;
+            self.consumerStalls += 1;
+        }
+        [condition wait];
+    }
+    if (self.buffers.count > 0 && !self.cancelled) {
+        self.fillSum += [self fillRatioLocked];
+        self.pops += 1;
+
+        sb = (CMSampleBufferRef)CFBridgingRetain(self.buffers.firstObject);
+        self.queuedBytes -= self.sizes.firstObject.unsignedLongValue;
+        [self.buffers removeObjectAtIndex:0];
+        [self.sizes removeObjectAtIndex:0];
+        [condition broadcast];
+    }
+    [condition unlock];
+    return sb;
+}
+
+- (SBPrefetchStats)stats
+{
+    SBPrefetchStats stats;
+    [self.condition lock];
+    stats.frames = self.buffers.count;
+    stats.bytes = self.queuedBytes;
+    stats.peakFrames = self.peakFrames;
+    stats.averageFill = (self.pops > 0 ? self.fillSum / (double)self.pops : 0.0);
+    stats.producerStalls = self.producerStalls;
+    stats.consumerStalls = self.consumerStalls;
+    [self.condition unlock];
+    return stats;
+}
+
+- (double)fillRatio
+{
+    [self.condition lock];
+    double ratio = [self fillRatioLocked];
+    [self.condition unlock];
+    return ratio;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
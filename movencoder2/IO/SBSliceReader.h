@@ -0,0 +1,89 @@
+//
+//  SBSliceReader.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header SBSliceReader.h
+ * @abstract Internal API - Concurrent decode of an intra-only track by several readers
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * SBSliceReader cuts the time range into chunks of a few frames and deals them
+ * round robin to K AVAssetReaders: reader i decodes chunks i, i+K, i+2K, ...
+ * (SBSpanSource). Each reader runs ahead on its own SBPrefetchQueue, bounded by
+ * the chunk size in frames and by a byte budget split between the readers, so
+ * the reorder window never holds more than K chunks. copyNextSampleBuffer takes
+ * the chunks back in order, which puts the frames in presentation order again
+ * for a single consumer. A frame that two neighbouring chunks both return is
+ * passed once.
+ *
+ * Only tracks whose samples are all sync samples are worth slicing; with long
+ * GOPs every chunk would decode from its previous key frame.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef SBSliceReader_h
+#define SBSliceReader_h
+
+@import Foundation;
+@import AVFoundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBSliceReader : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/// YES if every sample of the track is a full sync sample (ProRes, DNxHR, ...); reads the whole sample table
++ (BOOL)isIntraOnlyTrack:(AVAssetTrack*)track;
+
+/**
+ @param track Source video track
+ @param outputSettings Decompression settings of AVAssetReaderTrackOutput
+ @param timeRange Range to read
+ @param readers Number of readers (K)
+ @param chunkFrames Frames per chunk, also the read-ahead of each reader
+ @param maxBytes Byte budget of all read-ahead queues together (0 = frames only)
+ */
+- (instancetype)initWithTrack:(AVAssetTrack*)track
+               outputSettings:(nullable NSDictionary<NSString*, id>*)outputSettings
+                    timeRange:(CMTimeRange)timeRange
+                      readers:(NSUInteger)readers
+                  chunkFrames:(NSUInteger)chunkFrames
+                     maxBytes:(size_t)maxBytes NS_DESIGNATED_INITIALIZER;
++ (instancetype)sliceReaderWithTrack:(AVAssetTrack*)track
+                      outputSettings:(nullable NSDictionary<NSString*, id>*)outputSettings
+                           timeRange:(CMTimeRange)timeRange
+                             readers:(NSUInteger)readers
+                         chunkFrames:(NSUInteger)chunkFrames
+                            maxBytes:(size_t)maxBytes;
+
+@property (nonatomic, readonly) NSUInteger readerCount;
+@property (nonatomic, readonly) AVMediaType mediaType;
+
+/// Starts the readers on first use. Returns NULL at the end of the range, on cancel or on failure.
+- (nullable CMSampleBufferRef)copyNextSampleBuffer CF_RETURNS_RETAINED;
+
+/// Stop every reader; a waiting copyNextSampleBuffer returns NULL.
+- (void)cancel;
+
+/// Set when a reader failed
+@property (strong, readonly, nullable) NSError* error;     // atomic
+
+/// Times the merge waited for the reader of the next chunk
+- (uint64_t)mergeStalls;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* SBSliceReader_h */
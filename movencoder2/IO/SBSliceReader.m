@@ -0,0 +1,247 @@
+//
+//  SBSliceReader.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import CoreServices; // paramErr
+
+#import "MECommon.h"
+#import "SBSliceReader.h"
+#import "SBFanoutReader.h"
+#import "SBPrefetchQueue.h"
+#import "MEOutput.h"
+#import "MESecureLogging.h"
+
+static inline NSError* SBSliceReaderError(NSString* reason, NSInteger code) {
+    return [NSError errorWithDomain:@"com.MyCometG3.movencoder2.ErrorDomain"
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey : @"Sliced decode failed.",
+                                      NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SBSliceReader ()
+@property (nonatomic, strong) AVAssetTrack* track;
+@property (nonatomic, copy, nullable) NSDictionary<NSString*, id>* outputSettings;
+@property (nonatomic, assign) NSUInteger chunkFrames;
+@property (nonatomic, assign) size_t maxBytes;
+@property (nonatomic, strong) NSArray<NSValue*>* chunks;
+@property (nonatomic, readwrite) NSUInteger readerCount;
+
+// consumer side only
+@property (nonatomic, strong) NSArray<AVAssetReader*>* readers;
+@property (nonatomic, strong) NSArray<SBPrefetchQueue*>* queues;
+@property (nonatomic, strong) NSMutableArray* pending;      // CMSampleBufferRef or NSNull, per reader
+@property (nonatomic, assign) NSUInteger chunkIndex;
+@property (nonatomic, assign) BOOL started;
+
+@property (strong, readwrite, nullable) NSError* error;
+@property (assign) BOOL cancelled;                          // atomic
+@end
+
+@implementation SBSliceReader
+
++ (BOOL)isIntraOnlyTrack:(AVAssetTrack*)track
+{
+    if (!track.canProvideSampleCursors) return NO;
+    AVSampleCursor* cursor = [track makeSampleCursorAtFirstSampleInDecodeOrder];
+    if (!cursor) return NO;
+    // Every sample: a single non-sync sample late in the track would make its chunk decode wrong
+    do {
+        if (!cursor.currentSampleSyncInfo.sampleIsFullSync) return NO;
+    } while ([cursor stepInDecodeOrderByCount:1] == 1);
+    return YES;
+}
+
+- (instancetype)initWithTrack:(AVAssetTrack*)track
+               outputSettings:(nullable NSDictionary<NSString*, id>*)outputSettings
+                    timeRange:(CMTimeRange)timeRange
+                      readers:(NSUInteger)readers
+                  chunkFrames:(NSUInteger)chunkFrames
+                     maxBytes:(size_t)maxBytes
+{
+    if (self = [super init]) {
+        _track = track;
+        _outputSettings = [outputSettings copy];
+        _chunkFrames = MAX(chunkFrames, (NSUInteger)1);
+        _maxBytes = maxBytes;
+
+        CMTime frameDuration = track.minFrameDuration;
+        if (!CMTIME_IS_NUMERIC(frameDuration) || CMTIME_COMPARE_INLINE(frameDuration, <=, kCMTimeZero)) {
+            float rate = track.nominalFrameRate;
+            frameDuration = CMTimeMakeWithSeconds(1.0 / (rate > 0 ? rate : 30.0), track.naturalTimeScale ?: 600);
+        }
+        CMTime chunkDuration = CMTimeMultiply(frameDuration, (int32_t)_chunkFrames);
+        NSMutableArray<NSValue*>* chunks = [NSMutableArray array];
+        CMTime cursor = timeRange.start;
+        CMTime end = CMTimeRangeGetEnd(timeRange);
+        while (CMTIME_COMPARE_INLINE(cursor, <, end)) {
+            CMTime next = CMTimeMinimum(CMTimeAdd(cursor, chunkDuration), end);
+            [chunks addObject:[NSValue valueWithCMTimeRange:CMTimeRangeFromTimeToTime(cursor, next)]];
+            cursor = next;
+        }
+        _chunks = chunks;
+        _readerCount = MAX(MIN(readers, chunks.count), (NSUInteger)1);
+    }
+    return self;
+}
+
++ (instancetype)sliceReaderWithTrack:(AVAssetTrack*)track
+                      outputSettings:(nullable NSDictionary<NSString*, id>*)outputSettings
+                           timeRange:(CMTimeRange)timeRange
+                             readers:(NSUInteger)readers
+                         chunkFrames:(NSUInteger)chunkFrames
+                            maxBytes:(size_t)maxBytes
+{
+    return [[self alloc] initWithTrack:track outputSettings:outputSettings timeRange:timeRange
+                               readers:readers chunkFrames:chunkFrames maxBytes:maxBytes];
+}
+
+- (void)dealloc
+{
+    [self cancel];
+}
+
+- (AVMediaType)mediaType
+{
+    return self.track.mediaType;
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+- (BOOL)startReaders
+{
+    NSUInteger count = self.readerCount;
+    NSMutableArray<AVAssetReader*>* readers = [NSMutableArray array];
+    NSMutableArray<SBPrefetchQueue*>* queues = [NSMutableArray array];
+    NSMutableArray* pending = [NSMutableArray array];
+    for (NSUInteger r = 0; r < count; r++) {
+        NSMutableArray<NSValue*>* spans = [NSMutableArray array];
+        for (NSUInteger c = r; c < self.chunks.count; c += count) {
+            [spans addObject:self.chunks[c]];
+        }
+        NSError* readerError = nil;
+        AVAssetReader* ar = [AVAssetReader assetReaderWithAsset:self.track.asset error:&readerError];
+        AVAssetReaderTrackOutput* output = [AVAssetReaderTrackOutput assetReaderTrackOutputWithTrack:self.track
+                                                                                      outputSettings:self.outputSettings];
+        output.alwaysCopiesSampleData = NO;
+        SBSpanSource* source = [SBSpanSource spanSourceWithReaderOutput:output spans:spans];
+        if (!ar || ![ar canAddOutput:output]) {
+            self.error = readerError ?: SBSliceReaderError(@"Cannot add a reader output.", paramErr);
+            break;
+        }
+        [ar addOutput:output];
+        [source prepareReader:ar];
+        if (![ar startReading]) {
+            self.error = ar.error ?: SBSliceReaderError(@"Cannot start reading.", paramErr);
+            break;
+        }
+        NSString* label = [NSString stringWithFormat:@"com.movencoder2.SBSliceReader.reader%lu", (unsigned long)r];
+        SBPrefetchQueue* queue = [SBPrefetchQueue prefetchQueueWithProducer:(MEOutput*)source
+                                                                  maxFrames:self.chunkFrames
+                                                                   maxBytes:self.maxBytes / count
+                                                                      label:label];
+        [readers addObject:ar];
+        [queues addObject:queue];
+        [pending addObject:[NSNull null]];
+    }
+    self.readers = readers;
+    self.queues = queues;
+    self.pending = pending;
+    if (self.error) {
+        SecureErrorLogf(@"[SBSliceReader] ERROR: %@", self.error.localizedFailureReason ?: self.error.localizedDescription);
+        [self cancel];
+        return NO;
+    }
+    for (SBPrefetchQueue* queue in queues) {
+        [queue start];
+    }
+    return YES;
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+- (nullable CMSampleBufferRef)copyNextSampleBuffer
+{
+    if (!self.started) {
+        self.started = TRUE;
+        if (![self startReaders]) return NULL;
+    }
+    NSUInteger count = self.readers.count;
+    while (!self.cancelled && self.chunkIndex < self.chunks.count) {
+        NSUInteger r = self.chunkIndex % count;
+        CMSampleBufferRef sb = NULL;
+        if (self.pending[r] != [NSNull null]) {
+            sb = (CMSampleBufferRef)CFBridgingRetain(self.pending[r]);
+            self.pending[r] = [NSNull null];
+        } else {
+            sb = [self.queues[r] copyNextSampleBuffer];
+        }
+        if (!sb) {
+            if (self.readers[r].status == AVAssetReaderStatusFailed) {
+                self.error = self.readers[r].error ?: SBSliceReaderError(@"Reader failed.", paramErr);
+                return NULL;
+            }
+            // nothing left in this chunk (or in any later chunk of this reader)
+            self.chunkIndex += 1;
+            continue;
+        }
+
+        CMTimeRange chunk = self.chunks[self.chunkIndex].CMTimeRangeValue;
+        CMTime pts = CMSampleBufferGetPresentationTimeStamp(sb);
+        BOOL lastChunk = (self.chunkIndex + 1 == self.chunks.count);
+        if (!lastChunk && CMTIME_COMPARE_INLINE(pts, >=, CMTimeRangeGetEnd(chunk))) {
+            // first frame of this reader's next chunk
+            self.pending[r] = (__bridge_transfer id)sb;
+            self.chunkIndex += 1;
+            continue;
+        }
+        if (self.chunkIndex > 0 && CMTIME_COMPARE_INLINE(pts, <, chunk.start)) {
+            // overlaps the boundary; the previous chunk returned it already
+            CFRelease(sb);
+            continue;
+        }
+        return sb;
+    }
+    return NULL;
+}
+
+- (void)cancel
+{
+    self.cancelled = TRUE;
+    for (SBPrefetchQueue* queue in self.queues) {
+        [queue cancel];
+    }
+    for (AVAssetReader* ar in self.readers) {
+        if (ar.status == AVAssetReaderStatusReading) {
+            [ar cancelReading];
+        }
+    }
+}
+
+- (uint64_t)mergeStalls
+{
+    uint64_t stalls = 0;
+    for (SBPrefetchQueue* queue in self.queues) {
+        stalls += [queue stats].consumerStalls;
+    }
+    return stalls;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
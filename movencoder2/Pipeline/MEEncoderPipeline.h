@@ -69,6 +69,23 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic) int logLevel;
 
+/**
+ * Number of encoder threads. 0 keeps the default; an explicit "threads" codec option wins.
+ */
+@property (nonatomic) int threadCount;
+
+/**
+ * Keep parameter sets in the codec extradata (default YES). Set NO for outputs
+ * without a header (Annex-B, MPEG-TS) so they are repeated in the stream.
+ */
+@property (nonatomic) BOOL useGlobalHeader;
+
+/**
+ * Zero-latency encoding: no B-frames, no lookahead and slice threading only, so
+ * each frame is encoded as soon as it is sent (x264/x265 tune=zerolatency).
+ */
+@property (nonatomic) BOOL lowLatency;
+
 /**
  * The time base for timestamp calculations.
  */
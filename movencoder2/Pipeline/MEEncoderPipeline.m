@@ -71,6 +71,7 @@ static inline BOOL uselibx265(MEEncoderPipeline *obj) {
         _isFlushed = NO;
         _verbose = NO;
         _logLevel = AV_LOG_ERROR;
+        _useGlobalHeader = YES;
         _timeBase = 0;
         _configIssuesLogged = NO;
     }
@@ -263,7 +264,10 @@ static inline BOOL uselibx265(MEEncoderPipeline *obj) {
             avctx->chroma_sample_location = frame->chroma_location;
         }
         
-        avctx->flags |= (AV_CODEC_FLAG_GLOBAL_HEADER | AV_CODEC_FLAG_CLOSED_GOP); // Use Closed GOP by default
+        avctx->flags |= AV_CODEC_FLAG_CLOSED_GOP; // Use Closed GOP by default
+        if (self.useGlobalHeader) {
+            avctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
         
         MEVideoEncoderConfig *cfg = self.videoEncoderConfig;
         if (cfg.hasFrameRate) {
@@ -339,6 +343,24 @@ static inline BOOL uselibx265(MEEncoderPipeline *obj) {
                 }
             }
         }
+        
+        // zero latency; overrides bf/tune from codecOptions. Frame threading delays output by a frame per thread.
+        if (self.lowLatency) {
+            avctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+            avctx->thread_type = FF_THREAD_SLICE;
+            ret = av_dict_set(&opts, "bf", "0", 0);
+            if (ret >= 0 && (uselibx264(self) || uselibx265(self))) {
+                // libx264 takes one psy tune plus zerolatency; libx265 takes one tune
+                AVDictionaryEntry* tune = av_dict_get(opts, "tune", NULL, 0);
+                NSString* value = (tune && uselibx264(self) && strcmp(tune->value, "zerolatency") != 0)
+                                ? [NSString stringWithFormat:@"%s,zerolatency", tune->value] : @"zerolatency";
+                ret = av_dict_set(&opts, "tune", value.UTF8String, 0);
+            }
+            if (ret < 0) {
+                SecureErrorLogf(@"[MEEncoderPipeline] ERROR: Cannot apply low latency options.");
+                goto end;
+            }
+        }
     }
     
     char* buf;
@@ -363,6 +385,9 @@ static inline BOOL uselibx265(MEEncoderPipeline *obj) {
             SecureDebugLogf(@"[MEEncoderPipeline][ConfigIssue] %@", msg);
         }
     }
+    if (self.threadCount > 0 && !av_dict_get(opts, "threads", NULL, 0)) {
+        avctx->thread_count = self.threadCount;
+    }
     ret = avcodec_open2(avctx, codec, &opts);
     if (ret < 0) {
         NSString *fferr = [MEErrorFormatter stringFromFFmpegCode:ret];
@@ -62,6 +62,11 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic) int logLevel;
 
+/**
+ * Number of filter graph threads. 0 keeps the libavfilter default.
+ */
+@property (nonatomic) int threadCount;
+
 /**
  * The time base for timestamp calculations.
  */
@@ -91,6 +96,16 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)prepareVideoFilterWith:(CMSampleBufferRef)sampleBuffer;
 
+/**
+ * Prepare the video filter with the provided decoded frame.
+ * Same as -prepareVideoFilterWith: for frames from the libavcodec decoder. The
+ * buffer source takes the frame pixel format as is; timeBase must be set.
+ *
+ * @param frame The AVFrame containing video frame information
+ * @return YES if successful, NO otherwise
+ */
+- (BOOL)prepareVideoFilterWithFrame:(void *)frame;
+
 /**
  * Pull a filtered frame from the filter graph.
  * This method retrieves the next available filtered frame.
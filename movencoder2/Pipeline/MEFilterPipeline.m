@@ -87,9 +87,6 @@ NS_ASSUME_NONNULL_END
 
 - (BOOL)prepareVideoFilterWith:(CMSampleBufferRef)sampleBuffer
 {
-    char *filters_descr = NULL;
-    AVFilterInOut *outputs = NULL;
-    AVFilterInOut *inputs = NULL;
     char args[512] = {0};
 
     if (self.isReady) {
@@ -141,10 +138,61 @@ NS_ASSUME_NONNULL_END
                  width, height, pxl_fmt_filter.ff_id,
                  timebase_q.num, timebase_q.den,
                  sample_aspect_ratio.num, sample_aspect_ratio.den);
-        
-        if (self.verbose) {
-            SecureDebugLogf(@"[MEFilterPipeline] avfilter.buffer = %@", [NSString stringWithUTF8String:args]);
-        }
+    }
+    
+    return [self prepareVideoFilterWithArgs:args];
+    
+end:
+    return NO;
+}
+
+- (BOOL)prepareVideoFilterWithFrame:(void *)frame
+{
+    AVFrame *source = (AVFrame *)frame;
+    char args[512] = {0};
+    
+    if (self.isReady) {
+        return YES;
+    }
+    
+    if (!(self.filterString && self.filterString.length)) {
+        SecureErrorLogf(@"[MEFilterPipeline] ERROR: Invalid video filter parameters.");
+        return NO;
+    }
+    
+    if (source == NULL || source->width <= 0 || source->height <= 0 || source->format == AV_PIX_FMT_NONE) {
+        SecureErrorLogf(@"[MEFilterPipeline] ERROR: Invalid video filter parameters.");
+        return NO;
+    }
+    
+    if (self.timeBase == 0) {
+        SecureErrorLogf(@"[MEFilterPipeline] ERROR: Cannot validate timebase.");
+        return NO;
+    }
+    
+    // Decoded frames may use any libavutil pixel format; the buffer source accepts them all
+    AVRational sample_aspect_ratio = source->sample_aspect_ratio;
+    if (sample_aspect_ratio.num <= 0 || sample_aspect_ratio.den <= 0) {
+        sample_aspect_ratio = av_make_q(1, 1);
+    }
+    snprintf(args, sizeof(args),
+             "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+             source->width, source->height, source->format,
+             1, self.timeBase,
+             sample_aspect_ratio.num, sample_aspect_ratio.den);
+    
+    return [self prepareVideoFilterWithArgs:args];
+}
+
+/// Build and configure the filter graph from the buffer source arguments
+- (BOOL)prepareVideoFilterWithArgs:(const char *)args
+{
+    char *filters_descr = NULL;
+    AVFilterInOut *outputs = NULL;
+    AVFilterInOut *inputs = NULL;
+    
+    if (self.verbose) {
+        SecureDebugLogf(@"[MEFilterPipeline] avfilter.buffer = %@", [NSString stringWithUTF8String:args]);
     }
     
     // Update log_level
@@ -154,6 +202,9 @@ NS_ASSUME_NONNULL_END
     {
         int ret = AVERROR_UNKNOWN;
         filter_graph = avfilter_graph_alloc();
+        if (filter_graph && self.threadCount > 0) {
+            filter_graph->nb_threads = self.threadCount;
+        }
         
         /* buffer video source: the decoded frames from the decoder will be inserted here. */
         const AVFilter *buffersrc = avfilter_get_by_name("buffer");
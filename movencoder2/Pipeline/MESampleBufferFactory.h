@@ -40,6 +40,11 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, strong, nullable) NSMutableDictionary *videoEncoderSetting;
 
+/**
+ * The video filter string; uncompressed output requires it.
+ */
+@property (nonatomic, copy, nullable) NSString *videoFilterString;
+
 /**
  * The time base for timestamp calculations.
  */
@@ -127,9 +127,7 @@ static BOOL MEPacketIsSyncSample(const AVPacket *packet, enum AVCodecID codecId)
 
 - (BOOL)isUsingVideoFilter
 {
-    // This would typically check for videoFilterString != NULL in the original MEManager
-    // For now, we'll assume this is determined by the caller
-    return NO; // Placeholder - would need to be set by the caller
+    return (self.videoFilterString != NULL);
 }
 
 - (BOOL)isUsingVideoEncoder
@@ -0,0 +1,78 @@
+//
+//  MEWorkerEncoderPipeline.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEWorkerEncoderPipeline.h
+ * @abstract Internal API - Video encoder in a child worker process
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * MEWorkerEncoderPipeline runs an MEEncoderPipeline in a child process started
+ * from the same executable, so an encoder crash or assert does not take the
+ * transcoder down. Frames go to the worker through a ring of frame slots in
+ * unlinked shared memory (shm_open + mmap) and packets come back through a ring
+ * of packet slots in the same mapping; a pair of pipes carries the slot messages,
+ * wakes the other side and reports the death of the worker as end of file.
+ *
+ * Packets of the open GOP are held back and the frames sent since its key frame
+ * are kept, up to about one keyint of frames and a share of the memory. When
+ * the worker dies, a new worker is started and those frames are sent again, so
+ * the output continues from the last closed GOP; the dts of the new worker are
+ * shifted by one offset to continue the old ones. x264/x265 are forced to
+ * closed GOPs, since leading pictures of an open GOP would be lost. Low latency
+ * encoding does not hold packets back and cannot be restarted.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEWorkerEncoderPipeline_h
+#define MEWorkerEncoderPipeline_h
+
+@import Foundation;
+
+#import "MEEncoderPipeline.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Command line argument that makes the executable run as an encoder worker
+extern NSString* const kMEEncoderWorkerArgument;
+
+/**
+ * Entry point of the worker process. Reads frames until the parent closes the
+ * command pipe.
+ *
+ * @return Exit status of the worker
+ */
+int MEEncoderWorkerMain(void);
+
+@interface MEWorkerEncoderPipeline : MEEncoderPipeline
+
+/**
+ * Number of times a crashed worker was replaced.
+ */
+@property (atomic, readonly) NSUInteger restartCount;
+
+/**
+ * Process identifier of the running worker, 0 when none is running.
+ */
+@property (atomic, readonly) pid_t workerProcessIdentifier;
+
+/**
+ * Executable started as the worker; nil uses the main bundle executable.
+ * Set before the first frame.
+ */
+@property (nonatomic, copy, nullable) NSString* workerExecutablePath;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEWorkerEncoderPipeline_h */
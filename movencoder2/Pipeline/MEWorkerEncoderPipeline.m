@@ -0,0 +1,1301 @@
+//
+//  MEWorkerEncoderPipeline.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MEWorkerEncoderPipeline.h"
+#import "MECommon.h"
+#import "MEUtils.h"
+#import "MESecureLogging.h"
+#import "MEErrorFormatter.h"
+#import "MEManager.h" // for legacy keys
+#import "Config/MEVideoEncoderConfig.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+NSString* const kMEEncoderWorkerArgument = @"-encoder-worker-process";
+
+/* =================================================================================== */
+// MARK: - Worker protocol
+/* =================================================================================== */
+
+// Shared memory: a header page, kWorkerFrameSlots frame slots, kWorkerPacketSlots packet slots.
+// Each frame slot starts with a MEWorkerFrameHeader page followed by the packed image.
+static const uint32_t kWorkerMagic = 0x4D45574B;            // 'MEWK'
+enum {
+    kWorkerFrameSlots = 4,                                  // frames the parent runs ahead of the worker
+    kWorkerPacketSlots = 8,
+};
+static const size_t kWorkerPageSize = 4096;
+static const size_t kWorkerMinPacketSlotSize = 1 << 20;
+static const int kWorkerImageAlign = 64;
+static const uint32_t kWorkerInlineSlot = UINT32_MAX;       // packet bytes follow the message in the pipe
+static const uint64_t kWorkerMaxPayload = 1ULL << 30;
+
+static const NSUInteger kWorkerReplayMaxFrames = 300;      // open GOP kept for a restart, without a configured keyint
+static const NSUInteger kWorkerReplayReorderFrames = 16;    // keyint plus the frames a key packet can trail its GOP by
+static const uint64_t kWorkerReplayMaxBytes = 2ULL << 30;   // also at most 1/8 of the physical memory
+static const NSUInteger kWorkerMaxRestarts = 3;
+
+// Descriptors inherited by the worker
+static const int kWorkerShmFD = 3;
+static const int kWorkerCmdFD = 4;
+static const int kWorkerEvtFD = 5;
+
+typedef NS_ENUM(uint32_t, MEWorkerMessageType) {
+    MEWorkerMessageConfig = 1,      // parent: binary plist of the encoder settings follows
+    MEWorkerMessageFrame,           // parent: frame in slot
+    MEWorkerMessageFlush,           // parent: no more frames
+    MEWorkerMessagePacketDone,      // parent: packet slot is free again
+    MEWorkerMessageOpened,          // worker: MEWorkerCodecParams and extradata follow
+    MEWorkerMessageFrameDone,       // worker: frame slot is free again
+    MEWorkerMessagePacket,          // worker: packet in slot, or inline
+    MEWorkerMessageEOF,             // worker: encoder is fully flushed
+    MEWorkerMessageError,           // worker: encoder failed with result
+};
+
+typedef struct {
+    uint32_t type;
+    uint32_t slot;
+    uint64_t size;                  // packet or inline payload bytes
+    int64_t pts;
+    int64_t dts;
+    int64_t duration;
+    int32_t flags;
+    int32_t result;
+} MEWorkerMessage;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t frameSlots;
+    uint32_t packetSlots;
+    uint32_t reserved;
+    uint64_t frameSlotSize;
+    uint64_t packetSlotSize;
+} MEWorkerShmHeader;
+
+typedef struct {
+    int32_t format, width, height, flags;
+    int64_t pts, duration;
+    int32_t sarNum, sarDen;
+    int32_t colorRange, colorPrimaries, colorTrc, colorspace, chromaLocation;
+    int32_t pictType;
+    uint64_t dataSize;
+} MEWorkerFrameHeader;
+
+typedef struct {
+    int32_t codecID, width, height, format;
+    int32_t profile, level, fieldOrder;
+    int32_t colorRange, colorPrimaries, colorTrc, colorspace, chromaLocation;
+    int32_t sarNum, sarDen, timeBaseNum, timeBaseDen, frameRateNum, frameRateDen;
+    int64_t bitRate;
+    int32_t extradataSize;
+    int32_t reserved;
+} MEWorkerCodecParams;
+
+static inline size_t roundUpToPage(size_t size) {
+    return (size + kWorkerPageSize - 1) & ~(kWorkerPageSize - 1);
+}
+
+static BOOL writeAll(int fd, const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return NO;
+        p += n;
+        len -= (size_t)n;
+    }
+    return YES;
+}
+
+static BOOL readAll(int fd, void* buf, size_t len) {
+    uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return NO;                              // end of file: the other side is gone
+        p += n;
+        len -= (size_t)n;
+    }
+    return YES;
+}
+
+static BOOL sendMessage(int fd, MEWorkerMessage msg, const void* _Nullable payload) {
+    if (!writeAll(fd, &msg, sizeof(msg))) return NO;
+    return (payload == NULL || msg.size == 0) ? YES : writeAll(fd, payload, (size_t)msg.size);
+}
+
+static NSData* _Nullable readPayload(int fd, uint64_t size) {
+    if (size > kWorkerMaxPayload) return nil;
+    NSMutableData* data = [NSMutableData dataWithLength:(NSUInteger)size];
+    return (size == 0 || readAll(fd, data.mutableBytes, (size_t)size)) ? data : nil;
+}
+
+/* =================================================================================== */
+// MARK: - Encoder settings as property list
+/* =================================================================================== */
+
+// NSValue entries (CMTime, NSSize, NSRect) of the encoder settings are wrapped in one-key dictionaries
+static NSString* const kWorkerCMTimeKey = @"MEWorkerCMTime";
+static NSString* const kWorkerSizeKey = @"MEWorkerNSSize";
+static NSString* const kWorkerRectKey = @"MEWorkerNSRect";
+
+static id _Nullable plistFromSettingValue(id value) {
+    if ([value isKindOfClass:[NSDictionary class]]) {
+        NSMutableDictionary* dict = [NSMutableDictionary dictionary];
+        for (id key in (NSDictionary*)value) {
+            id item = plistFromSettingValue(((NSDictionary*)value)[key]);
+            if (!item) return nil;
+            dict[key] = item;
+        }
+        return dict;
+    }
+    if ([value isKindOfClass:[NSValue class]] && ![value isKindOfClass:[NSNumber class]]) {
+        NSValue* v = value;
+        if (strcmp(v.objCType, @encode(CMTime)) == 0) {
+            return @{kWorkerCMTimeKey: CFBridgingRelease(CMTimeCopyAsDictionary(v.CMTimeValue, kCFAllocatorDefault))};
+        }
+        if (strcmp(v.objCType, @encode(NSSize)) == 0) {
+            return @{kWorkerSizeKey: NSStringFromSize(v.sizeValue)};
+        }
+        if (strcmp(v.objCType, @encode(NSRect)) == 0) {
+            return @{kWorkerRectKey: NSStringFromRect(v.rectValue)};
+        }
+        return nil;
+    }
+    return value;
+}
+
+static id settingValueFromPlist(id value) {
+    if (![value isKindOfClass:[NSDictionary class]]) return value;
+    NSDictionary* dict = value;
+    if (dict.count == 1 && dict[kWorkerCMTimeKey]) {
+        return [NSValue valueWithCMTime:CMTimeMakeFromDictionary((__bridge CFDictionaryRef)dict[kWorkerCMTimeKey])];
+    }
+    if (dict.count == 1 && dict[kWorkerSizeKey]) {
+        return [NSValue valueWithSize:NSSizeFromString(dict[kWorkerSizeKey])];
+    }
+    if (dict.count == 1 && dict[kWorkerRectKey]) {
+        return [NSValue valueWithRect:NSRectFromString(dict[kWorkerRectKey])];
+    }
+    NSMutableDictionary* result = [NSMutableDictionary dictionary];
+    for (id key in dict) {
+        result[key] = settingValueFromPlist(dict[key]);
+    }
+    return result;
+}
+
+/* =================================================================================== */
+// MARK: - GOP structure
+/* =================================================================================== */
+
+/// keyint of the x264/x265 params, or g of the codec options; 0 when not set
+static NSUInteger configuredKeyint(MEVideoEncoderConfig* _Nullable cfg) {
+    NSString* params = (cfg.codecKind == MEVideoCodecKindX265) ? cfg.x265Params : cfg.x264Params;
+    for (NSString* item in [params componentsSeparatedByString:@":"]) {
+        NSArray<NSString*>* pair = [item componentsSeparatedByString:@"="];
+        if (pair.count == 2 && [pair[0] isEqualToString:@"keyint"]) {
+            return (NSUInteger)MAX(pair[1].integerValue, 0);   // "infinite" is 0
+        }
+    }
+    NSString* gop = cfg.codecOptions[@"g"];
+    return (NSUInteger)MAX(gop.integerValue, 0);
+}
+
+/// A restart resumes at the last key packet, so no frame after it in decode order may be shown
+/// before it. MEEncoderPipeline sets AV_CODEC_FLAG_CLOSED_GOP, but libx265 defaults to open GOP
+/// and the x264/x265 params can turn it on again; open-gop=0 goes last.
+static NSDictionary* closedGOPSetting(NSDictionary* setting, MEVideoEncoderConfig* _Nullable cfg) {
+    NSString* key = nil;
+    NSString* params = nil;
+    if (cfg.codecKind == MEVideoCodecKindX264) {
+        key = kMEVEx264_paramsKey;
+        params = cfg.x264Params;
+    } else if (cfg.codecKind == MEVideoCodecKindX265) {
+        key = kMEVEx265_paramsKey;
+        params = cfg.x265Params;
+    }
+    if (!key) return setting;
+    NSMutableDictionary* result = [setting mutableCopy];
+    result[key] = params.length ? [params stringByAppendingString:@":open-gop=0"] : @"open-gop=0";
+    return result;
+}
+
+/* =================================================================================== */
+// MARK: - Worker process
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEEncoderWorker : NSObject
+{
+    uint8_t* shm;
+    size_t shmSize;
+    MEWorkerShmHeader header;
+    BOOL packetSlotBusy[kWorkerPacketSlots];
+    uint32_t released[kWorkerFrameSlots];
+    NSUInteger releasedCount;
+}
+@property (nonatomic, strong, nullable) MEEncoderPipeline* pipeline;
+@property (nonatomic, strong) NSMutableArray<NSData*>* backlog;     // commands read while waiting for a packet slot
+- (void)releaseFrameSlotWithData:(uint8_t*)data;
+@end
+
+static void releaseFrameSlot(void* opaque, uint8_t* data) {
+    [(__bridge MEEncoderWorker*)opaque releaseFrameSlotWithData:data];
+}
+
+@implementation MEEncoderWorker
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _backlog = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (shm) {
+        munmap(shm, shmSize);
+    }
+}
+
+- (uint8_t*)frameSlot:(uint32_t)slot
+{
+    return shm + kWorkerPageSize + (size_t)slot * header.frameSlotSize;
+}
+
+- (uint8_t*)packetSlot:(uint32_t)slot
+{
+    return shm + kWorkerPageSize + (size_t)header.frameSlots * header.frameSlotSize + (size_t)slot * header.packetSlotSize;
+}
+
+- (BOOL)mapSharedMemory
+{
+    struct stat st;
+    if (fstat(kWorkerShmFD, &st) != 0 || (size_t)st.st_size < kWorkerPageSize) return NO;
+    shmSize = (size_t)st.st_size;
+    void* addr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, kWorkerShmFD, 0);
+    if (addr == MAP_FAILED) return NO;
+    shm = addr;
+    memcpy(&header, shm, sizeof(header));
+    size_t needed = kWorkerPageSize + (size_t)header.frameSlots * header.frameSlotSize
+                  + (size_t)header.packetSlots * header.packetSlotSize;
+    return (header.magic == kWorkerMagic &&
+            header.frameSlots <= kWorkerFrameSlots && header.packetSlots <= kWorkerPacketSlots &&
+            header.frameSlotSize > kWorkerPageSize && needed <= shmSize);
+}
+
+- (BOOL)applyConfig:(NSData*)data
+{
+    NSDictionary* config = [NSPropertyListSerialization propertyListWithData:data options:0 format:NULL error:NULL];
+    if (![config isKindOfClass:[NSDictionary class]]) return NO;
+    MEEncoderPipeline* pipeline = [[MEEncoderPipeline alloc] init];
+    pipeline.videoEncoderSetting = [settingValueFromPlist(config[@"setting"]) mutableCopy];
+    pipeline.timeBase = [config[@"timeBase"] intValue];
+    pipeline.threadCount = [config[@"threadCount"] intValue];
+    pipeline.lowLatency = [config[@"lowLatency"] boolValue];
+    pipeline.useGlobalHeader = [config[@"useGlobalHeader"] boolValue];
+    pipeline.logLevel = [config[@"logLevel"] intValue];
+    pipeline.verbose = [config[@"verbose"] boolValue];
+    NSDictionary* extensions = config[@"sourceExtensions"];
+    if ([extensions isKindOfClass:[NSDictionary class]]) {
+        pipeline.sourceExtensions = (__bridge CFDictionaryRef)extensions;
+    }
+    self.pipeline = pipeline;
+    return YES;
+}
+
+- (void)releaseFrameSlotWithData:(uint8_t*)data
+{
+    uint32_t slot = (uint32_t)((data - kWorkerPageSize - [self frameSlot:0]) / header.frameSlotSize);
+    if (releasedCount < kWorkerFrameSlots) {
+        released[releasedCount++] = slot;
+    }
+}
+
+- (BOOL)sendReleasedSlots
+{
+    for (NSUInteger i = 0; i < releasedCount; i++) {
+        MEWorkerMessage msg = {.type = MEWorkerMessageFrameDone, .slot = released[i]};
+        if (!sendMessage(kWorkerEvtFD, msg, NULL)) return NO;
+    }
+    releasedCount = 0;
+    return YES;
+}
+
+- (BOOL)sendError:(int)result
+{
+    SecureErrorLogf(@"[MEEncoderWorker] ERROR: %@", [MEErrorFormatter stringFromFFmpegCode:result]);
+    MEWorkerMessage msg = {.type = MEWorkerMessageError, .result = (result < 0 ? result : AVERROR_EXTERNAL)};
+    sendMessage(kWorkerEvtFD, msg, NULL);
+    return NO;
+}
+
+- (BOOL)nextCommand:(MEWorkerMessage*)msg
+{
+    if (self.backlog.count > 0) {
+        memcpy(msg, self.backlog.firstObject.bytes, sizeof(*msg));
+        [self.backlog removeObjectAtIndex:0];
+        return YES;
+    }
+    return readAll(kWorkerCmdFD, msg, sizeof(*msg));
+}
+
+/// Free packet slot; reads the commands ahead while the parent holds every slot
+- (NSInteger)waitForPacketSlot
+{
+    while (TRUE) {
+        for (uint32_t slot = 0; slot < header.packetSlots; slot++) {
+            if (!packetSlotBusy[slot]) return slot;
+        }
+        MEWorkerMessage msg;
+        if (!readAll(kWorkerCmdFD, &msg, sizeof(msg))) return -1;
+        if (msg.type == MEWorkerMessagePacketDone && msg.slot < header.packetSlots) {
+            packetSlotBusy[msg.slot] = NO;
+        } else {
+            [self.backlog addObject:[NSData dataWithBytes:&msg length:sizeof(msg)]];
+        }
+    }
+}
+
+- (BOOL)sendPacket:(AVPacket*)pkt
+{
+    MEWorkerMessage msg = {.type = MEWorkerMessagePacket, .size = (uint64_t)pkt->size,
+                           .pts = pkt->pts, .dts = pkt->dts, .duration = pkt->duration, .flags = pkt->flags};
+    if ((uint64_t)pkt->size > header.packetSlotSize) {
+        msg.slot = kWorkerInlineSlot;
+        return sendMessage(kWorkerEvtFD, msg, pkt->data);
+    }
+    NSInteger slot = [self waitForPacketSlot];
+    if (slot < 0) return NO;
+    memcpy([self packetSlot:(uint32_t)slot], pkt->data, (size_t)pkt->size);
+    packetSlotBusy[slot] = YES;
+    msg.slot = (uint32_t)slot;
+    return sendMessage(kWorkerEvtFD, msg, NULL);
+}
+
+- (BOOL)sendOpened
+{
+    AVCodecContext* avctx = (AVCodecContext*)[self.pipeline codecContext];
+    MEWorkerCodecParams params = {
+        .codecID = avctx->codec_id, .width = avctx->width, .height = avctx->height, .format = avctx->pix_fmt,
+        .profile = avctx->profile, .level = avctx->level, .fieldOrder = avctx->field_order,
+        .colorRange = avctx->color_range, .colorPrimaries = avctx->color_primaries,
+        .colorTrc = avctx->color_trc, .colorspace = avctx->colorspace,
+        .chromaLocation = avctx->chroma_sample_location,
+        .sarNum = avctx->sample_aspect_ratio.num, .sarDen = avctx->sample_aspect_ratio.den,
+        .timeBaseNum = avctx->time_base.num, .timeBaseDen = avctx->time_base.den,
+        .frameRateNum = avctx->framerate.num, .frameRateDen = avctx->framerate.den,
+        .bitRate = avctx->bit_rate, .extradataSize = MAX(avctx->extradata_size, 0),
+    };
+    NSMutableData* payload = [NSMutableData dataWithBytes:&params length:sizeof(params)];
+    if (params.extradataSize > 0) {
+        [payload appendBytes:avctx->extradata length:(NSUInteger)params.extradataSize];
+    }
+    MEWorkerMessage msg = {.type = MEWorkerMessageOpened, .size = payload.length};
+    return sendMessage(kWorkerEvtFD, msg, payload.bytes);
+}
+
+/// 0 when the encoder wants more input, AVERROR_EOF when flushed out, or an error
+- (int)drainPackets
+{
+    int ret = 0;
+    while ([self.pipeline receivePacketFromEncoderWithResult:&ret] && ret == 0) {
+        if (![self sendPacket:(AVPacket*)[self.pipeline encodedPacket]]) return AVERROR(EPIPE);
+    }
+    return (ret == AVERROR(EAGAIN)) ? 0 : ret;
+}
+
+- (BOOL)encodeFrameInSlot:(uint32_t)slot
+{
+    if (slot >= header.frameSlots) return [self sendError:AVERROR(EINVAL)];
+    uint8_t* base = [self frameSlot:slot];
+    const MEWorkerFrameHeader* fh = (const MEWorkerFrameHeader*)base;
+    uint8_t* data = base + kWorkerPageSize;
+    if (fh->dataSize > header.frameSlotSize - kWorkerPageSize) return [self sendError:AVERROR(EINVAL)];
+
+    // Wrap the slot; it is handed back when the encoder releases the frame
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) return [self sendError:AVERROR(ENOMEM)];
+    frame->format = fh->format;
+    frame->width = fh->width;
+    frame->height = fh->height;
+    frame->flags = fh->flags;
+    frame->pts = fh->pts;
+    frame->duration = fh->duration;
+    frame->sample_aspect_ratio = av_make_q(fh->sarNum, fh->sarDen);
+    frame->color_range = fh->colorRange;
+    frame->color_primaries = fh->colorPrimaries;
+    frame->color_trc = fh->colorTrc;
+    frame->colorspace = fh->colorspace;
+    frame->chroma_location = fh->chromaLocation;
+    frame->pict_type = fh->pictType;
+    frame->time_base = av_make_q(1, self.pipeline.timeBase);
+    frame->buf[0] = av_buffer_create(data, (size_t)fh->dataSize, releaseFrameSlot, (__bridge void*)self, 0);
+    int ret = frame->buf[0] ? av_image_fill_arrays(frame->data, frame->linesize, data, fh->format,
+                                                   fh->width, fh->height, kWorkerImageAlign)
+                            : AVERROR(ENOMEM);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return [self sendError:ret];
+    }
+
+    if (!self.pipeline.isReady) {
+        if (![self.pipeline prepareVideoEncoderWith:NULL filteredFrame:frame hasValidFilteredFrame:YES]) {
+            av_frame_free(&frame);
+            return [self sendError:AVERROR_EXTERNAL];
+        }
+        if (![self sendOpened]) {
+            av_frame_free(&frame);
+            return NO;
+        }
+    }
+
+    while (TRUE) {
+        if (![self.pipeline sendFrameToEncoder:frame withResult:&ret]) break;
+        if (ret != AVERROR(EAGAIN)) break;
+        ret = [self drainPackets];                          // encoder is full: make room
+        if (ret < 0) break;
+    }
+    av_frame_free(&frame);
+    if (ret < 0 && ret != AVERROR_EOF) return [self sendError:ret];
+    ret = [self drainPackets];
+    return (ret < 0 && ret != AVERROR_EOF) ? [self sendError:ret] : YES;
+}
+
+- (BOOL)flush
+{
+    if (self.pipeline.isReady) {
+        int ret = 0;
+        if (![self.pipeline flushEncoderWithResult:&ret]) return [self sendError:ret];
+        ret = [self drainPackets];
+        if (ret != AVERROR_EOF) return [self sendError:(ret < 0 ? ret : AVERROR_BUG)];
+    }
+    MEWorkerMessage msg = {.type = MEWorkerMessageEOF};
+    return sendMessage(kWorkerEvtFD, msg, NULL);
+}
+
+- (int)run
+{
+    fcntl(kWorkerEvtFD, F_SETNOSIGPIPE, 1);
+    if (![self mapSharedMemory]) {
+        SecureErrorLogf(@"[MEEncoderWorker] ERROR: Cannot map the frame slots.");
+        return EXIT_FAILURE;
+    }
+    MEWorkerMessage msg;
+    if (!readAll(kWorkerCmdFD, &msg, sizeof(msg)) || msg.type != MEWorkerMessageConfig) {
+        return EXIT_FAILURE;
+    }
+    NSData* config = readPayload(kWorkerCmdFD, msg.size);
+    if (!config || ![self applyConfig:config]) {
+        [self sendError:AVERROR(EINVAL)];
+        return EXIT_FAILURE;
+    }
+
+    BOOL ok = YES;
+    while (ok && [self nextCommand:&msg]) {
+        @autoreleasepool {
+            switch (msg.type) {
+                case MEWorkerMessageFrame:
+                    ok = [self encodeFrameInSlot:msg.slot];
+                    break;
+                case MEWorkerMessageFlush:
+                    ok = [self flush];
+                    break;
+                case MEWorkerMessagePacketDone:
+                    if (msg.slot < header.packetSlots) {
+                        packetSlotBusy[msg.slot] = NO;
+                    }
+                    break;
+                default:
+                    ok = [self sendError:AVERROR(EINVAL)];
+                    break;
+            }
+            ok = ok && [self sendReleasedSlots];
+        }
+    }
+    [self.pipeline cleanup];                                // frames still held by the encoder come back here
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;                // end of the command pipe: the parent is done
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+int MEEncoderWorkerMain(void)
+{
+    @autoreleasepool {
+        MEEncoderWorker* worker = [[MEEncoderWorker alloc] init];
+        return [worker run];
+    }
+}
+
+/* =================================================================================== */
+// MARK: - Parent side
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+// setters are synthesized by MEEncoderPipeline
+@interface MEEncoderPipeline ()
+@property (atomic, readwrite) BOOL isReady;
+@property (atomic, readwrite) BOOL isEOF;
+@property (atomic, readwrite) BOOL isFlushed;
+@end
+
+@interface MEWorkerEncoderPipeline ()
+{
+    pid_t workerPID;
+    int shmFD;
+    int cmdFD;
+    int evtFD;
+    uint8_t* shm;
+    size_t shmSize;
+    MEWorkerShmHeader header;
+    BOOL frameSlotBusy[kWorkerFrameSlots];
+    AVCodecContext* remoteContext;                          // parameters of the encoder in the worker
+    AVPacket* current;                                      // packet handed out by encodedPacket
+    int64_t lastDTS;                                        // of the last committed packet
+    int64_t resumeDTS;                                      // dts of the open GOP's key packet when the worker died
+    int64_t dtsOffset;                                      // added to the dts of the current worker's packets
+    BOOL rebasePending;                                     // dtsOffset is taken from the next packet
+    int64_t openKeyPTS;                                     // key packet of the open GOP
+    uint64_t replayBytes;
+    uint64_t replayByteLimit;
+    NSUInteger replayFrameLimit;
+}
+@property (atomic, readwrite) NSUInteger restartCount;
+@property (atomic, readwrite) pid_t workerProcessIdentifier;
+@property (nonatomic, strong) NSMutableArray<NSValue*>* replayFrames;   // AVFrame* sent since the open GOP began
+@property (nonatomic, strong) NSMutableArray<NSValue*>* heldPackets;    // AVPacket* of the open GOP
+@property (nonatomic, strong) NSMutableArray<NSValue*>* readyPackets;   // AVPacket* of closed GOPs
+@property (nonatomic, assign) BOOL replayValid;
+@property (nonatomic, copy, nullable) NSString* replayInvalidReason;   // why a restart cannot recover this GOP
+@property (nonatomic, assign) BOOL flushSent;
+@property (nonatomic, assign) BOOL workerEOF;
+@property (nonatomic, assign) int workerError;
+@end
+
+@implementation MEWorkerEncoderPipeline
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        workerPID = 0;
+        shmFD = cmdFD = evtFD = -1;
+        lastDTS = AV_NOPTS_VALUE;
+        resumeDTS = AV_NOPTS_VALUE;
+        openKeyPTS = AV_NOPTS_VALUE;
+        replayFrameLimit = kWorkerReplayMaxFrames;
+        replayByteLimit = kWorkerReplayMaxBytes;
+        _replayFrames = [NSMutableArray array];
+        _heldPackets = [NSMutableArray array];
+        _readyPackets = [NSMutableArray array];
+        _replayValid = YES;
+    }
+    return self;
+}
+
+- (void)cleanup
+{
+    [self me_reapWorker];
+    if (shm) {
+        munmap(shm, shmSize);
+        shm = NULL;
+    }
+    if (shmFD >= 0) {
+        close(shmFD);
+        shmFD = -1;
+    }
+    [self me_dropReplayFramesBefore:INT64_MAX];
+    [self me_discardPackets:self.heldPackets];
+    [self me_discardPackets:self.readyPackets];
+    av_packet_free(&current);
+    avcodec_free_context(&remoteContext);
+    [super cleanup];
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+- (uint8_t*)me_frameSlot:(NSUInteger)slot
+{
+    return shm + kWorkerPageSize + slot * header.frameSlotSize;
+}
+
+- (uint8_t*)me_packetSlot:(NSUInteger)slot
+{
+    return shm + kWorkerPageSize + header.frameSlots * header.frameSlotSize + slot * header.packetSlotSize;
+}
+
+- (void)me_discardPackets:(NSMutableArray<NSValue*>*)packets
+{
+    for (NSValue* value in packets) {
+        AVPacket* pkt = value.pointerValue;
+        av_packet_free(&pkt);
+    }
+    [packets removeAllObjects];
+}
+
+- (nullable NSData*)me_configData
+{
+    NSMutableDictionary* config = [NSMutableDictionary dictionary];
+    NSDictionary* setting = self.videoEncoderSetting ?: @{};
+    if (!self.lowLatency) {
+        setting = closedGOPSetting(setting, self.videoEncoderConfig);
+    }
+    config[@"setting"] = plistFromSettingValue(setting);
+    config[@"timeBase"] = @(self.timeBase);
+    config[@"threadCount"] = @(self.threadCount);
+    config[@"lowLatency"] = @(self.lowLatency);
+    config[@"useGlobalHeader"] = @(self.useGlobalHeader);
+    config[@"logLevel"] = @(self.logLevel);
+    config[@"verbose"] = @(self.verbose);
+    if (!config[@"setting"]) return nil;
+    if (self.sourceExtensions) {
+        config[@"sourceExtensions"] = (__bridge NSDictionary*)self.sourceExtensions;
+    }
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:config
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0 error:NULL];
+    if (!data && config[@"sourceExtensions"]) {
+        // the worker reads color tags from the frames as well
+        [config removeObjectForKey:@"sourceExtensions"];
+        data = [NSPropertyListSerialization dataWithPropertyList:config
+                                                          format:NSPropertyListBinaryFormat_v1_0
+                                                         options:0 error:NULL];
+    }
+    return data;
+}
+
+/// Unlinked shared memory sized for the first frame; it outlives every worker of this pipeline
+- (BOOL)me_createSharedMemoryForFrame:(AVFrame*)frame
+{
+    int imageSize = av_image_get_buffer_size(frame->format, frame->width, frame->height, kWorkerImageAlign);
+    if (imageSize <= 0) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Unsupported frame format for the encoder worker.");
+        return NO;
+    }
+    header = (MEWorkerShmHeader){
+        .magic = kWorkerMagic,
+        .frameSlots = (uint32_t)kWorkerFrameSlots,
+        .packetSlots = (uint32_t)kWorkerPacketSlots,
+        .frameSlotSize = kWorkerPageSize + roundUpToPage((size_t)imageSize),
+        .packetSlotSize = MAX(kWorkerMinPacketSlotSize, roundUpToPage((size_t)imageSize / 4)),
+    };
+    shmSize = kWorkerPageSize + header.frameSlots * header.frameSlotSize + header.packetSlots * header.packetSlotSize;
+
+    NSString* name = [NSString stringWithFormat:@"/me2w.%d.%08x", getpid(), arc4random()];
+    shmFD = shm_open(name.UTF8String, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (shmFD < 0) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: shm_open() failed (%d).", errno);
+        return NO;
+    }
+    shm_unlink(name.UTF8String);                            // reachable through the descriptor only
+    fcntl(shmFD, F_SETFD, FD_CLOEXEC);
+    void* addr = MAP_FAILED;
+    if (ftruncate(shmFD, (off_t)shmSize) == 0) {
+        addr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFD, 0);
+    }
+    if (addr == MAP_FAILED) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Cannot map %zu bytes of frame slots (%d).", shmSize, errno);
+        close(shmFD);
+        shmFD = -1;
+        return NO;
+    }
+    shm = addr;
+    memcpy(shm, &header, sizeof(header));
+    return YES;
+}
+
+- (BOOL)me_spawnWorker
+{
+    int cmd[2] = {-1, -1}, evt[2] = {-1, -1};
+    if (pipe(cmd) != 0 || pipe(evt) != 0) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: pipe() failed (%d).", errno);
+        for (int i = 0; i < 2; i++) {
+            if (cmd[i] >= 0) close(cmd[i]);
+            if (evt[i] >= 0) close(evt[i]);
+        }
+        return NO;
+    }
+    // Move the child ends above the target descriptors so that the dup2 actions cannot collide
+    int childShm = fcntl(shmFD, F_DUPFD_CLOEXEC, 10);
+    int childCmd = fcntl(cmd[0], F_DUPFD_CLOEXEC, 10);
+    int childEvt = fcntl(evt[1], F_DUPFD_CLOEXEC, 10);
+    close(cmd[0]);
+    close(evt[1]);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addinherit_np(&actions, STDIN_FILENO);
+    posix_spawn_file_actions_addinherit_np(&actions, STDOUT_FILENO);
+    posix_spawn_file_actions_addinherit_np(&actions, STDERR_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, childShm, kWorkerShmFD);
+    posix_spawn_file_actions_adddup2(&actions, childCmd, kWorkerCmdFD);
+    posix_spawn_file_actions_adddup2(&actions, childEvt, kWorkerEvtFD);
+
+    // Own process group: Ctrl-C goes to the transcoder, which cancels and closes the pipes
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_CLOEXEC_DEFAULT | POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    NSString* executable = self.workerExecutablePath ?: [NSBundle mainBundle].executablePath;
+    const char* path = executable.fileSystemRepresentation;
+    char* const argv[] = {(char*)path, (char*)kMEEncoderWorkerArgument.UTF8String, NULL};
+    pid_t pid = 0;
+    int err = (childShm >= 0 && childCmd >= 0 && childEvt >= 0)
+            ? posix_spawn(&pid, path, &actions, &attr, argv, environ) : errno;
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (childShm >= 0) close(childShm);
+    if (childCmd >= 0) close(childCmd);
+    if (childEvt >= 0) close(childEvt);
+
+    cmdFD = cmd[1];
+    evtFD = evt[0];
+    fcntl(cmdFD, F_SETFD, FD_CLOEXEC);
+    fcntl(evtFD, F_SETFD, FD_CLOEXEC);
+    fcntl(cmdFD, F_SETNOSIGPIPE, 1);                        // a dead worker is EPIPE, not SIGPIPE
+    if (err != 0) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Cannot start the encoder worker (%d).", err);
+        [self me_reapWorker];
+        return NO;
+    }
+    workerPID = pid;
+    self.workerProcessIdentifier = pid;
+    memset(frameSlotBusy, 0, sizeof(frameSlotBusy));
+    if (self.verbose) {
+        SecureDebugLogf(@"[MEWorkerEncoderPipeline] Encoder worker %d started", pid);
+    }
+
+    NSData* config = [self me_configData];
+    if (!config) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Cannot serialize the encoder settings.");
+        self.workerError = AVERROR(EINVAL);
+        return NO;
+    }
+    MEWorkerMessage msg = {.type = MEWorkerMessageConfig, .size = config.length};
+    return sendMessage(cmdFD, msg, config.bytes);
+}
+
+/// Close the pipes and wait for the worker. Returns its wait status.
+- (int)me_reapWorker
+{
+    if (cmdFD >= 0) {
+        close(cmdFD);                                       // the worker exits at the end of the command pipe
+        cmdFD = -1;
+    }
+    if (evtFD >= 0) {
+        close(evtFD);
+        evtFD = -1;
+    }
+    int status = 0;
+    if (workerPID > 0) {
+        pid_t result = 0;
+        for (int i = 0; i < 100 && (result = waitpid(workerPID, &status, WNOHANG)) == 0; i++) {
+            usleep(10 * 1000);
+        }
+        if (result == 0) {
+            kill(workerPID, SIGKILL);
+            waitpid(workerPID, &status, 0);
+        }
+        workerPID = 0;
+        self.workerProcessIdentifier = 0;
+    }
+    return status;
+}
+
+- (NSInteger)me_freeFrameSlot
+{
+    for (NSUInteger slot = 0; slot < header.frameSlots; slot++) {
+        if (!frameSlotBusy[slot]) return (NSInteger)slot;
+    }
+    return -1;
+}
+
+- (BOOL)me_writeFrame:(AVFrame*)frame toSlot:(NSInteger)slot
+{
+    uint8_t* base = [self me_frameSlot:(NSUInteger)slot];
+    int size = av_image_get_buffer_size(frame->format, frame->width, frame->height, kWorkerImageAlign);
+    if (size <= 0 || (uint64_t)size > header.frameSlotSize - kWorkerPageSize) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: The frame does not fit the frame slot.");
+        self.workerError = AVERROR(EINVAL);
+        return NO;
+    }
+    int ret = av_image_copy_to_buffer(base + kWorkerPageSize, size, (const uint8_t* const*)frame->data, frame->linesize,
+                                      frame->format, frame->width, frame->height, kWorkerImageAlign);
+    if (ret < 0) {
+        self.workerError = ret;
+        return NO;
+    }
+    MEWorkerFrameHeader* fh = (MEWorkerFrameHeader*)base;
+    *fh = (MEWorkerFrameHeader){
+        .format = frame->format, .width = frame->width, .height = frame->height, .flags = frame->flags,
+        .pts = frame->pts, .duration = frame->duration,
+        .sarNum = frame->sample_aspect_ratio.num, .sarDen = frame->sample_aspect_ratio.den,
+        .colorRange = frame->color_range, .colorPrimaries = frame->color_primaries,
+        .colorTrc = frame->color_trc, .colorspace = frame->colorspace,
+        .chromaLocation = frame->chroma_location, .pictType = frame->pict_type,
+        .dataSize = (uint64_t)size,
+    };
+    frameSlotBusy[slot] = YES;
+    MEWorkerMessage msg = {.type = MEWorkerMessageFrame, .slot = (uint32_t)slot};
+    return sendMessage(cmdFD, msg, NULL);
+}
+
+- (BOOL)me_applyCodecParams:(NSData*)payload
+{
+    if (remoteContext) return YES;                          // a restarted worker opens the same encoder
+    MEWorkerCodecParams params;
+    if (payload.length < sizeof(params)) return NO;
+    memcpy(&params, payload.bytes, sizeof(params));
+    if (params.extradataSize < 0 || payload.length != sizeof(params) + (NSUInteger)params.extradataSize) return NO;
+
+    AVCodecContext* avctx = avcodec_alloc_context3(NULL);
+    if (!avctx) return NO;
+    avctx->codec_type = AVMEDIA_TYPE_VIDEO;
+    avctx->codec_id = params.codecID;
+    avctx->width = params.width;
+    avctx->height = params.height;
+    avctx->pix_fmt = params.format;
+    avctx->profile = params.profile;
+    avctx->level = params.level;
+    avctx->field_order = params.fieldOrder;
+    avctx->color_range = params.colorRange;
+    avctx->color_primaries = params.colorPrimaries;
+    avctx->color_trc = params.colorTrc;
+    avctx->colorspace = params.colorspace;
+    avctx->chroma_sample_location = params.chromaLocation;
+    avctx->sample_aspect_ratio = av_make_q(params.sarNum, params.sarDen);
+    avctx->time_base = av_make_q(params.timeBaseNum, params.timeBaseDen);
+    avctx->framerate = av_make_q(params.frameRateNum, params.frameRateDen);
+    avctx->bit_rate = params.bitRate;
+    if (params.extradataSize > 0) {
+        avctx->extradata = av_mallocz((size_t)params.extradataSize + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!avctx->extradata) {
+            avcodec_free_context(&avctx);
+            return NO;
+        }
+        memcpy(avctx->extradata, (const uint8_t*)payload.bytes + sizeof(params), (size_t)params.extradataSize);
+        avctx->extradata_size = params.extradataSize;
+    }
+    remoteContext = avctx;
+    return YES;
+}
+
+- (void)me_commitPacket:(AVPacket*)pkt
+{
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        lastDTS = pkt->dts;
+    }
+    [self.readyPackets addObject:[NSValue valueWithPointer:pkt]];
+}
+
+/// A restarted encoder starts its dts from scratch: shift all of its packets by one offset, so that
+/// the first one takes the dts the lost key packet had (and still follows the committed packets)
+- (void)me_rebaseDTS:(AVPacket*)pkt
+{
+    if (pkt->dts == AV_NOPTS_VALUE) return;
+    if (rebasePending) {
+        int64_t target = resumeDTS;
+        if (target == AV_NOPTS_VALUE || (lastDTS != AV_NOPTS_VALUE && target <= lastDTS)) {
+            target = (lastDTS != AV_NOPTS_VALUE) ? lastDTS + 1 : pkt->dts;
+        }
+        dtsOffset = target - pkt->dts;
+        rebasePending = NO;
+        if (self.verbose) {
+            SecureDebugLogf(@"[MEWorkerEncoderPipeline] dts of the restarted worker shifted by %lld", dtsOffset);
+        }
+    }
+    pkt->dts += dtsOffset;
+    if (pkt->pts != AV_NOPTS_VALUE && pkt->dts > pkt->pts) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: dts %lld after pts %lld following the restart.", pkt->dts, pkt->pts);
+    }
+}
+
+- (void)me_commitHeldPackets
+{
+    for (NSValue* value in self.heldPackets) {
+        [self me_commitPacket:value.pointerValue];
+    }
+    [self.heldPackets removeAllObjects];
+}
+
+- (void)me_dropReplayFramesBefore:(int64_t)pts
+{
+    NSIndexSet* closed = [self.replayFrames indexesOfObjectsPassingTest:^BOOL(NSValue* value, NSUInteger idx, BOOL* stop) {
+        return ((AVFrame*)value.pointerValue)->pts < pts;
+    }];
+    [closed enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL* stop) {
+        AVFrame* frame = self.replayFrames[idx].pointerValue;
+        self->replayBytes -= MIN(self->replayBytes, (uint64_t)av_image_get_buffer_size(frame->format, frame->width,
+                                                                                       frame->height, 1));
+        av_frame_free(&frame);
+    }];
+    [self.replayFrames removeObjectsAtIndexes:closed];
+}
+
+- (void)me_invalidateReplay:(NSString*)reason
+{
+    if (!self.replayValid) return;
+    self.replayValid = NO;
+    self.replayInvalidReason = reason;
+    SecureErrorLogf(@"[MEWorkerEncoderPipeline] WARNING: %@; a worker crash before the next key frame cannot be recovered.", reason);
+}
+
+/// The key frame closes the previous GOP: frames shown before it are no longer needed for a restart
+- (void)me_trimReplayBeforeKeyPacket:(AVPacket*)pkt
+{
+    int64_t keyPTS = pkt->pts;                              // packets keep the time stamps of their frames
+    [self me_dropReplayFramesBefore:keyPTS];
+    AVFrame* first = self.replayFrames.firstObject.pointerValue;
+    self.replayValid = (first != NULL && first->pts <= keyPTS);
+    self.replayInvalidReason = self.replayValid ? nil : @"the frames of the open GOP were not kept";
+    openKeyPTS = keyPTS;
+}
+
+- (void)me_queuePacket:(AVPacket*)pkt
+{
+    if (self.lowLatency) {
+        [self me_commitPacket:pkt];
+        return;
+    }
+    if (pkt->flags & AV_PKT_FLAG_KEY) {
+        [self me_commitHeldPackets];
+        [self me_trimReplayBeforeKeyPacket:pkt];
+    } else if (openKeyPTS != AV_NOPTS_VALUE && pkt->pts != AV_NOPTS_VALUE && pkt->pts < openKeyPTS) {
+        // A leading picture (open GOP): its frame was freed with the previous GOP
+        [self me_invalidateReplay:@"The encoder produces open GOPs"];
+    }
+    [self.heldPackets addObject:[NSValue valueWithPointer:pkt]];
+    if (self.heldPackets.count > replayFrameLimit) {
+        // too long to hold back
+        [self me_commitHeldPackets];
+        [self me_invalidateReplay:[NSString stringWithFormat:@"GOP longer than %lu packets", (unsigned long)replayFrameLimit]];
+    }
+}
+
+/// Keep a sent frame for a restart, within the frame and byte limits of the replay buffer
+- (void)me_keepReplayFrame:(AVFrame*)frame
+{
+    [self.replayFrames addObject:[NSValue valueWithPointer:frame]];
+    replayBytes += (uint64_t)MAX(av_image_get_buffer_size(frame->format, frame->width, frame->height, 1), 0);
+    if (self.replayFrames.count <= replayFrameLimit && replayBytes <= replayByteLimit) return;
+
+    [self me_invalidateReplay:[NSString stringWithFormat:@"Open GOP exceeds the replay buffer (%lu frames, %llu MB)",
+                               (unsigned long)replayFrameLimit, replayByteLimit >> 20]];
+    while (self.replayFrames.count > 1 &&
+           (self.replayFrames.count > replayFrameLimit || replayBytes > replayByteLimit)) {
+        AVFrame* oldest = self.replayFrames.firstObject.pointerValue;
+        [self me_dropReplayFramesBefore:oldest->pts + 1];
+    }
+}
+
+- (BOOL)me_receivePacket:(MEWorkerMessage)msg
+{
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt || msg.size > INT_MAX || av_new_packet(pkt, (int)msg.size) < 0) {
+        av_packet_free(&pkt);
+        self.workerError = AVERROR(ENOMEM);
+        return NO;
+    }
+    BOOL ok = NO;
+    if (msg.slot == kWorkerInlineSlot) {
+        ok = readAll(evtFD, pkt->data, (size_t)msg.size);
+    } else if (msg.slot < header.packetSlots && msg.size <= header.packetSlotSize) {
+        memcpy(pkt->data, [self me_packetSlot:msg.slot], (size_t)msg.size);
+        MEWorkerMessage done = {.type = MEWorkerMessagePacketDone, .slot = msg.slot};
+        ok = sendMessage(cmdFD, done, NULL);
+    }
+    if (!ok) {
+        av_packet_free(&pkt);
+        return NO;
+    }
+    pkt->pts = msg.pts;
+    pkt->dts = msg.dts;
+    pkt->duration = msg.duration;
+    pkt->flags = msg.flags;
+    [self me_rebaseDTS:pkt];
+    [self me_queuePacket:pkt];
+    return YES;
+}
+
+- (BOOL)me_handleEvent
+{
+    MEWorkerMessage msg;
+    if (!readAll(evtFD, &msg, sizeof(msg))) return NO;
+    switch (msg.type) {
+        case MEWorkerMessageFrameDone:
+            if (msg.slot < header.frameSlots) {
+                frameSlotBusy[msg.slot] = NO;
+            }
+            return YES;
+        case MEWorkerMessagePacket:
+            return [self me_receivePacket:msg];
+        case MEWorkerMessageOpened: {
+            NSData* payload = readPayload(evtFD, msg.size);
+            if (payload && [self me_applyCodecParams:payload]) return YES;
+            self.workerError = AVERROR(EINVAL);
+            return NO;
+        }
+        case MEWorkerMessageEOF:
+            [self me_commitHeldPackets];
+            self.workerEOF = YES;
+            return YES;
+        case MEWorkerMessageError:
+            self.workerError = (msg.result < 0) ? msg.result : AVERROR_EXTERNAL;
+            return NO;
+        default:
+            self.workerError = AVERROR(EINVAL);
+            return NO;
+    }
+}
+
+/// Handle the worker messages that arrive within the timeout. NO when the worker is gone or failed.
+- (BOOL)me_pumpEventsWithTimeout:(int)milliseconds
+{
+    int timeout = milliseconds;
+    while (evtFD >= 0) {
+        struct pollfd pfd = {evtFD, POLLIN, 0};
+        int n = poll(&pfd, 1, timeout);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return YES;
+        if (![self me_handleEvent]) return NO;
+        timeout = 0;
+    }
+    return NO;
+}
+
+- (BOOL)me_replayFrames
+{
+    // A key packet during the replay only frees frames that were sent already
+    for (NSValue* value in [self.replayFrames copy]) {
+        NSInteger slot = -1;
+        while ((slot = [self me_freeFrameSlot]) < 0) {
+            if (![self me_pumpEventsWithTimeout:100]) return NO;
+        }
+        if (![self me_writeFrame:value.pointerValue toSlot:slot]) return NO;
+    }
+    if (self.flushSent) {
+        MEWorkerMessage msg = {.type = MEWorkerMessageFlush};
+        return sendMessage(cmdFD, msg, NULL);
+    }
+    return YES;
+}
+
+/// Replace a dead worker and send the frames of the open GOP again
+- (BOOL)me_recoverWorker
+{
+    while (TRUE) {
+        pid_t pid = workerPID;
+        int status = [self me_reapWorker];
+        if (self.workerError) break;                        // the encoder itself failed; a new worker fails again
+        if (WIFSIGNALED(status)) {
+            SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Encoder worker %d was terminated by signal %d.", pid, WTERMSIG(status));
+        } else {
+            SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Encoder worker %d exited (%d).", pid, WEXITSTATUS(status));
+        }
+        NSString* reason = nil;
+        if (self.lowLatency) {
+            reason = @"low latency encoding keeps no frames";
+        } else if (!self.replayValid) {
+            reason = self.replayInvalidReason ?: @"the frames of the open GOP were not kept";
+        } else if (self.restartCount >= kWorkerMaxRestarts) {
+            reason = [NSString stringWithFormat:@"restarted %lu times already", (unsigned long)self.restartCount];
+        }
+        if (reason) {
+            SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Cannot restart the encoder worker: %@.", reason);
+            break;
+        }
+        self.restartCount += 1;
+        SecureLogf(@"[MEWorkerEncoderPipeline] Restarting the encoder worker (%lu/%lu), resending %lu frames.",
+                   (unsigned long)self.restartCount, (unsigned long)kWorkerMaxRestarts,
+                   (unsigned long)self.replayFrames.count);
+        // The new worker encodes the open GOP again, starting with its key packet
+        AVPacket* key = self.heldPackets.firstObject.pointerValue;
+        resumeDTS = key ? key->dts : AV_NOPTS_VALUE;
+        rebasePending = YES;
+        dtsOffset = 0;
+        [self me_discardPackets:self.heldPackets];
+        if ([self me_spawnWorker] && [self me_replayFrames]) return YES;
+    }
+    if (!self.workerError) {
+        self.workerError = AVERROR_EXTERNAL;
+    }
+    return NO;
+}
+
+/* =================================================================================== */
+// MARK: - MEEncoderPipeline
+/* =================================================================================== */
+
+- (BOOL)prepareVideoEncoderWith:(CMSampleBufferRef _Nullable)sampleBuffer
+                  filteredFrame:(void * _Nullable)filteredFrame
+            hasValidFilteredFrame:(BOOL)hasValidFilteredFrame
+{
+    if (self.isReady)
+        return YES;
+    if (!(self.videoEncoderSetting && self.videoEncoderSetting.count)) {
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Invalid video encoder parameters.");
+        return NO;
+    }
+
+    // Replay buffer: one GOP of frames, and no more than a share of the memory
+    NSUInteger keyint = configuredKeyint(self.videoEncoderConfig);
+    replayFrameLimit = (keyint > 0) ? keyint + kWorkerReplayReorderFrames : kWorkerReplayMaxFrames;
+    replayByteLimit = MIN(kWorkerReplayMaxBytes, NSProcessInfo.processInfo.physicalMemory / 8);
+
+    // The worker opens the encoder with the first frame it gets
+    self.isReady = YES;
+    dispatch_semaphore_signal(self.encoderReadySemaphore);
+    return YES;
+}
+
+- (BOOL)sendFrameToEncoder:(void *)frame withResult:(int *)result
+{
+    if (!self.isReady || self.workerError) {
+        if (result) *result = self.workerError ?: AVERROR_UNKNOWN;
+        return NO;
+    }
+
+    if (!frame) {                                           // Flush
+        self.isFlushed = YES;
+        self.flushSent = YES;
+        if (!shm) {
+            self.workerEOF = YES;                           // no frame was ever sent
+        } else {
+            MEWorkerMessage msg = {.type = MEWorkerMessageFlush};
+            if (!sendMessage(cmdFD, msg, NULL) && ![self me_recoverWorker]) {
+                if (result) *result = self.workerError;
+                return NO;
+            }
+        }
+        if (result) *result = 0;
+        return YES;
+    }
+
+    AVFrame* input = (AVFrame*)frame;
+    if (!shm && !([self me_createSharedMemoryForFrame:input] && [self me_spawnWorker])) {
+        if (result) *result = self.workerError ?: AVERROR_EXTERNAL;
+        return NO;
+    }
+
+    NSInteger slot = [self me_freeFrameSlot];
+    if (slot < 0) {
+        if (![self me_pumpEventsWithTimeout:10] && ![self me_recoverWorker]) {
+            if (result) *result = self.workerError;
+            return NO;
+        }
+        slot = [self me_freeFrameSlot];
+    }
+    if (slot < 0) {
+        if (result) *result = AVERROR(EAGAIN);              // every slot is in the worker
+        return YES;
+    }
+
+    // Take ownership like avcodec_send_frame(); the frame is kept for a restart until its GOP closes
+    AVFrame* kept = av_frame_alloc();
+    if (!kept) {
+        if (result) *result = AVERROR(ENOMEM);
+        return NO;
+    }
+    av_frame_move_ref(kept, input);
+    BOOL sent = [self me_writeFrame:kept toSlot:slot];
+    if (self.lowLatency) {
+        av_frame_free(&kept);
+    } else {
+        [self me_keepReplayFrame:kept];
+    }
+    if (!sent && (self.workerError || ![self me_recoverWorker])) {
+        if (result) *result = self.workerError;
+        SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Cannot send the frame to the encoder worker.");
+        return NO;
+    }
+    if (result) *result = 0;
+    return YES;
+}
+
+- (BOOL)receivePacketFromEncoderWithResult:(int *)result
+{
+    if (self.isEOF) {
+        if (result) *result = AVERROR_EOF;
+        return NO;
+    }
+    if (!current) {
+        current = av_packet_alloc();
+        if (!current) {
+            SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: Failed to allocate a video packet.");
+            if (result) *result = AVERROR(ENOMEM);
+            return NO;
+        }
+    }
+
+    while (TRUE) {
+        if (self.readyPackets.count > 0) {
+            AVPacket* pkt = self.readyPackets.firstObject.pointerValue;
+            [self.readyPackets removeObjectAtIndex:0];
+            av_packet_unref(current);
+            av_packet_move_ref(current, pkt);
+            av_packet_free(&pkt);
+            if (result) *result = 0;
+            return YES;
+        }
+        if (self.workerEOF) {                               // Fully flushed out
+            self.isEOF = YES;
+            if (result) *result = AVERROR_EOF;
+            return YES;
+        }
+        if (self.workerError || !shm) {
+            if (result) *result = self.workerError ?: AVERROR(EAGAIN);
+            return (self.workerError == 0);
+        }
+        if (![self me_pumpEventsWithTimeout:(self.flushSent ? 100 : 10)]) {
+            if (![self me_recoverWorker]) {
+                SecureErrorLogf(@"[MEWorkerEncoderPipeline] ERROR: The encoder worker failed. %@",
+                                [MEErrorFormatter stringFromFFmpegCode:self.workerError]);
+                if (result) *result = self.workerError;
+                return NO;
+            }
+            continue;
+        }
+        if (self.readyPackets.count == 0 && !self.workerEOF) {
+            if (result) *result = AVERROR(EAGAIN);          // Encoder requests more input
+            return YES;
+        }
+    }
+}
+
+- (void *)encodedPacket
+{
+    return current;
+}
+
+- (void *)codecContext
+{
+    return remoteContext;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -39,6 +39,34 @@ extern NSString* const kVideoCodecKey;      // NSString representation of OSType
 extern NSString* const kAudioCodecKey;      // NSString representation of OSType
 extern NSString* const kAudioChannelLayoutTagKey; // NSNumber of uint32_t
 extern NSString* const kAudioVolumeKey;        // NSNumber of float (dB)
+extern NSString* const kPrefetchFramesKey;     // NSNumber of int (reader-side read-ahead in frames, 0 = off)
+extern NSString* const kPrefetchBytesKey;      // NSNumber of long long (reader-side read-ahead in bytes, 0 = off)
+extern NSString* const kInterleaveWindowKey;   // NSNumber of float (max lead in seconds between writer tracks, 0 = off)
+extern NSString* const kMetricsPathKey;        // NSString (per-stage metrics file; ".json" = JSON at exit, else Prometheus textfile)
+extern NSString* const kTracePathKey;          // NSString (Chrome trace-event JSON of per-frame pipeline stages)
+extern NSString* const kThreadBudgetKey;       // NSNumber of int (encoder/filter threads per video track, 0 = libav default)
+extern NSString* const kMovieLayoutKey;        // NSString (kMovieLayoutFastStart, kMovieLayoutMoovAtEnd or kMovieLayoutFragmented)
+extern NSString* const kMovieFragmentIntervalKey; // NSNumber of float (seconds between movie fragments for kMovieLayoutFragmented)
+extern NSString* const kMuxerFormatKey;        // NSString (libavformat muxer for the encoded video track: mp4, mov, matroska, mpegts, nut, ivf, h264 or hevc)
+extern NSString* const kSegmentDurationKey;    // NSNumber of float (seconds; > 0 writes CMAF segments, HLS playlist and DASH MPD into the output directory)
+extern NSString* const kInputBackendKey;       // NSString (kInputBackendAVFoundation or kInputBackendLibav)
+extern NSString* const kDecoderThreadsKey;     // NSNumber of int (libavcodec decoder threads for kInputBackendLibav, 0 = one per core)
+extern NSString* const kLowLatencyKey;         // NSNumber of BOOL (zero-latency encoder, single frame queues, latency percentiles in the log)
+extern NSString* const kResultCacheDirectoryKey; // NSString (directory of finished outputs keyed by input content and settings)
+extern NSString* const kResultCacheSizeKey;    // NSNumber of uint64_t (result cache size limit in bytes, default 20 GB)
+extern NSString* const kMetadataFixupKey;      // NSDictionary of NSString (primaries, transfer, matrix, range, sar, field; rewrite SPS VUI and colr/pasp/fiel without re-encoding)
+extern NSString* const kSliceReadersKey;       // NSNumber of int (readers decoding an intra-only video track concurrently, 0/1 = off)
+extern NSString* const kEncoderWorkerKey;      // NSNumber of BOOL (video encoder in a child process, restarted from the last closed GOP after a crash)
+extern NSString* const kThreadAffinityKey;     // NSNumber of BOOL (filter/encoder threads of each video track kept on one cache domain)
+
+// Values of kMovieLayoutKey
+extern NSString* const kMovieLayoutFastStart;  // moov moved to the head at finish (rewrites the whole file)
+extern NSString* const kMovieLayoutMoovAtEnd;  // moov appended at finish
+extern NSString* const kMovieLayoutFragmented; // movie fragments while writing; moov appended at finish
+
+// Values of kInputBackendKey
+extern NSString* const kInputBackendAVFoundation; // AVAssetReader decodes the source (default)
+extern NSString* const kInputBackendLibav;        // libavformat/libavcodec decode the video track; requires kMuxerFormatKey
 
 typedef void (^progress_block_t)(NSDictionary* _Nonnull);
 
@@ -120,4 +120,42 @@ extern NSString* const kProgressPercentKey;
  */
 extern NSString* const kProgressCountKey;
 
+/**
+ * @constant kProgressBytesKey
+ * @abstract Byte count key for progress callback dictionary
+ * @discussion Value is an NSNumber of long long (payload bytes processed)
+ */
+extern NSString* const kProgressBytesKey;
+
+/**
+ * @constant kProgressFPSKey
+ * @abstract Throughput key for progress callback dictionary
+ * @discussion Value is an NSNumber of float (samples per second of wall clock time)
+ */
+extern NSString* const kProgressFPSKey;
+
+/**
+ * @constant kProgressSpeedKey
+ * @abstract Speed key for progress callback dictionary
+ * @discussion Value is an NSNumber of float (media seconds per wall clock second, 1.0 = realtime)
+ */
+extern NSString* const kProgressSpeedKey;
+
+/**
+ * @constant kProgressETAKey
+ * @abstract Estimated time remaining key for progress callback dictionary
+ * @discussion Value is an NSNumber of float (seconds). Absent until speed is known.
+ */
+extern NSString* const kProgressETAKey;
+
+/**
+ * @constant kProgressQueueFillKey
+ * @abstract Prefetch queue fill level key for progress callback dictionary
+ * @discussion Value is an NSNumber of float (0.0 to 100.0). Present only on channels
+ *             with read-ahead enabled via kPrefetchFramesKey/kPrefetchBytesKey.
+ *             A queue that stays full means the consumer (encode) is the bottleneck;
+ *             a queue that stays empty means decode is.
+ */
+extern NSString* const kProgressQueueFillKey;
+
 #endif /* MovEncoder2_h */
@@ -0,0 +1,73 @@
+//
+//  MEAffinity.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEAffinity.h
+ * @abstract Internal API - Cache domain placement of filter and encoder threads
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * macOS has no NUMA placement API; the nearest control is the Mach affinity
+ * tag (THREAD_AFFINITY_POLICY). Threads with the same tag are scheduled on the
+ * same cache domain (package or shared L2/L3) where possible, threads with
+ * different tags are spread over domains, and threads created by a tagged
+ * thread inherit its tag. Each MEManager takes its own tag round robin over the
+ * domains, so the libavfilter and libavcodec thread pools it creates and the
+ * frame buffers they first touch stay on one domain, and concurrent managers
+ * land on different ones.
+ *
+ * Memory is uniform on every Mac, so only cache locality is at stake. Apple
+ * silicon does not support affinity tags; MEAffinityIsSupported() is NO there
+ * and tags are not applied.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEAffinity_h
+#define MEAffinity_h
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// No affinity tag (THREAD_AFFINITY_TAG_NULL)
+extern const NSInteger kMEAffinityTagNone;
+
+/// Cache domains on this host: packages or groups of cores sharing the last level cache (at least 1)
+NSInteger MEAffinityDomainCount(void);
+
+/// YES if the kernel accepts affinity tags on this host
+BOOL MEAffinityIsSupported(void);
+
+/// Next tag of a round robin over the domains, 1 ... MEAffinityDomainCount()
+NSInteger MEAffinityNextTag(void);
+
+/// Affinity tag of the calling thread (kMEAffinityTagNone if not tagged or not supported)
+NSInteger MEAffinityCurrentThreadTag(void);
+
+/**
+ * Sets the affinity tag of the calling thread.
+ *
+ * @param tag New tag, kMEAffinityTagNone to clear it
+ * @param previous Optional, receives the tag the thread had before
+ * @return YES if the tag was applied
+ */
+BOOL MEAffinitySetCurrentThreadTag(NSInteger tag, NSInteger* _Nullable previous);
+
+/// Wraps block so it runs with tag on whatever thread executes it; the thread's previous tag is restored afterwards
+dispatch_block_t MEAffinityBlock(NSInteger tag, dispatch_block_t block);
+
+/// i.e. "packages=2 logicalcpu=24 cpusPerDomain=12 domains=2 tags=supported"
+NSString* MEAffinityTopologyDescription(void);
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEAffinity_h */
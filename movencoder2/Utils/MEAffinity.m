@@ -0,0 +1,140 @@
+//
+//  MEAffinity.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MEAffinity.h"
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <sys/sysctl.h>
+#include <stdatomic.h>
+
+const NSInteger kMEAffinityTagNone = THREAD_AFFINITY_TAG_NULL;
+
+// Tag last applied to this thread through this file; -1 until then (a new thread may have inherited one)
+// Saves the get syscall when MEAffinityBlock looks up the tag to restore
+static __thread NSInteger sAppliedTag = -1;
+
+typedef struct {
+    int packages;
+    int logicalCPUs;
+    int cpusPerDomain;
+    int domains;
+    BOOL supported;
+} MEAffinityTopology;
+
+static int sysctlInt(const char* name, int fallback) {
+    int value = 0;
+    size_t size = sizeof(value);
+    if (sysctlbyname(name, &value, &size, NULL, 0) != 0 || value <= 0) return fallback;
+    return value;
+}
+
+static const MEAffinityTopology* topology(void) {
+    static MEAffinityTopology topo;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        topo.packages = sysctlInt("hw.packages", 1);
+        topo.logicalCPUs = sysctlInt("hw.logicalcpu", 1);
+
+        // hw.cacheconfig: logical CPUs sharing memory, L1, L2, L3, ...; take the last level present
+        uint64_t config[8] = {0};
+        size_t size = sizeof(config);
+        int sharing = 0;
+        if (sysctlbyname("hw.cacheconfig", config, &size, NULL, 0) == 0) {
+            for (size_t level = size / sizeof(uint64_t); level > 2; level--) {
+                if (config[level - 1] > 0) {
+                    sharing = (int)config[level - 1];
+                    break;
+                }
+            }
+        }
+        int perPackage = MAX(topo.logicalCPUs / topo.packages, 1);
+        topo.cpusPerDomain = (sharing > 0) ? MIN(sharing, perPackage) : perPackage;
+        topo.domains = MAX(topo.logicalCPUs / topo.cpusPerDomain, 1);
+
+        thread_affinity_policy_data_t policy = {THREAD_AFFINITY_TAG_NULL};
+        mach_msg_type_number_t count = THREAD_AFFINITY_POLICY_COUNT;
+        boolean_t getDefault = FALSE;
+        mach_port_t thread = mach_thread_self();
+        kern_return_t kr = thread_policy_get(thread, THREAD_AFFINITY_POLICY,
+                                             (thread_policy_t)&policy, &count, &getDefault);
+        mach_port_deallocate(mach_task_self(), thread);
+        topo.supported = (kr == KERN_SUCCESS);
+    });
+    return &topo;
+}
+
+NSInteger MEAffinityDomainCount(void)
+{
+    return topology()->domains;
+}
+
+BOOL MEAffinityIsSupported(void)
+{
+    return topology()->supported;
+}
+
+NSInteger MEAffinityNextTag(void)
+{
+    static atomic_uint_fast32_t next = 0;
+    uint_fast32_t index = atomic_fetch_add(&next, 1);
+    return (NSInteger)(index % (uint_fast32_t)topology()->domains) + 1;
+}
+
+NSInteger MEAffinityCurrentThreadTag(void)
+{
+    if (!topology()->supported) return kMEAffinityTagNone;
+    thread_affinity_policy_data_t policy = {THREAD_AFFINITY_TAG_NULL};
+    mach_msg_type_number_t count = THREAD_AFFINITY_POLICY_COUNT;
+    boolean_t getDefault = FALSE;
+    mach_port_t thread = mach_thread_self();
+    kern_return_t kr = thread_policy_get(thread, THREAD_AFFINITY_POLICY,
+                                         (thread_policy_t)&policy, &count, &getDefault);
+    mach_port_deallocate(mach_task_self(), thread);
+    return (kr == KERN_SUCCESS) ? policy.affinity_tag : kMEAffinityTagNone;
+}
+
+BOOL MEAffinitySetCurrentThreadTag(NSInteger tag, NSInteger* _Nullable previous)
+{
+    if (previous) *previous = MEAffinityCurrentThreadTag();
+    if (!topology()->supported) return NO;
+    thread_affinity_policy_data_t policy = {(integer_t)tag};
+    mach_port_t thread = mach_thread_self();
+    kern_return_t kr = thread_policy_set(thread, THREAD_AFFINITY_POLICY,
+                                         (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
+    mach_port_deallocate(mach_task_self(), thread);
+    sAppliedTag = (kr == KERN_SUCCESS) ? tag : -1;
+    return (kr == KERN_SUCCESS);
+}
+
+dispatch_block_t MEAffinityBlock(NSInteger tag, dispatch_block_t block)
+{
+    if (tag == kMEAffinityTagNone || !topology()->supported) return block;
+    return ^{
+        // GCD threads are shared with other work; put the thread's own tag back before returning it
+        NSInteger previous = (sAppliedTag >= 0) ? sAppliedTag : MEAffinityCurrentThreadTag();
+        if (previous == tag) {
+            block();
+            return;
+        }
+        BOOL applied = MEAffinitySetCurrentThreadTag(tag, NULL);
+        block();
+        if (applied) {
+            MEAffinitySetCurrentThreadTag(previous, NULL);
+        }
+    };
+}
+
+NSString* MEAffinityTopologyDescription(void)
+{
+    const MEAffinityTopology* topo = topology();
+    return [NSString stringWithFormat:@"packages=%d logicalcpu=%d cpusPerDomain=%d domains=%d tags=%@",
+            topo->packages, topo->logicalCPUs, topo->cpusPerDomain, topo->domains,
+            topo->supported ? @"supported" : @"unsupported"];
+}
@@ -49,6 +49,15 @@ CF_RETURNS_RETAINED _Nullable CMFormatDescriptionRef createDescriptionH264(AVCod
  */
 CF_RETURNS_RETAINED _Nullable CMFormatDescriptionRef createDescriptionH265(AVCodecContext* avctx);
 
+/**
+ * Get the parameter sets of an H.264/H.265 CMFormatDescription.
+ *
+ * @param desc An avc1/avc3 or hvc1/hev1 video format description.
+ * @return NAL payloads without start codes, in the order createDescriptionH264/H265
+ *         pass them to CoreMedia (SPS/PPS/SPS-ext, or VPS/SPS/PPS/SEI), or nil.
+ */
+NSArray<NSData*>* _Nullable parameterSetsOfDescription(CMFormatDescriptionRef desc);
+
 /**
  * Create a new CMFormatDescription with clean aperture information.
  *
@@ -247,6 +247,34 @@ CMFormatDescriptionRef createDescriptionH265(AVCodecContext* avctx) {
     return desc;
 }
 
+NSArray<NSData*>* _Nullable parameterSetsOfDescription(CMFormatDescriptionRef desc) {
+    FourCharCode subType = CMFormatDescriptionGetMediaSubType(desc);
+    BOOL isH264 = (subType == kCMVideoCodecType_H264 || subType == 'avc3');
+    BOOL isH265 = (subType == kCMVideoCodecType_HEVC || subType == 'hev1');
+    if (!(isH264 || isH265))
+        return nil;
+    
+    size_t count = 0;
+    OSStatus err = isH264
+        ? CMVideoFormatDescriptionGetH264ParameterSetAtIndex(desc, 0, NULL, NULL, &count, NULL)
+        : CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(desc, 0, NULL, NULL, &count, NULL);
+    if (err != noErr || count == 0)
+        return nil;
+    
+    NSMutableArray<NSData*>* parameterSets = [NSMutableArray arrayWithCapacity:count];
+    for (size_t index = 0; index < count; index++) {
+        const uint8_t* ptr = NULL;
+        size_t size = 0;
+        err = isH264
+            ? CMVideoFormatDescriptionGetH264ParameterSetAtIndex(desc, index, &ptr, &size, NULL, NULL)
+            : CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(desc, index, &ptr, &size, NULL, NULL);
+        if (err != noErr || !ptr)
+            return nil;
+        [parameterSets addObject:[NSData dataWithBytes:ptr length:size]];
+    }
+    return parameterSets;
+}
+
 CMFormatDescriptionRef createDescriptionWithAperture(CMFormatDescriptionRef inDesc, NSValue* cleanApertureValue) {
     if (cleanApertureValue) {
         // Prepare extensions dictionary
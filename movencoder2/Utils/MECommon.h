@@ -54,5 +54,10 @@ extern NSString* const kProgressPTSKey;         // NSNumber of float
 extern NSString* const kProgressDTSKey;         // NSNumber of float
 extern NSString* const kProgressPercentKey;     // NSNumber of float
 extern NSString* const kProgressCountKey;       // NSNumber of int
+extern NSString* const kProgressBytesKey;       // NSNumber of long long
+extern NSString* const kProgressFPSKey;         // NSNumber of float
+extern NSString* const kProgressSpeedKey;       // NSNumber of float
+extern NSString* const kProgressETAKey;         // NSNumber of float
+extern NSString* const kProgressQueueFillKey;   // NSNumber of float
 
 #endif /* MECommon_h */
@@ -49,3 +49,8 @@ NSString* const kProgressPTSKey = @"pts";                   // NSNumber of float
 NSString* const kProgressDTSKey = @"dts";                   // NSNumber of float
 NSString* const kProgressPercentKey = @"percent";           // NSNumber of float
 NSString* const kProgressCountKey = @"count";               // NSNumber of float
+NSString* const kProgressBytesKey = @"bytes";               // NSNumber of long long
+NSString* const kProgressFPSKey = @"fps";                   // NSNumber of float
+NSString* const kProgressSpeedKey = @"speed";               // NSNumber of float
+NSString* const kProgressETAKey = @"eta";                   // NSNumber of float
+NSString* const kProgressQueueFillKey = @"queueFill";       // NSNumber of float
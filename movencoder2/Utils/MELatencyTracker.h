@@ -0,0 +1,59 @@
+//
+//  MELatencyTracker.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MELatencyTracker.h
+ * @abstract Internal API - Frame-in to packet-out latency of one MEManager
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * The input side stamps each frame by presentation time as it enters MEManager
+ * (appendSampleBuffer:/appendFrame:); the output side looks the stamp up when the
+ * packet with the same presentation time leaves (copyNextSampleBuffer or the
+ * muxer). Latencies go into a fixed 0.1 ms resolution histogram up to 1 s, so
+ * memory use does not grow with the length of the job. Frames dropped or
+ * retimed by the filter graph are never matched and age out of the pending set.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MELatencyTracker_h
+#define MELatencyTracker_h
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MELatencyTracker : NSObject
+
+/// Frame entered the pipeline; pts in seconds (NAN is ignored)
+- (void)markInputPTS:(double)pts;
+
+/// Frame left the pipeline; records its latency if the input stamp is known
+- (void)markOutputPTS:(double)pts;
+
+/// Number of latencies recorded
+@property (readonly) uint64_t count;
+
+/// Latency in seconds at percentile p (0-100); NAN while empty
+- (double)latencyAtPercentile:(double)p;
+
+/// Largest latency in seconds; NAN while empty
+@property (readonly) double maxLatency;
+
+/// i.e. "frames=1200 p50=12.3ms p90=18.0ms p99=41.2ms max=77.0ms"
+- (NSString*)summary;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MELatencyTracker_h */
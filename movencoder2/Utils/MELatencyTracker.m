@@ -0,0 +1,119 @@
+//
+//  MELatencyTracker.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MELatencyTracker.h"
+#include <time.h>
+#include <math.h>
+
+static const int kPendingCount = 64;            // frames in flight; older stamps are overwritten
+static const int kBucketCount = 10000;          // 0.1 ms buckets up to 1 s
+static const uint64_t kBucketNanos = 100 * NSEC_PER_USEC;
+static const int64_t kMatchToleranceUsec = 2;   // CMTime and AVRational round differently
+
+typedef struct {
+    int64_t ptsUsec;
+    uint64_t nanos;                             // 0 = free slot
+} MEPendingStamp;
+
+@implementation MELatencyTracker
+{
+    MEPendingStamp _pending[kPendingCount];
+    int _nextSlot;
+    uint32_t _buckets[kBucketCount];
+    uint64_t _overflow;                         // latencies of 1 s or more
+    uint64_t _count;
+    uint64_t _maxNanos;
+}
+
+static inline uint64_t nowNanos(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+- (void)markInputPTS:(double)pts
+{
+    if (!isfinite(pts)) return;
+    uint64_t now = nowNanos();
+    @synchronized (self) {
+        _pending[_nextSlot] = (MEPendingStamp){ llround(pts * 1e6), now };
+        _nextSlot = (_nextSlot + 1) % kPendingCount;
+    }
+}
+
+- (void)markOutputPTS:(double)pts
+{
+    if (!isfinite(pts)) return;
+    uint64_t now = nowNanos();
+    int64_t ptsUsec = llround(pts * 1e6);
+    @synchronized (self) {
+        for (int i = 0; i < kPendingCount; i++) {
+            MEPendingStamp* stamp = &_pending[i];
+            if (stamp->nanos == 0 || llabs(stamp->ptsUsec - ptsUsec) > kMatchToleranceUsec) continue;
+            uint64_t latency = (now > stamp->nanos) ? now - stamp->nanos : 0;
+            uint64_t bucket = latency / kBucketNanos;
+            if (bucket < kBucketCount) {
+                _buckets[bucket]++;
+            } else {
+                _overflow++;
+            }
+            _count++;
+            _maxNanos = MAX(_maxNanos, latency);
+            stamp->nanos = 0;
+            break;
+        }
+    }
+}
+
+- (uint64_t)count
+{
+    @synchronized (self) {
+        return _count;
+    }
+}
+
+- (double)maxLatency
+{
+    @synchronized (self) {
+        return _count ? (double)_maxNanos / NSEC_PER_SEC : NAN;
+    }
+}
+
+- (double)latencyAtPercentile:(double)p
+{
+    @synchronized (self) {
+        if (_count == 0) return NAN;
+        uint64_t rank = (uint64_t)ceil(_count * MIN(MAX(p, 0.0), 100.0) / 100.0);
+        rank = MAX(rank, (uint64_t)1);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; i++) {
+            seen += _buckets[i];
+            if (seen >= rank) {
+                // upper bound of the bucket, but never above the largest sample
+                return MIN((double)(i + 1) * kBucketNanos, (double)_maxNanos) / NSEC_PER_SEC;
+            }
+        }
+        return (double)_maxNanos / NSEC_PER_SEC;
+    }
+}
+
+- (NSString*)summary
+{
+    uint64_t count = self.count;
+    if (count == 0) {
+        return @"frames=0";
+    }
+    return [NSString stringWithFormat:@"frames=%llu p50=%.1fms p90=%.1fms p99=%.1fms max=%.1fms",
+            count,
+            [self latencyAtPercentile:50] * 1000,
+            [self latencyAtPercentile:90] * 1000,
+            [self latencyAtPercentile:99] * 1000,
+            self.maxLatency * 1000];
+}
+
+@end
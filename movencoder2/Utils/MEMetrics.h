@@ -0,0 +1,167 @@
+//
+//  MEMetrics.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header MEMetrics.h
+ * @abstract Internal API - Per-stage pipeline counters, histograms and exporter
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * Each pipeline stage records frames, bytes and elapsed time into process-wide
+ * lock-free counters plus a log2 latency histogram. Instrumentation is written as
+ *
+ *     uint64_t t0 = MEMetricsBegin();
+ *     ... stage work ...
+ *     MEMetricsEndPTS(MEMetricsStageEncoderSend, t0, frames, bytes, pts);
+ *
+ * The same probes feed the per-frame tracer (METrace.h). While neither metrics
+ * nor tracing is enabled MEMetricsBegin() is a single relaxed load and returns 0,
+ * and MEMetricsEnd() with t0 == 0 does nothing.
+ *
+ * MEMetricsExporter periodically writes a Prometheus textfile, or writes a JSON
+ * document once at the end, including a job summary (fps, speed, CPU seconds,
+ * peak RSS).
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef MEMetrics_h
+#define MEMetrics_h
+
+@import Foundation;
+#include <stdatomic.h>
+#include <math.h>
+#include <time.h>
+
+/* =================================================================================== */
+// MARK: - Collector
+/* =================================================================================== */
+
+typedef NS_ENUM(int, MEMetricsStage) {
+    MEMetricsStageReaderWait = 0,       // AVAssetReaderOutput copyNextSampleBuffer (decode wait)
+    MEMetricsStagePrepareInput,         // -[MEManager prepareInputFrameWith:] copy into AVFrame
+    MEMetricsStageFilterPush,           // av_buffersrc_add_frame
+    MEMetricsStageFilterPull,           // av_buffersink_get_frame
+    MEMetricsStageEncoderSend,          // avcodec_send_frame
+    MEMetricsStageEncoderReceive,       // avcodec_receive_packet
+    MEMetricsStageCreateSampleBuffer,   // -[MEManager createCompressedSampleBuffer] and friends
+    MEMetricsStageWriterAppend,         // AVAssetWriterInput appendSampleBuffer (append wait)
+    MEMetricsStageCount
+};
+
+/// Number of latency buckets; bucket i counts durations <= 2^i microseconds, the last one is +Inf
+#define MEMetricsBucketCount 24
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t calls;
+    uint64_t totalNanos;
+    uint64_t maxNanos;
+    uint64_t buckets[MEMetricsBucketCount];   // non-cumulative
+} MEMetricsStageStats;
+
+/// Consumers of the probes; MEMetricsBegin() is active while any bit is set
+enum {
+    MEProbeMetrics = 1u << 0,
+    MEProbeTrace   = 1u << 1,
+};
+extern atomic_uint gMEProbeMask;
+
+NS_ASSUME_NONNULL_BEGIN
+
+void MEMetricsSetEnabled(BOOL enabled);
+BOOL MEMetricsIsEnabled(void);
+void MEMetricsReset(void);
+
+/// Record one call of a stage into the counters. Prefer MEMetricsEnd().
+void MEMetricsRecord(MEMetricsStage stage, uint64_t nanos, uint64_t frames, uint64_t bytes);
+
+/// Dispatch one finished probe to the enabled consumers.
+void MEMetricsRecordSpan(MEMetricsStage stage, uint64_t beginNanos, uint64_t endNanos,
+                         uint64_t frames, uint64_t bytes, double pts);
+
+/// Snapshot of a stage; safe to call from any thread.
+MEMetricsStageStats MEMetricsSnapshot(MEMetricsStage stage);
+
+/// Metric label of a stage (e.g. "encoder_send")
+NSString* MEMetricsStageName(MEMetricsStage stage);
+
+static inline uint64_t MEMetricsBegin(void) {
+    if (atomic_load_explicit(&gMEProbeMask, memory_order_relaxed) == 0) return 0;
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+/// @param pts Presentation time in seconds of the frame handled, or NAN
+static inline void MEMetricsEndPTS(MEMetricsStage stage, uint64_t t0, uint64_t frames, uint64_t bytes, double pts) {
+    if (t0 == 0) return;
+    MEMetricsRecordSpan(stage, t0, clock_gettime_nsec_np(CLOCK_UPTIME_RAW), frames, bytes, pts);
+}
+
+static inline void MEMetricsEnd(MEMetricsStage stage, uint64_t t0, uint64_t frames, uint64_t bytes) {
+    MEMetricsEndPTS(stage, t0, frames, bytes, NAN);
+}
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: - Exporter
+/* =================================================================================== */
+
+typedef NS_ENUM(NSInteger, MEMetricsFormat) {
+    MEMetricsFormatPrometheus = 0,      // textfile collector format, rewritten periodically
+    MEMetricsFormatJSON,                // single document written at the end
+};
+
+/// Job level progress supplied by the owner of the exporter
+typedef struct {
+    uint64_t frames;            // video frames delivered to the writer
+    double mediaSeconds;        // media time processed so far
+} MEMetricsJobProgress;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef MEMetricsJobProgress (^MEMetricsJobProgressBlock)(void);
+
+@interface MEMetricsExporter : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ @param url Destination file; replaced atomically on every write
+ @param format Output format
+ @param interval Rewrite interval in seconds for MEMetricsFormatPrometheus (ignored for JSON)
+ */
+- (instancetype)initWithURL:(NSURL*)url format:(MEMetricsFormat)format interval:(double)interval NS_DESIGNATED_INITIALIZER;
++ (instancetype)exporterWithURL:(NSURL*)url format:(MEMetricsFormat)format interval:(double)interval;
+
+/// Format implied by the path extension: ".json" selects JSON, anything else Prometheus
++ (MEMetricsFormat)formatForURL:(NSURL*)url;
+
+@property (nonatomic, readonly) NSURL* url;
+@property (nonatomic, readonly) MEMetricsFormat format;
+@property (nonatomic, copy, nullable) MEMetricsJobProgressBlock jobProgress;
+
+/// Reset and enable the collector, then start periodic export.
+- (void)start;
+
+/// Stop periodic export, write the final document with job summary and disable the collector.
+- (BOOL)finishWithError:(NSError * _Nullable * _Nullable)error;
+
+/// Current document as text (for tests and logging)
+- (NSString*)renderFinal:(BOOL)final;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif /* MEMetrics_h */
@@ -0,0 +1,369 @@
+//
+//  MEMetrics.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MECommon.h"
+#import "MEMetrics.h"
+#import "MESecureLogging.h"
+#import "METrace.h"
+#include <sys/resource.h>
+
+/* =================================================================================== */
+// MARK: - Collector
+/* =================================================================================== */
+
+typedef struct {
+    _Atomic(uint64_t) frames;
+    _Atomic(uint64_t) bytes;
+    _Atomic(uint64_t) calls;
+    _Atomic(uint64_t) totalNanos;
+    _Atomic(uint64_t) maxNanos;
+    _Atomic(uint64_t) buckets[MEMetricsBucketCount];
+} MEMetricsStageCounters;
+
+atomic_uint gMEProbeMask = 0;
+static MEMetricsStageCounters gStageCounters[MEMetricsStageCount];
+
+static NSString* const kStageNames[MEMetricsStageCount] = {
+    @"reader_wait",
+    @"prepare_input",
+    @"filter_push",
+    @"filter_pull",
+    @"encoder_send",
+    @"encoder_receive",
+    @"create_sample_buffer",
+    @"writer_append",
+};
+
+static inline int bucketIndex(uint64_t nanos) {
+    uint64_t usec = nanos / NSEC_PER_USEC;
+    if (usec <= 1) return 0;
+    int index = 64 - __builtin_clzll(usec - 1);     // smallest i with usec <= 2^i
+    return MIN(index, MEMetricsBucketCount - 1);
+}
+
+void MEMetricsSetEnabled(BOOL enabled) {
+    if (enabled) {
+        atomic_fetch_or_explicit(&gMEProbeMask, MEProbeMetrics, memory_order_relaxed);
+    } else {
+        atomic_fetch_and_explicit(&gMEProbeMask, ~(unsigned)MEProbeMetrics, memory_order_relaxed);
+    }
+}
+
+BOOL MEMetricsIsEnabled(void) {
+    return (atomic_load_explicit(&gMEProbeMask, memory_order_relaxed) & MEProbeMetrics) != 0;
+}
+
+void MEMetricsReset(void) {
+    for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+        MEMetricsStageCounters* c = &gStageCounters[stage];
+        atomic_store_explicit(&c->frames, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->totalNanos, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->maxNanos, 0, memory_order_relaxed);
+        for (int i = 0; i < MEMetricsBucketCount; i++) {
+            atomic_store_explicit(&c->buckets[i], 0, memory_order_relaxed);
+        }
+    }
+}
+
+void MEMetricsRecord(MEMetricsStage stage, uint64_t nanos, uint64_t frames, uint64_t bytes) {
+    if (stage < 0 || stage >= MEMetricsStageCount) return;
+    MEMetricsStageCounters* c = &gStageCounters[stage];
+    atomic_fetch_add_explicit(&c->frames, frames, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->totalNanos, nanos, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->buckets[bucketIndex(nanos)], 1, memory_order_relaxed);
+    uint64_t prevMax = atomic_load_explicit(&c->maxNanos, memory_order_relaxed);
+    while (nanos > prevMax &&
+           !atomic_compare_exchange_weak_explicit(&c->maxNanos, &prevMax, nanos,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+        // prevMax is reloaded on failure
+    }
+}
+
+void MEMetricsRecordSpan(MEMetricsStage stage, uint64_t beginNanos, uint64_t endNanos,
+                         uint64_t frames, uint64_t bytes, double pts) {
+    unsigned mask = atomic_load_explicit(&gMEProbeMask, memory_order_relaxed);
+    uint64_t nanos = (endNanos > beginNanos ? endNanos - beginNanos : 0);
+    if (mask & MEProbeMetrics) {
+        MEMetricsRecord(stage, nanos, frames, bytes);
+    }
+    if (mask & MEProbeTrace) {
+        METraceRecord(stage, beginNanos, endNanos, bytes, pts);
+    }
+}
+
+MEMetricsStageStats MEMetricsSnapshot(MEMetricsStage stage) {
+    MEMetricsStageStats stats = {0};
+    if (stage < 0 || stage >= MEMetricsStageCount) return stats;
+    MEMetricsStageCounters* c = &gStageCounters[stage];
+    stats.frames = atomic_load_explicit(&c->frames, memory_order_relaxed);
+    stats.bytes = atomic_load_explicit(&c->bytes, memory_order_relaxed);
+    stats.calls = atomic_load_explicit(&c->calls, memory_order_relaxed);
+    stats.totalNanos = atomic_load_explicit(&c->totalNanos, memory_order_relaxed);
+    stats.maxNanos = atomic_load_explicit(&c->maxNanos, memory_order_relaxed);
+    for (int i = 0; i < MEMetricsBucketCount; i++) {
+        stats.buckets[i] = atomic_load_explicit(&c->buckets[i], memory_order_relaxed);
+    }
+    return stats;
+}
+
+NSString* MEMetricsStageName(MEMetricsStage stage) {
+    if (stage < 0 || stage >= MEMetricsStageCount) return @"unknown";
+    return kStageNames[stage];
+}
+
+/* =================================================================================== */
+// MARK: - Exporter
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface MEMetricsExporter ()
+
+@property (nonatomic, readwrite) NSURL* url;
+@property (nonatomic, readwrite) MEMetricsFormat format;
+@property (nonatomic, assign) double interval;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong, nullable) dispatch_source_t timer;
+@property (nonatomic, assign) CFAbsoluteTime startedAt;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation MEMetricsExporter
+
+- (instancetype)initWithURL:(NSURL*)url format:(MEMetricsFormat)format interval:(double)interval
+{
+    if (self = [super init]) {
+        _url = url;
+        _format = format;
+        _interval = interval;
+        _queue = dispatch_queue_create("com.movencoder2.MEMetricsExporter", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
++ (instancetype)exporterWithURL:(NSURL*)url format:(MEMetricsFormat)format interval:(double)interval
+{
+    return [[self alloc] initWithURL:url format:format interval:interval];
+}
+
++ (MEMetricsFormat)formatForURL:(NSURL*)url
+{
+    if ([url.pathExtension.lowercaseString isEqualToString:@"json"]) {
+        return MEMetricsFormatJSON;
+    }
+    return MEMetricsFormatPrometheus;
+}
+
+/* =================================================================================== */
+// MARK: - private
+/* =================================================================================== */
+
+- (NSDictionary*)jobSummary
+{
+    double elapsed = MAX(CFAbsoluteTimeGetCurrent() - self.startedAt, 0.0);
+    MEMetricsJobProgress progress = {0, 0.0};
+    if (self.jobProgress) {
+        progress = self.jobProgress();
+    }
+
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+    double cpuSeconds = (usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6);
+#ifdef __APPLE__
+    uint64_t peakRSS = (uint64_t)usage.ru_maxrss;          // bytes
+#else
+    uint64_t peakRSS = (uint64_t)usage.ru_maxrss * 1024;   // kilobytes
+#endif
+
+    return @{
+        @"elapsed_seconds" : @(elapsed),
+        @"frames" : @(progress.frames),
+        @"media_seconds" : @(progress.mediaSeconds),
+        @"fps" : @(elapsed > 0 ? progress.frames / elapsed : 0.0),
+        @"speed" : @(elapsed > 0 ? progress.mediaSeconds / elapsed : 0.0),
+        @"cpu_seconds" : @(cpuSeconds),
+        @"peak_rss_bytes" : @(peakRSS),
+    };
+}
+
+static double bucketBound(int index) {
+    return (double)(1ULL << index) / USEC_PER_SEC;
+}
+
+- (NSString*)renderPrometheusFinal:(BOOL)final
+{
+    NSMutableString* text = [NSMutableString string];
+    NSArray<NSArray<NSString*>*>* counters = @[
+        @[@"frames_total", @"Frames completed by pipeline stage"],
+        @[@"bytes_total", @"Payload bytes handled by pipeline stage"],
+        @[@"calls_total", @"Calls into pipeline stage including retries"],
+    ];
+    MEMetricsStageStats all[MEMetricsStageCount];
+    for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+        all[stage] = MEMetricsSnapshot(stage);
+    }
+
+    for (NSArray<NSString*>* counter in counters) {
+        [text appendFormat:@"# HELP movencoder2_stage_%@ %@\n", counter[0], counter[1]];
+        [text appendFormat:@"# TYPE movencoder2_stage_%@ counter\n", counter[0]];
+        for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+            uint64_t value = ([counter[0] hasPrefix:@"frames"] ? all[stage].frames :
+                              [counter[0] hasPrefix:@"bytes"] ? all[stage].bytes : all[stage].calls);
+            [text appendFormat:@"movencoder2_stage_%@{stage=\"%@\"} %llu\n",
+             counter[0], MEMetricsStageName(stage), value];
+        }
+    }
+
+    [text appendString:@"# HELP movencoder2_stage_seconds Time spent per call of pipeline stage\n"];
+    [text appendString:@"# TYPE movencoder2_stage_seconds histogram\n"];
+    for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+        NSString* name = MEMetricsStageName(stage);
+        uint64_t cumulative = 0;
+        for (int i = 0; i < MEMetricsBucketCount - 1; i++) {
+            cumulative += all[stage].buckets[i];
+            [text appendFormat:@"movencoder2_stage_seconds_bucket{stage=\"%@\",le=\"%g\"} %llu\n",
+             name, bucketBound(i), cumulative];
+        }
+        [text appendFormat:@"movencoder2_stage_seconds_bucket{stage=\"%@\",le=\"+Inf\"} %llu\n",
+         name, all[stage].calls];
+        [text appendFormat:@"movencoder2_stage_seconds_sum{stage=\"%@\"} %.9f\n",
+         name, all[stage].totalNanos / (double)NSEC_PER_SEC];
+        [text appendFormat:@"movencoder2_stage_seconds_count{stage=\"%@\"} %llu\n",
+         name, all[stage].calls];
+    }
+
+    [text appendString:@"# HELP movencoder2_stage_max_seconds Longest single call of pipeline stage\n"];
+    [text appendString:@"# TYPE movencoder2_stage_max_seconds gauge\n"];
+    for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+        [text appendFormat:@"movencoder2_stage_max_seconds{stage=\"%@\"} %.9f\n",
+         MEMetricsStageName(stage), all[stage].maxNanos / (double)NSEC_PER_SEC];
+    }
+
+    NSDictionary* summary = [self jobSummary];
+    NSArray<NSString*>* keys = @[@"elapsed_seconds", @"frames", @"media_seconds", @"fps",
+                                 @"speed", @"cpu_seconds", @"peak_rss_bytes"];
+    for (NSString* key in keys) {
+        [text appendFormat:@"# TYPE movencoder2_job_%@ gauge\n", key];
+        [text appendFormat:@"movencoder2_job_%@ %@\n", key, summary[key]];
+    }
+    [text appendString:@"# TYPE movencoder2_job_finished gauge\n"];
+    [text appendFormat:@"movencoder2_job_finished %d\n", (final ? 1 : 0)];
+    return text;
+}
+
+- (NSString*)renderJSONFinal:(BOOL)final
+{
+    NSMutableDictionary* stages = [NSMutableDictionary dictionary];
+    for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+        MEMetricsStageStats stats = MEMetricsSnapshot(stage);
+        NSMutableDictionary* histogram = [NSMutableDictionary dictionary];
+        for (int i = 0; i < MEMetricsBucketCount; i++) {
+            if (stats.buckets[i] == 0) continue;
+            NSString* bound = (i < MEMetricsBucketCount - 1
+                               ? [NSString stringWithFormat:@"%g", bucketBound(i)] : @"+Inf");
+            histogram[bound] = @(stats.buckets[i]);
+        }
+        double seconds = stats.totalNanos / (double)NSEC_PER_SEC;
+        stages[MEMetricsStageName(stage)] = @{
+            @"frames" : @(stats.frames),
+            @"bytes" : @(stats.bytes),
+            @"calls" : @(stats.calls),
+            @"seconds" : @(seconds),
+            @"mean_seconds" : @(stats.calls > 0 ? seconds / stats.calls : 0.0),
+            @"max_seconds" : @(stats.maxNanos / (double)NSEC_PER_SEC),
+            @"histogram" : histogram,
+        };
+    }
+    NSDictionary* document = @{
+        @"finished" : @(final),
+        @"stages" : stages,
+        @"summary" : [self jobSummary],
+    };
+    NSData* data = [NSJSONSerialization dataWithJSONObject:document
+                                                   options:(NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys)
+                                                     error:nil];
+    return data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : @"{}";
+}
+
+- (BOOL)writeFinal:(BOOL)final error:(NSError * _Nullable * _Nullable)error
+{
+    NSString* text = [self renderFinal:final];
+    NSData* data = [text dataUsingEncoding:NSUTF8StringEncoding];
+    // NSDataWritingAtomic writes a temporary file and renames it, so scrapers never see a partial file
+    BOOL result = [data writeToURL:self.url options:NSDataWritingAtomic error:error];
+    if (!result) {
+        SecureErrorLogf(@"[MEMetricsExporter] ERROR: Failed to write metrics to %@", self.url.path);
+    }
+    return result;
+}
+
+/* =================================================================================== */
+// MARK: - public
+/* =================================================================================== */
+
+- (NSString*)renderFinal:(BOOL)final
+{
+    if (self.format == MEMetricsFormatJSON) {
+        return [self renderJSONFinal:final];
+    }
+    return [self renderPrometheusFinal:final];
+}
+
+- (void)start
+{
+    MEMetricsReset();
+    MEMetricsSetEnabled(TRUE);
+    self.startedAt = CFAbsoluteTimeGetCurrent();
+
+    if (self.format != MEMetricsFormatPrometheus || self.interval <= 0) return;
+
+    uint64_t interval = (uint64_t)(self.interval * NSEC_PER_SEC);
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+    __weak typeof(self) wself = self;
+    dispatch_source_set_event_handler(timer, ^{
+        [wself writeFinal:FALSE error:nil];
+    });
+    self.timer = timer;
+    dispatch_resume(timer);
+}
+
+- (BOOL)finishWithError:(NSError * _Nullable * _Nullable)error
+{
+    __block BOOL result = FALSE;
+    __block NSError* err = nil;
+    dispatch_sync(self.queue, ^{
+        if (self.timer) {
+            dispatch_source_cancel(self.timer);
+            self.timer = nil;
+        }
+        result = [self writeFinal:TRUE error:&err];
+    });
+    MEMetricsSetEnabled(FALSE);
+    if (error) *error = err;
+    return result;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
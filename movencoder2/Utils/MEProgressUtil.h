@@ -33,6 +33,9 @@ NS_ASSUME_NONNULL_BEGIN
 + (float)progressPercentForSampleBuffer:(CMSampleBufferRef)buffer
                                start:(CMTime)start
                                  end:(CMTime)end; // 0.0 .. 100.0
++ (float)progressPercentForSeconds:(Float64)seconds
+                             start:(CMTime)start
+                               end:(CMTime)end; // 0.0 .. 100.0
 @end
 
 NS_ASSUME_NONNULL_END
@@ -22,8 +22,17 @@
     if (CMTIME_IS_NUMERIC(dur)) {
         pts = CMTimeAdd(pts, dur);
     }
+    if (!CMTIME_IS_NUMERIC(pts)) return 0.0f;
+    return [self progressPercentForSeconds:CMTimeGetSeconds(pts) start:start end:end];
+}
+
++ (float)progressPercentForSeconds:(Float64)seconds
+                             start:(CMTime)start
+                               end:(CMTime)end
+{
+    if (isnan(seconds)) return 0.0f;
     if (!CMTIME_IS_NUMERIC(start) || !CMTIME_IS_NUMERIC(end)) return 0.0f;
-    Float64 offsetSec = CMTimeGetSeconds(CMTimeSubtract(pts, start));
+    Float64 offsetSec = seconds - CMTimeGetSeconds(start);
     Float64 lenSec = CMTimeGetSeconds(CMTimeSubtract(end, start));
     if (lenSec <= 0.0) return 0.0f;
     Float64 progress = offsetSec / lenSec;
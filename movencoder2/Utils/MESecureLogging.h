@@ -23,6 +23,16 @@
 
 #import <Foundation/Foundation.h>
 
+// Log level gate; values match MELogLevel (0 = silent, 1 = error, 2 = info, 3 = debug).
+// Messages above the current level are dropped before formatting. Default is debug.
+void SecureLogSetLevel(NSInteger level);
+NSInteger SecureLogGetLevel(void);
+BOOL SecureLogIsEnabled(NSInteger level);
+
+// Messages are queued on a lock-free ring and written by a background thread.
+// Blocks until queued messages are written (also runs at exit).
+void SecureLogFlush(void);
+
 // Secure logging functions (prevent format-string attacks)
 void SecureLog(NSString* message);
 void SecureErrorLog(NSString* message);
@@ -14,6 +14,35 @@
 
 #import <libavutil/log.h>
 
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Values match MELogLevel
+enum {
+    kLogLevelSilent = 0,
+    kLogLevelError  = 1,
+    kLogLevelInfo   = 2,
+    kLogLevelDebug  = 3,
+};
+
+static atomic_long gLogLevel = kLogLevelDebug;
+
+void SecureLogSetLevel(NSInteger level) {
+    atomic_store_explicit(&gLogLevel, (long)level, memory_order_relaxed);
+}
+
+NSInteger SecureLogGetLevel(void) {
+    return atomic_load_explicit(&gLogLevel, memory_order_relaxed);
+}
+
+BOOL SecureLogIsEnabled(NSInteger level) {
+    return level <= atomic_load_explicit(&gLogLevel, memory_order_relaxed);
+}
+
+/* =================================================================================== */
+// MARK: - Sanitizer
+/* =================================================================================== */
+
 typedef NS_OPTIONS(NSUInteger, SanitizeOptions) {
     SanitizeOptionsNone = 0,
     SanitizeOptionsEscapePercent = 1 << 0,
@@ -22,24 +51,40 @@ typedef NS_OPTIONS(NSUInteger, SanitizeOptions) {
     SanitizeOptionsEscapeCarriageReturn = 1 << 3
 };
 
+static inline NSString* _Nullable escapeFor(unichar c, SanitizeOptions options) {
+    switch (c) {
+        case '%':  return (options & SanitizeOptionsEscapePercent) ? @"%%" : nil;
+        case '\n': return (options & SanitizeOptionsEscapeNewline) ? @"\\n" : nil;
+        case '\t': return (options & SanitizeOptionsEscapeTab) ? @"\\t" : nil;
+        case '\r': return (options & SanitizeOptionsEscapeCarriageReturn) ? @"\\r" : nil;
+        default:   return nil;
+    }
+}
+
+// Single pass; returns the input itself when nothing needs escaping
 static NSString* sanitizeStringWithOptions(NSString* input, SanitizeOptions options) {
     if (!input) return @"(null)";
     
-    NSString* result = input;
+    CFStringRef str = (__bridge CFStringRef)input;
+    CFIndex length = CFStringGetLength(str);
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer(str, &buffer, CFRangeMake(0, length));
     
-    if (options & SanitizeOptionsEscapePercent) {
-        result = [result stringByReplacingOccurrencesOfString:@"%" withString:@"%%"];
-    }
-    if (options & SanitizeOptionsEscapeNewline) {
-        result = [result stringByReplacingOccurrencesOfString:@"\n" withString:@"\\n"];
-    }
-    if (options & SanitizeOptionsEscapeTab) {
-        result = [result stringByReplacingOccurrencesOfString:@"\t" withString:@"\\t"];
-    }
-    if (options & SanitizeOptionsEscapeCarriageReturn) {
-        result = [result stringByReplacingOccurrencesOfString:@"\r" withString:@"\\r"];
+    NSMutableString* result = nil;
+    CFIndex copied = 0;     // input[0..copied) is already in result
+    for (CFIndex i = 0; i < length; i++) {
+        unichar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        NSString* escape = escapeFor(c, options);
+        if (!escape) continue;
+        if (!result) {
+            result = [NSMutableString stringWithCapacity:length + 16];
+        }
+        [result appendString:[input substringWithRange:NSMakeRange(copied, i - copied)]];
+        [result appendString:escape];
+        copied = i + 1;
     }
-    
+    if (!result) return input;
+    [result appendString:[input substringFromIndex:copied]];
     return result;
 }
 
@@ -53,51 +98,171 @@ NSString* sanitizeLogString(NSString* input) {
     return sanitizeStringWithOptions(input, SanitizeOptionsEscapePercent | SanitizeOptionsEscapeNewline | SanitizeOptionsEscapeTab);
 }
 
+/* =================================================================================== */
+// MARK: - Asynchronous writer
+/* =================================================================================== */
+
+// Bounded MPSC ring (Vyukov): producers claim a cell with CAS on enqueuePos and publish
+// it through the cell sequence; the single writer thread consumes in order.
+#define kLogRingSize 4096   // power of two
+
+typedef struct {
+    _Atomic(size_t) sequence;
+    void* message;          // retained NSString
+} LogCell;
+
+static LogCell gLogRing[kLogRingSize];
+static _Atomic(size_t) gEnqueuePos = 0;
+static size_t gDequeuePos = 0;                  // writer thread only
+static _Atomic(uint64_t) gLogWritten = 0;       // messages handed to NSLog
+static _Atomic(uint64_t) gLogQueued = 0;        // messages accepted by the ring
+static dispatch_semaphore_t gLogSemaphore = NULL;
+static pthread_once_t gLogOnce = PTHREAD_ONCE_INIT;
+
+static BOOL ringEnqueue(void* message) {
+    size_t pos = atomic_load_explicit(&gEnqueuePos, memory_order_relaxed);
+    LogCell* cell = NULL;
+    while (TRUE) {
+        cell = &gLogRing[pos & (kLogRingSize - 1)];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&gEnqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return NO;      // full
+        } else {
+            pos = atomic_load_explicit(&gEnqueuePos, memory_order_relaxed);
+        }
+    }
+    cell->message = message;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return YES;
+}
+
+static void* _Nullable ringDequeue(void) {
+    LogCell* cell = &gLogRing[gDequeuePos & (kLogRingSize - 1)];
+    size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(gDequeuePos + 1) != 0) return NULL;
+    void* message = cell->message;
+    cell->message = NULL;
+    atomic_store_explicit(&cell->sequence, gDequeuePos + kLogRingSize, memory_order_release);
+    gDequeuePos += 1;
+    return message;
+}
+
+static void* logWriterMain(void* unused) {
+    pthread_setname_np("com.movencoder2.SecureLogging");
+    while (TRUE) {
+        @autoreleasepool {
+            void* message = NULL;
+            while ((message = ringDequeue()) != NULL) {
+                NSString* line = CFBridgingRelease(message);
+                NSLog(@"%@", line);
+                atomic_fetch_add_explicit(&gLogWritten, 1, memory_order_release);
+            }
+        }
+        // Timeout covers a producer which published just after the ring looked empty
+        dispatch_semaphore_wait(gLogSemaphore, dispatch_time(DISPATCH_TIME_NOW, 100 * NSEC_PER_MSEC));
+    }
+    return NULL;
+}
+
+static void startLogWriter(void) {
+    for (size_t i = 0; i < kLogRingSize; i++) {
+        atomic_init(&gLogRing[i].sequence, i);
+        gLogRing[i].message = NULL;
+    }
+    gLogSemaphore = dispatch_semaphore_create(0);
+    
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attr, logWriterMain, NULL);
+    pthread_attr_destroy(&attr);
+    
+    atexit(SecureLogFlush);
+}
+
+static void emitLine(NSString* prefix, NSString* message) {
+    NSString* line = [prefix stringByAppendingString:sanitizeForOutput(message)];
+    pthread_once(&gLogOnce, startLogWriter);
+    if (ringEnqueue((void*)CFBridgingRetain(line))) {
+        atomic_fetch_add_explicit(&gLogQueued, 1, memory_order_relaxed);
+        dispatch_semaphore_signal(gLogSemaphore);
+    } else {
+        // Ring is full: never block the caller; write directly (ordering may interleave)
+        NSLog(@"%@", line);
+    }
+}
+
+void SecureLogFlush(void) {
+    if (!gLogSemaphore) return;
+    uint64_t target = atomic_load_explicit(&gLogQueued, memory_order_relaxed);
+    CFAbsoluteTime limit = CFAbsoluteTimeGetCurrent() + 2.0;
+    while (atomic_load_explicit(&gLogWritten, memory_order_acquire) < target) {
+        if (CFAbsoluteTimeGetCurrent() > limit) break;     // writer is stuck; do not hang exit
+        dispatch_semaphore_signal(gLogSemaphore);
+        usleep(1000);
+    }
+}
+
+/* =================================================================================== */
+// MARK: - Public API
+/* =================================================================================== */
+
 void SecureLog(NSString* message) {
-    NSString* out = sanitizeForOutput(message);
-    NSLog(@"[INFO] %@", out);
+    if (!SecureLogIsEnabled(kLogLevelInfo)) return;
+    emitLine(@"[INFO] ", message);
 }
 
 void SecureErrorLog(NSString* message) {
-    NSString* out = sanitizeForOutput(message);
-    NSLog(@"[ERROR] %@", out);
+    if (!SecureLogIsEnabled(kLogLevelError)) return;
+    emitLine(@"[ERROR] ", message);
 }
 
 void SecureDebugLog(NSString* message) {
-    NSString* out = sanitizeForOutput(message);
-    NSLog(@"[DEBUG] %@", out);
+    if (!SecureLogIsEnabled(kLogLevelDebug)) return;
+    emitLine(@"[DEBUG] ", message);
 }
 
 void SecureLogf(NSString* format, ...) {
+    if (!SecureLogIsEnabled(kLogLevelInfo)) return;
     va_list args;
     va_start(args, format);
     NSString* formatted = [[NSString alloc] initWithFormat:format arguments:args];
     va_end(args);
-    NSString* out = sanitizeForOutput(formatted);
-    NSLog(@"[INFO] %@", out);
+    emitLine(@"[INFO] ", formatted);
 }
 
 void SecureErrorLogf(NSString* format, ...) {
+    if (!SecureLogIsEnabled(kLogLevelError)) return;
     va_list args;
     va_start(args, format);
     NSString* formatted = [[NSString alloc] initWithFormat:format arguments:args];
     va_end(args);
-    NSString* out = sanitizeForOutput(formatted);
-    NSLog(@"[ERROR] %@", out);
+    emitLine(@"[ERROR] ", formatted);
 }
 
 void SecureDebugLogf(NSString* format, ...) {
+    if (!SecureLogIsEnabled(kLogLevelDebug)) return;
     va_list args;
     va_start(args, format);
     NSString* formatted = [[NSString alloc] initWithFormat:format arguments:args];
     va_end(args);
-    NSString* out = sanitizeForOutput(formatted);
-    NSLog(@"[DEBUG] %@", out);
+    emitLine(@"[DEBUG] ", formatted);
 }
 
 static void ffmpeg_log_callback(void *ptr, int level, const char *fmt, va_list vl) {
     // Respect global FFmpeg log level
     if (level > av_log_get_level()) return;
+    // ... and our own gate, before formatting anything
+    NSInteger ourLevel = (level <= AV_LOG_ERROR ? kLogLevelError :
+                          level <= AV_LOG_INFO ? kLogLevelInfo : kLogLevelDebug);
+    if (!SecureLogIsEnabled(ourLevel)) return;
     // Compose message
     va_list vl_copy;
     va_copy(vl_copy, vl);
@@ -0,0 +1,65 @@
+//
+//  METrace.h
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+/**
+ * @header METrace.h
+ * @abstract Internal API - Per-frame lifecycle tracer with Chrome trace-event output
+ * @discussion
+ * This header is part of the internal implementation of movencoder2.
+ * It is not intended for public use and its interface may change without notice.
+ *
+ * METrace records one complete event (begin, duration, stage, PTS, bytes) per
+ * instrumented pipeline call. It shares the probes of MEMetrics, so every
+ * MEMetricsBegin()/MEMetricsEndPTS() pair becomes a trace event while tracing.
+ *
+ * Events go into per-thread chunked buffers: the owning thread appends without
+ * locks and publishes each event with a release store; new thread buffers are
+ * pushed onto a global list with compare-and-swap. Chunks are never reallocated,
+ * so a long encode only costs memory proportional to its event count.
+ *
+ * Buffers are only freed at quiescence: METraceStart() and METraceDiscard()
+ * disable recording, make every thread cache stale and wait until no
+ * METraceRecord() call is in flight before freeing them. METraceStop() waits
+ * for the calls in flight too, so METraceWriteToURL() sees a stable set.
+ *
+ * @internal This is an internal API. Do not use directly.
+ */
+
+#ifndef METrace_h
+#define METrace_h
+
+@import Foundation;
+
+#import "MEMetrics.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Discard previous events and start recording.
+void METraceStart(void);
+
+/// Stop recording; recorded events are kept until METraceDiscard() or the next METraceStart().
+void METraceStop(void);
+
+/// Stop recording and free the recorded events, i.e. after METraceWriteToURL().
+void METraceDiscard(void);
+
+/// Append one event from the calling thread. Normally called via MEMetricsEndPTS().
+void METraceRecord(MEMetricsStage stage, uint64_t beginNanos, uint64_t endNanos,
+                   uint64_t bytes, double pts);
+
+/// Number of events recorded since METraceStart()
+uint64_t METraceEventCount(void);
+
+/// Write recorded events as Chrome/Perfetto trace JSON ("traceEvents" array); replaced atomically.
+BOOL METraceWriteToURL(NSURL* url, NSError * _Nullable * _Nullable error);
+
+NS_ASSUME_NONNULL_END
+
+#endif /* METrace_h */
@@ -0,0 +1,257 @@
+//
+//  METrace.m
+//  movencoder2
+//
+//  Created by Takashi Mochizuki on 2026/10/18.
+//
+//  Copyright (C) 2018-2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+#import "MECommon.h"
+#import "METrace.h"
+#import "MESecureLogging.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+#define kTraceChunkEvents 4096      // 160 KiB per chunk
+
+typedef struct {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t bytes;
+    double pts;
+    int32_t stage;
+} METraceEvent;
+
+typedef struct METraceChunk {
+    _Atomic(struct METraceChunk*) next;
+    _Atomic(uint32_t) count;            // published events; written by owner only
+    METraceEvent events[kTraceChunkEvents];
+} METraceChunk;
+
+typedef struct METraceThreadBuffer {
+    struct METraceThreadBuffer* nextBuffer;     // registry link; immutable once published
+    uint64_t tid;
+    char name[64];
+    METraceChunk* head;
+    METraceChunk* tail;                         // owner only
+} METraceThreadBuffer;
+
+static _Atomic(METraceThreadBuffer*) gTraceBuffers = NULL;
+static _Atomic(uint64_t) gTraceGeneration = 0;
+static _Atomic(uint64_t) gTraceEventCount = 0;
+static _Atomic(uint64_t) gTraceInFlight = 0;     // METraceRecord calls that may hold a buffer pointer
+static uint64_t gTraceOrigin = 0;
+
+// Per-thread cache; the generation tells a stale pointer from the current registry
+static __thread METraceThreadBuffer* tlsBuffer = NULL;
+static __thread uint64_t tlsGeneration = 0;
+
+static METraceChunk* newChunk(void) {
+    METraceChunk* chunk = malloc(sizeof(METraceChunk));
+    if (chunk) {
+        atomic_init(&chunk->next, NULL);
+        atomic_init(&chunk->count, 0);
+    }
+    return chunk;
+}
+
+static METraceThreadBuffer* currentThreadBuffer(void) {
+    uint64_t generation = atomic_load_explicit(&gTraceGeneration, memory_order_acquire);
+    if (tlsBuffer && tlsGeneration == generation) return tlsBuffer;
+
+    METraceThreadBuffer* buffer = calloc(1, sizeof(METraceThreadBuffer));
+    if (!buffer) return NULL;
+    buffer->head = buffer->tail = newChunk();
+    if (!buffer->head) {
+        free(buffer);
+        return NULL;
+    }
+    pthread_threadid_np(NULL, &buffer->tid);
+    if (pthread_getname_np(pthread_self(), buffer->name, sizeof(buffer->name)) != 0 || buffer->name[0] == 0) {
+        const char* label = dispatch_queue_get_label(DISPATCH_CURRENT_QUEUE_LABEL);
+        strlcpy(buffer->name, (label ? label : "thread"), sizeof(buffer->name));
+    }
+
+    METraceThreadBuffer* top = atomic_load_explicit(&gTraceBuffers, memory_order_relaxed);
+    do {
+        buffer->nextBuffer = top;
+    } while (!atomic_compare_exchange_weak_explicit(&gTraceBuffers, &top, buffer,
+                                                    memory_order_release, memory_order_relaxed));
+    tlsBuffer = buffer;
+    tlsGeneration = generation;
+    return buffer;
+}
+
+static void freeBuffers(METraceThreadBuffer* buffer) {
+    while (buffer) {
+        METraceThreadBuffer* nextBuffer = buffer->nextBuffer;
+        METraceChunk* chunk = buffer->head;
+        while (chunk) {
+            METraceChunk* next = atomic_load_explicit(&chunk->next, memory_order_relaxed);
+            free(chunk);
+            chunk = next;
+        }
+        free(buffer);
+        buffer = nextBuffer;
+    }
+}
+
+/// Wait until no METraceRecord call started before tracing was disabled is still running
+static void drainRecorders(void) {
+    while (atomic_load_explicit(&gTraceInFlight, memory_order_seq_cst) != 0) {
+        sched_yield();
+    }
+}
+
+/// Free the buffers at quiescence: tracing off, every thread cache stale and every recorder drained
+static void reclaimBuffers(void) {
+    atomic_fetch_and_explicit(&gMEProbeMask, ~(unsigned)MEProbeTrace, memory_order_seq_cst);
+    atomic_fetch_add_explicit(&gTraceGeneration, 1, memory_order_seq_cst);
+    drainRecorders();
+    freeBuffers(atomic_exchange_explicit(&gTraceBuffers, NULL, memory_order_acq_rel));
+    atomic_store_explicit(&gTraceEventCount, 0, memory_order_relaxed);
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+void METraceStart(void) {
+    reclaimBuffers();
+    gTraceOrigin = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    atomic_fetch_or_explicit(&gMEProbeMask, MEProbeTrace, memory_order_seq_cst);
+}
+
+void METraceStop(void) {
+    atomic_fetch_and_explicit(&gMEProbeMask, ~(unsigned)MEProbeTrace, memory_order_seq_cst);
+    drainRecorders();
+}
+
+void METraceDiscard(void) {
+    reclaimBuffers();
+}
+
+static void recordEvent(MEMetricsStage stage, uint64_t beginNanos, uint64_t endNanos,
+                        uint64_t bytes, double pts) {
+    METraceThreadBuffer* buffer = currentThreadBuffer();
+    if (!buffer) return;
+
+    METraceChunk* chunk = buffer->tail;
+    uint32_t count = atomic_load_explicit(&chunk->count, memory_order_relaxed);
+    if (count == kTraceChunkEvents) {
+        METraceChunk* next = newChunk();
+        if (!next) return;
+        atomic_store_explicit(&chunk->next, next, memory_order_release);
+        buffer->tail = chunk = next;
+        count = 0;
+    }
+    METraceEvent* event = &chunk->events[count];
+    event->begin = beginNanos;
+    event->end = endNanos;
+    event->bytes = bytes;
+    event->pts = pts;
+    event->stage = stage;
+    atomic_store_explicit(&chunk->count, count + 1, memory_order_release);
+    atomic_fetch_add_explicit(&gTraceEventCount, 1, memory_order_relaxed);
+}
+
+void METraceRecord(MEMetricsStage stage, uint64_t beginNanos, uint64_t endNanos,
+                   uint64_t bytes, double pts) {
+    // The caller tested the probe mask earlier; test it again inside the in-flight window, so a
+    // call either sees tracing disabled or is waited for before the buffers are freed
+    atomic_fetch_add_explicit(&gTraceInFlight, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&gMEProbeMask, memory_order_seq_cst) & MEProbeTrace) {
+        recordEvent(stage, beginNanos, endNanos, bytes, pts);
+    }
+    atomic_fetch_sub_explicit(&gTraceInFlight, 1, memory_order_release);
+}
+
+uint64_t METraceEventCount(void) {
+    return atomic_load_explicit(&gTraceEventCount, memory_order_relaxed);
+}
+
+// Thread names may contain anything; keep the JSON valid
+static void writeJSONString(FILE* fp, const char* str) {
+    fputc('"', fp);
+    for (const char* p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            fputc('\\', fp);
+            fputc(c, fp);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+BOOL METraceWriteToURL(NSURL* url, NSError * _Nullable * _Nullable error) {
+    NSString* path = url.path;
+    NSString* tmpPath = [path stringByAppendingFormat:@".%d.tmp", getpid()];
+    FILE* fp = fopen(tmpPath.fileSystemRepresentation, "w");
+    if (!fp) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        SecureErrorLogf(@"[METrace] ERROR: Failed to open %@", tmpPath);
+        return NO;
+    }
+
+    const char* stageNames[MEMetricsStageCount];
+    for (int stage = 0; stage < MEMetricsStageCount; stage++) {
+        stageNames[stage] = MEMetricsStageName(stage).UTF8String;
+    }
+    int pid = getpid();
+    uint64_t origin = gTraceOrigin;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"movencoder2\"}}", pid);
+    METraceThreadBuffer* buffer = atomic_load_explicit(&gTraceBuffers, memory_order_acquire);
+    for (; buffer; buffer = buffer->nextBuffer) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":",
+                pid, buffer->tid);
+        writeJSONString(fp, buffer->name);
+        fputs("}}", fp);
+
+        METraceChunk* chunk = buffer->head;
+        while (chunk) {
+            uint32_t count = atomic_load_explicit(&chunk->count, memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++) {
+                METraceEvent* event = &chunk->events[i];
+                if (event->stage < 0 || event->stage >= MEMetricsStageCount) continue;
+                double ts = (event->begin > origin ? event->begin - origin : 0) / 1000.0;
+                double dur = (event->end > event->begin ? event->end - event->begin : 0) / 1000.0;
+                fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"pid\":%d,\"tid\":%llu,\"args\":{\"bytes\":%llu",
+                        stageNames[event->stage], ts, dur, pid, buffer->tid, event->bytes);
+                if (!isnan(event->pts)) {
+                    fprintf(fp, ",\"pts\":%.6f", event->pts);
+                }
+                fputs("}}", fp);
+            }
+            chunk = atomic_load_explicit(&chunk->next, memory_order_acquire);
+        }
+    }
+    fputs("\n]}\n", fp);
+
+    BOOL result = (ferror(fp) == 0);
+    result = (fclose(fp) == 0) && result;
+    if (result && rename(tmpPath.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+        result = NO;
+    }
+    if (!result) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        SecureErrorLogf(@"[METrace] ERROR: Failed to write trace to %@", path);
+        unlink(tmpPath.fileSystemRepresentation);
+    }
+    return result;
+}
@@ -126,12 +126,12 @@ void startMonitor(monitor_block_t mon, cancel_block_t can) {
     
     // install GCD based signal handler
     signalSrcInstaller(SIGINT, ^{
-        printf("\n");
+        fputs("\n", stderr); // stdout may carry a stream
         SecureLog(@"SIGINT detected");
         cancelAndExit(SIGINT, can); // never returns
     });
     signalSrcInstaller(SIGTERM, ^{
-        printf("\n");
+        fputs("\n", stderr); // stdout may carry a stream
         SecureLog(@"SIGTERM detected");
         cancelAndExit(SIGTERM, can); // never returns
     });
@@ -143,6 +143,7 @@ void startMonitor(monitor_block_t mon, cancel_block_t can) {
 void finishMonitor(int code, NSString* _Nullable msg, NSString* _Nullable errMsg) {
     cancelAllHandlers(timerSource());
     logInfoOrError(msg, errMsg);
+    SecureLogFlush();
     exitAsync(code, timerSource());
 }
 
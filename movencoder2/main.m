@@ -17,6 +17,16 @@
 #import "MEManager.h"
 #import "MEAudioConverter.h"
 #import "MESecureLogging.h"
+#import "MEBatchRunner.h"
+#import "MEJobScheduler.h"
+#import "MEJobServer.h"
+#import "MECheckpointSession.h"
+#import "MEStreamTranscoder.h"
+#import "MESmartRenderSession.h"
+#import "MEConcatSession.h"
+#import "MEMetadataFixer.h"
+#import "MEEDLSession.h"
+#import "MEWorkerEncoderPipeline.h"
 #import <getopt.h>
 
 NS_ASSUME_NONNULL_BEGIN
@@ -36,6 +46,50 @@ static void printUsage(void) {
     printf("  --mevf \"args\"        libavfilter video filter string\n");
     printf("  --mex264/--mex265 \"args\"  libx264/libx265 specific params\n");
     printf("  -c, --co              Copy non-A/V tracks into output (short: -c)\n");
+    printf("  --prefetch \"args\"    Decode read-ahead per track (frames=_;bytes=_)\n");
+    printf("  --slices <n>          Decode an intra-only video track with <n> readers at once\n");
+    printf("  --interleave <sec>    Pace encoded tracks to within <sec> of the slowest\n");
+    printf("  --metrics <file>      Per-stage metrics (.json at exit, else Prometheus textfile)\n");
+    printf("  --trace <file>        Per-frame Chrome/Perfetto trace-event JSON\n");
+    printf("  --layout <mode>       Output layout: faststart (default), moov-end or fragmented\n");
+    printf("  --fragment <sec>      Movie fragment interval; implies --layout fragmented\n");
+    printf("  --segment <sec>       Write CMAF segments, HLS and DASH manifests into <output> dir\n");
+    printf("  --mux <format>        Write the encoded video via libavformat (mp4, mov, mkv, ts,\n");
+    printf("                        nut, ivf, h264, hevc)\n");
+    printf("  --decoder <n>         With --mux, decode via libavcodec on <n> threads (0 = auto)\n");
+    printf("  --lowlatency          Zero-latency encode; logs frame-in to packet-out percentiles\n");
+    printf("  --encoder-worker      Run the video encoder in a child process, restarted on a crash\n");
+    printf("  --affinity            Keep filter/encoder threads of each video track on one cache domain\n");
+    printf("  --cache <dir>         Reuse outputs of identical input and settings from <dir>\n");
+    printf("  --cache-size <GB>     Result cache size limit (default 20)\n");
+    printf("  --start <sec>         Start of the range to export\n");
+    printf("  --end <sec>           End of the range to export\n");
+    printf("  --smart               With --start/--end, re-encode only the GOPs at the cuts\n");
+    printf("  --fixup \"args\"       Rewrite color/aspect/field tags and SPS VUI; samples are copied\n");
+    printf("  --concat <file>       Join the movies listed in <file> (one per line) instead of -i\n");
+    printf("  --edl <file>          Export the clips listed in <file> (start end output per line)\n");
+    printf("                        from -i in one decode pass instead of -o\n");
+    printf("  --batch <file>        Run jobs from a JSON lines file; other options are shared\n");
+    printf("  --jobs <n>            Number of batch jobs running at once (default 1)\n");
+    printf("  --serve <socket>      Run a job server on a Unix domain socket\n");
+    printf("  --cores <n>           Cores the job server splits across jobs\n");
+    printf("  --submit <socket>     Send this job to a job server and wait for it\n");
+    printf("  --deadline <sec>      Deadline of the submitted job from now\n");
+    printf("  --cancel <id>         With --submit, cancel a job instead\n");
+    printf("  --status <socket>     Show jobs of a job server\n");
+    printf("  --checkpoint <sec>    Export in resumable parts of about <sec> seconds\n");
+    printf("  --stdin <format>      Read raw video from stdin (y4m, nut or auto); libav only\n");
+    printf("  --stdout <format>     Write the video to stdout (h264, hevc, ivf, nut, ts, mkv)\n");
+    printf("  --follow <sec>        Encode a file still being recorded; end after <sec> idle\n");
+    printf("  --done <file>         With --follow, end once <file> exists (default <input>.done)\n");
+}
+
+// -mux/-stdout format name to libavformat muxer name
+static NSDictionary<NSString*, NSString*>* muxerFormatNames(void) {
+    return @{@"mp4": @"mp4", @"mov": @"mov",
+             @"mkv": @"matroska", @"matroska": @"matroska",
+             @"ts": @"mpegts", @"mpegts": @"mpegts",
+             @"nut": @"nut", @"ivf": @"ivf", @"h264": @"h264", @"hevc": @"hevc"};
 }
 
 #if 1
@@ -271,6 +325,29 @@ error:
     return FALSE;
 }
 
+/*
+ # -fixup "options"
+ # primaries=_; color primaries (code point or name: bt709, bt2020, smpte432, ...)
+ #  transfer=_; transfer function (code point or name: bt709, smpte2084, arib-std-b67, ...)
+ #    matrix=_; YCbCr matrix (code point or name: bt709, bt2020nc, smpte170m, ...)
+ #     range=_; full or limited
+ #       sar=_; sample aspect ratio (i.e. 40:33)
+ #     field=_; progressive, tff or bff
+ */
+static NSDictionary<NSString*, NSString*>* _Nullable parseOptFixup(NSString* param) {
+    NSMutableDictionary<NSString*, NSString*>* options = [NSMutableDictionary dictionary];
+    NSArray* optArray = [param componentsSeparatedByString:separator];
+    for (NSString* opt in optArray) {
+        NSArray* optParse = [opt componentsSeparatedByString:equal];
+        if (optParse.count != 2 || ![[MEMetadataFixer optionNames] containsObject:optParse[0]]) {
+            SecureErrorLogf(@"ERROR: Invalid option string: %@", opt);
+            return nil;
+        }
+        options[optParse[0]] = optParse[1];
+    }
+    return options;
+}
+
 /*
  # -ve "options" (or -v "options")
  # bitrate=_; video bit rate (i.e. 2.5M, 5M, 10M, 20M, ...)
@@ -409,6 +486,43 @@ error:
     return FALSE;
 }
 
+/*
+ # -prefetch "options"
+ # frames=_; maximum number of decoded frames queued ahead per track (i.e. 4, 8, 16)
+ #  bytes=_; maximum bytes queued ahead per track (i.e. 64M, 256M, 1G)
+ */
+static BOOL parseOptPrefetch(NSString* param, METranscoder* coder) {
+    NSArray* optArray = [param componentsSeparatedByString:separator];
+    for (NSString* opt in optArray) {
+        NSArray* optParse = [opt componentsSeparatedByString:equal];
+        if (optParse.count != 2) {
+            SecureErrorLogf(@"ERROR: Invalid option string: %@", opt);
+            goto error;
+        }
+        NSString* key = optParse[0];
+        NSString* val = optParse[1];
+        if ([key isEqualToString:@"frames"]) {
+            if (val == nil || val.length == 0) goto error;
+            NSNumber* framesNum = parseInteger(val);
+            if (nil == framesNum || framesNum.intValue < 0) goto error;
+            coder.param[kPrefetchFramesKey] = framesNum;
+        } else if ([key isEqualToString:@"bytes"]) {
+            if (val == nil || val.length == 0) goto error;
+            NSNumber* bytesNum = parseDouble(val);
+            if (nil == bytesNum || bytesNum.doubleValue < 0) goto error;
+            coder.param[kPrefetchBytesKey] = @(bytesNum.longLongValue);
+        } else {
+            SecureErrorLogf(@"ERROR: Unknown prefetch option: %@", key);
+            goto error;
+        }
+    }
+    
+    return TRUE;
+    
+error:
+    return FALSE;
+}
+
 /*
  ### MEManager.h
  extern NSString* const kMEVECodecNameKey;       // ffmpeg -c:v libx264
@@ -435,91 +549,54 @@ error:
  extern NSString* const kAudioCodecKey;      // NSString representation of OSType
  */
 
-static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
-    BOOL verbose = FALSE;
-    BOOL dump = FALSE;
-    BOOL debug = FALSE;
-    NSURL* input = nil;
-    NSURL* output = nil;
-    NSString* meve = nil;
-    NSString* mevf = nil;
-    NSString* mex264 = nil;
-    NSString* mex265 = nil;
-    NSString* ve = nil;
-    NSString* ae = nil;
-    BOOL copyOthers = FALSE;
-    
-    METranscoder* transcoder = nil;
-    NSArray *videoTracks = nil;
-    NSArray *audioTracks = nil;
-    
+// Options of a movie transcode; the value is the long option name used in the parsed option dictionary
+static const struct option transcodeLongOpts[] = {
+    {"verbose", no_argument, NULL, 'V'},
+    {"dump", no_argument, NULL, 'D'},
+    {"debug", no_argument, NULL, 'd'},
+    {"in", required_argument, NULL, 'i'},
+    {"out", required_argument, NULL, 'o'},
+    {"ve", required_argument, NULL, 'v'},
+    {"ae", required_argument, NULL, 'a'},
+    {"co", no_argument, NULL, 'c'},
+    {"help", no_argument, NULL, 'h'},
+    {"meve", required_argument, NULL, -128},
+    {"mevf", required_argument, NULL, -129},
+    {"mex264", required_argument, NULL, -264},
+    {"mex265", required_argument, NULL, -265},
+    {"prefetch", required_argument, NULL, -130},
+    {"interleave", required_argument, NULL, -131},
+    {"metrics", required_argument, NULL, -132},
+    {"trace", required_argument, NULL, -133},
+    {"layout", required_argument, NULL, -134},
+    {"fragment", required_argument, NULL, -135},
+    {"segment", required_argument, NULL, -136},
+    {"mux", required_argument, NULL, -137},
+    {"decoder", required_argument, NULL, -138},
+    {"lowlatency", no_argument, NULL, -139},
+    {"cache", required_argument, NULL, -140},
+    {"cache-size", required_argument, NULL, -141},
+    {"start", required_argument, NULL, -142},
+    {"end", required_argument, NULL, -143},
+    {"fixup", required_argument, NULL, -144},
+    {"slices", required_argument, NULL, -145},
+    {"encoder-worker", no_argument, NULL, -146},
+    {"affinity", no_argument, NULL, -147},
+    {0,0,0,0}
+};
+
+// Collect the options by long name; flags get an empty string. NO on an unknown option or -help in a job
+static BOOL scanTranscodeOpt(int argc, char * const * argv, BOOL batch, NSMutableDictionary<NSString*, NSString*>* opts) {
     const char* shortopts = "VDdi:o:v:a:ch";
-    static struct option longopts[] = {
-        {"verbose", no_argument, NULL, 'V'},
-        {"dump", no_argument, NULL, 'D'},
-        {"debug", no_argument, NULL, 'd'},
-        {"in", required_argument, NULL, 'i'},
-        {"out", required_argument, NULL, 'o'},
-        {"ve", required_argument, NULL, 'v'},
-        {"ae", required_argument, NULL, 'a'},
-        {"co", no_argument, NULL, 'c'},
-        {"help", no_argument, NULL, 'h'},
-        {"meve", required_argument, NULL, -128},
-        {"mevf", required_argument, NULL, -129},
-        {"mex264", required_argument, NULL, -264},
-        {"mex265", required_argument, NULL, -265},
-        {0,0,0,0}
-    };
-    
     int opt, longindex;
     opterr = 0;
-    while ((opt = getopt_long_only(argc, argv, shortopts, longopts, &longindex)) != -1) {
+    optreset = 1; // validateOpt is called once per batch job
+    optind = 1;
+    while ((opt = getopt_long_only(argc, argv, shortopts, transcodeLongOpts, &longindex)) != -1) {
         @autoreleasepool {
-            // Use nil when optarg is absent so parsers can distinguish missing value
-            NSString* val = optarg ? [NSString stringWithUTF8String:optarg] : nil;
-            switch (opt) {
-            case 'V':
-                verbose = TRUE;
-                break;
-            case 'D':
-                dump = TRUE;
-                break;
-            case 'd':
-                debug = TRUE;
-                break;
-            case 'i':
-                input = val ? [NSURL fileURLWithPath:val] : nil;
-                break;
-            case 'o':
-                output = val ? [NSURL fileURLWithPath:val] : nil;
-                break;
-            case 'v':
-                ve = val;
-                break;
-            case 'a':
-                ae = val;
-                break;
-            case 'c':
-                // -co is a flag without argument; mark copyOthers true
-                copyOthers = TRUE;
-                break;
-            case 'h':
-                printUsage();
-                exit(EXIT_SUCCESS);
-                break;
-            case -128:
-                meve = val;
-                break;
-            case -129:
-                mevf = val;
-                break;
-            case -264:
-                mex264 = val;
-                break;
-            case -265:
-                mex265 = val;
-                break;
-            default: {
+            const struct option* entry = transcodeLongOpts;
+            while (entry->name && entry->val != opt) entry++;
+            if (!entry->name) {
                 // Safely select a parameter string to print; guard against out-of-bounds optind
                 const char *paramStr = "unknown";
                 if (optind < argc && argv[optind]) {
@@ -530,88 +607,94 @@ static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
                     paramStr = optarg;
                 }
                 SecureErrorLogf(@"ERROR: unknown parameter = \"%s\"", paramStr);
-                goto error;
+                return NO;
             }
-                break;
-        }
+            if (opt == 'h') {
+                if (batch) {
+                    SecureErrorLog(@"ERROR: -help is not available for a job.");
+                    return NO;
+                }
+                printUsage();
+                exit(EXIT_SUCCESS);
+            }
+            // Use an empty string for flags so a missing value of other options stays distinguishable
+            NSString* name = [NSString stringWithUTF8String:entry->name];
+            opts[name] = optarg ? [NSString stringWithUTF8String:optarg] : @"";
         }
     }
+    return YES;
+}
+
+// Resolve -i/-o and check that the input is readable and the output directory writable
+static BOOL parsePathOpt(NSDictionary<NSString*, NSString*>* opts, NSURL* _Nullable * _Nonnull input,
+                         NSURL* _Nullable * _Nonnull output) {
+    NSURL* inURL = opts[@"in"].length ? [NSURL fileURLWithPath:opts[@"in"]] : nil;
+    NSURL* outURL = opts[@"out"].length ? [NSURL fileURLWithPath:opts[@"out"]] : nil;
     
     // Enhanced path validation and normalization
-    input = input ? [[input URLByResolvingSymlinksInPath] URLByStandardizingPath] : nil;
-    output = output ? [[output URLByResolvingSymlinksInPath] URLByStandardizingPath] : nil;
-    if (!(input && output)) {
+    inURL = inURL ? [[inURL URLByResolvingSymlinksInPath] URLByStandardizingPath] : nil;
+    outURL = outURL ? [[outURL URLByResolvingSymlinksInPath] URLByStandardizingPath] : nil;
+    if (!(inURL && outURL)) {
         SecureErrorLog(@"ERROR: Either input or output is not available.");
-        goto error;
-    } else {
-        // Comprehensive security validation for input/output paths
-        if (!isAllowedPath(input)) {
-            SecureErrorLogf(@"ERROR: Input file path security validation failed: %@", input.path);
-            goto error;
-        }
-        if (!isAllowedPath(output)) {
-            SecureErrorLogf(@"ERROR: Output file path security validation failed: %@", output.path);
-            goto error;
-        }
-        
-        // Additional validation: Check if input file exists and is readable
-        NSFileManager *fm = [NSFileManager defaultManager];
-        if (![fm fileExistsAtPath:input.path]) {
-            SecureErrorLogf(@"ERROR: Input file does not exist: %@", input.path);
-            goto error;
-        }
-        if (![fm isReadableFileAtPath:input.path]) {
-            SecureErrorLogf(@"ERROR: Input file is not readable: %@", input.path);
-            goto error;
-        }
-        
-        // Check output directory exists and is writable
-        NSString *outputDir = [output.path stringByDeletingLastPathComponent];
-        if (![fm fileExistsAtPath:outputDir]) {
-            SecureErrorLogf(@"ERROR: Output directory does not exist: %@", outputDir);
-            goto error;
-        }
-        if (![fm isWritableFileAtPath:outputDir]) {
-            SecureErrorLogf(@"ERROR: Output directory is not writable: %@", outputDir);
-            goto error;
-        }
-        
-        // Prevent overwriting existing files without explicit confirmation
-        if ([fm fileExistsAtPath:output.path]) {
-            SecureLogf(@"WARNING: Output file already exists and will be overwritten: %@", output.path);
-        }
+        return NO;
+    }
+    // Comprehensive security validation for input/output paths
+    if (!isAllowedPath(inURL)) {
+        SecureErrorLogf(@"ERROR: Input file path security validation failed: %@", inURL.path);
+        return NO;
+    }
+    if (!isAllowedPath(outURL)) {
+        SecureErrorLogf(@"ERROR: Output file path security validation failed: %@", outURL.path);
+        return NO;
     }
     
-    // Quick Options Check
-    if (ve != NULL) {
-        if (meve || mex264 || mex265) {
-            SecureErrorLog(@"ERROR: -ve is not compatible with -meve/-mex264/-mex265.");
-            goto error;
-        }
+    // Additional validation: Check if input file exists and is readable
+    NSFileManager *fm = [NSFileManager defaultManager];
+    if (![fm fileExistsAtPath:inURL.path]) {
+        SecureErrorLogf(@"ERROR: Input file does not exist: %@", inURL.path);
+        return NO;
     }
-    if (mex264 && mex265) {
-        SecureErrorLog(@"ERROR: Either -mex264 or -mex265 should be used.");
-        goto error;
+    if (![fm isReadableFileAtPath:inURL.path]) {
+        SecureErrorLogf(@"ERROR: Input file is not readable: %@", inURL.path);
+        return NO;
     }
     
-    // Instanciate METranscoder
-    transcoder = [METranscoder transcoderWithInput:input output:output];
-    if (!transcoder) {
-        SecureErrorLog(@"ERROR: Invalid input or output.");
-        goto error;
+    // Check output directory exists and is writable
+    NSString *outputDir = [outURL.path stringByDeletingLastPathComponent];
+    if (![fm fileExistsAtPath:outputDir]) {
+        SecureErrorLogf(@"ERROR: Output directory does not exist: %@", outputDir);
+        return NO;
+    }
+    if (![fm isWritableFileAtPath:outputDir]) {
+        SecureErrorLogf(@"ERROR: Output directory is not writable: %@", outputDir);
+        return NO;
     }
     
-    // Configure METranscoder with meve/mevf/mex264/mex265 or ve/ae/co
-    {
-        NSArray *vList = [transcoder.inMovie tracksWithMediaType:AVMediaTypeVideo];
-        NSArray *mList = [transcoder.inMovie tracksWithMediaType:AVMediaTypeMuxed];
-        videoTracks = [vList arrayByAddingObjectsFromArray:mList];
-        audioTracks = [transcoder.inMovie tracksWithMediaType:AVMediaTypeAudio];
+    // Prevent overwriting existing files without explicit confirmation
+    if ([fm fileExistsAtPath:outURL.path]) {
+        SecureLogf(@"WARNING: Output file already exists and will be overwritten: %@", outURL.path);
     }
+    *input = inURL;
+    *output = outURL;
+    return YES;
+}
+
+// -meve/-mevf/-mex264/-mex265 (libavcodec per video track) or -ve (AVFoundation), and libavcodec encoder modes
+static BOOL parseVideoOpt(NSDictionary<NSString*, NSString*>* opts, METranscoder* transcoder) {
+    NSString* meve = opts[@"meve"];
+    NSString* mevf = opts[@"mevf"];
+    NSString* mex264 = opts[@"mex264"];
+    NSString* mex265 = opts[@"mex265"];
+    NSString* ve = opts[@"ve"];
+    BOOL libavVideo = (meve || mex264 || mex265);
+    
+    NSArray *vList = [transcoder.inMovie tracksWithMediaType:AVMediaTypeVideo];
+    NSArray *mList = [transcoder.inMovie tracksWithMediaType:AVMediaTypeMuxed];
+    NSArray *videoTracks = [vList arrayByAddingObjectsFromArray:mList];
     if (meve || mevf) {
         if (videoTracks.count == 0) {
             SecureErrorLog(@"ERROR: No video track is available.");
-            goto error;
+            return NO;
         }
         // setup MEManager for each video tracks
         for (AVAssetTrack* track in videoTracks) {
@@ -620,7 +703,7 @@ static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
             if (meve) {
                 if (parseOptMEVE(meve, manager) == FALSE) {
                     SecureErrorLog(@"ERROR: Video parameter meve is invalid.");
-                    goto error;
+                    return NO;
                 }
                 if (mex264) {
                     manager.videoEncoderSetting[kMEVEx264_paramsKey] = mex264;
@@ -633,9 +716,9 @@ static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
                 manager.videoFilterString = mevf;
             }
             manager.initialDelayInSec = initialDelayInSec;
-            manager.verbose = verbose;
+            manager.verbose = (opts[@"verbose"] != nil);
             [transcoder registerMEManager:manager forTrackID:trackID];
-            if (debug) {
+            if (opts[@"debug"]) {
                 manager.log_level = 48; //AV_LOG_DEBUG
             }
         }
@@ -643,49 +726,219 @@ static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
     if (ve) {
         if (videoTracks.count == 0) {
             SecureErrorLog(@"ERROR: No video track is available.");
-            goto error;
+            return NO;
         }
         if (parseOptVE(ve, transcoder) == FALSE) {
             SecureErrorLog(@"ERROR: Video parameter ve is invalid.");
-            goto error;
+            return NO;
         }
     }
-    if (ae) {
-        if (audioTracks.count == 0) {
-            SecureErrorLog(@"ERROR: No audio track is available.");
-            goto error;
+    if (opts[@"lowlatency"]) {
+        if (!libavVideo) {
+            SecureErrorLog(@"ERROR: -lowlatency requires -meve.");
+            return NO;
         }
-        if (parseOptAE(ae, transcoder) == FALSE) {
-            SecureErrorLog(@"ERROR: Audio parameter ae is invalid.");
-            goto error;
+        transcoder.param[kLowLatencyKey] = @YES;
+    }
+    if (opts[@"encoder-worker"]) {
+        if (!libavVideo) {
+            SecureErrorLog(@"ERROR: -encoder-worker requires -meve.");
+            return NO;
         }
-        
-        // Register MEAudioConverter if channel layout or volume is specified
-        if (transcoder.param[kAudioChannelLayoutTagKey] || transcoder.param[kAudioVolumeKey]) {
-            for (AVAssetTrack* track in audioTracks) {
-                CMPersistentTrackID trackID = track.trackID;
-                MEAudioConverter* audioConverter = [MEAudioConverter new];
-                
-                // Configure volume if specified
-                if (transcoder.param[kAudioVolumeKey]) {
-                    NSNumber* volumeNum = transcoder.param[kAudioVolumeKey];
-                    audioConverter.volumeDb = volumeNum.doubleValue;
-                    if (verbose) {
-                        SecureLogf(@"Setting audio volume to %.1f dB for track %d", audioConverter.volumeDb, trackID);
-                    }
+        transcoder.param[kEncoderWorkerKey] = @YES;
+    }
+    if (opts[@"affinity"]) {
+        if (!(libavVideo || mevf)) {
+            SecureErrorLog(@"ERROR: -affinity requires -meve or -mevf.");
+            return NO;
+        }
+        transcoder.param[kThreadAffinityKey] = @YES;
+    }
+    return YES;
+}
+
+// -ae, with an MEAudioConverter per audio track for channel layout or volume
+static BOOL parseAudioOpt(NSDictionary<NSString*, NSString*>* opts, METranscoder* transcoder) {
+    NSString* ae = opts[@"ae"];
+    if (!ae) return YES;
+    NSArray *audioTracks = [transcoder.inMovie tracksWithMediaType:AVMediaTypeAudio];
+    if (audioTracks.count == 0) {
+        SecureErrorLog(@"ERROR: No audio track is available.");
+        return NO;
+    }
+    if (parseOptAE(ae, transcoder) == FALSE) {
+        SecureErrorLog(@"ERROR: Audio parameter ae is invalid.");
+        return NO;
+    }
+    
+    // Register MEAudioConverter if channel layout or volume is specified
+    if (transcoder.param[kAudioChannelLayoutTagKey] || transcoder.param[kAudioVolumeKey]) {
+        for (AVAssetTrack* track in audioTracks) {
+            CMPersistentTrackID trackID = track.trackID;
+            MEAudioConverter* audioConverter = [MEAudioConverter new];
+            
+            // Configure volume if specified
+            if (transcoder.param[kAudioVolumeKey]) {
+                NSNumber* volumeNum = transcoder.param[kAudioVolumeKey];
+                audioConverter.volumeDb = volumeNum.doubleValue;
+                if (opts[@"verbose"]) {
+                    SecureLogf(@"Setting audio volume to %.1f dB for track %d", audioConverter.volumeDb, trackID);
                 }
-                
-                [transcoder registerMEAudioConverter:audioConverter forTrackID:trackID];
             }
+            
+            [transcoder registerMEAudioConverter:audioConverter forTrackID:trackID];
+        }
+    }
+    return YES;
+}
+
+// -prefetch/-slices/-interleave/-decoder: how samples are read and paced
+static BOOL parseReaderOpt(NSDictionary<NSString*, NSString*>* opts, METranscoder* transcoder) {
+    if (opts[@"prefetch"]) {
+        if (parseOptPrefetch(opts[@"prefetch"], transcoder) == FALSE) {
+            SecureErrorLog(@"ERROR: Prefetch parameter is invalid.");
+            return NO;
+        }
+    }
+    if (opts[@"slices"]) {
+        NSNumber* slicesNum = parseInteger(opts[@"slices"]);
+        if (nil == slicesNum || slicesNum.integerValue < 1) {
+            SecureErrorLog(@"ERROR: Slices parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kSliceReadersKey] = slicesNum;
+    }
+    if (opts[@"interleave"]) {
+        NSNumber* windowNum = parseDouble(opts[@"interleave"]);
+        if (nil == windowNum || windowNum.doubleValue < 0) {
+            SecureErrorLog(@"ERROR: Interleave parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kInterleaveWindowKey] = windowNum;
+    }
+    if (opts[@"decoder"]) {
+        NSNumber* threadsNum = parseDouble(opts[@"decoder"]);
+        if (nil == threadsNum || threadsNum.intValue < 0 || !opts[@"mux"]) {
+            SecureErrorLog(@"ERROR: Decoder parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kInputBackendKey] = kInputBackendLibav;
+        transcoder.param[kDecoderThreadsKey] = @(threadsNum.intValue);
+    }
+    return YES;
+}
+
+// -layout/-fragment/-segment/-mux/-fixup/-cache/-cache-size/-co: what is written and how
+static BOOL parseOutputOpt(NSDictionary<NSString*, NSString*>* opts, METranscoder* transcoder) {
+    NSString* layout = opts[@"layout"];
+    NSString* fragment = opts[@"fragment"];
+    NSString* segment = opts[@"segment"];
+    NSString* mux = opts[@"mux"];
+    NSString* cache = opts[@"cache"];
+    BOOL libavVideo = (opts[@"meve"] || opts[@"mex264"] || opts[@"mex265"]);
+    if (layout || fragment) {
+        NSDictionary* layouts = @{@"faststart": kMovieLayoutFastStart,
+                                  @"moov-end": kMovieLayoutMoovAtEnd,
+                                  @"fragmented": kMovieLayoutFragmented};
+        NSString* movieLayout = layout ? layouts[layout] : kMovieLayoutFragmented;
+        if (nil == movieLayout || (fragment && movieLayout != kMovieLayoutFragmented)) {
+            SecureErrorLog(@"ERROR: Layout parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kMovieLayoutKey] = movieLayout;
+    }
+    if (fragment) {
+        NSNumber* intervalNum = parseDouble(fragment);
+        if (nil == intervalNum || intervalNum.doubleValue <= 0) {
+            SecureErrorLog(@"ERROR: Fragment parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kMovieFragmentIntervalKey] = intervalNum;
+    }
+    if (segment) {
+        NSNumber* durationNum = parseDouble(segment);
+        if (nil == durationNum || durationNum.doubleValue <= 0 || layout || fragment) {
+            SecureErrorLog(@"ERROR: Segment parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kSegmentDurationKey] = durationNum;
+    }
+    if (mux) {
+        NSString* muxerFormat = muxerFormatNames()[mux];
+        if (nil == muxerFormat || !libavVideo || segment || layout || fragment) {
+            SecureErrorLog(@"ERROR: Mux parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kMuxerFormatKey] = muxerFormat;
+    }
+    if (cache) {
+        NSURL* cacheURL = [NSURL fileURLWithPath:cache isDirectory:YES];
+        cacheURL = [[cacheURL URLByResolvingSymlinksInPath] URLByStandardizingPath];
+        if (cache.length == 0 || !isAllowedPath(cacheURL) || segment) {
+            SecureErrorLog(@"ERROR: Cache parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kResultCacheDirectoryKey] = cacheURL.path;
+    }
+    if (opts[@"cache-size"]) {
+        NSNumber* sizeNum = parseDouble(opts[@"cache-size"]);
+        if (nil == sizeNum || sizeNum.doubleValue <= 0 || !cache) {
+            SecureErrorLog(@"ERROR: Cache-size parameter is invalid.");
+            return NO;
+        }
+        transcoder.param[kResultCacheSizeKey] = @((uint64_t)(sizeNum.doubleValue * 1000 * 1000 * 1000));
+    }
+    if (opts[@"fixup"]) {
+        NSDictionary* fixupOptions = parseOptFixup(opts[@"fixup"]);
+        NSError* fixupError = nil;
+        if (!fixupOptions || ![MEMetadataFixer fixerWithOptions:fixupOptions error:&fixupError] ||
+            libavVideo || opts[@"mevf"] || mux || segment) {
+            SecureErrorLogf(@"ERROR: Fixup parameter is invalid. %@", fixupError.localizedFailureReason ?: @"");
+            return NO;
         }
+        transcoder.param[kMetadataFixupKey] = fixupOptions;
     }
-    if (copyOthers) {
+    if (opts[@"co"]) {
         transcoder.param[kCopyOtherMediaKey] = @YES;
     }
-    if (verbose) {
+    return YES;
+}
+
+// -start/-end in seconds of the source movie
+static BOOL parseRangeOpt(NSDictionary<NSString*, NSString*>* opts, METranscoder* transcoder) {
+    NSString* start = opts[@"start"];
+    NSString* end = opts[@"end"];
+    if (!(start || end)) return YES;
+    CMTime duration = transcoder.inMovie.duration;
+    NSNumber* startNum = start ? parseDouble(start) : @0;
+    NSNumber* endNum = end ? parseDouble(end) : @(CMTimeGetSeconds(duration));
+    if (nil == startNum || nil == endNum || startNum.doubleValue < 0 ||
+        endNum.doubleValue <= startNum.doubleValue || startNum.doubleValue >= CMTimeGetSeconds(duration)) {
+        SecureErrorLog(@"ERROR: Start/End parameter is invalid.");
+        return NO;
+    }
+    int32_t timescale = MAX(duration.timescale, 600);
+    transcoder.startTime = CMTimeMakeWithSeconds(startNum.doubleValue, timescale);
+    transcoder.endTime = CMTimeMinimum(CMTimeMakeWithSeconds(endNum.doubleValue, timescale), duration);
+    return YES;
+}
+
+// -metrics/-trace/-verbose/-dump: reports and progress output
+static BOOL parseReportOpt(NSDictionary<NSString*, NSString*>* opts, METranscoder* transcoder, BOOL batch) {
+    NSDictionary<NSString*, NSString*>* reports = @{@"metrics": kMetricsPathKey, @"trace": kTracePathKey};
+    for (NSString* name in @[@"metrics", @"trace"]) {
+        if (!opts[name]) continue;
+        NSURL* url = [[[NSURL fileURLWithPath:opts[name]] URLByResolvingSymlinksInPath] URLByStandardizingPath];
+        if (opts[name].length == 0 || !isAllowedPath(url)) {
+            SecureErrorLogf(@"ERROR: %@ file path security validation failed: %@", name.capitalizedString, url.path);
+            return NO;
+        }
+        transcoder.param[reports[name]] = url.path;
+    }
+    if (opts[@"verbose"]) {
         transcoder.verbose = TRUE;
     }
-    if (dump) {
+    if (opts[@"dump"]) {
         transcoder.progressCallback = ^(NSDictionary* info) {
             NSString* type = (NSString*)info[kProgressMediaTypeKey];
             if ( [@"vide" compare:type] == NSOrderedSame ) {
@@ -695,14 +948,19 @@ static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
                 NSNumber* dtsNum = (NSNumber*)info[kProgressDTSKey];
                 NSNumber* ptsNum = (NSNumber*)info[kProgressPTSKey];
                 NSNumber* trackID = (NSNumber*)info[kProgressTrackIDKey];
+                NSNumber* fps = (NSNumber*)info[kProgressFPSKey];
+                NSNumber* speed = (NSNumber*)info[kProgressSpeedKey];
+                NSNumber* queueFill = (NSNumber*)info[kProgressQueueFillKey];
                 float progress = MIN(percent.floatValue, 99.99);
-                SecureLogf(@"%2d|%@|%@|%5.2f%%|dts:%7.2f|pts:%7.2f|cnt:%6d|",
+                NSString* queueStr = queueFill ? [NSString stringWithFormat:@"q:%3.0f%%|", queueFill.floatValue] : @"";
+                SecureLogf(@"%2d|%@|%@|%5.2f%%|dts:%7.2f|pts:%7.2f|cnt:%6d|%6.1ffps|%5.2fx|%@",
                       trackID.intValue, type, tag, progress,
-                      dtsNum.floatValue, ptsNum.floatValue, count.intValue);
+                      dtsNum.floatValue, ptsNum.floatValue, count.intValue,
+                      fps.floatValue, speed.floatValue, queueStr);
             }
         };
         transcoder.callbackQueue = dispatch_get_main_queue();
-    } else {
+    } else if (!batch) {
         __weak typeof(transcoder) wx = transcoder;
         transcoder.progressCallback = ^(NSDictionary* info) {
             NSString* type = (NSString*)info[kProgressMediaTypeKey];
@@ -721,11 +979,52 @@ static METranscoder* _Nullable validateOpt(int argc, char * const * argv) {
         };
         transcoder.callbackQueue = dispatch_get_main_queue();
     }
+    return YES;
+}
+
+static METranscoder* _Nullable validateOpt(int argc, char * const * argv, BOOL batch) {
+    NSMutableDictionary<NSString*, NSString*>* opts = [NSMutableDictionary dictionary];
+    if (!scanTranscodeOpt(argc, argv, batch, opts)) {
+        return nil;
+    }
     
-    return transcoder;
+    NSURL* input = nil;
+    NSURL* output = nil;
+    if (!parsePathOpt(opts, &input, &output)) {
+        return nil;
+    }
     
-error:
-    return nil;
+    // Quick Options Check
+    if (batch && (opts[@"metrics"] || opts[@"trace"])) {
+        // The stage collector and the tracer are process-wide
+        SecureErrorLog(@"ERROR: -metrics/-trace are not available in batch mode.");
+        return nil;
+    }
+    if (opts[@"ve"] && (opts[@"meve"] || opts[@"mex264"] || opts[@"mex265"])) {
+        SecureErrorLog(@"ERROR: -ve is not compatible with -meve/-mex264/-mex265.");
+        return nil;
+    }
+    if (opts[@"mex264"] && opts[@"mex265"]) {
+        SecureErrorLog(@"ERROR: Either -mex264 or -mex265 should be used.");
+        return nil;
+    }
+    
+    // Instanciate METranscoder
+    METranscoder* transcoder = [METranscoder transcoderWithInput:input output:output];
+    if (!transcoder) {
+        SecureErrorLog(@"ERROR: Invalid input or output.");
+        return nil;
+    }
+    
+    if (!parseVideoOpt(opts, transcoder) ||
+        !parseAudioOpt(opts, transcoder) ||
+        !parseReaderOpt(opts, transcoder) ||
+        !parseOutputOpt(opts, transcoder) ||
+        !parseRangeOpt(opts, transcoder) ||
+        !parseReportOpt(opts, transcoder, batch)) {
+        return nil;
+    }
+    return transcoder;
 }
 
 static void busyWait(METranscoder *transcoder) {
@@ -744,15 +1043,852 @@ static void busyWait(METranscoder *transcoder) {
 }
 
 /* =================================================================================== */
-// MARK: -
+// MARK: - blocking sessions
 /* =================================================================================== */
 
-int main(int argc, char * const *argv) {
-    // Setup FFmpeg logging redirection so multi-line ffmpeg outputs (filters, encoder details) are shown
-    SetupFFmpegLogging();
-    @autoreleasepool {
+// Checkpoint, smart render, concat, EDL and stream sessions all answer these; call sites cast to it
+@protocol MEBlockingSession <NSObject>
+- (BOOL)runWithError:(NSError * _Nullable * _Nullable)error;
+- (void)cancel;
+@property (readonly, getter=isCancelled) BOOL cancelled;
+@end
+
+// Run the session on a background queue under the signal monitor and map the result to the exit code.
+// cancelNote follows "<title> canceled."; failureDetail goes between "<title> failed" and the error. It never returns.
+static void runSession(id<MEBlockingSession> session, NSString* title, NSString* _Nullable cancelNote,
+                       NSString* (^ _Nullable failureDetail)(void)) {
+    dispatch_group_t group = dispatch_group_create();
+    __block BOOL success = NO;
+    __block NSError* sessionError = nil;
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSError* err = nil;
+        success = [session runWithError:&err]; // blocking method call
+        sessionError = err;
+    });
+    
+    monitor_block_t monitorHandler = ^{
+        if (dispatch_group_wait(group, DISPATCH_TIME_NOW) != 0) return;
+        if (success) {
+            finishMonitor(EXIT_SUCCESS, [NSString stringWithFormat:@"%@ completed.", title], nil);
+        } else if (session.cancelled) {
+            NSString* info = [NSString stringWithFormat:@"%@ canceled.%@", title,
+                              cancelNote ? [@" " stringByAppendingString:cancelNote] : @""];
+            finishMonitor(128 + lastSignal(), info, nil); // 128 + SIGNUMBER
+        } else {
+            NSString* errorInfo = [NSString stringWithFormat:@"%@ failed%@: %@", title,
+                                   failureDetail ? failureDetail() : @"", [sessionError description]];
+            finishMonitor(EXIT_FAILURE, nil, errorInfo);
+        }
+    };
+    cancel_block_t cancelHandler = ^{
+        [session cancel];
+    };
+    startMonitor(monitorHandler, cancelHandler); // it never returns
+}
+
+/* =================================================================================== */
+// MARK: - batch mode
+/* =================================================================================== */
+
+// Options selecting batch/server/client mode; each takes a value
+static NSArray<NSString*>* modeOptNames(void) {
+    return @[@"batch", @"jobs", @"serve", @"cores", @"submit", @"status", @"cancel", @"deadline",
+             @"checkpoint", @"concat", @"edl", @"stdin", @"stdout", @"follow", @"done"];
+}
+
+// Mode options without a value
+static NSArray<NSString*>* modeFlagNames(void) {
+    return @[@"smart"];
+}
+
+// Remove mode options from argv into modeOpts; remaining arguments are shared by every job
+static BOOL scanModeOpt(int argc, char * const * argv, NSMutableDictionary<NSString*, NSString*>* modeOpts,
+                        NSMutableArray<NSString*>* sharedArgs) {
+    NSArray<NSString*>* names = modeOptNames();
+    for (int i = 1; i < argc; i++) {
+        NSString* arg = [NSString stringWithUTF8String:argv[i]];
+        NSString* name = nil;
+        NSString* value = nil;
+        if ([arg hasPrefix:@"--"]) {
+            name = [arg substringFromIndex:2];
+        } else if ([arg hasPrefix:@"-"]) {
+            name = [arg substringFromIndex:1];
+        }
+        NSRange eq = name ? [name rangeOfString:@"="] : NSMakeRange(NSNotFound, 0);
+        if (eq.location != NSNotFound) {
+            value = [name substringFromIndex:eq.location + 1];
+            name = [name substringToIndex:eq.location];
+        }
+        if (name && !value && [modeFlagNames() containsObject:name]) {
+            modeOpts[name] = @"";
+            continue;
+        }
+        if (!name || ![names containsObject:name]) {
+            [sharedArgs addObject:arg];
+            continue;
+        }
+        if (!value) {
+            if (i + 1 >= argc) {
+                SecureErrorLogf(@"ERROR: -%@ requires a value.", name);
+                return NO;
+            }
+            value = [NSString stringWithUTF8String:argv[++i]];
+        }
+        modeOpts[name] = value;
+    }
+    return YES;
+}
+
+// -verbose/-debug among the top-level arguments; per-job arguments do not change the process-wide log level
+static BOOL wantsDebugLog(NSArray<NSString*>* sharedArgs) {
+    NSArray<NSString*>* flags = @[@"-V", @"-d", @"-verbose", @"--verbose", @"-debug", @"--debug"];
+    for (NSString* arg in sharedArgs) {
+        if ([flags containsObject:arg]) return YES;
+    }
+    return NO;
+}
+
+static BOOL parseCountOpt(NSString* _Nullable value, NSString* label, NSUInteger* count) {
+    if (!value) return YES;
+    NSNumber* num = parseInteger(value);
+    if (nil == num || num.integerValue < 1) {
+        SecureErrorLogf(@"ERROR: %@ parameter is invalid.", label);
+        return NO;
+    }
+    *count = (NSUInteger)num.integerValue;
+    return YES;
+}
+
+// Each non-empty line: {"id":"name", "in":"path", "out":"path", "args":["-meve", "..."]}
+// Lines starting with '#' are ignored.
+static NSArray<MEBatchJob*>* _Nullable loadBatchJobs(NSURL* url) {
+    NSError* error = nil;
+    NSString* text = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:&error];
+    if (!text) {
+        SecureErrorLogf(@"ERROR: Failed to read batch file: %@", error.localizedDescription);
+        return nil;
+    }
+    
+    NSMutableArray<MEBatchJob*>* jobs = [NSMutableArray array];
+    NSMutableSet<NSString*>* identifiers = [NSMutableSet set];
+    NSMutableSet<NSString*>* outputs = [NSMutableSet set];
+    __block NSUInteger lineNumber = 0;
+    __block BOOL valid = YES;
+    [text enumerateLinesUsingBlock:^(NSString *line, BOOL *stop) {
+        lineNumber++;
+        NSString* trimmed = [line stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if (trimmed.length == 0 || [trimmed hasPrefix:@"#"]) return;
+        
+        NSError* jsonError = nil;
+        NSData* data = [trimmed dataUsingEncoding:NSUTF8StringEncoding];
+        id spec = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
+        if (![spec isKindOfClass:[NSDictionary class]]) {
+            SecureErrorLogf(@"ERROR: Batch file line %lu is not a JSON object.", (unsigned long)lineNumber);
+            valid = NO; *stop = YES; return;
+        }
+        NSDictionary* dict = spec;
+        id identifier = dict[@"id"] ?: [NSString stringWithFormat:@"%lu", (unsigned long)lineNumber];
+        id output = dict[@"out"];
+        id args = dict[@"args"];
+        BOOL argsOK = (args == nil) || ([args isKindOfClass:[NSArray class]] &&
+                                        [[args filteredArrayUsingPredicate:
+                                          [NSPredicate predicateWithFormat:@"NOT (self isKindOfClass: %@)", [NSString class]]] count] == 0);
+        if (![identifier isKindOfClass:[NSString class]] || ![dict[@"in"] isKindOfClass:[NSString class]] ||
+            ![output isKindOfClass:[NSString class]] || !argsOK) {
+            SecureErrorLogf(@"ERROR: Batch file line %lu requires \"in\", \"out\" strings and an \"args\" string array.",
+                            (unsigned long)lineNumber);
+            valid = NO; *stop = YES; return;
+        }
+        NSString* outputPath = [output stringByStandardizingPath];
+        if ([identifiers containsObject:identifier] || [outputs containsObject:outputPath]) {
+            SecureErrorLogf(@"ERROR: Batch file line %lu duplicates a job id or output path.", (unsigned long)lineNumber);
+            valid = NO; *stop = YES; return;
+        }
+        [identifiers addObject:identifier];
+        [outputs addObject:outputPath];
+        [jobs addObject:[MEBatchJob jobWithIdentifier:identifier spec:dict]];
+    }];
+    if (!valid) return nil;
+    if (jobs.count == 0) {
+        SecureErrorLog(@"ERROR: Batch file has no job.");
+        return nil;
+    }
+    return jobs;
+}
+
+// NULL terminated copy of argv0 + argList for getopt; release with freeArgv()
+static char* _Nullable * _Nullable copyArgv(NSString* argv0, NSArray<NSString*>* argList, int* argc) {
+    NSMutableArray<NSString*>* args = [NSMutableArray arrayWithObject:argv0];
+    [args addObjectsFromArray:argList];
+    
+    *argc = (int)args.count;
+    char** argv = calloc((size_t)*argc + 1, sizeof(char*));
+    if (!argv) return NULL;
+    for (int i = 0; i < *argc; i++) {
+        argv[i] = strdup(args[i].UTF8String);
+    }
+    return argv;
+}
+
+static void freeArgv(char* _Nullable * _Nonnull argv, int argc) {
+    for (int i = 0; i < argc; i++) {
+        free(argv[i]);
+    }
+    free(argv);
+}
+
+// Parse an argument list as one command line; called serially (getopt is not reentrant)
+static METranscoder* _Nullable transcoderWithArgs(NSString* argv0, NSArray<NSString*>* argList) {
+    int jobArgc = 0;
+    char** jobArgv = copyArgv(argv0, argList, &jobArgc);
+    if (!jobArgv) return nil;
+    METranscoder* transcoder = validateOpt(jobArgc, jobArgv, TRUE);
+    freeArgv(jobArgv, jobArgc);
+    return transcoder;
+}
+
+// Shared arguments, then per-job arguments, then the job's input and output
+static METranscoder* _Nullable buildBatchJob(NSString* argv0, NSArray<NSString*>* sharedArgs, MEBatchJob* job) {
+    NSMutableArray<NSString*>* args = [sharedArgs mutableCopy];
+    [args addObjectsFromArray:job.spec[@"args"] ?: @[]];
+    [args addObjectsFromArray:@[@"-i", job.spec[@"in"], @"-o", job.spec[@"out"]]];
+    return transcoderWithArgs(argv0, args);
+}
+
+static void runBatch(NSString* argv0, NSURL* batchURL, NSUInteger maxJobs, NSArray<NSString*>* sharedArgs) {
+    batchURL = [[batchURL URLByResolvingSymlinksInPath] URLByStandardizingPath];
+    if (!isAllowedPath(batchURL)) {
+        SecureErrorLogf(@"ERROR: Batch file path security validation failed: %@", batchURL.path);
+        exit(EXIT_FAILURE);
+    }
+    NSArray<MEBatchJob*>* jobs = loadBatchJobs(batchURL);
+    if (!jobs) {
+        exit(EXIT_FAILURE);
+    }
+    
+    MEBatchRunner* runner = [MEBatchRunner batchRunnerWithJobs:jobs maxConcurrentJobs:maxJobs
+                                                       builder:^METranscoder* _Nullable (MEBatchJob* job, NSString* _Nullable * _Nonnull reason) {
+        @autoreleasepool {
+            METranscoder* transcoder = buildBatchJob(argv0, sharedArgs, job);
+            if (!transcoder) {
+                *reason = @"Invalid job options.";
+            }
+            return transcoder;
+        }
+    }];
+    [runner startWithCompletion:nil];
+    
+    monitor_block_t monitorHandler = ^{
+        if (!runner.finished) return;
+        SecureInfoMultiline(@"Batch summary:", nil, [runner summary]);
+        NSUInteger failures = [runner countOfStatus:MEBatchJobStatusFailed]
+                            + [runner countOfStatus:MEBatchJobStatusInvalid];
+        if (runner.cancelled) {
+            finishMonitor(128 + lastSignal(), @"Batch canceled.", nil); // 128 + SIGNUMBER
+        } else if (failures) {
+            NSString* errorInfo = [NSString stringWithFormat:@"Batch failed: %lu of %lu jobs.",
+                                   (unsigned long)failures, (unsigned long)jobs.count];
+            finishMonitor(EXIT_FAILURE, nil, errorInfo);
+        } else {
+            finishMonitor(EXIT_SUCCESS, @"Batch completed.", nil);
+        }
+    };
+    cancel_block_t cancelHandler = ^{
+        [runner cancel];
+    };
+    startMonitor(monitorHandler, cancelHandler); // it never returns
+}
+
+/* =================================================================================== */
+// MARK: - checkpointed export
+/* =================================================================================== */
+
+static void runCheckpoint(NSString* argv0, NSString* chunkValue, NSArray<NSString*>* sharedArgs) {
+    NSNumber* chunkNum = parseDouble(chunkValue);
+    if (nil == chunkNum || chunkNum.doubleValue < 1.0) {
+        SecureErrorLog(@"ERROR: Checkpoint parameter is invalid.");
+        exit(EXIT_FAILURE);
+    }
+    // validate the whole command line once; each part is parsed again with its own output
+    METranscoder* probe = transcoderWithArgs(argv0, sharedArgs);
+    if (!probe) {
+        exit(EXIT_FAILURE);
+    }
+    NSURL* input = probe.inputURL;
+    NSURL* output = probe.outputURL;
+    probe = nil;
+    
+    MECheckpointSession* session = [MECheckpointSession sessionWithInputURL:input
+                                                                  outputURL:output
+                                                              chunkDuration:chunkNum.doubleValue
+                                                                fingerprint:sharedArgs
+                                                                    builder:^METranscoder* _Nullable (NSURL* partURL) {
+        @autoreleasepool {
+            NSArray<NSString*>* args = [sharedArgs arrayByAddingObjectsFromArray:@[@"-o", partURL.path]];
+            return transcoderWithArgs(argv0, args);
+        }
+    }];
+    
+    runSession((id<MEBlockingSession>)session, @"Transcode", @"Run the same command again to resume.", nil);
+}
+
+/* =================================================================================== */
+// MARK: - smart render
+/* =================================================================================== */
+
+static void runSmartRender(NSString* argv0, NSArray<NSString*>* sharedArgs) {
+    // validate the whole command line once; each part is parsed again with its own output
+    METranscoder* probe = transcoderWithArgs(argv0, sharedArgs);
+    if (!probe) {
+        exit(EXIT_FAILURE);
+    }
+    if (!(CMTIME_IS_VALID(probe.startTime) && CMTIME_IS_VALID(probe.endTime))) {
+        SecureErrorLog(@"ERROR: -smart requires -start or -end.");
+        exit(EXIT_FAILURE);
+    }
+    NSURL* input = probe.inputURL;
+    NSURL* output = probe.outputURL;
+    CMTimeRange range = CMTimeRangeFromTimeToTime(probe.startTime, probe.endTime);
+    probe = nil;
+    
+    MESmartRenderSession* session = [MESmartRenderSession sessionWithInputURL:input
+                                                                    outputURL:output
+                                                                    timeRange:range
+                                                                      builder:^METranscoder* _Nullable (NSURL* partURL) {
+        @autoreleasepool {
+            NSArray<NSString*>* args = [sharedArgs arrayByAddingObjectsFromArray:@[@"-o", partURL.path]];
+            return transcoderWithArgs(argv0, args);
+        }
+    }];
+    
+    runSession((id<MEBlockingSession>)session, @"Transcode", nil, nil);
+}
+
+/* =================================================================================== */
+// MARK: - concatenation
+/* =================================================================================== */
+
+// One movie path per line; blank lines and lines starting with # are skipped, relative paths follow the list
+static NSArray<NSURL*>* _Nullable loadConcatList(NSURL* listURL) {
+    NSError* error = nil;
+    NSString* text = [NSString stringWithContentsOfURL:listURL encoding:NSUTF8StringEncoding error:&error];
+    if (!text) {
+        SecureErrorLogf(@"ERROR: Cannot read concat list: %@", listURL.path);
+        return nil;
+    }
+    NSURL* baseURL = listURL.URLByDeletingLastPathComponent;
+    NSMutableArray<NSURL*>* inputURLs = [NSMutableArray array];
+    for (NSString* rawLine in [text componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+        NSString* line = [rawLine stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if (line.length == 0 || [line hasPrefix:@"#"]) continue;
+        NSURL* url = [line hasPrefix:@"/"] ? [NSURL fileURLWithPath:line]
+                                           : [NSURL fileURLWithPath:line relativeToURL:baseURL].absoluteURL;
+        if (![[NSFileManager defaultManager] fileExistsAtPath:url.path]) {
+            SecureErrorLogf(@"ERROR: Concat input not found: %@", url.path);
+            return nil;
+        }
+        [inputURLs addObject:url];
+    }
+    if (inputURLs.count == 0) {
+        SecureErrorLogf(@"ERROR: Concat list has no input: %@", listURL.path);
+        return nil;
+    }
+    return inputURLs;
+}
+
+static void runConcat(NSString* argv0, NSURL* listURL, NSArray<NSString*>* sharedArgs) {
+    for (NSString* arg in sharedArgs) {
+        if ([@[@"-i", @"-in", @"--in"] containsObject:arg] || [arg hasPrefix:@"-in="] || [arg hasPrefix:@"--in="]) {
+            SecureErrorLog(@"ERROR: -concat takes the place of -i.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    NSArray<NSURL*>* inputURLs = loadConcatList(listURL);
+    if (!inputURLs) {
+        exit(EXIT_FAILURE);
+    }
+    // validate the whole command line once with the first clip; conformed clips are parsed again
+    METranscoder* probe = transcoderWithArgs(argv0, [sharedArgs arrayByAddingObjectsFromArray:@[@"-i", inputURLs.firstObject.path]]);
+    if (!probe) {
+        exit(EXIT_FAILURE);
+    }
+    if (probe.param[kMuxerFormatKey] || [probe.param[kSegmentDurationKey] doubleValue] > 0) {
+        SecureErrorLog(@"ERROR: -concat writes a QuickTime movie; -mux and -segment are not available.");
+        exit(EXIT_FAILURE);
+    }
+    NSURL* output = probe.outputURL;
+    BOOL copyOtherMedia = [probe.param[kCopyOtherMediaKey] boolValue];
+    probe = nil;
+    
+    MEConcatSession* session = [MEConcatSession sessionWithInputURLs:inputURLs
+                                                           outputURL:output
+                                                             builder:^METranscoder* _Nullable (NSURL* inputURL, NSURL* partURL) {
+        @autoreleasepool {
+            NSArray<NSString*>* args = [sharedArgs arrayByAddingObjectsFromArray:@[@"-i", inputURL.path, @"-o", partURL.path]];
+            return transcoderWithArgs(argv0, args);
+        }
+    }];
+    session.copyOtherMedia = copyOtherMedia;
+    
+    runSession((id<MEBlockingSession>)session, @"Concatenation", nil, nil);
+}
+
+/* =================================================================================== */
+// MARK: - edit decision list
+/* =================================================================================== */
+
+// "start end output" per line in seconds; blank lines and lines starting with # are skipped, relative paths follow the list
+static BOOL loadEDL(NSURL* listURL, NSMutableArray<NSArray<NSNumber*>*>* bounds, NSMutableArray<NSURL*>* clipURLs) {
+    NSError* error = nil;
+    NSString* text = [NSString stringWithContentsOfURL:listURL encoding:NSUTF8StringEncoding error:&error];
+    if (!text) {
+        SecureErrorLogf(@"ERROR: Cannot read EDL: %@", listURL.path);
+        return NO;
+    }
+    NSURL* baseURL = listURL.URLByDeletingLastPathComponent;
+    NSCharacterSet* whitespace = [NSCharacterSet whitespaceCharacterSet];
+    for (NSString* rawLine in [text componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+        NSString* line = [rawLine stringByTrimmingCharactersInSet:whitespace];
+        if (line.length == 0 || [line hasPrefix:@"#"]) continue;
+        NSArray<NSString*>* fields = [[line componentsSeparatedByCharactersInSet:whitespace]
+                                      filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]];
+        NSNumber* startNum = (fields.count >= 3) ? parseDouble(fields[0]) : nil;
+        NSNumber* endNum = (fields.count >= 3) ? parseDouble(fields[1]) : nil;
+        if (nil == startNum || nil == endNum || startNum.doubleValue < 0 || endNum.doubleValue <= startNum.doubleValue) {
+            SecureErrorLogf(@"ERROR: Invalid EDL line: %@", line);
+            return NO;
+        }
+        // the output path may contain spaces
+        NSString* path = [[fields subarrayWithRange:NSMakeRange(2, fields.count - 2)] componentsJoinedByString:@" "];
+        NSURL* url = [path hasPrefix:@"/"] ? [NSURL fileURLWithPath:path]
+                                           : [NSURL fileURLWithPath:path relativeToURL:baseURL].absoluteURL;
+        if ([clipURLs containsObject:url]) {
+            SecureErrorLogf(@"ERROR: EDL output is used twice: %@", url.path);
+            return NO;
+        }
+        [bounds addObject:@[startNum, endNum]];
+        [clipURLs addObject:url];
+    }
+    if (clipURLs.count == 0) {
+        SecureErrorLogf(@"ERROR: EDL has no clip: %@", listURL.path);
+        return NO;
+    }
+    return YES;
+}
+
+static void runEDL(NSString* argv0, NSURL* listURL, NSArray<NSString*>* sharedArgs) {
+    NSArray<NSString*>* takenOver = @[@"o", @"out", @"start", @"end"];
+    for (NSString* arg in sharedArgs) {
+        NSString* name = [arg stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"-"]];
+        name = [name componentsSeparatedByString:@"="].firstObject;
+        if ([arg hasPrefix:@"-"] && [takenOver containsObject:name]) {
+            SecureErrorLog(@"ERROR: -edl takes the place of -o, -start and -end.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    NSMutableArray<NSArray<NSNumber*>*>* bounds = [NSMutableArray array];
+    NSMutableArray<NSURL*>* clipURLs = [NSMutableArray array];
+    if (!loadEDL(listURL, bounds, clipURLs)) {
+        exit(EXIT_FAILURE);
+    }
+    // validate the whole command line once with the first clip; each clip is parsed again with its own output
+    METranscoder* probe = transcoderWithArgs(argv0, [sharedArgs arrayByAddingObjectsFromArray:@[@"-o", clipURLs.firstObject.path]]);
+    if (!probe) {
+        exit(EXIT_FAILURE);
+    }
+    NSURL* input = probe.inputURL;
+    int32_t timescale = MAX(probe.inMovie.duration.timescale, 600);
+    probe = nil;
+    
+    NSMutableArray<NSValue*>* timeRanges = [NSMutableArray array];
+    for (NSArray<NSNumber*>* pair in bounds) {
+        CMTime start = CMTimeMakeWithSeconds(pair[0].doubleValue, timescale);
+        CMTime end = CMTimeMakeWithSeconds(pair[1].doubleValue, timescale);
+        [timeRanges addObject:[NSValue valueWithCMTimeRange:CMTimeRangeFromTimeToTime(start, end)]];
+    }
+    
+    MEEDLSession* session = [MEEDLSession sessionWithInputURL:input
+                                                   timeRanges:timeRanges
+                                                     clipURLs:clipURLs
+                                                      builder:^METranscoder* _Nullable (NSURL* clipURL) {
+        @autoreleasepool {
+            NSArray<NSString*>* args = [sharedArgs arrayByAddingObjectsFromArray:@[@"-o", clipURL.path]];
+            return transcoderWithArgs(argv0, args);
+        }
+    }];
+    
+    runSession((id<MEBlockingSession>)session, @"EDL export", nil, ^NSString* {
+        return [NSString stringWithFormat:@" (%lu of %lu clips)",
+                (unsigned long)session.failedClipCount, (unsigned long)clipURLs.count];
+    });
+}
+
+/* =================================================================================== */
+// MARK: - stdin/stdout stream
+/* =================================================================================== */
+
+// -stdin/-stdout take the place of -i/-o, -follow reads -i while it grows; only libav video options apply
+static MEStreamTranscoder* _Nullable streamTranscoderWithArgs(NSString* argv0, NSDictionary<NSString*, NSString*>* modeOpts,
+                                                             NSArray<NSString*>* argList) {
+    BOOL verbose = FALSE;
+    BOOL debug = FALSE;
+    BOOL lowLatency = FALSE;
+    NSString* input = nil;
+    NSString* output = nil;
+    NSString* meve = nil;
+    NSString* mevf = nil;
+    NSString* mex264 = nil;
+    NSString* mex265 = nil;
+    NSString* mux = nil;
+    NSString* decoder = nil;
+    NSString* inputFormat = nil;
+    NSString* outputFormat = nil;
+    NSString* marker = nil;
+    double idleTimeout = 0;
+    MEManager* manager = nil;
+    MEStreamTranscoder* stream = nil;
+    
+    const char* shortopts = "Vdi:o:";
+    static struct option longopts[] = {
+        {"verbose", no_argument, NULL, 'V'},
+        {"debug", no_argument, NULL, 'd'},
+        {"in", required_argument, NULL, 'i'},
+        {"out", required_argument, NULL, 'o'},
+        {"meve", required_argument, NULL, -128},
+        {"mevf", required_argument, NULL, -129},
+        {"mex264", required_argument, NULL, -264},
+        {"mex265", required_argument, NULL, -265},
+        {"mux", required_argument, NULL, -137},
+        {"decoder", required_argument, NULL, -138},
+        {"lowlatency", no_argument, NULL, -139},
+        {0,0,0,0}
+    };
+    
+    int argc = 0;
+    char** argv = copyArgv(argv0, argList, &argc);
+    if (!argv) return nil;
+    int opt, longindex;
+    opterr = 0;
+    optreset = 1;
+    optind = 1;
+    while ((opt = getopt_long_only(argc, argv, shortopts, longopts, &longindex)) != -1) {
+        @autoreleasepool {
+            NSString* val = optarg ? [NSString stringWithUTF8String:optarg] : nil;
+            switch (opt) {
+            case 'V':
+                verbose = TRUE;
+                break;
+            case 'd':
+                debug = TRUE;
+                break;
+            case 'i':
+                input = val;
+                break;
+            case 'o':
+                output = val;
+                break;
+            case -128:
+                meve = val;
+                break;
+            case -129:
+                mevf = val;
+                break;
+            case -264:
+                mex264 = val;
+                break;
+            case -265:
+                mex265 = val;
+                break;
+            case -137:
+                mux = val;
+                break;
+            case -138:
+                decoder = val;
+                break;
+            case -139:
+                lowLatency = TRUE;
+                break;
+            default:
+                SecureErrorLog(@"ERROR: Only -meve/-mevf/-mex264/-mex265/-mux/-decoder/-lowlatency/-i/-o/-V/-d are available with -stdin/-stdout.");
+                goto error;
+            }
+        }
+    }
+    
+    // Resolve each side to stdin/stdout or a file
+    if (modeOpts[@"stdin"]) {
+        NSDictionary* formats = @{@"y4m": @"yuv4mpegpipe", @"nut": @"nut", @"auto": @""};
+        inputFormat = formats[modeOpts[@"stdin"]];
+        if (nil == inputFormat || input) {
+            SecureErrorLog(@"ERROR: Stdin parameter is invalid.");
+            goto error;
+        }
+        input = @"-";
+    } else if (!input || !isAllowedPath([[[NSURL fileURLWithPath:input] URLByResolvingSymlinksInPath] URLByStandardizingPath])) {
+        SecureErrorLog(@"ERROR: Input path security validation failed.");
+        goto error;
+    }
+    if (modeOpts[@"follow"]) {
+        NSNumber* idleNum = parseDouble(modeOpts[@"follow"]);
+        if (nil == idleNum || idleNum.doubleValue < 0 || modeOpts[@"stdin"]) {
+            SecureErrorLog(@"ERROR: Follow parameter is invalid.");
+            goto error;
+        }
+        idleTimeout = idleNum.doubleValue;
+        marker = modeOpts[@"done"] ?: [input stringByAppendingPathExtension:@"done"];
+    }
+    if (modeOpts[@"stdout"]) {
+        outputFormat = muxerFormatNames()[modeOpts[@"stdout"]];
+        if (nil == outputFormat || [@[@"mp4", @"mov"] containsObject:outputFormat] || output || mux) {
+            // mp4/mov need a seekable output for the movie header
+            SecureErrorLog(@"ERROR: Stdout parameter is invalid.");
+            goto error;
+        }
+        output = @"-";
+    } else {
+        outputFormat = mux ? muxerFormatNames()[mux] : nil;
+        if (nil == outputFormat) {
+            SecureErrorLog(@"ERROR: Mux parameter is invalid.");
+            goto error;
+        }
+        if (!output || !isAllowedPath([[NSURL fileURLWithPath:output] URLByStandardizingPath])) {
+            SecureErrorLog(@"ERROR: Output path security validation failed.");
+            goto error;
+        }
+    }
+    
+    // Same video settings as a movie transcode
+    if (!meve || (mex264 && mex265)) {
+        SecureErrorLog(@"ERROR: -stdin/-stdout require -meve, with either -mex264 or -mex265.");
+        goto error;
+    }
+    manager = [MEManager new];
+    if (parseOptMEVE(meve, manager) == FALSE) {
+        SecureErrorLog(@"ERROR: Video parameter meve is invalid.");
+        goto error;
+    }
+    if (mex264) {
+        manager.videoEncoderSetting[kMEVEx264_paramsKey] = mex264;
+    }
+    if (mex265) {
+        manager.videoEncoderSetting[kMEVEx265_paramsKey] = mex265;
+    }
+    if (mevf) {
+        manager.videoFilterString = mevf;
+    }
+    manager.initialDelayInSec = initialDelayInSec;
+    manager.verbose = verbose;
+    manager.lowLatency = lowLatency;
+    if (debug) {
+        manager.log_level = 48; //AV_LOG_DEBUG
+    }
+    
+    stream = [MEStreamTranscoder streamTranscoderWithInput:input output:output manager:manager];
+    stream.inputFormat = inputFormat.length ? inputFormat : nil;
+    stream.outputFormat = outputFormat;
+    stream.verbose = verbose;
+    if (marker) {
+        stream.followsInput = YES;
+        stream.idleTimeout = idleTimeout;
+        stream.completionMarker = [[NSURL fileURLWithPath:marker] URLByStandardizingPath].path;
+    }
+    if (decoder) {
+        NSNumber* threadsNum = parseInteger(decoder);
+        if (nil == threadsNum || threadsNum.intValue < 0) {
+            SecureErrorLog(@"ERROR: Decoder parameter is invalid.");
+            goto error;
+        }
+        stream.decoderThreads = threadsNum.intValue;
+    }
+    freeArgv(argv, argc);
+    return stream;
+    
+error:
+    freeArgv(argv, argc);
+    return nil;
+}
+
+static void runStream(NSString* argv0, NSDictionary<NSString*, NSString*>* modeOpts, NSArray<NSString*>* sharedArgs) {
+    MEStreamTranscoder* stream = streamTranscoderWithArgs(argv0, modeOpts, sharedArgs);
+    if (!stream) {
+        exit(EXIT_FAILURE);
+    }
+    // A reader leaving early fails the write with EPIPE instead of killing the process
+    signal(SIGPIPE, SIG_IGN);
+    
+    runSession((id<MEBlockingSession>)stream, @"Transcode", nil, nil);
+}
+
+/* =================================================================================== */
+// MARK: - job server
+/* =================================================================================== */
+
+static void runServer(NSString* argv0, NSURL* socketURL, NSUInteger cores, NSArray<NSString*>* sharedArgs) {
+    socketURL = [[socketURL URLByResolvingSymlinksInPath] URLByStandardizingPath];
+    if (!isAllowedPath(socketURL)) {
+        SecureErrorLogf(@"ERROR: Socket path security validation failed: %@", socketURL.path);
+        exit(EXIT_FAILURE);
+    }
+    
+    // A lone job gets half of the cores; the rest waits for the next arrival or a deadline
+    NSUInteger minimumCores = MIN((NSUInteger)2, cores);
+    MEJobScheduler* scheduler = [MEJobScheduler schedulerWithCoreCount:cores
+                                                          minimumCores:minimumCores
+                                                          maximumCores:MAX(minimumCores, cores / 2)];
+    MEJobServer* server = [MEJobServer jobServerWithSocketURL:socketURL scheduler:scheduler
+                                                      builder:^METranscoder* _Nullable (MEBatchJob* job, NSString* _Nullable * _Nonnull reason) {
+        @autoreleasepool {
+            METranscoder* transcoder = buildBatchJob(argv0, sharedArgs, job);
+            if (!transcoder) {
+                *reason = @"Invalid job options.";
+            }
+            return transcoder;
+        }
+    }];
+    NSError* error = nil;
+    if (![server startWithError:&error]) {
+        exit(EXIT_FAILURE);
+    }
+    
+    monitor_block_t monitorHandler = ^{
+        if (server.stopped && server.runningJobCount == 0) {
+            finishMonitor(128 + lastSignal(), @"Server stopped.", nil); // 128 + SIGNUMBER
+        }
+    };
+    cancel_block_t cancelHandler = ^{
+        [server stop];
+    };
+    startMonitor(monitorHandler, cancelHandler); // it never returns
+}
+
+// -submit sends the job described by the shared arguments; -status prints the server state
+static int runClient(NSDictionary<NSString*, NSString*>* modeOpts, NSArray<NSString*>* sharedArgs) {
+    NSString* socketPath = modeOpts[@"submit"] ?: modeOpts[@"status"];
+    NSURL* socketURL = [[[NSURL fileURLWithPath:socketPath] URLByResolvingSymlinksInPath] URLByStandardizingPath];
+    NSMutableDictionary* request = [NSMutableDictionary dictionary];
+    
+    if (modeOpts[@"status"]) {
+        request[@"cmd"] = @"status";
+    } else if (modeOpts[@"cancel"]) {
+        request[@"cmd"] = @"cancel";
+        request[@"id"] = modeOpts[@"cancel"];
+    } else {
+        // -i/-o are sent as absolute paths; the server may run in another directory
+        NSMutableArray<NSString*>* args = [NSMutableArray array];
+        for (NSUInteger i = 0; i < sharedArgs.count; i++) {
+            NSString* arg = sharedArgs[i];
+            BOOL isIn = [@[@"-i", @"-in", @"--in"] containsObject:arg];
+            BOOL isOut = [@[@"-o", @"-out", @"--out"] containsObject:arg];
+            if ((isIn || isOut) && i + 1 < sharedArgs.count) {
+                NSString* path = [[NSURL fileURLWithPath:sharedArgs[++i]] URLByStandardizingPath].path;
+                request[isIn ? @"in" : @"out"] = path;
+            } else {
+                [args addObject:arg];
+            }
+        }
+        if (!(request[@"in"] && request[@"out"])) {
+            SecureErrorLog(@"ERROR: Either input or output is not available.");
+            return EXIT_FAILURE;
+        }
+        request[@"cmd"] = @"submit";
+        request[@"args"] = args;
+        if (modeOpts[@"deadline"]) {
+            NSNumber* deadlineNum = parseDouble(modeOpts[@"deadline"]);
+            if (nil == deadlineNum || deadlineNum.doubleValue < 0) {
+                SecureErrorLog(@"ERROR: Deadline parameter is invalid.");
+                return EXIT_FAILURE;
+            }
+            request[@"deadline"] = deadlineNum;
+        }
+    }
+    
+    BOOL submit = [@"submit" isEqualToString:request[@"cmd"]];
+    __block int code = EXIT_FAILURE;
+    NSError* error = nil;
+    BOOL replied = [MEJobClient sendRequest:request toSocketURL:socketURL replyHandler:^BOOL(NSDictionary* reply) {
+        NSData* data = [NSJSONSerialization dataWithJSONObject:reply options:NSJSONWritingSortedKeys error:nil];
+        SecureLogf(@"%@", [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
+        if (reply[@"error"]) return NO;
+        NSString* status = reply[@"status"];
+        if (submit && ([@"queued" isEqual:status] || [@"running" isEqual:status])) return YES;
+        code = (!submit || [@"ok" isEqual:status]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        return NO;
+    } error:&error];
+    if (!replied) {
+        SecureErrorLogf(@"ERROR: No reply from server at %@ (%@)", socketURL.path, error.localizedDescription);
+    }
+    return code;
+}
+
+/* =================================================================================== */
+// MARK: -
+/* =================================================================================== */
+
+int main(int argc, char * const *argv) {
+    // Setup FFmpeg logging redirection so multi-line ffmpeg outputs (filters, encoder details) are shown
+    SetupFFmpegLogging();
+    @autoreleasepool {
+        // child process of MEWorkerEncoderPipeline
+        if (argc == 2 && [kMEEncoderWorkerArgument isEqualToString:@(argv[1])]) {
+            return MEEncoderWorkerMain();
+        }
+        
+        // batch, server and client modes run many jobs with shared setup
+        NSMutableDictionary<NSString*, NSString*>* modeOpts = [NSMutableDictionary dictionary];
+        NSMutableArray<NSString*>* sharedArgs = [NSMutableArray array];
+        NSUInteger maxJobs = 1;
+        NSUInteger cores = [NSProcessInfo processInfo].activeProcessorCount;
+        if (!scanModeOpt(argc, argv, modeOpts, sharedArgs) ||
+            !parseCountOpt(modeOpts[@"jobs"], @"Jobs", &maxJobs) ||
+            !parseCountOpt(modeOpts[@"cores"], @"Cores", &cores)) {
+            exit(EXIT_FAILURE);
+        }
+        // Debug messages only with -verbose/-debug; skipped before formatting otherwise
+        SecureLogSetLevel(wantsDebugLog(sharedArgs) ? 3 : 2); // MELogLevelDebug : MELogLevelInfo
+        NSArray<NSString*>* modes = [@[@"batch", @"serve", @"submit", @"status", @"checkpoint", @"smart", @"concat", @"edl"] filteredArrayUsingPredicate:
+                                     [NSPredicate predicateWithFormat:@"self IN %@", modeOpts.allKeys]];
+        BOOL stream = (modeOpts[@"stdin"] || modeOpts[@"stdout"] || modeOpts[@"follow"]);
+        if (stream) {
+            modes = [modes arrayByAddingObject:@"stream"];
+        }
+        if (modes.count > 1) {
+            SecureErrorLog(@"ERROR: Either -batch, -serve, -submit, -status, -checkpoint, -smart, -concat, -edl or -stdin/-stdout/-follow should be used.");
+            exit(EXIT_FAILURE);
+        }
+        if ((modeOpts[@"jobs"] && !modeOpts[@"batch"]) || (modeOpts[@"cores"] && !modeOpts[@"serve"]) ||
+            ((modeOpts[@"cancel"] || modeOpts[@"deadline"]) && !modeOpts[@"submit"]) ||
+            (modeOpts[@"done"] && !modeOpts[@"follow"])) {
+            SecureErrorLog(@"ERROR: -jobs requires -batch, -cores requires -serve, -cancel/-deadline require -submit, -done requires -follow.");
+            exit(EXIT_FAILURE);
+        }
+        NSString* argv0 = [NSString stringWithUTF8String:argv[0]];
+        if (modeOpts[@"batch"]) {
+            runBatch(argv0, [NSURL fileURLWithPath:modeOpts[@"batch"]], maxJobs, sharedArgs);
+        }
+        if (modeOpts[@"serve"]) {
+            runServer(argv0, [NSURL fileURLWithPath:modeOpts[@"serve"]], cores, sharedArgs);
+        }
+        if (modeOpts[@"checkpoint"]) {
+            runCheckpoint(argv0, modeOpts[@"checkpoint"], sharedArgs);
+        }
+        if (modeOpts[@"smart"]) {
+            runSmartRender(argv0, sharedArgs);
+        }
+        if (modeOpts[@"concat"]) {
+            runConcat(argv0, [NSURL fileURLWithPath:modeOpts[@"concat"]], sharedArgs);
+        }
+        if (modeOpts[@"edl"]) {
+            runEDL(argv0, [NSURL fileURLWithPath:modeOpts[@"edl"]], sharedArgs);
+        }
+        if (modeOpts[@"submit"] || modeOpts[@"status"]) {
+            exit(runClient(modeOpts, sharedArgs));
+        }
+        if (stream) {
+            runStream(argv0, modeOpts, sharedArgs);
+        }
+        
         // validate opt and prepare transcoder object
-        METranscoder* transcoder = validateOpt(argc, argv);
+        METranscoder* transcoder = validateOpt(argc, argv, FALSE);
         if (!transcoder) {
             exit(EXIT_FAILURE);
         }
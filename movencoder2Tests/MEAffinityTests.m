@@ -0,0 +1,65 @@
+//  MEAffinityTests.m
+//  movencoder2Tests
+//
+//  Tests for cache domain round robin and affinity tag scoping.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEAffinity.h"
+
+@interface MEAffinityTests : XCTestCase
+@end
+
+@implementation MEAffinityTests
+
+- (void)testNextTagCyclesOverDomains {
+    NSInteger domains = MEAffinityDomainCount();
+    XCTAssertGreaterThanOrEqual(domains, 1);
+    NSMutableSet<NSNumber*>* seen = [NSMutableSet set];
+    for (NSInteger i = 0; i < domains * 2; i++) {
+        NSInteger tag = MEAffinityNextTag();
+        XCTAssertGreaterThanOrEqual(tag, 1);
+        XCTAssertLessThanOrEqual(tag, domains);
+        [seen addObject:@(tag)];
+    }
+    XCTAssertEqual((NSInteger)seen.count, domains);
+}
+
+- (void)testBlockRestoresThreadTag {
+    NSInteger before = MEAffinityCurrentThreadTag();
+    __block NSInteger inside = kMEAffinityTagNone;
+    dispatch_block_t block = MEAffinityBlock(before + 1, ^{
+        inside = MEAffinityCurrentThreadTag();
+    });
+    block();
+    NSInteger expected = MEAffinityIsSupported() ? before + 1 : kMEAffinityTagNone;
+    XCTAssertEqual(inside, expected);
+    XCTAssertEqual(MEAffinityCurrentThreadTag(), before);
+
+    // Nested blocks with the same tag leave the outer tag in place
+    __block NSInteger nested = kMEAffinityTagNone;
+    dispatch_block_t outer = MEAffinityBlock(before + 1, ^{
+        MEAffinityBlock(before + 1, ^{})();
+        nested = MEAffinityCurrentThreadTag();
+    });
+    outer();
+    XCTAssertEqual(nested, expected);
+    XCTAssertEqual(MEAffinityCurrentThreadTag(), before);
+}
+
+- (void)testNoTagReturnsBlockUnchanged {
+    dispatch_block_t block = ^{};
+    XCTAssertEqual(MEAffinityBlock(kMEAffinityTagNone, block), block);
+}
+
+- (void)testTopologyDescription {
+    NSString* description = MEAffinityTopologyDescription();
+    XCTAssertTrue([description containsString:@"domains="]);
+    XCTAssertTrue([description containsString:(MEAffinityIsSupported() ? @"tags=supported" : @"tags=unsupported")]);
+}
+
+@end
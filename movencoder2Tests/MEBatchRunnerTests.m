@@ -0,0 +1,71 @@
+//  MEBatchRunnerTests.m
+//  movencoder2Tests
+//
+//  Tests for job admission, concurrency limit and summary of the batch runner.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEBatchRunner.h"
+
+@interface MEBatchRunnerTests : XCTestCase
+@end
+
+@implementation MEBatchRunnerTests
+
+- (NSArray<MEBatchJob*>*)jobsWithCount:(NSUInteger)count {
+    NSMutableArray<MEBatchJob*>* jobs = [NSMutableArray array];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString* identifier = [NSString stringWithFormat:@"job%lu", (unsigned long)i];
+        [jobs addObject:[MEBatchJob jobWithIdentifier:identifier spec:@{@"in": @"in.mov", @"out": identifier}]];
+    }
+    return jobs;
+}
+
+- (void)testRejectedJobsAreInvalidAndBuiltSerially {
+    NSArray<MEBatchJob*>* jobs = [self jobsWithCount:4];
+    NSMutableArray<NSString*>* built = [NSMutableArray array];    // builder runs serially
+    MEBatchRunner* runner = [MEBatchRunner batchRunnerWithJobs:jobs maxConcurrentJobs:2
+                                                      builder:^METranscoder* _Nullable (MEBatchJob* job, NSString* _Nullable * _Nonnull reason) {
+        [built addObject:job.identifier];
+        *reason = @"rejected";
+        return nil;
+    }];
+    XCTestExpectation* done = [self expectationWithDescription:@"completion"];
+    [runner startWithCompletion:^{
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertTrue(runner.finished);
+    XCTAssertEqualObjects(built, (@[@"job0", @"job1", @"job2", @"job3"]));
+    XCTAssertEqual([runner countOfStatus:MEBatchJobStatusInvalid], (NSUInteger)4);
+    XCTAssertEqualObjects(jobs[0].message, @"rejected");
+    XCTAssertTrue([[runner summary] containsString:@"invalid 4"]);
+}
+
+- (void)testCancelBeforeStartCancelsPendingJobs {
+    NSArray<MEBatchJob*>* jobs = [self jobsWithCount:3];
+    __block NSUInteger builds = 0;
+    MEBatchRunner* runner = [MEBatchRunner batchRunnerWithJobs:jobs maxConcurrentJobs:0
+                                                      builder:^METranscoder* _Nullable (MEBatchJob* job, NSString* _Nullable * _Nonnull reason) {
+        builds++;
+        return nil;
+    }];
+    XCTAssertEqual(runner.maxConcurrentJobs, (NSUInteger)1);
+    [runner cancel];
+    XCTestExpectation* done = [self expectationWithDescription:@"completion"];
+    [runner startWithCompletion:^{
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertTrue(runner.cancelled);
+    XCTAssertEqual(builds, (NSUInteger)0);
+    XCTAssertEqual([runner countOfStatus:MEBatchJobStatusCancelled], (NSUInteger)3);
+}
+
+@end
@@ -0,0 +1,68 @@
+//  MEConcatSessionTests.m
+//  movencoder2Tests
+//
+//  Tests for the format checks deciding which concat clips are copied.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import CoreMedia;
+
+#import "MEMovieAssembler.h"
+#import "MECodecUtils.h"
+
+// Baseline 3.0, 320x240 and 640x240
+static const uint8_t kSPS320[] = {0x67, 0x42, 0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe4};
+static const uint8_t kSPS640[] = {0x67, 0x42, 0xc0, 0x1e, 0xda, 0x02, 0x81, 0xf9};
+static const uint8_t kPPS[] = {0x68, 0xce, 0x3c, 0x80};
+
+static CMFormatDescriptionRef createH264Description(const uint8_t* sps, size_t spsSize) {
+    const uint8_t* sets[] = {sps, kPPS};
+    size_t sizes[] = {spsSize, sizeof(kPPS)};
+    CMFormatDescriptionRef desc = NULL;
+    CMVideoFormatDescriptionCreateFromH264ParameterSets(kCFAllocatorDefault, 2, sets, sizes, 4, &desc);
+    return desc;
+}
+
+@interface MEConcatSessionTests : XCTestCase
+@end
+
+@implementation MEConcatSessionTests
+
+- (void)testParameterSetsFollowCreationOrder {
+    CMFormatDescriptionRef desc = createH264Description(kSPS320, sizeof(kSPS320));
+    XCTAssertTrue(desc != NULL);
+    NSArray<NSData*>* sets = parameterSetsOfDescription(desc);
+    XCTAssertEqual(sets.count, 2u);
+    XCTAssertEqualObjects(sets[0], [NSData dataWithBytes:kSPS320 length:sizeof(kSPS320)]);
+    XCTAssertEqualObjects(sets[1], [NSData dataWithBytes:kPPS length:sizeof(kPPS)]);
+    CFRelease(desc);
+}
+
+- (void)testSameParameterSetsAreCompatible {
+    CMFormatDescriptionRef a = createH264Description(kSPS320, sizeof(kSPS320));
+    CMFormatDescriptionRef b = createH264Description(kSPS320, sizeof(kSPS320));
+    XCTAssertNil([MEMovieAssembler incompatibilityOfVideoFormat:b withFormat:a]);
+    XCTAssertEqualObjects(parameterSetsOfDescription(a), parameterSetsOfDescription(b));
+    CFRelease(a);
+    CFRelease(b);
+}
+
+- (void)testDifferentDimensionsAreReported {
+    CMFormatDescriptionRef a = createH264Description(kSPS320, sizeof(kSPS320));
+    CMFormatDescriptionRef b = createH264Description(kSPS640, sizeof(kSPS640));
+    XCTAssertEqualObjects([MEMovieAssembler incompatibilityOfVideoFormat:b withFormat:a], @"dimensions");
+    CFRelease(a);
+    CFRelease(b);
+}
+
+- (void)testNonParameterSetCodecHasNoParameterSets {
+    CMFormatDescriptionRef desc = NULL;
+    CMVideoFormatDescriptionCreate(kCFAllocatorDefault, kCMVideoCodecType_AppleProRes422, 320, 240, NULL, &desc);
+    XCTAssertNil(parameterSetsOfDescription(desc));
+    CFRelease(desc);
+}
+
+@end
@@ -0,0 +1,88 @@
+//  MEGrowingFileTests.m
+//  movencoder2Tests
+//
+//  Tests for reading a file while it is still being written.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEGrowingFile.h"
+
+@interface MEGrowingFileTests : XCTestCase
+@end
+
+@implementation MEGrowingFileTests
+
+- (NSString*)pathWithName:(NSString*)name {
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:name];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    return path;
+}
+
+// Read everything the growing file returns until EOF
+- (NSData*)readAll:(MEGrowingFile*)file {
+    AVIOContext* pb = MEGrowingFileIOContext(file);
+    NSMutableData* data = [NSMutableData data];
+    uint8_t buf[4096];
+    int n = 0;
+    while ((n = avio_read(pb, buf, sizeof(buf))) > 0) {
+        [data appendBytes:buf length:(NSUInteger)n];
+    }
+    XCTAssertEqual(n, AVERROR_EOF);
+    return data;
+}
+
+- (void)testFollowsAppendsUntilMarker {
+    NSString* path = [self pathWithName:@"MEGrowingFileTests.bin"];
+    NSString* marker = [path stringByAppendingPathExtension:@"done"];
+    [[NSFileManager defaultManager] removeItemAtPath:marker error:nil];
+    [[NSData dataWithBytes:"head" length:4] writeToFile:path atomically:NO];
+
+    int ret = 0;
+    MEGrowingFile* file = MEGrowingFileOpen(path.fileSystemRepresentation, marker.fileSystemRepresentation, 0, &ret);
+    XCTAssertTrue(file != NULL, @"%d", ret);
+    XCTAssertEqual(avio_size(MEGrowingFileIOContext(file)), AVERROR(ENOSYS));   // not final yet
+
+    // The recorder appends twice, then drops the marker
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:path];
+        for (int i = 0; i < 2; i++) {
+            usleep(200 * 1000);
+            [handle seekToEndOfFile];
+            [handle writeData:[NSData dataWithBytes:"body" length:4]];
+        }
+        [handle closeFile];
+        [[NSData data] writeToFile:marker atomically:NO];
+    });
+    NSData* data = [self readAll:file];
+    XCTAssertEqualObjects([[NSString alloc] initWithData:data encoding:NSASCIIStringEncoding], @"headbodybody");
+    XCTAssertEqual(avio_size(MEGrowingFileIOContext(file)), 12);
+
+    MEGrowingFileClose(&file);
+    XCTAssertTrue(file == NULL);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:marker error:nil];
+}
+
+- (void)testIdleTimeoutAndCancelEndTheFile {
+    NSString* path = [self pathWithName:@"MEGrowingFileTests.idle"];
+    [[NSData dataWithBytes:"abc" length:3] writeToFile:path atomically:NO];
+
+    MEGrowingFile* file = MEGrowingFileOpen(path.fileSystemRepresentation, NULL, 0.3, NULL);
+    XCTAssertTrue(file != NULL);
+    XCTAssertEqual([self readAll:file].length, 3u);
+    MEGrowingFileClose(&file);
+
+    file = MEGrowingFileOpen(path.fileSystemRepresentation, NULL, 0, NULL);     // marker only
+    MEGrowingFileCancel(file);
+    XCTAssertEqual([self readAll:file].length, 3u);
+    MEGrowingFileClose(&file);
+
+    XCTAssertTrue(MEGrowingFileOpen("/nonexistent/MEGrowingFileTests", NULL, 1, NULL) == NULL);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+@end
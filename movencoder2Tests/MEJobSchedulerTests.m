@@ -0,0 +1,107 @@
+//  MEJobSchedulerTests.m
+//  movencoder2Tests
+//
+//  Tests for core budgets of the job server, with a synthetic load harness.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEJobScheduler.h"
+
+@interface MEJobSchedulerTests : XCTestCase
+@end
+
+@implementation MEJobSchedulerTests
+
+- (void)testDeadlineOrderAndIdleCoresStolen {
+    MEJobScheduler* scheduler = [MEJobScheduler schedulerWithCoreCount:8 minimumCores:2 maximumCores:4];
+    XCTAssertTrue([scheduler enqueueJob:@"a" deadline:nil]);
+    XCTAssertTrue([scheduler enqueueJob:@"b" deadline:[NSDate dateWithTimeIntervalSinceNow:100]]);
+    XCTAssertTrue([scheduler enqueueJob:@"c" deadline:[NSDate dateWithTimeIntervalSinceNow:10]]);
+    XCTAssertFalse([scheduler enqueueJob:@"a" deadline:nil]);
+
+    NSArray<MEJobGrant*>* grants = [scheduler admitJobs];
+    XCTAssertEqualObjects([grants valueForKey:@"identifier"], (@[@"c", @"b", @"a"]));
+    XCTAssertEqualObjects([grants valueForKey:@"cores"], (@[@4, @2, @2]));  // c takes the idle 2 cores
+    XCTAssertEqual(scheduler.freeCores, (NSUInteger)0);
+
+    [scheduler finishJob:@"c"];
+    XCTAssertEqual(scheduler.freeCores, (NSUInteger)4);
+    XCTAssertEqual([scheduler coresForJob:@"c"], (NSUInteger)0);
+}
+
+- (void)testLoneJobLeavesHeadroomForNextArrival {
+    MEJobScheduler* scheduler = [MEJobScheduler schedulerWithCoreCount:16 minimumCores:2 maximumCores:8];
+    [scheduler enqueueJob:@"first" deadline:nil];
+    XCTAssertEqual([scheduler admitJobs].firstObject.cores, (NSUInteger)8);
+
+    [scheduler enqueueJob:@"second" deadline:nil];
+    [scheduler enqueueJob:@"third" deadline:nil];
+    NSArray<MEJobGrant*>* grants = [scheduler admitJobs];
+    XCTAssertEqual(grants.count, (NSUInteger)2);
+    XCTAssertEqual(grants[0].cores + grants[1].cores, (NSUInteger)8);
+    XCTAssertEqual(scheduler.pendingCount, (NSUInteger)0);
+
+    [scheduler enqueueJob:@"fourth" deadline:nil];
+    XCTAssertEqual([scheduler admitJobs].count, (NSUInteger)0);  // waits for cores
+    XCTAssertTrue([scheduler removePendingJob:@"fourth"]);
+}
+
+// Random arrivals, sizes and deadlines; every tick a job advances by its budget.
+- (void)testSyntheticLoad {
+    const NSUInteger cores = 12;
+    const NSUInteger jobCount = 300;
+    MEJobScheduler* scheduler = [MEJobScheduler schedulerWithCoreCount:cores minimumCores:2 maximumCores:6];
+    srand48(2026);
+
+    NSMutableDictionary<NSString*, NSNumber*>* remaining = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSString*, NSDate*>* deadlines = [NSMutableDictionary dictionary];
+    NSDate* origin = [NSDate date];
+    NSUInteger submitted = 0, finished = 0, tick = 0;
+
+    while (finished < jobCount) {
+        if (++tick > 100000) {
+            XCTFail(@"scheduler starved a job");
+            break;
+        }
+        if (submitted < jobCount && drand48() < 0.3) {
+            NSString* identifier = [NSString stringWithFormat:@"job%lu", (unsigned long)submitted++];
+            NSDate* deadline = drand48() < 0.5 ? [origin dateByAddingTimeInterval:tick + 50 * drand48()] : nil;
+            deadlines[identifier] = deadline;
+            remaining[identifier] = @(20 + (NSInteger)(100 * drand48()));
+            [scheduler enqueueJob:identifier deadline:deadline];
+        }
+
+        NSArray<MEJobGrant*>* grants = [scheduler admitJobs];
+        NSDate* previous = nil;
+        for (MEJobGrant* grant in grants) {
+            XCTAssertGreaterThanOrEqual(grant.cores, scheduler.minimumCores);
+            NSDate* due = deadlines[grant.identifier] ?: [NSDate distantFuture];
+            if (previous) XCTAssertNotEqual([previous compare:due], NSOrderedDescending);
+            previous = due;
+        }
+
+        NSUInteger used = 0;
+        for (NSString* identifier in remaining.allKeys) {
+            NSUInteger budget = [scheduler coresForJob:identifier];
+            used += budget;
+            if (budget == 0) continue;
+            NSInteger left = remaining[identifier].integerValue - (NSInteger)budget;
+            if (left <= 0) {
+                [scheduler finishJob:identifier];
+                [remaining removeObjectForKey:identifier];
+                finished++;
+            } else {
+                remaining[identifier] = @(left);
+            }
+        }
+        XCTAssertLessThanOrEqual(used, cores);
+        XCTAssertEqual(used + scheduler.freeCores, cores);
+    }
+    XCTAssertEqual(scheduler.runningCount + scheduler.pendingCount, (NSUInteger)0);
+}
+
+@end
@@ -0,0 +1,51 @@
+//  MELatencyTrackerTests.m
+//  movencoder2Tests
+//
+//  Tests for frame-in to packet-out latency percentiles.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MELatencyTracker.h"
+
+@interface MELatencyTrackerTests : XCTestCase
+@end
+
+@implementation MELatencyTrackerTests
+
+- (void)testEmptyTrackerHasNoPercentiles {
+    MELatencyTracker* tracker = [MELatencyTracker new];
+    XCTAssertEqual(tracker.count, (uint64_t)0);
+    XCTAssertTrue(isnan([tracker latencyAtPercentile:50]));
+    XCTAssertTrue(isnan(tracker.maxLatency));
+    XCTAssertEqualObjects([tracker summary], @"frames=0");
+}
+
+- (void)testMatchesOutputByPresentationTime {
+    MELatencyTracker* tracker = [MELatencyTracker new];
+    for (int i = 0; i < 4; i++) {
+        [tracker markInputPTS:i * 1001.0 / 30000.0];
+    }
+    usleep(5 * 1000);
+    // Output order differs from input order; the PTS carries the match
+    [tracker markOutputPTS:3 * 1001.0 / 30000.0];
+    [tracker markOutputPTS:1 * 1001.0 / 30000.0 + 1e-7];   // rounding noise within tolerance
+    [tracker markOutputPTS:7.0];                            // never entered
+    [tracker markOutputPTS:NAN];
+    XCTAssertEqual(tracker.count, (uint64_t)2);
+
+    double p50 = [tracker latencyAtPercentile:50];
+    XCTAssertGreaterThanOrEqual(p50, 0.005);
+    XCTAssertLessThan(p50, 1.0);
+    XCTAssertLessThanOrEqual([tracker latencyAtPercentile:99], tracker.maxLatency);
+    XCTAssertTrue([[tracker summary] hasPrefix:@"frames=2 p50="]);
+
+    // A stamp is consumed once
+    [tracker markOutputPTS:3 * 1001.0 / 30000.0];
+    XCTAssertEqual(tracker.count, (uint64_t)2);
+}
+
+@end
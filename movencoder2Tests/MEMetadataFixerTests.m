@@ -0,0 +1,60 @@
+//  MEMetadataFixerTests.m
+//  movencoder2Tests
+//
+//  Tests for option parsing and sample description rewrite of the metadata fix-up.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import CoreMedia;
+
+#import "MEMetadataFixer.h"
+
+@interface MEMetadataFixerTests : XCTestCase
+@end
+
+@implementation MEMetadataFixerTests
+
+- (void)testRejectsUnknownOptionsAndValues {
+    NSError* error = nil;
+    XCTAssertNil([MEMetadataFixer fixerWithOptions:@{@"gamma": @"2.2"} error:&error]);
+    XCTAssertNotNil(error);
+    XCTAssertNil([MEMetadataFixer fixerWithOptions:@{@"sar": @"0:1"} error:nil]);
+    XCTAssertNil([MEMetadataFixer fixerWithOptions:@{@"field": @"top"} error:nil]);
+    XCTAssertNil([MEMetadataFixer fixerWithOptions:@{@"primaries": @"nonsense"} error:nil]);
+    XCTAssertNotNil([MEMetadataFixer fixerWithOptions:@{@"primaries": @"bt709", @"matrix": @"1", @"range": @"limited"}
+                                                error:nil]);
+}
+
+- (void)testContainerTagsOfCodecWithoutParameterSets {
+    NSDictionary* verbatim = @{(__bridge NSString*)kCMFormatDescriptionExtension_VerbatimSampleDescription: [NSData dataWithBytes:"stsd" length:4]};
+    CMFormatDescriptionRef desc = NULL;
+    CMVideoFormatDescriptionCreate(kCFAllocatorDefault, kCMVideoCodecType_AppleProRes422, 1920, 1080,
+                                   (__bridge CFDictionaryRef)verbatim, &desc);
+    MEMetadataFixer* fixer = [MEMetadataFixer fixerWithOptions:@{@"primaries": @"bt709", @"transfer": @"bt709",
+                                                                 @"matrix": @"bt709", @"sar": @"4:3",
+                                                                 @"field": @"tff"}
+                                                         error:nil];
+    NSError* error = nil;
+    CMFormatDescriptionRef fixed = [fixer createFixedFormatDescription:desc error:&error];
+    XCTAssertTrue(fixed != NULL, @"%@", error);
+
+    XCTAssertEqual(CMFormatDescriptionGetMediaSubType(fixed), kCMVideoCodecType_AppleProRes422);
+    XCTAssertEqualObjects((__bridge id)CMFormatDescriptionGetExtension(fixed, kCMFormatDescriptionExtension_ColorPrimaries),
+                          (__bridge id)kCMFormatDescriptionColorPrimaries_ITU_R_709_2);
+    XCTAssertEqualObjects((__bridge id)CMFormatDescriptionGetExtension(fixed, kCMFormatDescriptionExtension_YCbCrMatrix),
+                          (__bridge id)kCMFormatDescriptionYCbCrMatrix_ITU_R_709_2);
+    NSDictionary* pasp = (__bridge NSDictionary*)CMFormatDescriptionGetExtension(fixed, kCMFormatDescriptionExtension_PixelAspectRatio);
+    XCTAssertEqualObjects(pasp[(__bridge NSString*)kCMFormatDescriptionKey_PixelAspectRatioHorizontalSpacing], @4);
+    XCTAssertEqualObjects(pasp[(__bridge NSString*)kCMFormatDescriptionKey_PixelAspectRatioVerticalSpacing], @3);
+    XCTAssertEqualObjects((__bridge id)CMFormatDescriptionGetExtension(fixed, kCMFormatDescriptionExtension_FieldCount), @2);
+    // the old sample entry must not be written verbatim
+    XCTAssertTrue(CMFormatDescriptionGetExtension(fixed, kCMFormatDescriptionExtension_VerbatimSampleDescription) == NULL);
+
+    CFRelease(fixed);
+    CFRelease(desc);
+}
+
+@end
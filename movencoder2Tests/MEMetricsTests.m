@@ -0,0 +1,77 @@
+//  MEMetricsTests.m
+//  movencoder2Tests
+//
+//  Tests for per-stage pipeline counters and the metrics exporter.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEMetrics.h"
+
+@interface MEMetricsTests : XCTestCase
+@end
+
+@implementation MEMetricsTests
+
+- (void)tearDown {
+    MEMetricsSetEnabled(FALSE);
+    MEMetricsReset();
+    [super tearDown];
+}
+
+- (void)testDisabledCollectorRecordsNothing {
+    MEMetricsReset();
+    MEMetricsSetEnabled(FALSE);
+    uint64_t t0 = MEMetricsBegin();
+    XCTAssertEqual(t0, (uint64_t)0);
+    MEMetricsEnd(MEMetricsStageEncoderSend, t0, 1, 100);
+    XCTAssertEqual(MEMetricsSnapshot(MEMetricsStageEncoderSend).calls, (uint64_t)0);
+}
+
+- (void)testRecordAccumulatesCountersAndHistogram {
+    MEMetricsReset();
+    MEMetricsRecord(MEMetricsStageFilterPull, 500, 1, 10);               // 0.5 us -> first bucket
+    MEMetricsRecord(MEMetricsStageFilterPull, 3 * NSEC_PER_MSEC, 0, 0);  // 3000 us -> le 4096 us
+    MEMetricsStageStats stats = MEMetricsSnapshot(MEMetricsStageFilterPull);
+    XCTAssertEqual(stats.frames, (uint64_t)1);
+    XCTAssertEqual(stats.bytes, (uint64_t)10);
+    XCTAssertEqual(stats.calls, (uint64_t)2);
+    XCTAssertEqual(stats.maxNanos, (uint64_t)(3 * NSEC_PER_MSEC));
+    XCTAssertEqual(stats.buckets[0], (uint64_t)1);
+    XCTAssertEqual(stats.buckets[12], (uint64_t)1);
+}
+
+- (void)testExporterRendersBothFormats {
+    NSURL* promURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"metrics.prom"]];
+    NSURL* jsonURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"metrics.json"]];
+    XCTAssertEqual([MEMetricsExporter formatForURL:promURL], MEMetricsFormatPrometheus);
+    XCTAssertEqual([MEMetricsExporter formatForURL:jsonURL], MEMetricsFormatJSON);
+
+    MEMetricsExporter* exporter = [MEMetricsExporter exporterWithURL:jsonURL format:MEMetricsFormatJSON interval:0];
+    exporter.jobProgress = ^MEMetricsJobProgress{
+        MEMetricsJobProgress progress = {30, 1.0};
+        return progress;
+    };
+    [exporter start];
+    MEMetricsEnd(MEMetricsStageWriterAppend, MEMetricsBegin(), 1, 42);
+    NSError* error = nil;
+    XCTAssertTrue([exporter finishWithError:&error]);
+    XCTAssertFalse(MEMetricsIsEnabled());
+
+    NSData* data = [NSData dataWithContentsOfURL:jsonURL];
+    NSDictionary* document = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    XCTAssertEqualObjects(document[@"stages"][@"writer_append"][@"bytes"], @42);
+    XCTAssertEqualObjects(document[@"summary"][@"frames"], @30);
+    XCTAssertNotNil(document[@"summary"][@"peak_rss_bytes"]);
+
+    MEMetricsExporter* prom = [MEMetricsExporter exporterWithURL:promURL format:MEMetricsFormatPrometheus interval:0];
+    NSString* text = [prom renderFinal:TRUE];
+    XCTAssertTrue([text containsString:@"movencoder2_stage_seconds_bucket{stage=\"writer_append\",le=\"+Inf\"} 1"]);
+    XCTAssertTrue([text containsString:@"movencoder2_job_finished 1"]);
+    [[NSFileManager defaultManager] removeItemAtURL:jsonURL error:nil];
+}
+
+@end
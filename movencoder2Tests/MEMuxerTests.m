@@ -0,0 +1,128 @@
+//  MEMuxerTests.m
+//  movencoder2Tests
+//
+//  Tests for writing encoded packets through libavformat.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEMuxer.h"
+
+@interface MEMuxerTests : XCTestCase
+@end
+
+@implementation MEMuxerTests
+
+// Encode a few gray frames with the native MPEG-4 encoder and mux them
+- (AVCodecParameters*)muxFramesToPath:(NSString*)path format:(const char*)format {
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    if (!codec) return NULL;
+    AVCodecContext* avctx = avcodec_alloc_context3(codec);
+    avctx->width = 64;
+    avctx->height = 48;
+    avctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    avctx->time_base = av_make_q(1, 30);
+    avctx->framerate = av_make_q(30, 1);
+    avctx->sample_aspect_ratio = av_make_q(4, 3);
+    avctx->field_order = AV_FIELD_TT;
+    avctx->color_primaries = AVCOL_PRI_BT709;
+    avctx->color_trc = AVCOL_TRC_BT709;
+    avctx->colorspace = AVCOL_SPC_BT709;
+    avctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    XCTAssertEqual(avcodec_open2(avctx, codec, NULL), 0);
+
+    int ret = 0;
+    MEMuxer* muxer = MEMuxerCreate(path.fileSystemRepresentation, format, &ret);
+    XCTAssertTrue(muxer != NULL, @"%d", ret);
+    MEMuxerCleanAperture clap = {60, 44, 0, 0};
+    int index = MEMuxerAddVideoStream(muxer, avctx, &clap);
+    if (index == AVERROR(ENOSYS)) {
+        index = MEMuxerAddVideoStream(muxer, avctx, NULL);   // libavcodec without frame cropping
+    }
+    XCTAssertGreaterThanOrEqual(index, 0);
+    XCTAssertEqual(MEMuxerWriteHeader(muxer), 0);
+
+    AVFrame* frame = av_frame_alloc();
+    frame->width = avctx->width;
+    frame->height = avctx->height;
+    frame->format = avctx->pix_fmt;
+    av_frame_get_buffer(frame, 0);
+    AVPacket* packet = av_packet_alloc();
+    for (int i = 0; i <= 10; i++) {
+        AVFrame* input = NULL;
+        if (i < 10) {
+            av_frame_make_writable(frame);
+            for (int plane = 0; plane < 3; plane++) {
+                int lines = plane ? frame->height / 2 : frame->height;
+                memset(frame->data[plane], 128, (size_t)(frame->linesize[plane] * lines));
+            }
+            frame->pts = i;
+            input = frame;
+        }
+        XCTAssertEqual(avcodec_send_frame(avctx, input), 0);
+        while (avcodec_receive_packet(avctx, packet) == 0) {
+            XCTAssertEqual(MEMuxerWritePacket(muxer, index, packet, avctx->time_base), 0);
+            XCTAssertEqual(packet->size, 0);    // reference taken over
+        }
+    }
+    XCTAssertEqual(MEMuxerFinish(muxer), 0);
+    MEMuxerFree(&muxer);
+    XCTAssertTrue(muxer == NULL);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+
+    AVFormatContext* fmtctx = NULL;
+    XCTAssertEqual(avformat_open_input(&fmtctx, path.fileSystemRepresentation, NULL, NULL), 0);
+    XCTAssertGreaterThanOrEqual(avformat_find_stream_info(fmtctx, NULL), 0);
+    AVCodecParameters* par = avcodec_parameters_alloc();
+    avcodec_parameters_copy(par, fmtctx->streams[0]->codecpar);
+    avformat_close_input(&fmtctx);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    return par;
+}
+
+- (void)testMovCarriesColorAspectAndFieldOrder {
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MEMuxerTests.mov"];
+    AVCodecParameters* par = [self muxFramesToPath:path format:"mov"];
+    if (!par) {
+        NSLog(@"MPEG-4 encoder is not available; skipped");
+        return;
+    }
+    XCTAssertEqual(par->codec_id, AV_CODEC_ID_MPEG4);
+    XCTAssertEqual(par->color_primaries, AVCOL_PRI_BT709);
+    XCTAssertEqual(par->color_trc, AVCOL_TRC_BT709);
+    XCTAssertEqual(par->color_space, AVCOL_SPC_BT709);
+    XCTAssertEqual(par->sample_aspect_ratio.num, 4);
+    XCTAssertEqual(par->sample_aspect_ratio.den, 3);
+    XCTAssertEqual(par->field_order, AV_FIELD_TT);
+    avcodec_parameters_free(&par);
+}
+
+- (void)testMatroskaOutput {
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MEMuxerTests.mkv"];
+    AVCodecParameters* par = [self muxFramesToPath:path format:"matroska"];
+    if (!par) return;
+    XCTAssertEqual(par->codec_id, AV_CODEC_ID_MPEG4);
+    XCTAssertEqual(par->color_primaries, AVCOL_PRI_BT709);
+    avcodec_parameters_free(&par);
+}
+
+- (void)testInvalidUseIsRejected {
+    XCTAssertEqual(MEMuxerWriteHeader(NULL), AVERROR(EINVAL));
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MEMuxerTests.mp4"];
+    int ret = 0;
+    MEMuxer* muxer = MEMuxerCreate(path.fileSystemRepresentation, "mp4", &ret);
+    XCTAssertTrue(muxer != NULL);
+    XCTAssertEqual(MEMuxerWriteHeader(muxer), AVERROR(EINVAL));     // no stream yet
+    XCTAssertEqual(MEMuxerFinish(muxer), AVERROR(EINVAL));          // no header yet
+    MEMuxerFree(&muxer);
+    XCTAssertTrue(MEMuxerCreate(path.fileSystemRepresentation, "no-such-format", &ret) == NULL);
+    XCTAssertLessThan(ret, 0);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+@end
@@ -0,0 +1,126 @@
+//  MERemuxerTests.m
+//  movencoder2Tests
+//
+//  Tests for the box level fast start rewrite of the remux fast path.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MERemuxer.h"
+
+static void appendBox(NSMutableData* data, const char* type, NSData* payload) {
+    uint32_t size = CFSwapInt32HostToBig((uint32_t)(8 + payload.length));
+    [data appendBytes:&size length:4];
+    [data appendBytes:type length:4];
+    [data appendData:payload];
+}
+
+static NSData* box(const char* type, NSData* payload) {
+    NSMutableData* data = [NSMutableData data];
+    appendBox(data, type, payload);
+    return data;
+}
+
+static NSData* stco(uint32_t offset) {
+    uint32_t words[] = {0, CFSwapInt32HostToBig(1), CFSwapInt32HostToBig(offset)};   // version/flags, count, entry
+    return box("stco", [NSData dataWithBytes:words length:sizeof(words)]);
+}
+
+@interface MERemuxerTests : XCTestCase
+@property (nonatomic, strong) NSURL* fileURL;
+@end
+
+@implementation MERemuxerTests
+
+- (void)setUp {
+    NSString* name = [NSUUID.UUID.UUIDString stringByAppendingPathExtension:@"mov"];
+    self.fileURL = [NSFileManager.defaultManager.temporaryDirectory URLByAppendingPathComponent:name];
+}
+
+- (void)tearDown {
+    [NSFileManager.defaultManager removeItemAtURL:self.fileURL error:nil];
+}
+
+- (void)testMovesMovieHeaderAndShiftsChunkOffsets {
+    NSData* ftyp = box("ftyp", [@"qt  \0\0\0\0" dataUsingEncoding:NSASCIIStringEncoding]);
+    NSData* mdat = box("mdat", [@"0123456789abcdef" dataUsingEncoding:NSASCIIStringEncoding]);
+    uint32_t sampleOffset = (uint32_t)(ftyp.length + 8);
+    NSData* moov = box("moov", box("trak", box("mdia", box("minf", box("stbl", stco(sampleOffset))))));
+
+    NSMutableData* file = [NSMutableData data];
+    [file appendData:ftyp];
+    [file appendData:mdat];
+    [file appendData:moov];
+    XCTAssertTrue([file writeToURL:self.fileURL atomically:NO]);
+
+    NSError* error = nil;
+    XCTAssertTrue([MERemuxer moveMovieHeaderToFrontOfFileAtURL:self.fileURL error:&error], @"%@", error);
+    NSData* result = [NSData dataWithContentsOfURL:self.fileURL];
+    XCTAssertEqual(result.length, file.length);
+
+    const uint8_t* p = result.bytes;
+    XCTAssertEqual(memcmp(p + ftyp.length + 4, "moov", 4), 0);
+    XCTAssertEqual(memcmp(p + ftyp.length + moov.length + 4, "mdat", 4), 0);
+    uint32_t entry = 0;
+    memcpy(&entry, p + ftyp.length + moov.length - 4, 4);
+    XCTAssertEqual(CFSwapInt32BigToHost(entry), sampleOffset + (uint32_t)moov.length);
+    XCTAssertEqualObjects([result subdataWithRange:NSMakeRange(CFSwapInt32BigToHost(entry), 16)],
+                          [@"0123456789abcdef" dataUsingEncoding:NSASCIIStringEncoding]);
+
+    // A second pass finds moov in front and leaves the file alone
+    XCTAssertTrue([MERemuxer moveMovieHeaderToFrontOfFileAtURL:self.fileURL error:&error]);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:self.fileURL], result);
+}
+
+- (void)testPromotesOverflowingStcoToCo64 {
+    NSData* ftyp = box("ftyp", [@"qt  \0\0\0\0" dataUsingEncoding:NSASCIIStringEncoding]);
+    NSData* mdat = box("mdat", [@"0123456789abcdef" dataUsingEncoding:NSASCIIStringEncoding]);
+    uint32_t farOffset = UINT32_MAX - 16;     // as in a file just under 4 GiB; only the value matters here
+    NSData* stbl = box("stbl", stco(farOffset));
+    NSData* moov = box("moov", box("trak", box("mdia", box("minf", stbl))));
+
+    NSMutableData* file = [NSMutableData data];
+    [file appendData:ftyp];
+    [file appendData:mdat];
+    [file appendData:moov];
+    XCTAssertTrue([file writeToURL:self.fileURL atomically:NO]);
+
+    NSError* error = nil;
+    XCTAssertTrue([MERemuxer moveMovieHeaderToFrontOfFileAtURL:self.fileURL error:&error], @"%@", error);
+    NSData* result = [NSData dataWithContentsOfURL:self.fileURL];
+    NSUInteger moovSize = moov.length + 4;    // one entry grows from 4 to 8 bytes
+    XCTAssertEqual(result.length, file.length + 4);
+
+    // every enclosing box grew by 4 bytes
+    const uint8_t* p = (const uint8_t*)result.bytes + ftyp.length;
+    const char* types[] = {"moov", "trak", "mdia", "minf", "stbl"};
+    for (int i = 0; i < 5; i++) {
+        uint32_t size = 0;
+        memcpy(&size, p + i * 8, 4);
+        XCTAssertEqual(memcmp(p + i * 8 + 4, types[i], 4), 0);
+        XCTAssertEqual(CFSwapInt32BigToHost(size), (uint32_t)(moovSize - i * 8));
+    }
+    const uint8_t* co64 = p + 5 * 8;
+    uint32_t co64Size = 0, count = 0;
+    memcpy(&co64Size, co64, 4);
+    memcpy(&count, co64 + 12, 4);
+    XCTAssertEqual(memcmp(co64 + 4, "co64", 4), 0);
+    XCTAssertEqual(CFSwapInt32BigToHost(co64Size), 24u);
+    XCTAssertEqual(CFSwapInt32BigToHost(count), 1u);
+    uint64_t entry = 0;
+    memcpy(&entry, co64 + 16, 8);
+    XCTAssertEqual(CFSwapInt64BigToHost(entry), (uint64_t)farOffset + moovSize);
+    XCTAssertEqual(memcmp(p + moovSize + 4, "mdat", 4), 0);
+}
+
+- (void)testRejectsFileWithoutMovieHeader {
+    [box("mdat", [NSData dataWithBytes:"abcd" length:4]) writeToURL:self.fileURL atomically:NO];
+    NSError* error = nil;
+    XCTAssertFalse([MERemuxer moveMovieHeaderToFrontOfFileAtURL:self.fileURL error:&error]);
+    XCTAssertNotNil(error);
+}
+
+@end
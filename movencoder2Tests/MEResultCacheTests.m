@@ -0,0 +1,108 @@
+//  MEResultCacheTests.m
+//  movencoder2Tests
+//
+//  Tests for the content addressed result cache.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MEResultCache.h"
+#include <sys/stat.h>
+
+@interface MEResultCacheTests : XCTestCase
+@property (nonatomic, strong) NSURL* workURL;
+@end
+
+@implementation MEResultCacheTests
+
+- (void)setUp {
+    self.workURL = [NSFileManager.defaultManager.temporaryDirectory
+                    URLByAppendingPathComponent:NSUUID.UUID.UUIDString isDirectory:YES];
+    [NSFileManager.defaultManager createDirectoryAtURL:self.workURL
+                           withIntermediateDirectories:YES attributes:nil error:nil];
+}
+
+- (void)tearDown {
+    [NSFileManager.defaultManager removeItemAtURL:self.workURL error:nil];
+}
+
+- (NSURL*)fileNamed:(NSString*)name length:(NSUInteger)length fill:(uint8_t)fill {
+    NSMutableData* data = [NSMutableData dataWithLength:length];
+    memset(data.mutableBytes, fill, length);
+    NSURL* url = [self.workURL URLByAppendingPathComponent:name];
+    [data writeToURL:url atomically:NO];
+    return url;
+}
+
+- (void)testContentHashFollowsContent {
+    NSURL* a = [self fileNamed:@"a.mov" length:8 * 1024 * 1024 fill:1];
+    NSURL* b = [self fileNamed:@"b.mov" length:8 * 1024 * 1024 fill:1];
+    NSURL* c = [self fileNamed:@"c.mov" length:8 * 1024 * 1024 fill:2];
+    NSString* hashA = [MEResultCache contentHashOfFileAtURL:a];
+    XCTAssertEqual(hashA.length, (NSUInteger)64);
+    XCTAssertEqualObjects(hashA, [MEResultCache contentHashOfFileAtURL:b]);
+    XCTAssertNotEqualObjects(hashA, [MEResultCache contentHashOfFileAtURL:c]);
+    XCTAssertNil([MEResultCache contentHashOfFileAtURL:[self.workURL URLByAppendingPathComponent:@"missing"]]);
+
+    // Same size, one byte changed in the middle
+    NSMutableData* data = [NSMutableData dataWithContentsOfURL:a];
+    ((uint8_t*)data.mutableBytes)[data.length / 2 + 12345] ^= 0xFF;
+    NSURL* d = [self.workURL URLByAppendingPathComponent:@"d.mov"];
+    [data writeToURL:d atomically:NO];
+    XCTAssertNotEqualObjects(hashA, [MEResultCache contentHashOfFileAtURL:d]);
+
+    XCTAssertNotEqualObjects([MEResultCache keyWithComponents:@[@"a", @"b"]],
+                             [MEResultCache keyWithComponents:@[@"a", @"c"]]);
+}
+
+- (void)testStoreThenHitAndCount {
+    MEResultCache* cache = [MEResultCache resultCacheWithDirectoryURL:[self.workURL URLByAppendingPathComponent:@"cache"]
+                                                             maxBytes:1024 * 1024];
+    NSURL* output = [self fileNamed:@"out.mp4" length:1000 fill:7];
+    NSURL* placed = [self.workURL URLByAppendingPathComponent:@"placed.mp4"];
+
+    XCTAssertFalse([cache placeEntryForKey:@"k1" atURL:placed]);
+    NSError* error = nil;
+    XCTAssertTrue([cache storeFileAtURL:output forKey:@"k1" error:&error], @"%@", error);
+    XCTAssertTrue([cache placeEntryForKey:@"k1" atURL:placed]);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:placed], [NSData dataWithContentsOfURL:output]);
+
+    // The placed output is a separate, writable file
+    struct stat placedStat, entryStat;
+    XCTAssertEqual(stat(placed.fileSystemRepresentation, &placedStat), 0);
+    NSURL* entry = [[self.workURL URLByAppendingPathComponent:@"cache"] URLByAppendingPathComponent:@"k1.mp4"];
+    XCTAssertEqual(stat(entry.fileSystemRepresentation, &entryStat), 0);
+    XCTAssertNotEqual(placedStat.st_ino, entryStat.st_ino);
+    XCTAssertEqual(placedStat.st_nlink, (nlink_t)1);
+    XCTAssertTrue([NSFileManager.defaultManager isWritableFileAtPath:placed.path]);
+
+    NSDictionary* stats = [cache statistics];
+    XCTAssertEqualObjects(stats[@"hits"], @1);
+    XCTAssertEqualObjects(stats[@"misses"], @1);
+    XCTAssertEqualObjects(stats[@"stores"], @1);
+    XCTAssertEqualObjects(stats[@"entries"], @1);
+    XCTAssertEqualObjects(stats[@"bytes"], @1000);
+}
+
+- (void)testEvictsLeastRecentlyUsed {
+    MEResultCache* cache = [MEResultCache resultCacheWithDirectoryURL:[self.workURL URLByAppendingPathComponent:@"cache"]
+                                                             maxBytes:2500];
+    NSURL* placed = [self.workURL URLByAppendingPathComponent:@"placed.mov"];
+    [cache storeFileAtURL:[self fileNamed:@"1.mov" length:1000 fill:1] forKey:@"old" error:nil];
+    sleep(1);
+    [cache storeFileAtURL:[self fileNamed:@"2.mov" length:1000 fill:2] forKey:@"used" error:nil];
+    sleep(1);
+    XCTAssertTrue([cache placeEntryForKey:@"old" atURL:placed]);   // now the most recent use
+    [NSFileManager.defaultManager removeItemAtURL:placed error:nil];
+    sleep(1);
+    [cache storeFileAtURL:[self fileNamed:@"3.mov" length:1000 fill:3] forKey:@"new" error:nil];
+
+    XCTAssertTrue([cache placeEntryForKey:@"old" atURL:placed]);
+    XCTAssertFalse([cache placeEntryForKey:@"used" atURL:placed]);
+    XCTAssertEqualObjects([cache statistics][@"evictions"], @1);
+}
+
+@end
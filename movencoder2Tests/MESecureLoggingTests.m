@@ -0,0 +1,58 @@
+//  MESecureLoggingTests.m
+//  movencoder2Tests
+//
+//  Tests for the single-pass sanitizer and the log level gate.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "MESecureLogging.h"
+
+@interface MESecureLoggingTests : XCTestCase
+@property (nonatomic, assign) NSInteger savedLevel;
+@end
+
+@implementation MESecureLoggingTests
+
+- (void)setUp {
+    [super setUp];
+    self.savedLevel = SecureLogGetLevel();
+}
+
+- (void)tearDown {
+    SecureLogSetLevel(self.savedLevel);
+    [super tearDown];
+}
+
+- (void)testSanitizeEscapesInOnePass {
+    XCTAssertEqualObjects(sanitizeLogString(@"100%\tdone\nnext"), @"100%%\\tdone\\nnext");
+    XCTAssertEqualObjects(sanitizeLogString(@"%%"), @"%%%%");
+    XCTAssertEqualObjects(sanitizeLogString(@""), @"");
+}
+
+- (void)testSanitizeReturnsCleanInputUnchanged {
+    NSString* clean = @"[MEManager] plain message";
+    XCTAssertTrue(sanitizeLogString(clean) == clean);
+}
+
+- (void)testLevelGate {
+    SecureLogSetLevel(2); // info
+    XCTAssertTrue(SecureLogIsEnabled(1));
+    XCTAssertTrue(SecureLogIsEnabled(2));
+    XCTAssertFalse(SecureLogIsEnabled(3));
+    SecureLogSetLevel(0); // silent
+    XCTAssertFalse(SecureLogIsEnabled(1));
+}
+
+- (void)testQueuedMessagesAreFlushed {
+    SecureLogSetLevel(3);
+    for (int i = 0; i < 100; i++) {
+        SecureDebugLogf(@"[MESecureLoggingTests] message %d", i);
+    }
+    SecureLogFlush();   // must return once the writer thread has drained the ring
+}
+
+@end
@@ -0,0 +1,201 @@
+//  MESegmentWriterTests.m
+//  movencoder2Tests
+//
+//  Tests for the HLS media playlist and the DASH MPD written next to CMAF segments.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import AVFoundation;
+
+#import "MESegmentWriter.h"
+
+static CMTime seconds90k(int64_t value) {
+    return CMTimeMake(value, 90000);
+}
+
+static NSData* box(const char* type, NSData* payload) {
+    NSMutableData* data = [NSMutableData data];
+    uint32_t size = CFSwapInt32HostToBig((uint32_t)(8 + payload.length));
+    [data appendBytes:&size length:4];
+    [data appendBytes:type length:4];
+    [data appendData:payload];
+    return data;
+}
+
+static NSData* bytes(const uint8_t* p, size_t length) {
+    return [NSData dataWithBytes:p length:length];
+}
+
+// trak with a handler and one sample entry: fixed fields followed by one configuration box
+static NSData* trak(const char* handler, const char* format, NSData* fixed, const char* configType, NSData* config) {
+    NSMutableData* hdlr = [NSMutableData dataWithLength:8];
+    [hdlr appendBytes:handler length:4];
+    [hdlr increaseLengthBy:13];
+    NSMutableData* entry = [fixed mutableCopy];
+    [entry appendData:box(configType, config)];
+    const uint8_t stsdHeader[] = {0, 0, 0, 0, 0, 0, 0, 1};
+    NSMutableData* stsd = [bytes(stsdHeader, sizeof(stsdHeader)) mutableCopy];
+    [stsd appendData:box(format, entry)];
+    NSMutableData* mdia = [box("hdlr", hdlr) mutableCopy];
+    [mdia appendData:box("minf", box("stbl", box("stsd", stsd)))];
+    return box("trak", box("mdia", mdia));
+}
+
+// VisualSampleEntry fields of a width x height track
+static NSData* visualFields(uint16_t width, uint16_t height) {
+    NSMutableData* fixed = [NSMutableData dataWithLength:78];
+    uint8_t* p = fixed.mutableBytes;
+    p[7] = 1;                                   // data_reference_index
+    p[24] = width >> 8; p[25] = width & 0xFF;
+    p[26] = height >> 8; p[27] = height & 0xFF;
+    return fixed;
+}
+
+// init segment of a 1280x720 High 3.1 track and an AAC-LC track
+static NSData* avcAacInitSegment(void) {
+    const uint8_t avcC[] = {0x01, 0x64, 0x00, 0x1F, 0xFF, 0xE0, 0x00};
+    NSMutableData* audioFields = [NSMutableData dataWithLength:28];
+    ((uint8_t*)audioFields.mutableBytes)[7] = 1;
+    const uint8_t esds[] = {0, 0, 0, 0,
+                            0x03, 0x16, 0x00, 0x01, 0x00,                   // ES_Descriptor
+                            0x04, 0x11, 0x40, 0x15, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // DecoderConfigDescriptor
+                            0x05, 0x02, 0x11, 0x90};                        // AudioSpecificConfig: AAC-LC
+    NSMutableData* moov = [trak("vide", "avc1", visualFields(1280, 720), "avcC", bytes(avcC, sizeof(avcC))) mutableCopy];
+    [moov appendData:trak("soun", "mp4a", audioFields, "esds", bytes(esds, sizeof(esds)))];
+    NSMutableData* data = [box("ftyp", [@"cmfc\0\0\0\0" dataUsingEncoding:NSASCIIStringEncoding]) mutableCopy];
+    [data appendData:box("moov", moov)];
+    return data;
+}
+
+@interface MESegmentWriterTests : XCTestCase
+@property (nonatomic, strong) NSURL* directoryURL;
+@property (nonatomic, strong) MESegmentWriter* writer;
+@end
+
+@implementation MESegmentWriterTests
+
+- (void)setUp {
+    NSString* name = NSUUID.UUID.UUIDString;
+    self.directoryURL = [NSFileManager.defaultManager.temporaryDirectory URLByAppendingPathComponent:name];
+    self.writer = [MESegmentWriter segmentWriterWithDirectoryURL:self.directoryURL targetDuration:2.0];
+    XCTAssertTrue([self.writer prepareWithError:nil]);
+}
+
+- (void)tearDown {
+    [NSFileManager.defaultManager removeItemAtURL:self.directoryURL error:nil];
+}
+
+- (NSString*)contentsOf:(NSString*)name {
+    NSURL* url = [self.directoryURL URLByAppendingPathComponent:name];
+    return [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:nil];
+}
+
+- (void)writeSegmentStart:(int64_t)start duration:(int64_t)duration {
+    [self.writer writeSegmentData:[NSMutableData dataWithLength:1000]
+                      segmentType:AVAssetSegmentTypeSeparable
+                            start:seconds90k(start)
+                         duration:seconds90k(duration)
+                        mediaType:AVMediaTypeVideo];
+}
+
+- (void)testPlaylistDurationsAndNumbering {
+    [self.writer writeSegmentData:[NSMutableData dataWithLength:100] segmentType:AVAssetSegmentTypeInitialization
+                            start:kCMTimeInvalid duration:kCMTimeInvalid mediaType:nil];
+    [self writeSegmentStart:0 duration:180180];          // 2.002 s
+    [self writeSegmentStart:180180 duration:180180];
+
+    // 2.002 s rounds to 2: the target stays at the preferred interval
+    NSString* playlist = [self contentsOf:@"media.m3u8"];
+    XCTAssertTrue([playlist containsString:@"#EXT-X-TARGETDURATION:2\n"], @"%@", playlist);
+    XCTAssertTrue([playlist containsString:@"#EXT-X-PLAYLIST-TYPE:EVENT\n"]);
+    XCTAssertFalse([playlist containsString:@"#EXT-X-ENDLIST"]);
+
+    [self writeSegmentStart:360360 duration:315000];     // 3.5 s, a longer GOP
+    [self writeSegmentStart:675360 duration:90000];
+    XCTAssertEqual(self.writer.segmentCount, 4u);
+    XCTAssertTrue([self.writer finishWithError:nil]);
+
+    playlist = [self contentsOf:@"media.m3u8"];
+    NSString* expected = @"#EXTM3U\n"
+                         @"#EXT-X-VERSION:7\n"
+                         @"#EXT-X-TARGETDURATION:4\n"
+                         @"#EXT-X-PLAYLIST-TYPE:VOD\n"
+                         @"#EXT-X-MEDIA-SEQUENCE:1\n"
+                         @"#EXT-X-INDEPENDENT-SEGMENTS\n"
+                         @"#EXT-X-MAP:URI=\"init.mp4\"\n"
+                         @"#EXTINF:2.002000,\nsegment-00001.m4s\n"
+                         @"#EXTINF:2.002000,\nsegment-00002.m4s\n"
+                         @"#EXTINF:3.500000,\nsegment-00003.m4s\n"
+                         @"#EXTINF:1.000000,\nsegment-00004.m4s\n"
+                         @"#EXT-X-ENDLIST\n";
+    XCTAssertEqualObjects(playlist, expected);
+    for (int i = 1; i <= 4; i++) {
+        NSString* name = [NSString stringWithFormat:@"segment-%05d.m4s", i];
+        XCTAssertTrue([NSFileManager.defaultManager fileExistsAtPath:[self.directoryURL URLByAppendingPathComponent:name].path]);
+    }
+}
+
+- (void)testManifestTimeline {
+    self.writer.frameDuration = CMTimeMake(1001, 30000);
+    [self.writer writeSegmentData:avcAacInitSegment() segmentType:AVAssetSegmentTypeInitialization
+                            start:kCMTimeInvalid duration:kCMTimeInvalid mediaType:nil];
+    [self writeSegmentStart:0 duration:180000];
+    [self writeSegmentStart:180000 duration:180000];
+    [self writeSegmentStart:450000 duration:90000];      // gap before the third segment
+
+    NSString* manifest = [self contentsOf:@"manifest.mpd"];
+    XCTAssertTrue([manifest containsString:@"type=\"dynamic\""], @"%@", manifest);
+    XCTAssertTrue([self.writer finishWithError:nil]);
+
+    manifest = [self contentsOf:@"manifest.mpd"];
+    XCTAssertTrue([manifest containsString:@"type=\"static\" mediaPresentationDuration=\"PT5.000S\""], @"%@", manifest);
+    XCTAssertTrue([manifest containsString:@"timescale=\"90000\" initialization=\"init.mp4\" "
+                                           @"media=\"segment-$Number%05d$.m4s\" startNumber=\"1\""]);
+    // 1000 bytes in 1 s is the peak; codecs and size come from the init segment
+    XCTAssertTrue([manifest containsString:@"<Representation id=\"0\" bandwidth=\"8000\" codecs=\"avc1.64001F,mp4a.40.2\" "
+                                           @"width=\"1280\" height=\"720\" frameRate=\"30000/1001\">"], @"%@", manifest);
+    NSString* timeline = @"            <S t=\"0\" d=\"180000\"/>\n"
+                         @"            <S d=\"180000\"/>\n"
+                         @"            <S t=\"450000\" d=\"90000\"/>\n";
+    XCTAssertTrue([manifest containsString:timeline], @"%@", manifest);
+}
+
+- (void)testMultivariantPlaylistCodecs {
+    self.writer.frameDuration = CMTimeMake(1001, 30000);
+    [self.writer writeSegmentData:avcAacInitSegment() segmentType:AVAssetSegmentTypeInitialization
+                            start:kCMTimeInvalid duration:kCMTimeInvalid mediaType:nil];
+    [self writeSegmentStart:0 duration:90000];
+    XCTAssertTrue([self.writer finishWithError:nil]);
+
+    NSString* expected = @"#EXTM3U\n"
+                         @"#EXT-X-VERSION:7\n"
+                         @"#EXT-X-INDEPENDENT-SEGMENTS\n"
+                         @"#EXT-X-STREAM-INF:BANDWIDTH=8000,CODECS=\"avc1.64001F,mp4a.40.2\",RESOLUTION=1280x720,FRAME-RATE=29.970\n"
+                         @"media.m3u8\n";
+    XCTAssertEqualObjects([self contentsOf:@"master.m3u8"], expected);
+}
+
+- (void)testHEVCCodecString {
+    // Main profile, compatibility flags 0x60000000, main tier level 3.1, progressive source constraint
+    const uint8_t hvcC[] = {0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0xB0, 0, 0, 0, 0, 0, 0x5D, 0xF0, 0x00};
+    NSMutableData* init = [box("ftyp", [@"cmfc\0\0\0\0" dataUsingEncoding:NSASCIIStringEncoding]) mutableCopy];
+    [init appendData:box("moov", trak("vide", "hvc1", visualFields(1920, 1080), "hvcC", bytes(hvcC, sizeof(hvcC))))];
+    [self.writer writeSegmentData:init segmentType:AVAssetSegmentTypeInitialization
+                            start:kCMTimeInvalid duration:kCMTimeInvalid mediaType:nil];
+    [self writeSegmentStart:0 duration:90000];
+
+    NSString* manifest = [self contentsOf:@"manifest.mpd"];
+    XCTAssertTrue([manifest containsString:@"codecs=\"hvc1.1.6.L93.B0\" width=\"1920\" height=\"1080\">"], @"%@", manifest);
+    XCTAssertTrue([[self contentsOf:@"master.m3u8"] containsString:@"CODECS=\"hvc1.1.6.L93.B0\",RESOLUTION=1920x1080\n"]);
+}
+
+- (void)testFinishWithoutInitSegmentFails {
+    NSError* error = nil;
+    XCTAssertFalse([self.writer finishWithError:&error]);
+    XCTAssertNotNil(error);
+}
+
+@end
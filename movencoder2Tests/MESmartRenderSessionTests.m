@@ -0,0 +1,210 @@
+//  MESmartRenderSessionTests.m
+//  movencoder2Tests
+//
+//  Tests for the open GOP check at cut points and the track assembly of smart rendering.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import AVFoundation;
+
+#import "MESmartRenderSession.h"
+#import "MEMovieAssembler.h"
+
+static const int32_t kTimeScale = 30;
+static const int kSampleRate = 48000;
+static const int kSamplesPerFrame = kSampleRate / kTimeScale;
+
+typedef struct {
+    int64_t dts;
+    int64_t pts;
+    BOOL sync;
+} METestSample;
+
+@interface MESmartRenderSession (Testing)
+- (BOOL)assembleMovie:(AVMovie*)source head:(id)head tail:(id)tail middle:(CMTimeRange)middle
+       copyOtherMedia:(BOOL)copyOtherMedia error:(NSError**)error;
+@end
+
+// JPEG samples with the given timing (1/30 s units), and LPCM audio over the first audioFrames frames
+static BOOL writeMovie(NSURL* url, const METestSample* samples, int count, int audioFrames) {
+    NSError* error = nil;
+    AVAssetWriter* writer = [AVAssetWriter assetWriterWithURL:url fileType:AVFileTypeQuickTimeMovie error:&error];
+    CMFormatDescriptionRef videoDesc = NULL;
+    CMVideoFormatDescriptionCreate(kCFAllocatorDefault, kCMVideoCodecType_JPEG, 64, 64, NULL, &videoDesc);
+    AVAssetWriterInput* video = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeVideo
+                                                                   outputSettings:nil
+                                                                 sourceFormatHint:videoDesc];
+    video.expectsMediaDataInRealTime = NO;
+
+    AudioStreamBasicDescription asbd = {0};
+    asbd.mSampleRate = kSampleRate;
+    asbd.mFormatID = kAudioFormatLinearPCM;
+    asbd.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+    asbd.mBytesPerPacket = 2;
+    asbd.mFramesPerPacket = 1;
+    asbd.mBytesPerFrame = 2;
+    asbd.mChannelsPerFrame = 1;
+    asbd.mBitsPerChannel = 16;
+    CMAudioFormatDescriptionRef audioDesc = NULL;
+    CMAudioFormatDescriptionCreate(kCFAllocatorDefault, &asbd, 0, NULL, 0, NULL, NULL, &audioDesc);
+    AVAssetWriterInput* audio = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeAudio
+                                                                   outputSettings:nil
+                                                                 sourceFormatHint:audioDesc];
+    audio.expectsMediaDataInRealTime = NO;
+    BOOL ok = writer && [writer canAddInput:video] && (audioFrames == 0 || [writer canAddInput:audio]);
+    if (ok) {
+        [writer addInput:video];
+        if (audioFrames > 0) [writer addInput:audio];
+        ok = [writer startWriting];
+    }
+    if (ok) {
+        int64_t firstPTS = INT64_MAX;
+        for (int i = 0; i < count; i++) {
+            firstPTS = MIN(firstPTS, samples[i].pts);
+        }
+        [writer startSessionAtSourceTime:CMTimeMake(firstPTS, kTimeScale)];
+    }
+
+    static uint8_t payload[64];
+    static int16_t pcm[kSamplesPerFrame];
+    for (int i = 0; ok && i < count; i++) {
+        CMBlockBufferRef block = NULL;
+        CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, NULL, sizeof(payload), kCFAllocatorDefault,
+                                           NULL, 0, sizeof(payload), kCMBlockBufferAssureMemoryNowFlag, &block);
+        CMBlockBufferReplaceDataBytes(payload, block, 0, sizeof(payload));
+        CMSampleTimingInfo timing = {CMTimeMake(1, kTimeScale), CMTimeMake(samples[i].pts, kTimeScale),
+                                     CMTimeMake(samples[i].dts, kTimeScale)};
+        size_t size = sizeof(payload);
+        CMSampleBufferRef sb = NULL;
+        CMSampleBufferCreateReady(kCFAllocatorDefault, block, videoDesc, 1, 1, &timing, 1, &size, &sb);
+        if (!samples[i].sync) {
+            CFArrayRef attachments = CMSampleBufferGetSampleAttachmentsArray(sb, true);
+            CFMutableDictionaryRef dict = (CFMutableDictionaryRef)CFArrayGetValueAtIndex(attachments, 0);
+            CFDictionarySetValue(dict, kCMSampleAttachmentKey_NotSync, kCFBooleanTrue);
+        }
+        while (!video.readyForMoreMediaData) {
+            usleep(1000);
+        }
+        ok = [video appendSampleBuffer:sb];
+        CFRelease(sb);
+        CFRelease(block);
+
+        if (ok && i < audioFrames) {
+            CMBlockBufferRef pcmBlock = NULL;
+            CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, NULL, sizeof(pcm), kCFAllocatorDefault,
+                                               NULL, 0, sizeof(pcm), kCMBlockBufferAssureMemoryNowFlag, &pcmBlock);
+            CMBlockBufferReplaceDataBytes(pcm, pcmBlock, 0, sizeof(pcm));
+            CMSampleBufferRef audioBuffer = NULL;
+            CMAudioSampleBufferCreateReadyWithPacketDescriptions(kCFAllocatorDefault, pcmBlock, audioDesc, kSamplesPerFrame,
+                                                                 CMTimeMake((int64_t)i * kSamplesPerFrame, kSampleRate),
+                                                                 NULL, &audioBuffer);
+            while (!audio.readyForMoreMediaData) {
+                usleep(1000);
+            }
+            ok = [audio appendSampleBuffer:audioBuffer];
+            CFRelease(audioBuffer);
+            CFRelease(pcmBlock);
+            if (i == audioFrames - 1) [audio markAsFinished];
+        }
+    }
+    CFRelease(videoDesc);
+    CFRelease(audioDesc);
+    if (!ok) return NO;
+    [video markAsFinished];
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [writer finishWritingWithCompletionHandler:^{
+        dispatch_semaphore_signal(done);
+    }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    return writer.status == AVAssetWriterStatusCompleted;
+}
+
+@interface MESmartRenderSessionTests : XCTestCase
+@property (nonatomic, strong) NSURL* sourceURL;
+@property (nonatomic, strong) NSURL* outputURL;
+@end
+
+@implementation MESmartRenderSessionTests
+
+- (void)setUp {
+    NSURL* tmp = NSFileManager.defaultManager.temporaryDirectory;
+    self.sourceURL = [tmp URLByAppendingPathComponent:[NSUUID.UUID.UUIDString stringByAppendingPathExtension:@"mov"]];
+    self.outputURL = [tmp URLByAppendingPathComponent:[NSUUID.UUID.UUIDString stringByAppendingPathExtension:@"mov"]];
+}
+
+- (void)tearDown {
+    [NSFileManager.defaultManager removeItemAtURL:self.sourceURL error:nil];
+    [NSFileManager.defaultManager removeItemAtURL:self.outputURL error:nil];
+}
+
+- (AVMovie*)sourceMovie {
+    return [AVMovie movieWithURL:self.sourceURL options:@{AVURLAssetPreferPreciseDurationAndTimingKey: @YES}];
+}
+
+- (void)testTrackOutsideTheRangeIsNotAdded {
+    // 3 sec of intra-only video; audio only over the first second
+    METestSample samples[90];
+    for (int i = 0; i < 90; i++) {
+        samples[i] = (METestSample){i, i, YES};
+    }
+    XCTAssertTrue(writeMovie(self.sourceURL, samples, 90, 30));
+    AVMovie* source = [self sourceMovie];
+    XCTAssertEqual([source tracksWithMediaType:AVMediaTypeAudio].count, 1u);
+
+    CMTimeRange range = CMTimeRangeMake(CMTimeMake(60, kTimeScale), CMTimeMake(30, kTimeScale));
+    MESmartRenderSession* session = [MESmartRenderSession sessionWithInputURL:self.sourceURL outputURL:self.outputURL
+                                                                    timeRange:range
+                                                                      builder:^METranscoder* _Nullable (NSURL* partURL) {
+        return nil;
+    }];
+    NSError* error = nil;
+    XCTAssertTrue([session assembleMovie:source head:[NSNull null] tail:[NSNull null] middle:range
+                          copyOtherMedia:NO error:&error], @"%@", error);
+
+    AVMovie* output = [AVMovie movieWithURL:self.outputURL options:nil];
+    XCTAssertEqual([output tracksWithMediaType:AVMediaTypeVideo].count, 1u);
+    XCTAssertEqual([output tracksWithMediaType:AVMediaTypeAudio].count, 0u, @"empty audio track left in the output");
+    XCTAssertEqual(CMTimeCompare([output tracksWithMediaType:AVMediaTypeVideo].firstObject.timeRange.duration,
+                                 range.duration), 0);
+}
+
+- (void)testLeadingPicturesMarkOpenGOP {
+    // I B B per GOP in decode order; both B frames are shown before their I frame
+    METestSample samples[12];
+    for (int k = 0; k < 4; k++) {
+        samples[3 * k] = (METestSample){3 * k, 3 * k + 3, YES};
+        samples[3 * k + 1] = (METestSample){3 * k + 1, 3 * k + 1, NO};
+        samples[3 * k + 2] = (METestSample){3 * k + 2, 3 * k + 2, NO};
+    }
+    XCTAssertTrue(writeMovie(self.sourceURL, samples, 12, 0));
+    AVMovieTrack* track = [[self sourceMovie] tracksWithMediaType:AVMediaTypeVideo].firstObject;
+    XCTAssertEqual(track.segments.count, 1u);
+
+    // media pts 6 (the second I frame) is movie time 5/30 after the session start at pts 1
+    CMTime sync = [MEMovieAssembler syncTimeOfTrack:track atOrAfter:CMTimeMake(4, kTimeScale)];
+    XCTAssertEqual(CMTimeCompare(sync, CMTimeMake(5, kTimeScale)), 0);
+    XCTAssertTrue([MEMovieAssembler isOpenGOPOfTrack:track atSyncTime:sync]);
+}
+
+- (void)testClosedGOPIsNotOpen {
+    // I P B B in decode order: nothing after the I frame is shown before it
+    METestSample samples[16];
+    for (int k = 0; k < 4; k++) {
+        int64_t base = 4 * k;
+        samples[base] = (METestSample){base, base + 1, YES};
+        samples[base + 1] = (METestSample){base + 1, base + 4, NO};
+        samples[base + 2] = (METestSample){base + 2, base + 2, NO};
+        samples[base + 3] = (METestSample){base + 3, base + 3, NO};
+    }
+    XCTAssertTrue(writeMovie(self.sourceURL, samples, 16, 0));
+    AVMovieTrack* track = [[self sourceMovie] tracksWithMediaType:AVMediaTypeVideo].firstObject;
+
+    CMTime sync = [MEMovieAssembler syncTimeOfTrack:track atOrAfter:CMTimeMake(1, kTimeScale)];
+    XCTAssertEqual(CMTimeCompare(sync, CMTimeMake(4, kTimeScale)), 0);
+    XCTAssertFalse([MEMovieAssembler isOpenGOPOfTrack:track atSyncTime:sync]);
+}
+
+@end
@@ -0,0 +1,102 @@
+//  METraceTests.m
+//  movencoder2Tests
+//
+//  Tests for per-thread trace buffers and Chrome trace-event output.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+
+#import "METrace.h"
+#include <stdatomic.h>
+
+@interface METraceTests : XCTestCase
+@end
+
+@implementation METraceTests
+
+- (void)tearDown {
+    METraceStop();
+    [super tearDown];
+}
+
+- (void)testProbesAreInactiveUntilStarted {
+    METraceStop();
+    MEMetricsSetEnabled(FALSE);
+    XCTAssertEqual(MEMetricsBegin(), (uint64_t)0);
+    METraceStart();
+    XCTAssertNotEqual(MEMetricsBegin(), (uint64_t)0);
+    XCTAssertEqual(METraceEventCount(), (uint64_t)0);
+}
+
+- (void)testEventsFromSeveralThreadsAreWrittenAsTraceJSON {
+    METraceStart();
+    const int perThread = 5000;     // spans more than one chunk
+    dispatch_apply(3, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t index) {
+        for (int i = 0; i < perThread; i++) {
+            uint64_t t0 = MEMetricsBegin();
+            MEMetricsEndPTS(MEMetricsStageEncoderSend, t0, 1, 100, i / 30.0);
+        }
+    });
+    MEMetricsEnd(MEMetricsStageWriterAppend, MEMetricsBegin(), 1, 7);
+    METraceStop();
+    MEMetricsEnd(MEMetricsStageWriterAppend, MEMetricsBegin(), 1, 7);   // ignored after stop
+    XCTAssertEqual(METraceEventCount(), (uint64_t)(3 * perThread + 1));
+
+    NSURL* url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"trace.json"]];
+    NSError* error = nil;
+    XCTAssertTrue(METraceWriteToURL(url, &error));
+
+    NSData* data = [NSData dataWithContentsOfURL:url];
+    NSDictionary* document = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+    XCTAssertNotNil(document, @"%@", error);
+    NSArray<NSDictionary*>* events = document[@"traceEvents"];
+    NSPredicate* complete = [NSPredicate predicateWithFormat:@"ph == 'X'"];
+    NSArray<NSDictionary*>* spans = [events filteredArrayUsingPredicate:complete];
+    XCTAssertEqual(spans.count, (NSUInteger)(3 * perThread + 1));
+
+    NSDictionary* append = [spans filteredArrayUsingPredicate:
+                            [NSPredicate predicateWithFormat:@"name == 'writer_append'"]].firstObject;
+    XCTAssertEqualObjects(append[@"args"][@"bytes"], @7);
+    XCTAssertNil(append[@"args"][@"pts"]);
+    NSDictionary* send = [spans filteredArrayUsingPredicate:
+                          [NSPredicate predicateWithFormat:@"name == 'encoder_send'"]].firstObject;
+    XCTAssertNotNil(send[@"args"][@"pts"]);
+    XCTAssertNotNil(send[@"tid"]);
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+}
+
+- (void)testRestartWhileThreadsRecord {
+    // Start/discard while other threads record must neither crash nor lose the new trace
+    static atomic_bool running;
+    atomic_store(&running, true);
+    dispatch_group_t group = dispatch_group_create();
+    METraceStart();
+    for (int t = 0; t < 3; t++) {
+        dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+            while (atomic_load(&running)) {
+                MEMetricsEnd(MEMetricsStageEncoderSend, MEMetricsBegin(), 1, 1);
+            }
+        });
+    }
+    for (int i = 0; i < 200; i++) {
+        if (i % 2) {
+            METraceDiscard();
+        } else {
+            METraceStart();
+        }
+    }
+    METraceStart();
+    usleep(10 * 1000);
+    atomic_store(&running, false);
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    METraceStop();
+    XCTAssertGreaterThan(METraceEventCount(), (uint64_t)0);
+
+    METraceDiscard();
+    XCTAssertEqual(METraceEventCount(), (uint64_t)0);
+}
+
+@end
@@ -0,0 +1,170 @@
+//  METranscoderInterleaveTests.m
+//  movencoder2Tests
+//
+//  Transcodes an encoded video track next to a passthrough audio track under a small interleave window.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import AVFoundation;
+
+#include <libavcodec/avcodec.h>
+
+#import "METranscoder+Internal.h"
+#import "MEManager.h"
+#import "SBChannel.h"
+#import "SBChannelScheduler.h"
+
+static const int kFrames = 90;              // 3 seconds at 30 fps
+static const int kSampleRate = 48000;
+static const int kSamplesPerBuffer = 1600;  // one video frame of audio
+
+// H.264 video (160x120) and 16-bit mono LPCM audio, appended in timestamp order
+static BOOL writeSourceMovie(NSURL* url) {
+    NSError* error = nil;
+    AVAssetWriter* writer = [AVAssetWriter assetWriterWithURL:url fileType:AVFileTypeQuickTimeMovie error:&error];
+    if (!writer) return NO;
+
+    AVAssetWriterInput* video = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeVideo
+                                                                   outputSettings:@{AVVideoCodecKey: AVVideoCodecTypeH264,
+                                                                                    AVVideoWidthKey: @160,
+                                                                                    AVVideoHeightKey: @120}];
+    video.expectsMediaDataInRealTime = NO;
+    NSDictionary* pixelAttributes = @{(id)kCVPixelBufferPixelFormatTypeKey: @(kCVPixelFormatType_32BGRA),
+                                      (id)kCVPixelBufferWidthKey: @160,
+                                      (id)kCVPixelBufferHeightKey: @120};
+    AVAssetWriterInputPixelBufferAdaptor* adaptor =
+        [AVAssetWriterInputPixelBufferAdaptor assetWriterInputPixelBufferAdaptorWithAssetWriterInput:video
+                                                                         sourcePixelBufferAttributes:pixelAttributes];
+
+    AudioStreamBasicDescription asbd = {0};
+    asbd.mSampleRate = kSampleRate;
+    asbd.mFormatID = kAudioFormatLinearPCM;
+    asbd.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+    asbd.mBytesPerPacket = 2;
+    asbd.mFramesPerPacket = 1;
+    asbd.mBytesPerFrame = 2;
+    asbd.mChannelsPerFrame = 1;
+    asbd.mBitsPerChannel = 16;
+    AudioChannelLayout layout = {0};
+    layout.mChannelLayoutTag = kAudioChannelLayoutTag_Mono;
+    CMAudioFormatDescriptionRef audioDesc = NULL;
+    CMAudioFormatDescriptionCreate(kCFAllocatorDefault, &asbd, sizeof(layout), &layout, 0, NULL, NULL, &audioDesc);
+    AVAssetWriterInput* audio = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeAudio
+                                                                   outputSettings:nil
+                                                                 sourceFormatHint:audioDesc];
+    audio.expectsMediaDataInRealTime = NO;
+    if (![writer canAddInput:video] || ![writer canAddInput:audio]) {
+        CFRelease(audioDesc);
+        return NO;
+    }
+    [writer addInput:video];
+    [writer addInput:audio];
+    [writer startWriting];
+    [writer startSessionAtSourceTime:kCMTimeZero];
+
+    static int16_t pcm[kSamplesPerBuffer];
+    BOOL ok = YES;
+    for (int i = 0; i < kFrames && ok; i++) {
+        CVPixelBufferRef pb = NULL;
+        CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, adaptor.pixelBufferPool, &pb);
+        CVPixelBufferLockBaseAddress(pb, 0);
+        memset(CVPixelBufferGetBaseAddress(pb), (i * 3) & 0xFF, CVPixelBufferGetDataSize(pb));
+        CVPixelBufferUnlockBaseAddress(pb, 0);
+        while (!video.readyForMoreMediaData) {
+            usleep(1000);
+        }
+        ok = [adaptor appendPixelBuffer:pb withPresentationTime:CMTimeMake(i, 30)];
+        CVPixelBufferRelease(pb);
+
+        CMBlockBufferRef block = NULL;
+        CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, NULL, sizeof(pcm), kCFAllocatorDefault,
+                                           NULL, 0, sizeof(pcm), kCMBlockBufferAssureMemoryNowFlag, &block);
+        CMBlockBufferReplaceDataBytes(pcm, block, 0, sizeof(pcm));
+        CMSampleBufferRef sb = NULL;
+        CMAudioSampleBufferCreateReadyWithPacketDescriptions(kCFAllocatorDefault, block, audioDesc, kSamplesPerBuffer,
+                                                             CMTimeMake((int64_t)i * kSamplesPerBuffer, kSampleRate),
+                                                             NULL, &sb);
+        while (!audio.readyForMoreMediaData) {
+            usleep(1000);
+        }
+        ok = ok && [audio appendSampleBuffer:sb];
+        CFRelease(sb);
+        CFRelease(block);
+    }
+    CFRelease(audioDesc);
+    [video markAsFinished];
+    [audio markAsFinished];
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [writer finishWritingWithCompletionHandler:^{
+        dispatch_semaphore_signal(done);
+    }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    return ok && writer.status == AVAssetWriterStatusCompleted;
+}
+
+@interface METranscoderInterleaveTests : XCTestCase
+@property (nonatomic, strong) NSURL* sourceURL;
+@property (nonatomic, strong) NSURL* outputURL;
+@end
+
+@implementation METranscoderInterleaveTests
+
+- (void)setUp {
+    NSURL* tmp = NSFileManager.defaultManager.temporaryDirectory;
+    self.sourceURL = [tmp URLByAppendingPathComponent:[NSUUID.UUID.UUIDString stringByAppendingPathExtension:@"mov"]];
+    self.outputURL = [tmp URLByAppendingPathComponent:[NSUUID.UUID.UUIDString stringByAppendingPathExtension:@"mov"]];
+}
+
+- (void)tearDown {
+    [NSFileManager.defaultManager removeItemAtURL:self.sourceURL error:nil];
+    [NSFileManager.defaultManager removeItemAtURL:self.outputURL error:nil];
+}
+
+- (void)testPassthroughAudioIsNotParkedBehindEncodedVideo {
+    if (!avcodec_find_encoder_by_name("libx264")) {
+        XCTSkip(@"libx264 is not available");
+    }
+    XCTAssertTrue(writeSourceMovie(self.sourceURL));
+
+    METranscoder* transcoder = [METranscoder transcoderWithInput:self.sourceURL output:self.outputURL];
+    AVAssetTrack* track = [transcoder.inMovie tracksWithMediaType:AVMediaTypeVideo].firstObject;
+    XCTAssertNotNil(track);
+    MEManager* manager = [MEManager new];
+    manager.videoEncoderSetting = [@{kMEVECodecNameKey: @"libx264",
+                                     kMEVECodecFrameRateKey: [NSValue valueWithCMTime:CMTimeMake(1, 30)],
+                                     kMEVECodecWxHKey: [NSValue valueWithSize:NSMakeSize(160, 120)],
+                                     kMEVECodecPARKey: [NSValue valueWithSize:NSMakeSize(1, 1)],
+                                     kMEVECodecBitRateKey: @(500000),
+                                     kMEVEx264_paramsKey: @"keyint=30:bframes=2:threads=1"} mutableCopy];
+    [transcoder registerMEManager:manager forTrackID:track.trackID];
+    transcoder.param[kInterleaveWindowKey] = @(0.05);
+
+    XCTestExpectation* done = [self expectationWithDescription:@"completion"];
+    transcoder.callbackQueue = dispatch_queue_create("METranscoderInterleaveTests", DISPATCH_QUEUE_SERIAL);
+    transcoder.completionCallback = ^{
+        [done fulfill];
+    };
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [transcoder startAsync];
+    [self waitForExpectationsWithTimeout:60.0 handler:nil];
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+    XCTAssertTrue(transcoder.finalSuccess, @"%@", transcoder.finalError);
+    // Reader-fed channels are never paced, so nothing waits on the watchdog
+    for (SBChannel* sbc in transcoder.sbChannels) {
+        if ([sbc.meOutput isKindOfClass:[AVAssetReaderOutput class]]) {
+            XCTAssertNil(sbc.scheduler, @"reader-fed track %d is paced", sbc.track);
+        }
+    }
+    XCTAssertEqual(transcoder.channelScheduler.watchdogCount, (uint64_t)0);
+    XCTAssertLessThan(elapsed, 30.0);
+
+    AVMovie* output = [AVMovie movieWithURL:self.outputURL options:nil];
+    XCTAssertEqual([output tracksWithMediaType:AVMediaTypeVideo].count, 1u);
+    XCTAssertEqual([output tracksWithMediaType:AVMediaTypeAudio].count, 1u);
+}
+
+@end
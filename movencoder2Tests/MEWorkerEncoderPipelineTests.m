@@ -0,0 +1,144 @@
+//  MEWorkerEncoderPipelineTests.m
+//  movencoder2Tests
+//
+//  Kills the encoder worker mid-stream and compares the output with an in-process encode.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import Foundation;
+
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <signal.h>
+
+#import "MEEncoderPipeline.h"
+#import "MEWorkerEncoderPipeline.h"
+#import "MEManager.h"
+
+static const int kFrameCount = 90;
+static const int kKillAfterFrame = 50;                      // mid GOP with keyint 30
+
+static AVFrame* makeFrame(int index) {
+    AVFrame* frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = 64;
+    frame->height = 64;
+    frame->sample_aspect_ratio = av_make_q(1, 1);
+    frame->pts = index;
+    frame->duration = 1;
+    av_frame_get_buffer(frame, 0);
+    for (int plane = 0; plane < 3; plane++) {
+        int rows = (plane == 0) ? 64 : 32;
+        for (int y = 0; y < rows; y++) {
+            memset(frame->data[plane] + y * frame->linesize[plane], (index * 3 + y + plane * 40) & 0xFF,
+                   (size_t)frame->linesize[plane]);
+        }
+    }
+    return frame;
+}
+
+@interface MEWorkerEncoderPipelineTests : XCTestCase
+@end
+
+@implementation MEWorkerEncoderPipelineTests
+
+- (void)configure:(MEEncoderPipeline*)enc
+{
+    enc.verbose = NO;
+    enc.logLevel = AV_LOG_ERROR;
+    enc.timeBase = 30;
+    enc.videoEncoderSetting = [@{kMEVECodecNameKey: @"libx264",
+                                 kMEVEx264_paramsKey: @"keyint=30:min-keyint=30:scenecut=0:bframes=2:"
+                                                      @"rc-lookahead=5:sync-lookahead=0:threads=1"} mutableCopy];
+}
+
+- (void)drain:(MEEncoderPipeline*)enc into:(NSMutableArray<NSArray<NSNumber*>*>*)packets
+{
+    int ret = 0;
+    while ([enc receivePacketFromEncoderWithResult:&ret] && ret == 0) {
+        AVPacket* pkt = [enc encodedPacket];
+        [packets addObject:@[@(pkt->pts), @(pkt->dts)]];
+    }
+    XCTAssertTrue(ret == 0 || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF, @"receive failed: %d", ret);
+}
+
+/// pts and dts of every packet, in output order
+- (NSArray<NSArray<NSNumber*>*>*)encodeWith:(MEEncoderPipeline*)enc killAfter:(int)killAfter
+{
+    NSMutableArray<NSArray<NSNumber*>*>* packets = [NSMutableArray array];
+    AVFrame* first = makeFrame(0);
+    XCTAssertTrue([enc prepareVideoEncoderWith:NULL filteredFrame:first hasValidFilteredFrame:YES]);
+    av_frame_free(&first);
+
+    for (int i = 0; i < kFrameCount; i++) {
+        AVFrame* frame = makeFrame(i);
+        int ret = 0;
+        do {
+            XCTAssertTrue([enc sendFrameToEncoder:frame withResult:&ret], @"send failed at frame %d", i);
+            [self drain:enc into:packets];
+        } while (ret == AVERROR(EAGAIN));
+        av_frame_free(&frame);
+
+        if (i == killAfter) {
+            pid_t pid = ((MEWorkerEncoderPipeline*)enc).workerProcessIdentifier;
+            XCTAssertGreaterThan(pid, 0);
+            kill(pid, SIGKILL);
+        }
+    }
+    int ret = 0;
+    XCTAssertTrue([enc flushEncoderWithResult:&ret]);
+    for (int tries = 0; tries < 1000 && !enc.isEOF; tries++) {
+        [self drain:enc into:packets];
+    }
+    XCTAssertTrue(enc.isEOF);
+    [enc cleanup];
+    return packets;
+}
+
+- (void)testKilledWorkerResumesFromLastClosedGOP {
+    if (!avcodec_find_encoder_by_name("libx264")) {
+        XCTSkip(@"libx264 is not available");
+    }
+    // The worker is the movencoder2 tool built next to the test bundle
+    NSURL* products = [[NSBundle bundleForClass:[self class]].bundleURL URLByDeletingLastPathComponent];
+    NSString* tool = [products URLByAppendingPathComponent:@"movencoder2"].path;
+    if (![NSFileManager.defaultManager isExecutableFileAtPath:tool]) {
+        XCTSkip(@"movencoder2 executable not found next to the test bundle");
+    }
+
+    MEEncoderPipeline* reference = [[MEEncoderPipeline alloc] init];
+    [self configure:reference];
+    NSArray<NSArray<NSNumber*>*>* expected = [self encodeWith:reference killAfter:-1];
+
+    MEWorkerEncoderPipeline* worker = [[MEWorkerEncoderPipeline alloc] init];
+    [self configure:worker];
+    worker.workerExecutablePath = tool;
+    NSArray<NSArray<NSNumber*>*>* actual = [self encodeWith:worker killAfter:kKillAfterFrame];
+    XCTAssertEqual(worker.restartCount, 1u);
+
+    // Every frame exactly once, with the same time stamps as without the worker
+    NSArray* (^sortedPTS)(NSArray<NSArray<NSNumber*>*>*) = ^NSArray*(NSArray<NSArray<NSNumber*>*>* packets) {
+        NSMutableArray<NSNumber*>* pts = [NSMutableArray array];
+        for (NSArray<NSNumber*>* packet in packets) {
+            [pts addObject:packet[0]];
+        }
+        return [pts sortedArrayUsingSelector:@selector(compare:)];
+    };
+    XCTAssertEqual(actual.count, (NSUInteger)kFrameCount);
+    XCTAssertEqualObjects(sortedPTS(actual), sortedPTS(expected));
+    XCTAssertEqual(actual.count, expected.count);
+
+    // dts strictly increasing and never after pts, across the restart
+    int64_t lastDTS = INT64_MIN;
+    for (NSArray<NSNumber*>* packet in actual) {
+        int64_t pts = packet[0].longLongValue, dts = packet[1].longLongValue;
+        XCTAssertGreaterThan(dts, lastDTS);
+        XCTAssertLessThanOrEqual(dts, pts);
+        lastDTS = dts;
+    }
+}
+
+@end
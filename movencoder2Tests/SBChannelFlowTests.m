@@ -16,6 +16,7 @@
 #import "MEOutput.h"
 #import "MEManager.h"
 #import "MECommon.h"
+#import "SBPrefetchQueue.h"
 
 @interface DummyManager : MEManager
 @property (nonatomic) BOOL ready;
@@ -106,6 +107,39 @@
     XCTAssertEqualObjects(info[kProgressMediaTypeKey], AVMediaTypeAudio);
     XCTAssertEqualObjects(info[kProgressTagKey], @"audio");
     XCTAssertEqualObjects(info[kProgressTrackIDKey], @(123));
+
+    // Counters reflect the single 4-byte sample at pts 0
+    SBChannelStats stats = [ch statsSnapshot];
+    XCTAssertEqual(stats.samples, (int64_t)self.didReadCount);
+    XCTAssertEqual(stats.bytes, (int64_t)4);
+    XCTAssertEqualWithAccuracy(stats.lastPTS, 0.0, 1e-9);
+    XCTAssertEqual(ch.count, self.didReadCount);
+}
+
+- (void)testSBChannelWithPrefetchQueueDeliversAndCompletes {
+    DummyManager *manager = [[DummyManager alloc] init];
+    MEOutput *out = [MEOutput outputWithManager:manager];
+    MEInput *in = [MEInput inputWithManager:manager];
+    SBChannel *ch = [SBChannel sbChannelWithProducerME:out consumerME:in TrackID:7];
+    self.channel = ch;
+    ch.prefetchFrames = 2;
+
+    XCTestExpectation *done = [self expectationWithDescription:@"completion"];
+    [ch startWithDelegate:self completionHandler:^{ [done fulfill]; }];
+    XCTAssertNotNil(ch.prefetchQueue);
+    if (manager.requestHandler) {
+        dispatch_queue_t queue = manager.requestQueue ?: dispatch_get_main_queue();
+        dispatch_async(queue, manager.requestHandler);
+    }
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+
+    XCTAssertTrue(ch.isFinished);
+    XCTAssertEqual(self.didReadCount, 1);
+    XCTAssertEqual(manager.appendedCount, 1);
+
+    SBPrefetchStats stats = [ch.prefetchQueue stats];
+    XCTAssertEqual(stats.frames, (NSUInteger)0);
+    XCTAssertLessThanOrEqual(stats.peakFrames, (NSUInteger)2);
 }
 
 @end
@@ -0,0 +1,126 @@
+//  SBChannelSchedulerTests.m
+//  movencoder2Tests
+//
+//  Tests for timestamp-ordered pacing of writer-side SBChannels.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import AVFoundation;
+
+#import "SBChannel.h"
+#import "SBChannelScheduler.h"
+#import "MEInput.h"
+#import "MEOutput.h"
+#import "MEManager.h"
+
+@interface SBChannelSchedulerTests : XCTestCase
+@end
+
+@implementation SBChannelSchedulerTests
+
+- (SBChannel *)channelWithTrackID:(CMPersistentTrackID)trackID {
+    MEManager *manager = [MEManager new];
+    return [SBChannel sbChannelWithProducerME:[MEOutput outputWithManager:manager]
+                                   consumerME:[MEInput inputWithManager:manager]
+                                      TrackID:trackID];
+}
+
+- (void)testLeadingChannelParksUntilSlowestAdvances {
+    SBChannelScheduler *scheduler = [SBChannelScheduler schedulerWithWindow:1.0 startTime:0.0];
+    SBChannel *video = [self channelWithTrackID:1];
+    SBChannel *audio = [self channelWithTrackID:2];
+    [scheduler registerChannel:video];
+    [scheduler registerChannel:audio];
+
+    // within window: no wait
+    [scheduler waitForTurnOfChannel:audio pts:0.5];
+    [scheduler channel:audio didAppendUpTo:0.9];
+    XCTAssertEqual(scheduler.parkCount, (uint64_t)0);
+
+    // audio is ahead by more than the window; it must wait for video
+    XCTestExpectation *released = [self expectationWithDescription:@"released"];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        [scheduler waitForTurnOfChannel:audio pts:2.0];
+        [released fulfill];
+    });
+    usleep(100 * 1000);
+    XCTAssertEqual(scheduler.parkCount, (uint64_t)1);
+
+    [scheduler channel:video didAppendUpTo:1.5];
+    [self waitForExpectationsWithTimeout:0.5 handler:nil];
+    XCTAssertEqual(scheduler.watchdogCount, (uint64_t)0);
+}
+
+- (void)testSlowestChannelNeverWaits {
+    SBChannelScheduler *scheduler = [SBChannelScheduler schedulerWithWindow:0.5 startTime:0.0];
+    SBChannel *video = [self channelWithTrackID:1];
+    SBChannel *audio = [self channelWithTrackID:2];
+    [scheduler registerChannel:video];
+    [scheduler registerChannel:audio];
+    [scheduler channel:audio didAppendUpTo:0.4];
+
+    // video sits at 0.0 and jumps over a gap; it is the slowest so it proceeds
+    [scheduler waitForTurnOfChannel:video pts:5.0];
+    XCTAssertEqual(scheduler.parkCount, (uint64_t)0);
+}
+
+- (void)testWatchdogReleaseHoldsUntilAnotherChannelAdvances {
+    SBChannelScheduler *scheduler = [SBChannelScheduler schedulerWithWindow:0.5 startTime:0.0];
+    SBChannel *video = [self channelWithTrackID:1];
+    SBChannel *audio = [self channelWithTrackID:2];
+    [scheduler registerChannel:video];
+    [scheduler registerChannel:audio];
+    [scheduler channel:audio didAppendUpTo:0.4];
+
+    // video is stuck; the watchdog releases audio once
+    [scheduler waitForTurnOfChannel:audio pts:2.0];
+    XCTAssertEqual(scheduler.watchdogCount, (uint64_t)1);
+    XCTAssertEqual(scheduler.parkCount, (uint64_t)1);
+
+    // audio keeps appending without parking again while video stays put
+    for (int i = 0; i < 5; i++) {
+        [scheduler channel:audio didAppendUpTo:2.0 + i];
+        [scheduler waitForTurnOfChannel:audio pts:3.0 + i];
+    }
+    XCTAssertEqual(scheduler.parkCount, (uint64_t)1);
+    XCTAssertEqual(scheduler.watchdogCount, (uint64_t)1);
+
+    // once video advances, pacing applies to audio again
+    [scheduler channel:video didAppendUpTo:0.5];
+    XCTestExpectation *released = [self expectationWithDescription:@"released"];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        [scheduler waitForTurnOfChannel:audio pts:8.0];
+        [released fulfill];
+    });
+    usleep(100 * 1000);
+    XCTAssertEqual(scheduler.parkCount, (uint64_t)2);
+    [scheduler channel:video didAppendUpTo:7.6];
+    [self waitForExpectationsWithTimeout:0.5 handler:nil];
+    XCTAssertEqual(scheduler.watchdogCount, (uint64_t)1);
+}
+
+- (void)testFinishAndCancelReleaseParkedChannels {
+    SBChannelScheduler *scheduler = [SBChannelScheduler schedulerWithWindow:0.5 startTime:0.0];
+    SBChannel *video = [self channelWithTrackID:1];
+    SBChannel *audio = [self channelWithTrackID:2];
+    [scheduler registerChannel:video];
+    [scheduler registerChannel:audio];
+    [scheduler channel:audio didAppendUpTo:0.4];
+
+    XCTestExpectation *released = [self expectationWithDescription:@"released"];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        [scheduler waitForTurnOfChannel:audio pts:3.0];
+        [released fulfill];
+    });
+    usleep(100 * 1000);
+    [scheduler channelDidFinish:video];
+    [self waitForExpectationsWithTimeout:0.5 handler:nil];
+
+    [scheduler cancel];
+    [scheduler waitForTurnOfChannel:audio pts:100.0];
+}
+
+@end
@@ -0,0 +1,117 @@
+//  SBFanoutReaderTests.m
+//  movencoder2Tests
+//
+//  Tests for span merging and frame distribution of the shared EDL decode pass.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import AVFoundation;
+
+#import "SBFanoutReader.h"
+
+static NSValue* rangeValue(double start, double end) {
+    return [NSValue valueWithCMTimeRange:CMTimeRangeFromTimeToTime(CMTimeMake((int64_t)(start * 10), 10),
+                                                                   CMTimeMake((int64_t)(end * 10), 10))];
+}
+
+// One-second frames without data, pts 0 .. count-1
+@interface SBFakeFrameSource : NSObject
+@property (nonatomic, assign) int64_t next;
+@property (nonatomic, assign) int64_t count;
+@end
+
+@implementation SBFakeFrameSource
+
+- (AVMediaType)mediaType
+{
+    return AVMediaTypeVideo;
+}
+
+- (nullable CMSampleBufferRef)copyNextSampleBuffer CF_RETURNS_RETAINED
+{
+    if (self.next >= self.count) return NULL;
+    CMSampleTimingInfo timing = {CMTimeMake(1, 1), CMTimeMake(self.next, 1), kCMTimeInvalid};
+    self.next += 1;
+    CMSampleBufferRef sb = NULL;
+    CMSampleBufferCreate(kCFAllocatorDefault, NULL, true, NULL, NULL, NULL, 1, 1, &timing, 0, NULL, &sb);
+    return sb;
+}
+
+@end
+
+@interface SBFanoutReaderTests : XCTestCase
+@end
+
+@implementation SBFanoutReaderTests
+
+- (void)testMergedTimeRangesJoinOverlapsAndShortGaps {
+    NSArray<NSValue*>* spans = SBMergedTimeRanges(@[rangeValue(30, 40), rangeValue(2, 5), rangeValue(4, 7),
+                                                    rangeValue(7.5, 9), rangeValue(12, 12)],
+                                                  CMTimeMake(1, 1));
+    XCTAssertEqual(spans.count, 2u);
+    XCTAssertEqual(CMTimeCompare(spans[0].CMTimeRangeValue.start, CMTimeMake(2, 1)), 0);
+    XCTAssertEqual(CMTimeCompare(CMTimeRangeGetEnd(spans[0].CMTimeRangeValue), CMTimeMake(9, 1)), 0);
+    XCTAssertEqual(CMTimeCompare(spans[1].CMTimeRangeValue.start, CMTimeMake(30, 1)), 0);
+}
+
+- (void)testOverlappingBranchesShareFrames {
+    SBFakeFrameSource* source = [SBFakeFrameSource new];
+    source.count = 10;
+    NSArray<NSValue*>* ranges = @[rangeValue(4, 7), rangeValue(2, 5), rangeValue(20, 25)];
+    SBFanoutReader* reader = [SBFanoutReader fanoutReaderWithProducer:(MEOutput*)source
+                                                               ranges:ranges
+                                                            maxFrames:1
+                                                                label:@"SBFanoutReaderTests"];
+    NSMutableArray<NSMutableArray<NSNumber*>*>* received = [NSMutableArray array];
+    for (NSUInteger i = 0; i < ranges.count; i++) {
+        [received addObject:[NSMutableArray array]];
+    }
+    NSMutableArray<NSNumber*>* startOrder = [NSMutableArray array];
+    dispatch_group_t group = dispatch_group_create();
+    reader.branchStartHandler = ^(NSUInteger index, SBFanoutBranch* branch) {
+        [startOrder addObject:@(index)];
+        dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            CMSampleBufferRef sb = NULL;
+            while ((sb = [branch copyNextSampleBuffer])) {
+                [received[index] addObject:@(CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sb)))];
+                CFRelease(sb);
+            }
+        });
+    };
+    dispatch_group_enter(group);
+    [reader startWithCompletionHandler:^{
+        dispatch_group_leave(group);
+    }];
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+
+    XCTAssertEqualObjects(startOrder, (@[@1, @0, @2]));
+    XCTAssertEqualObjects(received[0], (@[@4, @5, @6]));
+    XCTAssertEqualObjects(received[1], (@[@2, @3, @4]));
+    XCTAssertEqual(received[2].count, 0u);
+    XCTAssertEqual(reader.framesRead, 10u);
+    XCTAssertEqual(reader.framesDelivered, 6u);
+}
+
+- (void)testCancelledBranchDoesNotStallReader {
+    SBFakeFrameSource* source = [SBFakeFrameSource new];
+    source.count = 10;
+    SBFanoutReader* reader = [SBFanoutReader fanoutReaderWithProducer:(MEOutput*)source
+                                                               ranges:@[rangeValue(0, 10)]
+                                                            maxFrames:1
+                                                                label:@"SBFanoutReaderTests"];
+    reader.branchStartHandler = ^(NSUInteger index, SBFanoutBranch* branch) {
+        [branch cancel]; // never consumed
+    };
+    XCTestExpectation* done = [self expectationWithDescription:@"reader finished"];
+    [reader startWithCompletionHandler:^{
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqual(reader.framesRead, 10u);
+    XCTAssertEqual(reader.framesDelivered, 0u);
+}
+
+@end
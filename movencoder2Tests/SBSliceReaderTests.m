@@ -0,0 +1,118 @@
+//  SBSliceReaderTests.m
+//  movencoder2Tests
+//
+//  Tests for the intra-only check and the chunk merge of sliced decode.
+//
+//  Copyright (C) 2026 MyCometG3
+//  SPDX-License-Identifier: GPL-2.0-or-later
+//
+
+@import XCTest;
+@import AVFoundation;
+
+#import "SBSliceReader.h"
+
+static const int32_t kTimeScale = 30;
+
+// JPEG samples without valid data at 1/30 s each; only the sample table matters when read without decoding
+static BOOL writeMovie(NSURL* url, int frames, int nonSyncFrame) {
+    NSError* error = nil;
+    AVAssetWriter* writer = [AVAssetWriter assetWriterWithURL:url fileType:AVFileTypeQuickTimeMovie error:&error];
+    CMFormatDescriptionRef desc = NULL;
+    CMVideoFormatDescriptionCreate(kCFAllocatorDefault, kCMVideoCodecType_JPEG, 64, 64, NULL, &desc);
+    AVAssetWriterInput* input = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeVideo
+                                                                   outputSettings:nil
+                                                                 sourceFormatHint:desc];
+    input.expectsMediaDataInRealTime = NO;
+    if (!writer || ![writer canAddInput:input]) {
+        CFRelease(desc);
+        return NO;
+    }
+    [writer addInput:input];
+    [writer startWriting];
+    [writer startSessionAtSourceTime:kCMTimeZero];
+
+    static uint8_t payload[64];
+    for (int i = 0; i < frames; i++) {
+        CMBlockBufferRef block = NULL;
+        CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, NULL, sizeof(payload), kCFAllocatorDefault,
+                                           NULL, 0, sizeof(payload), kCMBlockBufferAssureMemoryNowFlag, &block);
+        CMBlockBufferReplaceDataBytes(payload, block, 0, sizeof(payload));
+        CMSampleTimingInfo timing = {CMTimeMake(1, kTimeScale), CMTimeMake(i, kTimeScale), kCMTimeInvalid};
+        size_t size = sizeof(payload);
+        CMSampleBufferRef sb = NULL;
+        CMSampleBufferCreateReady(kCFAllocatorDefault, block, desc, 1, 1, &timing, 1, &size, &sb);
+        if (i == nonSyncFrame) {
+            CFArrayRef attachments = CMSampleBufferGetSampleAttachmentsArray(sb, true);
+            CFMutableDictionaryRef dict = (CFMutableDictionaryRef)CFArrayGetValueAtIndex(attachments, 0);
+            CFDictionarySetValue(dict, kCMSampleAttachmentKey_NotSync, kCFBooleanTrue);
+        }
+        while (!input.readyForMoreMediaData) {
+            usleep(1000);
+        }
+        BOOL appended = [input appendSampleBuffer:sb];
+        CFRelease(sb);
+        CFRelease(block);
+        if (!appended) break;
+    }
+    CFRelease(desc);
+    [input markAsFinished];
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [writer finishWritingWithCompletionHandler:^{
+        dispatch_semaphore_signal(done);
+    }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    return writer.status == AVAssetWriterStatusCompleted;
+}
+
+@interface SBSliceReaderTests : XCTestCase
+@property (nonatomic, strong) NSURL* fileURL;
+@end
+
+@implementation SBSliceReaderTests
+
+- (void)setUp {
+    NSString* name = [NSUUID.UUID.UUIDString stringByAppendingPathExtension:@"mov"];
+    self.fileURL = [NSFileManager.defaultManager.temporaryDirectory URLByAppendingPathComponent:name];
+}
+
+- (void)tearDown {
+    [NSFileManager.defaultManager removeItemAtURL:self.fileURL error:nil];
+}
+
+- (AVAssetTrack*)videoTrack {
+    AVMovie* movie = [AVMovie movieWithURL:self.fileURL options:nil];
+    return [movie tracksWithMediaType:AVMediaTypeVideo].firstObject;
+}
+
+- (void)testLateNonSyncSampleIsNotIntraOnly {
+    XCTAssertTrue(writeMovie(self.fileURL, 120, 100));
+    XCTAssertFalse([SBSliceReader isIntraOnlyTrack:[self videoTrack]]);
+}
+
+- (void)testMergedChunksAreInOrderWithoutDuplicatesOrGaps {
+    const int frames = 90;
+    XCTAssertTrue(writeMovie(self.fileURL, frames, -1));
+    AVAssetTrack* track = [self videoTrack];
+    XCTAssertTrue([SBSliceReader isIntraOnlyTrack:track]);
+
+    // 3 readers over chunks of 4 frames; nil output settings pass the samples through
+    CMTimeRange range = CMTimeRangeMake(kCMTimeZero, CMTimeMake(frames, kTimeScale));
+    SBSliceReader* reader = [SBSliceReader sliceReaderWithTrack:track outputSettings:nil timeRange:range
+                                                        readers:3 chunkFrames:4 maxBytes:0];
+    XCTAssertEqual(reader.readerCount, 3u);
+
+    int64_t expected = 0;
+    CMSampleBufferRef sb = NULL;
+    while ((sb = [reader copyNextSampleBuffer])) {
+        CMTime pts = CMTimeConvertScale(CMSampleBufferGetPresentationTimeStamp(sb), kTimeScale,
+                                        kCMTimeRoundingMethod_RoundHalfAwayFromZero);
+        CFRelease(sb);
+        XCTAssertEqual(pts.value, expected, @"frame %lld out of order", expected);
+        expected = pts.value + 1;
+    }
+    XCTAssertNil(reader.error);
+    XCTAssertEqual(expected, (int64_t)frames);
+}
+
+@end